@@ -78,8 +78,7 @@ void mpz_set_64(mpz_t dest, uint64 src)
 {
 
 #if GMP_LIMB_BITS == 64
-	dest->_mp_d[0] = src;
-	dest->_mp_size = (src ? 1 : 0);
+	mpz_set_ui(dest, src);
 #else
 	/* mpz_import is terribly slow */
 	mpz_set_ui(dest, (uint32)(src >> 32));
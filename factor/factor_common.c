@@ -232,6 +232,7 @@ void init_factobj(fact_obj_t *fobj)
 	// an external binary
 	strcpy(fobj->ecm_obj.ecm_path,"");
 	fobj->ecm_obj.use_external = 0;
+	fobj->ecm_obj.use_pipe = 0;
 	fobj->ecm_obj.ecm_ext_xover = 40000;
 
 	// initialize stuff for squfof
@@ -244,6 +245,12 @@ void init_factobj(fact_obj_t *fobj)
 	fobj->qs_obj.gbl_override_blocks = 0 ;
 	fobj->qs_obj.gbl_override_lpmult_flag = 0;
 	fobj->qs_obj.gbl_override_lpmult = 0;
+	fobj->qs_obj.gbl_override_la_density_flag = 0;
+	fobj->qs_obj.gbl_override_la_density = 0;
+	fobj->qs_obj.gbl_override_poly_batch_flag = 0;
+	fobj->qs_obj.gbl_override_poly_batch = 0;
+	fobj->qs_obj.gbl_override_tfsmall_flag = 0;
+	fobj->qs_obj.gbl_override_tfsmall = 0;
 	fobj->qs_obj.gbl_override_rel_flag = 0;
 	fobj->qs_obj.gbl_override_rel = 0;
 	fobj->qs_obj.gbl_override_tf_flag = 0;
@@ -252,11 +259,16 @@ void init_factobj(fact_obj_t *fobj)
 	fobj->qs_obj.gbl_override_time = 0;
 	fobj->qs_obj.flags = 0;
 	fobj->qs_obj.gbl_force_DLP = 0;
+	fobj->qs_obj.gbl_force_TLP = 0;
 	fobj->qs_obj.qs_exponent = 0;
 	fobj->qs_obj.qs_multiplier = 0;
 	fobj->qs_obj.qs_tune_freq = 0;
 	fobj->qs_obj.no_small_cutoff_opt = 0;
 	strcpy(fobj->qs_obj.siqs_savefile,"siqs.dat");
+	fobj->qs_obj.binary_savefile = 0;
+	fobj->qs_obj.siqs_convert_file[0] = '\0';
+	fobj->qs_obj.prof = 0;
+	strcpy(fobj->qs_obj.prof_file, QS_PROF_FILE);
 	init_lehman();
 
 	// initialize stuff for trial division	
@@ -2319,11 +2331,7 @@ void factor(fact_obj_t *fobj)
 	fact_state = state_trialdiv;
 
 	//check to see if a siqs savefile exists for this input	
-	data = fopen(fobj->qs_obj.siqs_savefile,"r");
-
-	if (data != NULL)
 	{	
-		char *substr;
 		mpz_t tmpz;
 		mpz_t g;
 
@@ -2331,11 +2339,8 @@ void factor(fact_obj_t *fobj)
 		mpz_init(tmpz);
 		mpz_init(g);
 
-		fgets(tmpstr,1024,data);
-		substr = tmpstr + 2;
-		mpz_set_str(tmpz, substr, 0);	//auto detect the base
-
-		if (resume_check_input_match(tmpz, b, g))
+		if (qs_savefile_read_n(fobj->qs_obj.siqs_savefile, tmpz) &&
+			resume_check_input_match(tmpz, b, g))
 		{
 			if (VFLAG > 0)
 				printf("fac: found siqs savefile, resuming siqs\n");
@@ -2356,7 +2361,6 @@ void factor(fact_obj_t *fobj)
 		}
 		mpz_clear(tmpz);
 		mpz_clear(g);
-		fclose(data);
 	}
 
 	//check to see if a nfs job file exists for this input	
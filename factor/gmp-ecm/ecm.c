@@ -24,6 +24,13 @@ code to the public domain.
 #include "calc.h"
 #include "yafu_string.h"
 
+#if defined(WIN32) || defined(_WIN64)
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <sys/wait.h>
+#endif
+
 int ecm_loop(fact_obj_t *fobj)
 {
 	//expects the input in ecm_obj->gmp_n
@@ -46,6 +53,7 @@ int ecm_loop(fact_obj_t *fobj)
 	int total_curves_run;
 	int bail_on_factor = 1;
 	int bail = 0;
+	int ext_failed = 0;
 	int input_digits = gmp_base10(fobj->ecm_obj.gmp_n);
 
 	if (ecm_check_input(fobj) == 0)
@@ -125,6 +133,19 @@ int ecm_loop(fact_obj_t *fobj)
 		{
 			ecm_get_sigma(&thread_data[i]);
 
+			//(re)start this thread's external ecm process if needed.  this 
+			//is only done here, by the master, so that no two processes are 
+			//ever being started at once
+			if (fobj->ecm_obj.use_external && fobj->ecm_obj.use_pipe)
+			{
+				if (thread_data[i].ext_running &&
+					(mpz_cmp(thread_data[i].ext_n, fobj->ecm_obj.gmp_n) != 0))
+					ecm_ext_stop(&thread_data[i]);
+
+				if (!thread_data[i].ext_running)
+					ecm_ext_start(&thread_data[i]);
+			}
+
 			if (i == THREADS - 1) {
 				ecm_do_one_curve(&thread_data[i]);
 			}
@@ -191,12 +212,31 @@ int ecm_loop(fact_obj_t *fobj)
 				}
 			}
 
-			thread_data[i].curves_run++;
+			//a curve the external process never ran is not counted
+			if (thread_data[i].ext_failed)
+				ext_failed = 1;
+			else
+				thread_data[i].curves_run++;
 		}
 
 		if (bail)
 			goto done;
 
+		if (ext_failed)
+		{
+			//most likely a bad ecm_path, and every other curve would fail
+			//too.  stop this run and leave the rest to the built-in ecm, 
+			//so that the caller doesn't just try again with the same path
+			if (!ECM_ABORT)
+			{
+				printf("\nexternal ecm %s did not run its curves; "
+					"using the built-in ecm from now on\n", fobj->ecm_obj.ecm_path);
+				fobj->ecm_obj.ecm_path[0] = '\0';
+				fobj->ecm_obj.use_external = 0;
+			}
+			goto done;
+		}
+
 		if (VFLAG >= 0)
 		{
 			for (i=0, total_curves_run=0; i<THREADS; i++)
@@ -590,6 +630,10 @@ void ecm_thread_init(ecm_thread_data_t *tdata)
 	mpz_set(tdata->gmp_n, tdata->fobj->ecm_obj.gmp_n);
 	tdata->params->method = ECM_ECM;
 	tdata->curves_run = 0;
+	tdata->ext_running = 0;
+	tdata->ext_have_line = 0;
+	tdata->ext_failed = 0;
+	mpz_init(tdata->ext_n);
 		
 	return;
 }
@@ -600,6 +644,10 @@ void ecm_thread_free(ecm_thread_data_t *tdata)
 	mpz_clear(tdata->gmp_n);
 	mpz_clear(tdata->gmp_factor);
 
+	if (tdata->ext_running)
+		ecm_ext_stop(tdata);
+	mpz_clear(tdata->ext_n);
+
 	if (tdata->fobj->ecm_obj.use_external)
 	{
 		// remove temp file specific to this thread num
@@ -659,6 +707,11 @@ void *ecm_do_one_curve(void *ptr)
 		//the return value is the stage the factor was found in, if no error
 		thread_data->stagefound = status;
 	}
+	else if (fobj->ecm_obj.use_pipe)
+	{
+		// the process for this thread was started by the master
+		thread_data->ext_failed = !ecm_ext_curve(thread_data);
+	}
 	else
 	{
 		char *cmd;
@@ -731,6 +784,311 @@ void *ecm_do_one_curve(void *ptr)
 	return 0;
 }
 
+int ecm_ext_start(ecm_thread_data_t *tdata)
+{
+	//start an external ecm process which will run all of the remaining
+	//curves for this thread on the current input, in one go.  the input
+	//is written to its stdin, and its stdout is read back a curve at a
+	//time by ecm_ext_curve.
+	fact_obj_t *fobj = tdata->fobj;
+	char *cmd;
+	char *nstr = NULL;
+	int curves = fobj->ecm_obj.num_curves / THREADS - tdata->curves_run;
+
+	if (curves < 1)
+		curves = 1;
+
+	nstr = mpz_get_str(nstr, 10, fobj->ecm_obj.gmp_n);
+	cmd = (char *)malloc((strlen(fobj->ecm_obj.ecm_path) + 256) * sizeof(char));
+
+	// a fixed sigma is passed on, otherwise ecm picks its own and we
+	// read back the one used on each curve
+#if defined(WIN32) || defined(_WIN64)
+	if (fobj->ecm_obj.sigma != 0)
+		sprintf(cmd, "%s -c %d -sigma %u %u", fobj->ecm_obj.ecm_path, curves,
+			fobj->ecm_obj.sigma, fobj->ecm_obj.B1);
+	else
+		sprintf(cmd, "%s -c %d %u", fobj->ecm_obj.ecm_path, curves, fobj->ecm_obj.B1);
+
+	{
+		SECURITY_ATTRIBUTES sa;
+		STARTUPINFO si;
+		PROCESS_INFORMATION pi;
+		HANDLE in_rd, in_wr, out_rd, out_wr;
+		DWORD written;
+
+		sa.nLength = sizeof(SECURITY_ATTRIBUTES);
+		sa.lpSecurityDescriptor = NULL;
+		sa.bInheritHandle = TRUE;
+
+		if (!CreatePipe(&in_rd, &in_wr, &sa, 0) ||
+			!CreatePipe(&out_rd, &out_wr, &sa, 0))
+		{
+			printf("could not create pipes to external ecm\n");
+			free(nstr);
+			free(cmd);
+			return 0;
+		}
+
+		// only the child's ends should be inherited
+		SetHandleInformation(in_wr, HANDLE_FLAG_INHERIT, 0);
+		SetHandleInformation(out_rd, HANDLE_FLAG_INHERIT, 0);
+
+		ZeroMemory(&si, sizeof(STARTUPINFO));
+		si.cb = sizeof(STARTUPINFO);
+		si.dwFlags = STARTF_USESTDHANDLES;
+		si.hStdInput = in_rd;
+		si.hStdOutput = out_wr;
+		si.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+
+		if (!CreateProcess(NULL, cmd, NULL, NULL, TRUE, 0, NULL, NULL, &si, &pi))
+		{
+			printf("could not start %s\n", fobj->ecm_obj.ecm_path);
+			CloseHandle(in_rd);
+			CloseHandle(in_wr);
+			CloseHandle(out_rd);
+			CloseHandle(out_wr);
+			free(nstr);
+			free(cmd);
+			return 0;
+		}
+
+		CloseHandle(pi.hThread);
+		CloseHandle(in_rd);
+		CloseHandle(out_wr);
+
+		// ecm exits once the curves are done and it reaches the end of its 
+		// input.  the write fails if it has already exited
+		if (!WriteFile(in_wr, nstr, (DWORD)strlen(nstr), &written, NULL) ||
+			!WriteFile(in_wr, "\n", 1, &written, NULL))
+		{
+			printf("could not send input to %s\n", fobj->ecm_obj.ecm_path);
+			CloseHandle(in_wr);
+			TerminateProcess(pi.hProcess, 0);
+			WaitForSingleObject(pi.hProcess, INFINITE);
+			CloseHandle(pi.hProcess);
+			CloseHandle(out_rd);
+			free(nstr);
+			free(cmd);
+			return 0;
+		}
+		CloseHandle(in_wr);
+
+		tdata->ext_process = pi.hProcess;
+		tdata->ext_out = _fdopen(_open_osfhandle((intptr_t)out_rd, _O_RDONLY), "r");
+	}
+#else
+	if (fobj->ecm_obj.sigma != 0)
+		sprintf(cmd, "exec %s -c %d -sigma %u %u", fobj->ecm_obj.ecm_path, curves,
+			fobj->ecm_obj.sigma, fobj->ecm_obj.B1);
+	else
+		sprintf(cmd, "exec %s -c %d %u", fobj->ecm_obj.ecm_path, curves, fobj->ecm_obj.B1);
+
+	{
+		int to_ecm[2], from_ecm[2];
+		pid_t pid;
+
+		if (pipe(to_ecm) != 0)
+		{
+			printf("could not create pipes to external ecm: %s\n", strerror(errno));
+			free(nstr);
+			free(cmd);
+			return 0;
+		}
+
+		if (pipe(from_ecm) != 0)
+		{
+			printf("could not create pipes to external ecm: %s\n", strerror(errno));
+			close(to_ecm[0]);
+			close(to_ecm[1]);
+			free(nstr);
+			free(cmd);
+			return 0;
+		}
+
+		pid = fork();
+		if (pid < 0)
+		{
+			printf("could not start %s: %s\n", fobj->ecm_obj.ecm_path, strerror(errno));
+			close(to_ecm[0]);
+			close(to_ecm[1]);
+			close(from_ecm[0]);
+			close(from_ecm[1]);
+			free(nstr);
+			free(cmd);
+			return 0;
+		}
+
+		if (pid == 0)
+		{
+			long fd, maxfd = sysconf(_SC_OPEN_MAX);
+
+			dup2(to_ecm[0], 0);
+			dup2(from_ecm[1], 1);
+
+			// drop every other descriptor, in particular the pipes to
+			// the other threads' processes, so that each process sees
+			// the end of its input (and we see the end of its output)
+			// as soon as its owner is done with it
+			if ((maxfd < 0) || (maxfd > 65536))
+				maxfd = 65536;
+			for (fd = 3; fd < maxfd; fd++)
+				close((int)fd);
+
+			// exec the shell (and through it ecm) the same way system() would
+			execl("/bin/sh", "sh", "-c", cmd, (char *)NULL);
+			_exit(127);
+		}
+
+		close(to_ecm[0]);
+		close(from_ecm[1]);
+
+		// ecm exits once the curves are done and it reaches the end of its 
+		// input.  if it has already exited (a bad ecm_path, say) the write
+		// raises SIGPIPE, which would kill us, so hold the signal off and 
+		// look at the error instead.
+		{
+			sigset_t pipe_set, old_set, pending;
+			int sig, ok;
+
+			sigemptyset(&pipe_set);
+			sigaddset(&pipe_set, SIGPIPE);
+			pthread_sigmask(SIG_BLOCK, &pipe_set, &old_set);
+
+			ok = (write(to_ecm[1], nstr, strlen(nstr)) >= 0) &&
+				(write(to_ecm[1], "\n", 1) >= 0);
+			if (!ok)
+				printf("could not send input to %s: %s\n", 
+					fobj->ecm_obj.ecm_path, strerror(errno));
+
+			// drop the SIGPIPE we caused before unblocking it
+			sigpending(&pending);
+			if (sigismember(&pending, SIGPIPE) && !sigismember(&old_set, SIGPIPE))
+				sigwait(&pipe_set, &sig);
+			pthread_sigmask(SIG_SETMASK, &old_set, NULL);
+
+			close(to_ecm[1]);
+			if (!ok)
+			{
+				kill(pid, SIGTERM);
+				close(from_ecm[0]);
+				waitpid(pid, NULL, 0);
+				free(nstr);
+				free(cmd);
+				return 0;
+			}
+		}
+
+		tdata->ext_pid = pid;
+		tdata->ext_out = fdopen(from_ecm[0], "r");
+	}
+#endif
+
+	free(nstr);
+	free(cmd);
+
+	mpz_set(tdata->ext_n, fobj->ecm_obj.gmp_n);
+	tdata->ext_have_line = 0;
+	tdata->ext_running = 1;
+
+	return 1;
+}
+
+void ecm_ext_stop(ecm_thread_data_t *tdata)
+{
+	//stop the external process, whether or not it has finished
+	//its curves
+#if defined(WIN32) || defined(_WIN64)
+	TerminateProcess(tdata->ext_process, 0);
+	fclose(tdata->ext_out);
+	WaitForSingleObject(tdata->ext_process, INFINITE);
+	CloseHandle(tdata->ext_process);
+#else
+	kill(tdata->ext_pid, SIGTERM);
+	fclose(tdata->ext_out);
+	waitpid(tdata->ext_pid, NULL, 0);
+#endif
+
+	tdata->ext_running = 0;
+	tdata->ext_have_line = 0;
+	return;
+}
+
+int ecm_ext_curve(ecm_thread_data_t *tdata)
+{
+	//read the output of the external process for one curve.  a curve's
+	//output starts with a "Using B1=" line, which also gives its sigma,
+	//and runs until the next curve's "Using B1=" line (kept for the next
+	//call), the end of the output, or a factor.  A factor found in
+	//stage 2 is reported after the stage 2 timing, so the timing lines
+	//can't be used to spot the end of a curve.  Returns 0 if the
+	//process is not running or ends before the curve starts.
+	int started = 0;
+	char *ptr;
+
+	mpz_set_ui(tdata->gmp_factor, 0);
+
+	if (!tdata->ext_running)
+		return 0;
+
+	while (1)
+	{
+		if (!tdata->ext_have_line)
+		{
+			if (fgets(tdata->ext_line, 1024, tdata->ext_out) == NULL)
+			{
+				// the process is done, or died.  if it died before
+				// starting this curve, the curve was never run.
+				if (!started && (VFLAG > 0) && !ECM_ABORT)
+					printf("\nexternal ecm process ended unexpectedly\n");
+
+				ecm_ext_stop(tdata);
+				break;
+			}
+		}
+		tdata->ext_have_line = 0;
+
+		if (strstr(tdata->ext_line, "Using B1=") != NULL)
+		{
+			if (started)
+			{
+				// the next curve has begun
+				tdata->ext_have_line = 1;
+				break;
+			}
+			started = 1;
+
+			// newer versions of ecm report sigma as param:sigma
+			ptr = strstr(tdata->ext_line, "sigma=");
+			if (ptr != NULL)
+			{
+				ptr += 6;
+				if (strchr(ptr, ':') != NULL)
+					ptr = strchr(ptr, ':') + 1;
+				tdata->sigma = (uint32)strtoul(ptr, NULL, 10);
+			}
+			continue;
+		}
+
+		ptr = strstr(tdata->ext_line, "**********");
+		if (ptr == NULL)
+			continue;
+
+		// found a factor.  search for the :
+		ptr = strstr(tdata->ext_line, ":");
+		if (ptr == NULL)
+			continue;
+
+		// the character prior to this is the stage, and the rest of the line
+		// after it is the factor
+		sscanf(ptr-2,"%d",&tdata->stagefound);
+		mpz_set_str(tdata->gmp_factor, ptr+1, 10);
+		break;
+	}
+
+	return started;
+}
+
 // function definitions
 void ecmexit(int sig)
 {
@@ -377,6 +377,11 @@ void nfs(fact_obj_t *fobj)
 				logprint_oc(fobj->flogname, "a", "nfs: raising min_rels by %1.2f percent to %u\n", 
 					100*(fobj->nfs_obj.filter_min_rels_nudge-1), job.min_rels);
 
+				// and have the background filter ask for more before it
+				// sends us here again
+				if (job.bgfilt != NULL)
+					nfs_bgfilt_retry(job.bgfilt, fobj->nfs_obj.filter_min_rels_nudge);
+
 				nfs_state = NFS_STATE_SIEVE;
 			}
 
@@ -550,6 +555,7 @@ void nfs(fact_obj_t *fobj)
 			sprintf(tmpstr, "%s.lp",fobj->nfs_obj.outputfile);	remove(tmpstr);
 			sprintf(tmpstr, "%s.d",fobj->nfs_obj.outputfile);	remove(tmpstr);
 			sprintf(tmpstr, "%s.mat.chk",fobj->nfs_obj.outputfile);	remove(tmpstr);
+			sprintf(tmpstr, "%s%s",fobj->nfs_obj.outputfile, NFS_QRANGE_EXT);	remove(tmpstr);
 
 			gettimeofday(&stop, NULL);
 
@@ -574,7 +580,37 @@ void nfs(fact_obj_t *fobj)
 			break;
 
 		case NFS_STATE_FILTCHECK:
-			if (job.current_rels >= job.min_rels)
+			if ((job.bgfilt != NULL) && job.bgfilt->ready)
+			{
+				if (VFLAG > 0)
+					printf("nfs: found %u relations, background filter expects a matrix, "
+					"proceeding with filtering ...\n", job.current_rels);
+
+				nfs_state = NFS_STATE_FILTER;
+			}
+			else if ((job.current_rels >= job.min_rels) && (job.bgfilt != NULL) &&
+				(job.bgfilt->est_rels > 0) && (job.bgfilt->est_rels <= job.bgfilt->est_ideals) &&
+				((fobj->nfs_obj.nfs_phases == NFS_DEFAULT_PHASES) ||
+				(fobj->nfs_obj.nfs_phases & NFS_PHASE_SIEVE)) &&
+				!(fobj->nfs_obj.nfs_phases & NFS_DONE_SIEVING))
+			{
+				// the background filter can already see that there are fewer
+				// relations than large ideals, so filtering would fail.  skip it
+				// and raise min_rels as if it had.
+				job.min_rels = job.current_rels * fobj->nfs_obj.filter_min_rels_nudge;
+
+				if (VFLAG > 0)
+					printf("nfs: found %u relations, but only %u remain for %u large ideals "
+					"after singleton removal, raising min_rels to %u and continuing with sieving ...\n",
+					job.current_rels, job.bgfilt->est_rels, job.bgfilt->est_ideals, job.min_rels);
+
+				logprint_oc(fobj->flogname, "a", "nfs: background filter: %u relations "
+					"for %u large ideals, raising min_rels to %u\n", 
+					job.bgfilt->est_rels, job.bgfilt->est_ideals, job.min_rels);
+
+				nfs_state = NFS_STATE_SIEVE;
+			}
+			else if (job.current_rels >= job.min_rels)
 			{
 				if (VFLAG > 0)
 					printf("nfs: found %u relations, need at least %u, proceeding with filtering ...\n",
@@ -628,6 +664,9 @@ void nfs(fact_obj_t *fobj)
 
 			nfs_state = NFS_STATE_POLY;		
 
+			// completed special-q ranges of some earlier job don't apply
+			sprintf(tmpstr, "%s%s",fobj->nfs_obj.outputfile, NFS_QRANGE_EXT);	remove(tmpstr);
+
 			// create a new directory for this job 
 //#ifdef _WIN32
 //			sprintf(tmpstr, "%s\%s", fobj->nfs_obj.ggnfs_dir, 
@@ -860,6 +899,9 @@ void nfs(fact_obj_t *fobj)
 		msieve_obj_free(obj);
 	free(input);
 	
+	nfs_bgfilt_stop(job.bgfilt);
+	nfs_relset_free(job.relset);
+
 	if( job.snfs )
 	{
 		snfs_clear(job.snfs);
@@ -0,0 +1,624 @@
+/*----------------------------------------------------------------------
+This source distribution is placed in the public domain by its author,
+Ben Buhrow. You may use it for any purpose, free of charge,
+without having to notify anyone. I disclaim any responsibility for any
+errors.
+
+Optionally, please be nice and tell me if you find this source to be
+useful. Again optionally, if you add to the functionality present here
+please consider making those additions public too, so that others may
+benefit from your work.
+
+       				   --bbuhrow@gmail.com 12/6/2012
+----------------------------------------------------------------------*/
+
+#include "nfs.h"
+
+#ifdef USE_NFS
+
+// background filtering: estimate, while sieving, whether msieve's
+// filtering would be able to build a matrix.  The estimate only looks at
+// large ideals (primes above the factor base limits), just as msieve's
+// singleton removal only looks at ideals above filtmin, and says yes once
+// the relations left after singleton removal outnumber the large ideals
+// left by more than the number of small ideals.  No duplicate or clique
+// removal is done beyond the (a,b) duplicates dropped by the master.
+
+#if defined(WIN32) || defined(_WIN64)
+DWORD WINAPI bgfilt_thread_main(LPVOID thread_data);
+#else
+void *bgfilt_thread_main(void *thread_data);
+#endif
+
+static void *bgfilt_grow(void *list, size_t *alloc, const char *what)
+{
+	// double a list of uint32, which is indexed with 32 bit offsets.  
+	// refuse to go past what those, or size_t, can address.
+	size_t n = 2 * *alloc;
+
+	if ((n / 2 != *alloc) || ((uint64)n > 0xffffffff) || 
+		(n > ((size_t)-1) / sizeof(uint32)))
+	{
+		printf("background filter %s is too large to grow\n", what);
+		exit(-1);
+	}
+
+	list = realloc(list, n * sizeof(uint32));
+	if (list == NULL)
+	{
+		printf("couldn't grow background filter %s\n", what);
+		exit(-1);
+	}
+
+	*alloc = n;
+	return list;
+}
+
+static double approx_pi(double x)
+{
+	if (x < 3)
+		return 1;
+	return x / log(x) * (1 + 1.2762 / log(x));
+}
+
+static uint64 mulmod64(uint64 a, uint64 b, uint64 p)
+{
+	uint64 r = 0;
+
+	if (p < ((uint64)1 << 32))
+		return (a * b) % p;
+
+	// large primes with more than 32 bits are rare, so do these the slow way
+	while (b > 0)
+	{
+		if (b & 1)
+		{
+			r += a;
+			if (r >= p)
+				r -= p;
+		}
+		a += a;
+		if (a >= p)
+			a -= p;
+		b >>= 1;
+	}
+	return r;
+}
+
+static uint64 modinv64(uint64 a, uint64 p)
+{
+	int64 t = 0, newt = 1;
+	uint64 r = p, newr = a;
+
+	while (newr != 0)
+	{
+		uint64 q = r / newr;
+		int64 tmp;
+		uint64 utmp;
+
+		tmp = t - (int64)q * newt;
+		t = newt;
+		newt = tmp;
+
+		utmp = r - q * newr;
+		r = newr;
+		newr = utmp;
+	}
+
+	if (t < 0)
+		t += (int64)p;
+	return (uint64)t;
+}
+
+static uint32 bgfilt_ideal_id(nfs_bgfilt_t *filt, uint64 key)
+{
+	// look up the id of an ideal, adding it if it's new
+	uint64 mask;
+	uint64 i;
+
+	if (filt->num_ideals >= ((uint64)7 << filt->ideal_bits) / 10)
+	{
+		uint64 *oldkeys = filt->ideal_keys;
+		uint32 *oldids = filt->ideal_ids;
+		uint64 oldsize = (uint64)1 << filt->ideal_bits;
+
+		filt->ideal_bits++;
+		filt->ideal_keys = (uint64 *)calloc((size_t)1 << filt->ideal_bits, sizeof(uint64));
+		filt->ideal_ids = (uint32 *)malloc(((size_t)1 << filt->ideal_bits) * sizeof(uint32));
+		if ((filt->ideal_keys == NULL) || (filt->ideal_ids == NULL))
+		{
+			printf("couldn't grow ideal map to 2^%u entries\n", filt->ideal_bits);
+			exit(-1);
+		}
+
+		mask = ((uint64)1 << filt->ideal_bits) - 1;
+		for (i = 0; i < oldsize; i++)
+		{
+			uint64 j;
+
+			if (oldkeys[i] == 0)
+				continue;
+
+			j = oldkeys[i] & mask;
+			while (filt->ideal_keys[j] != 0)
+				j = (j + 1) & mask;
+			filt->ideal_keys[j] = oldkeys[i];
+			filt->ideal_ids[j] = oldids[i];
+		}
+		free(oldkeys);
+		free(oldids);
+	}
+
+	mask = ((uint64)1 << filt->ideal_bits) - 1;
+	i = key & mask;
+	while (filt->ideal_keys[i] != 0)
+	{
+		if (filt->ideal_keys[i] == key)
+			return filt->ideal_ids[i];
+		i = (i + 1) & mask;
+	}
+
+	filt->ideal_keys[i] = key;
+	filt->ideal_ids[i] = filt->num_ideals;
+	return filt->num_ideals++;
+}
+
+static uint64 bgfilt_ideal_key(int side, uint64 p, uint64 r)
+{
+	// ideals are known by a 64 bit hash of (side, p, r)
+	uint64 h = p * 0x9E3779B97F4A7C15ULL + r * 0xC2B2AE3D27D4EB4FULL + side;
+
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+
+	if (h == 0)
+		h = 1;
+	return h;
+}
+
+static void bgfilt_add_rel(nfs_bgfilt_t *filt, int64 a, uint32 b, char *ptr)
+{
+	// record the large ideals of one relation.  after a,b: comes a comma
+	// separated list of rational primes, a :, then the algebraic primes,
+	// all in hex.
+	int side = 0;
+	uint32 start;
+
+	if (filt->num_rels + 1 >= filt->alloc_rels)
+		filt->rel_start = (uint32 *)bgfilt_grow(filt->rel_start,
+			&filt->alloc_rels, "relation list");
+
+	start = filt->rel_start[filt->num_rels];
+	while (*ptr != '\0')
+	{
+		uint64 p, r;
+		char *next;
+
+		if (*ptr == ':')
+		{
+			side = 1;
+			ptr++;
+			continue;
+		}
+		if (*ptr == ',')
+		{
+			ptr++;
+			continue;
+		}
+		if (!isxdigit(*ptr))
+			break;
+
+		p = strto_uint64(ptr, &next, 16);
+		ptr = next;
+
+		if (side == 0)
+		{
+			if (p <= filt->rlim)
+				continue;
+			r = 0;
+		}
+		else
+		{
+			uint64 am, bm;
+
+			if (p <= filt->alim)
+				continue;
+
+			// the ideal's root is a/b mod p (or p, for a projective root)
+			bm = (uint64)b % p;
+			if (bm == 0)
+				r = p;
+			else
+			{
+				if (a < 0)
+				{
+					am = (uint64)(-a) % p;
+					if (am > 0)
+						am = p - am;
+				}
+				else
+					am = (uint64)a % p;
+
+				r = mulmod64(am, modinv64(bm, p), p);
+			}
+		}
+
+		// the same prime may be listed more than once
+		{
+			uint32 id = bgfilt_ideal_id(filt, bgfilt_ideal_key(side, p, r));
+			uint32 k;
+
+			for (k = start; k < filt->rel_start[filt->num_rels]; k++)
+			{
+				if (filt->rel_ideals[k] == id)
+					break;
+			}
+			if (k < filt->rel_start[filt->num_rels])
+				continue;
+
+			if (filt->rel_start[filt->num_rels] >= filt->alloc_rel_ideals)
+				filt->rel_ideals = (uint32 *)bgfilt_grow(filt->rel_ideals,
+					&filt->alloc_rel_ideals, "ideal list");
+			filt->rel_ideals[filt->rel_start[filt->num_rels]++] = id;
+		}
+	}
+
+	// the slot after this relation starts where it ends
+	filt->num_rels++;
+	filt->rel_start[filt->num_rels] = filt->rel_start[filt->num_rels - 1];
+	filt->rel_start[filt->num_rels - 1] = start;
+	return;
+}
+
+static void bgfilt_singletons(nfs_bgfilt_t *filt)
+{
+	// repeated singleton removal over everything seen so far.  this runs
+	// entirely in memory, so it takes seconds where a filtering attempt
+	// would have to read the whole savefile.
+	uint32 *counts;
+	uint8 *alive;
+	uint32 i, k, removed;
+	uint32 alive_rels, alive_ideals;
+	double need;
+
+	counts = (uint32 *)calloc(filt->num_ideals + 1, sizeof(uint32));
+	alive = (uint8 *)malloc((filt->num_rels + 1) * sizeof(uint8));
+	if ((counts == NULL) || (alive == NULL))
+	{
+		printf("couldn't allocate background filter counts\n");
+		exit(-1);
+	}
+
+	for (i = 0; i < filt->num_rels; i++)
+	{
+		alive[i] = 1;
+		for (k = filt->rel_start[i]; k < filt->rel_start[i + 1]; k++)
+			counts[filt->rel_ideals[k]]++;
+	}
+
+	alive_rels = filt->num_rels;
+	do
+	{
+		removed = 0;
+		for (i = 0; i < filt->num_rels; i++)
+		{
+			if (!alive[i])
+				continue;
+
+			for (k = filt->rel_start[i]; k < filt->rel_start[i + 1]; k++)
+			{
+				if (counts[filt->rel_ideals[k]] < 2)
+					break;
+			}
+
+			if (k < filt->rel_start[i + 1])
+			{
+				alive[i] = 0;
+				removed++;
+				for (k = filt->rel_start[i]; k < filt->rel_start[i + 1]; k++)
+					counts[filt->rel_ideals[k]]--;
+			}
+		}
+		alive_rels -= removed;
+	} while ((removed > 0) && !filt->stop);
+
+	alive_ideals = 0;
+	for (i = 0; i < filt->num_ideals; i++)
+	{
+		if (counts[i] > 0)
+			alive_ideals++;
+	}
+
+	free(counts);
+	free(alive);
+
+	filt->est_rels = alive_rels;
+	filt->est_ideals = alive_ideals;
+	filt->last_pass_rels = filt->num_rels;
+
+	need = (filt->small_ideals + NFS_BGFILT_EXTRA) * filt->need_mult;
+	if ((double)alive_rels - (double)alive_ideals >= need)
+		filt->ready = 1;
+
+	if (VFLAG > 0)
+		printf("nfs: background filter: %u relations, %u large ideals after "
+			"singleton removal, excess %d of %1.0f needed\n",
+			alive_rels, alive_ideals, (int)alive_rels - (int)alive_ideals, need);
+
+	return;
+}
+
+static void bgfilt_load_savefile(nfs_bgfilt_t *filt)
+{
+	// bring in the relations that were in the savefile when sieving
+	// started, sharing the master's relation set so that duplicates of
+	// these are caught both here and as new relations come in.
+	FILE *in;
+	char tmpline[GSTR_MAXSIZE];
+
+	in = fopen(filt->savefile, "r");
+	if (in == NULL)
+		return;
+
+	while (!filt->stop && ((int64)nfs_ftell64(in) < filt->load_limit) &&
+		(fgets(tmpline, GSTR_MAXSIZE, in) != NULL))
+	{
+		char *ptr;
+		int64 a;
+		uint32 b;
+		int is_new;
+
+		if (!nfs_parse_ab(tmpline, &a, &b, &ptr))
+			continue;
+
+		nfs_bgfilt_lock(filt);
+		is_new = nfs_relset_insert(filt->set, a, b);
+		nfs_bgfilt_unlock(filt);
+
+		if (is_new)
+			bgfilt_add_rel(filt, a, b, ptr);
+	}
+	fclose(in);
+
+	return;
+}
+
+static void bgfilt_parse_pending(nfs_bgfilt_t *filt)
+{
+	// take everything the master has handed over so far and parse it
+	// without holding the lock
+	char *buf;
+	size_t len;
+	char *line;
+
+	nfs_bgfilt_lock(filt);
+	buf = filt->pending;
+	len = filt->pending_len;
+	filt->pending = (char *)malloc(filt->pending_alloc * sizeof(char));
+	filt->pending_len = 0;
+	nfs_bgfilt_unlock(filt);
+
+	line = buf;
+	while (line < buf + len)
+	{
+		char *ptr;
+		int64 a;
+		uint32 b;
+
+		if (nfs_parse_ab(line, &a, &b, &ptr))
+			bgfilt_add_rel(filt, a, b, ptr);
+		line += strlen(line) + 1;
+	}
+
+	free(buf);
+	return;
+}
+
+#if defined(WIN32) || defined(_WIN64)
+DWORD WINAPI bgfilt_thread_main(LPVOID thread_data) {
+#else
+void *bgfilt_thread_main(void *thread_data) {
+#endif
+	nfs_bgfilt_t *filt = (nfs_bgfilt_t *)thread_data;
+
+	bgfilt_load_savefile(filt);
+	filt->loaded = 1;
+
+	while (!filt->stop)
+	{
+		bgfilt_parse_pending(filt);
+
+		if ((filt->num_rels > filt->small_ideals) &&
+			((double)filt->num_rels >=
+			(double)filt->last_pass_rels * (1 + NFS_BGFILT_RECHECK)))
+			bgfilt_singletons(filt);
+
+		// sleep until there's more to do
+#if defined(WIN32) || defined(_WIN64)
+		WaitForSingleObject(filt->wake_event, NFS_BGFILT_POLL_MS);
+#else
+		{
+			struct timeval now;
+			struct timespec wake;
+
+			gettimeofday(&now, NULL);
+			wake.tv_sec = now.tv_sec + NFS_BGFILT_POLL_MS / 1000;
+			wake.tv_nsec = (now.tv_usec + (NFS_BGFILT_POLL_MS % 1000) * 1000) * 1000;
+			if (wake.tv_nsec >= 1000000000)
+			{
+				wake.tv_sec++;
+				wake.tv_nsec -= 1000000000;
+			}
+
+			pthread_mutex_lock(&filt->lock);
+			if (!filt->stop)
+				pthread_cond_timedwait(&filt->wake_cond, &filt->lock, &wake);
+			pthread_mutex_unlock(&filt->lock);
+		}
+#endif
+	}
+
+#if defined(WIN32) || defined(_WIN64)
+	return 0;
+#else
+	return NULL;
+#endif
+}
+
+nfs_bgfilt_t *nfs_bgfilt_start(fact_obj_t *fobj, nfs_job_t *job)
+{
+	// start background filtering for this job.  job->relset must already
+	// exist, and the savefile must not yet be open for appending, so
+	// that its current size is the amount to load.
+	nfs_bgfilt_t *filt;
+	FILE *in;
+
+	filt = (nfs_bgfilt_t *)malloc(sizeof(nfs_bgfilt_t));
+
+	filt->alloc_rels = 1 << 20;
+	filt->num_rels = 0;
+	filt->rel_start = (uint32 *)malloc(filt->alloc_rels * sizeof(uint32));
+	filt->rel_start[0] = 0;
+	filt->alloc_rel_ideals = 1 << 22;
+	filt->rel_ideals = (uint32 *)malloc(filt->alloc_rel_ideals * sizeof(uint32));
+
+	filt->ideal_bits = 22;
+	filt->num_ideals = 0;
+	filt->ideal_keys = (uint64 *)calloc((size_t)1 << filt->ideal_bits, sizeof(uint64));
+	filt->ideal_ids = (uint32 *)malloc(((size_t)1 << filt->ideal_bits) * sizeof(uint32));
+
+	filt->pending_alloc = 1 << 20;
+	filt->pending_len = 0;
+	filt->pending = (char *)malloc(filt->pending_alloc * sizeof(char));
+	filt->set = job->relset;
+
+	strcpy(filt->savefile, fobj->nfs_obj.outputfile);
+	filt->load_limit = 0;
+	in = fopen(filt->savefile, "r");
+	if (in != NULL)
+	{
+		nfs_fseek64(in, 0, SEEK_END);
+		filt->load_limit = (int64)nfs_ftell64(in);
+		fclose(in);
+	}
+
+	filt->rlim = job->rlim;
+	filt->alim = job->alim;
+	filt->small_ideals = approx_pi((double)job->rlim) + approx_pi((double)job->alim);
+	filt->need_mult = 1.0;
+	filt->last_pass_rels = 0;
+
+	filt->est_rels = 0;
+	filt->est_ideals = 0;
+	filt->loaded = 0;
+	filt->ready = 0;
+	filt->stop = 0;
+
+#if defined(WIN32) || defined(_WIN64)
+	filt->lock = CreateMutex(NULL, FALSE, NULL);
+	filt->wake_event = CreateEvent(NULL, FALSE, FALSE, NULL);
+	filt->thread_id = CreateThread(NULL, 0, bgfilt_thread_main, filt, 0, NULL);
+#else
+	pthread_mutex_init(&filt->lock, NULL);
+	pthread_cond_init(&filt->wake_cond, NULL);
+	pthread_create(&filt->thread_id, NULL, bgfilt_thread_main, filt);
+#endif
+
+	return filt;
+}
+
+void nfs_bgfilt_stop(nfs_bgfilt_t *filt)
+{
+	if (filt == NULL)
+		return;
+
+	nfs_bgfilt_lock(filt);
+	filt->stop = 1;
+#if defined(WIN32) || defined(_WIN64)
+	SetEvent(filt->wake_event);
+#else
+	pthread_cond_signal(&filt->wake_cond);
+#endif
+	nfs_bgfilt_unlock(filt);
+
+#if defined(WIN32) || defined(_WIN64)
+	WaitForSingleObject(filt->thread_id, INFINITE);
+	CloseHandle(filt->thread_id);
+	CloseHandle(filt->wake_event);
+	CloseHandle(filt->lock);
+#else
+	pthread_join(filt->thread_id, NULL);
+	pthread_cond_destroy(&filt->wake_cond);
+	pthread_mutex_destroy(&filt->lock);
+#endif
+
+	free(filt->rel_start);
+	free(filt->rel_ideals);
+	free(filt->ideal_keys);
+	free(filt->ideal_ids);
+	free(filt->pending);
+	free(filt);
+	return;
+}
+
+void nfs_bgfilt_lock(nfs_bgfilt_t *filt)
+{
+#if defined(WIN32) || defined(_WIN64)
+	WaitForSingleObject(filt->lock, INFINITE);
+#else
+	pthread_mutex_lock(&filt->lock);
+#endif
+	return;
+}
+
+void nfs_bgfilt_unlock(nfs_bgfilt_t *filt)
+{
+#if defined(WIN32) || defined(_WIN64)
+	ReleaseMutex(filt->lock);
+#else
+	pthread_mutex_unlock(&filt->lock);
+#endif
+	return;
+}
+
+void nfs_bgfilt_add(nfs_bgfilt_t *filt, char *line)
+{
+	// hand a new relation to the background filter.  the caller holds
+	// the lock.
+	size_t len = strlen(line) + 1;
+
+	if (filt->pending_len + len > filt->pending_alloc)
+	{
+		filt->pending_alloc *= 2;
+		if (filt->pending_alloc < filt->pending_len + len)
+			filt->pending_alloc = filt->pending_len + len;
+		filt->pending = (char *)realloc(filt->pending,
+			filt->pending_alloc * sizeof(char));
+		if (filt->pending == NULL)
+		{
+			printf("couldn't grow background filter input buffer\n");
+			exit(-1);
+		}
+	}
+
+	memcpy(filt->pending + filt->pending_len, line, len);
+	filt->pending_len += len;
+	return;
+}
+
+void nfs_bgfilt_retry(nfs_bgfilt_t *filt, double nudge)
+{
+	// filtering was tried on our say-so and didn't produce a matrix.
+	// ask for proportionally more excess before saying so again.
+	nfs_bgfilt_lock(filt);
+	filt->need_mult *= nudge;
+	filt->ready = 0;
+	filt->last_pass_rels = filt->num_rels;
+	nfs_bgfilt_unlock(filt);
+	return;
+}
+
+#endif
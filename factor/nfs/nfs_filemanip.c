@@ -48,6 +48,212 @@ void savefile_concat(char *filein, char *fileout, msieve_obj *mobj)
 	return;
 }
 
+nfs_relset_t *nfs_relset_new(void)
+{
+	nfs_relset_t *set = (nfs_relset_t *)malloc(sizeof(nfs_relset_t));
+
+	set->bits = NFS_RELSET_INIT_BITS;
+	set->slots = (nfs_relset_slot_t *)calloc((size_t)1 << set->bits, 
+		sizeof(nfs_relset_slot_t));
+	if (set->slots == NULL)
+	{
+		printf("couldn't allocate relation set\n");
+		exit(-1);
+	}
+	set->count = 0;
+	set->dups = 0;
+	set->bad = 0;
+
+	return set;
+}
+
+void nfs_relset_free(nfs_relset_t *set)
+{
+	if (set == NULL)
+		return;
+
+	free(set->slots);
+	free(set);
+	return;
+}
+
+static uint64 relset_hash(int64 a, uint32 b)
+{
+	// mix (a,b) down to 64 bits with the finalizer from murmurhash3.
+	// the low bits pick the slot and the high bits are the slot's tag;
+	// different pairs can share both, so the pair is compared as well
+	uint64 h = (uint64)a * 0x9E3779B97F4A7C15ULL + (uint64)b;
+
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+
+	return h;
+}
+
+#define RELSET_TAG(h) ((uint32)((h) >> 32) | 1)
+
+int nfs_relset_insert(nfs_relset_t *set, int64 a, uint32 b)
+{
+	// returns 1 if (a,b) is new to the set, 0 if it was already there
+	uint64 h = relset_hash(a, b);
+	uint64 mask;
+	uint64 i;
+
+	if (set->count >= ((uint64)7 << set->bits) / 10)
+	{
+		// grow to keep the probe sequences short
+		nfs_relset_slot_t *old = set->slots;
+		uint64 oldsize = (uint64)1 << set->bits;
+
+		set->bits++;
+		set->slots = (nfs_relset_slot_t *)calloc((size_t)1 << set->bits, 
+			sizeof(nfs_relset_slot_t));
+		if (set->slots == NULL)
+		{
+			printf("couldn't grow relation set to 2^%u entries\n", set->bits);
+			exit(-1);
+		}
+
+		mask = ((uint64)1 << set->bits) - 1;
+		for (i = 0; i < oldsize; i++)
+		{
+			uint64 j;
+
+			if (old[i].tag == 0)
+				continue;
+
+			j = relset_hash(old[i].a, old[i].b) & mask;
+			while (set->slots[j].tag != 0)
+				j = (j + 1) & mask;
+			set->slots[j] = old[i];
+		}
+		free(old);
+	}
+
+	mask = ((uint64)1 << set->bits) - 1;
+	i = h & mask;
+	while (set->slots[i].tag != 0)
+	{
+		if ((set->slots[i].tag == RELSET_TAG(h)) &&
+			(set->slots[i].a == a) && (set->slots[i].b == b))
+			return 0;
+		i = (i + 1) & mask;
+	}
+
+	set->slots[i].a = a;
+	set->slots[i].b = b;
+	set->slots[i].tag = RELSET_TAG(h);
+	set->count++;
+	return 1;
+}
+
+int nfs_parse_ab(char *line, int64 *a, uint32 *b, char **rest)
+{
+	// relations start with a,b: - read them and point rest at what 
+	// follows.  returns 0 if the line isn't a relation.
+	char *ptr = line;
+	int neg = 0;
+
+	if (*ptr == '-')
+	{
+		neg = 1;
+		ptr++;
+	}
+
+	if (!isdigit(*ptr))
+		return 0;
+
+	*a = (int64)strto_uint64(ptr, &ptr, 10);
+	if (neg)
+		*a = -(*a);
+
+	if (*ptr != ',')
+		return 0;
+
+	*b = (uint32)strtoul(ptr + 1, &ptr, 10);
+	if (*ptr != ':')
+		return 0;
+
+	*rest = ptr + 1;
+	return 1;
+}
+
+uint32 nfs_ingest_rels(char *filein, long *pos, int final, 
+	nfs_relset_t *set, nfs_bgfilt_t *filt, msieve_obj *mobj)
+{
+	// append the relations in filein, from *pos onward, to the savefile,
+	// which the caller has open for appending.  relations whose (a,b) is
+	// already in set are dropped, and the rest are also passed on to the
+	// background filter, if there is one.  unless this is the final pass
+	// over the file, a partial line at the end is left for next time, 
+	// since the siever may still be writing it.  *pos is left after the 
+	// last line consumed, and the number of relations written is returned.
+	FILE *in;
+	char tmpline[GSTR_MAXSIZE];
+	uint32 count = 0;
+
+	in = fopen(filein, "r");
+	if (in == NULL)
+	{
+		// the siever hasn't written anything yet
+		return 0;
+	}
+
+	if (fseek(in, *pos, SEEK_SET) != 0)
+	{
+		fclose(in);
+		return 0;
+	}
+
+	while (fgets(tmpline, GSTR_MAXSIZE, in) != NULL)
+	{
+		char *ptr;
+		int64 a;
+		uint32 b;
+		int is_new;
+
+		if (!final && (strchr(tmpline, '\n') == NULL))
+			break;
+
+		*pos = ftell(in);
+
+		if (!nfs_parse_ab(tmpline, &a, &b, &ptr))
+		{
+			set->bad++;
+			continue;
+		}
+
+		// the background filter shares the set while it loads
+		// the relations already in the savefile
+		if (filt != NULL)
+			nfs_bgfilt_lock(filt);
+
+		is_new = nfs_relset_insert(set, a, b);
+		if (is_new)
+		{
+			if (filt != NULL)
+				nfs_bgfilt_add(filt, tmpline);
+		}
+		else
+			set->dups++;
+
+		if (filt != NULL)
+			nfs_bgfilt_unlock(filt);
+
+		if (!is_new)
+			continue;
+
+		savefile_write_line(&mobj->savefile, tmpline);
+		count++;
+	}
+	fclose(in);
+
+	return count;
+}
+
 void win_file_concat(char *filein, char *fileout)
 {
 	FILE *in, *out;
@@ -466,6 +672,25 @@ enum nfs_state_e check_existing_files(fact_obj_t *fobj, uint32 *last_spq, nfs_jo
 					free(lines[i]);
 				free(lines);
 			}
+
+			// chunks are appended to the data file as they finish, not in
+			// special-q order, so if completed ranges were recorded resume
+			// from the first gap in them instead
+			{
+				nfs_qranges_t done_q;
+				uint32 q;
+
+				nfs_qranges_load(fobj, &done_q);
+				q = nfs_qranges_resume(&done_q);
+				nfs_qranges_free(&done_q);
+
+				if (q > 0)
+				{
+					if (VFLAG > 0)
+						printf("nfs: completed special-q ranges cover up to %u\n", q);
+					*last_spq = q;
+				}
+			}
 		}
 		else
 		{
@@ -377,6 +377,7 @@ void do_msieve_polyselect(fact_obj_t *fobj, msieve_obj *obj, nfs_job_t *job,
 		//give this thread a unique index
 		t->tindex = i;
 		t->is_poly_select = 1;
+		t->is_queued = 0;
 
 		t->thread_queue = thread_queue;
         t->threads_waiting = threads_waiting;
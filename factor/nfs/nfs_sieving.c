@@ -434,17 +434,223 @@ int test_sieve(fact_obj_t* fobj, void* args, int njobs, int are_files)
 	return minscore_id;
 }
 
+static int qrange_cmp(const void *x, const void *y)
+{
+	uint32 *xx = (uint32 *)x;
+	uint32 *yy = (uint32 *)y;
+
+	if (xx[0] < yy[0])
+		return -1;
+	return (xx[0] > yy[0]);
+}
+
+void nfs_qranges_load(fact_obj_t *fobj, nfs_qranges_t *r)
+{
+	// read the completed special-q ranges for this job, sorted and with
+	// overlapping or adjacent ranges merged.  empty ranges mark where a 
+	// round of sieving started.
+	FILE *fid;
+	char fname[GSTR_MAXSIZE];
+	uint32 *pairs, alloc, num, s, e, i;
+
+	r->start = r->end = NULL;
+	r->num = 0;
+
+	sprintf(fname, "%s%s", fobj->nfs_obj.outputfile, NFS_QRANGE_EXT);
+	fid = fopen(fname, "r");
+	if (fid == NULL)
+		return;
+
+	alloc = 256;
+	num = 0;
+	pairs = (uint32 *)malloc(2 * alloc * sizeof(uint32));
+	while (fscanf(fid, "%u %u", &s, &e) == 2)
+	{
+		if (e < s)
+			continue;
+
+		if (num == alloc)
+		{
+			alloc *= 2;
+			pairs = (uint32 *)realloc(pairs, 2 * alloc * sizeof(uint32));
+		}
+		pairs[2 * num] = s;
+		pairs[2 * num + 1] = e;
+		num++;
+	}
+	fclose(fid);
+
+	qsort(pairs, num, 2 * sizeof(uint32), &qrange_cmp);
+
+	r->start = (uint32 *)malloc((num + 1) * sizeof(uint32));
+	r->end = (uint32 *)malloc((num + 1) * sizeof(uint32));
+	for (i = 0; i < num; i++)
+	{
+		if ((r->num > 0) && (pairs[2 * i] <= r->end[r->num - 1]))
+		{
+			if (pairs[2 * i + 1] > r->end[r->num - 1])
+				r->end[r->num - 1] = pairs[2 * i + 1];
+		}
+		else
+		{
+			r->start[r->num] = pairs[2 * i];
+			r->end[r->num] = pairs[2 * i + 1];
+			r->num++;
+		}
+	}
+	free(pairs);
+
+	return;
+}
+
+void nfs_qranges_free(nfs_qranges_t *r)
+{
+	free(r->start);
+	free(r->end);
+	r->start = r->end = NULL;
+	r->num = 0;
+	return;
+}
+
+uint32 nfs_qranges_resume(nfs_qranges_t *r)
+{
+	// the first special-q not covered by a completed range, counting from
+	// where sieving started (the lowest range, or round start marker), or 
+	// 0 if nothing has been recorded
+	if (r->num == 0)
+		return 0;
+	return r->end[0];
+}
+
+static uint32 nfs_qranges_skip(nfs_qranges_t *r, uint32 q, uint32 *next)
+{
+	// move q past any completed ranges containing it, and return in *next
+	// where the next completed range above it starts
+	uint32 i;
+
+	*next = 0xffffffff;
+	for (i = 0; i < r->num; i++)
+	{
+		if (q < r->start[i])
+		{
+			*next = r->start[i];
+			break;
+		}
+		if (q < r->end[i])
+			q = r->end[i];
+	}
+
+	return q;
+}
+
+static void nfs_qranges_record(fact_obj_t *fobj, uint32 start, uint32 end)
+{
+	// called once all of the relations from [start, end) are in the
+	// savefile
+	FILE *fid;
+	char fname[GSTR_MAXSIZE];
+
+	sprintf(fname, "%s%s", fobj->nfs_obj.outputfile, NFS_QRANGE_EXT);
+	fid = fopen(fname, "a");
+	if (fid == NULL)
+	{
+		printf("could not record completed special-q range in %s\n", fname);
+		return;
+	}
+
+	fprintf(fid, "%u %u\n", start, end);
+	fclose(fid);
+
+	return;
+}
+
 void do_sieving(fact_obj_t *fobj, nfs_job_t *job)
 {
+	// lattice sieve one round of special-q.  rather than splitting the round
+	// into one range per thread, the round is handed out in chunks from a
+	// work queue: each thread takes the next chunk as soon as it finishes
+	// one, chunks are sized from the measured special-q rate, and they
+	// shrink near the end of the round so that all threads finish together.
+	// if no range was specified by the user, no more chunks are handed out
+	// once the relations found plus those expected from the chunks still
+	// being sieved reach min_rels.
+	// relations are streamed into the savefile while the sievers run, by
+	// tailing their output files each time the master wakes up, and
+	// duplicate (a,b) pairs are dropped on the way in.  chunks that finish
+	// are recorded in the completed ranges file, and chunks already in it 
+	// (from before a restart) are skipped.
 	nfs_threaddata_t *thread_data;		//an array of thread data objects
 	int i;
 	FILE *fid;
 	FILE *logfile;
 
+	// thread work-queue controls
+	int threads_working = 0;
+	int *thread_queue, *threads_waiting;
+#if defined(WIN32) || defined(_WIN64)
+	HANDLE queue_lock;
+	HANDLE *queue_events = NULL;
+#else
+	pthread_mutex_t queue_lock;
+	pthread_cond_t queue_cond;
+#endif
+
+	// work queue of special-q
+	uint32 round_q;				// size of this round
+	uint32 q_end;				// end of this round
+	uint32 base_chunk;			// chunk size until the rate is measured
+	uint32 max_chunk;			// never more than a thread's even share
+	uint32 chunk;
+	uint32 q_inflight = 0;		// special-q handed out but not yet collected
+	uint32 q_done = 0;			// special-q sieved so far this round
+	uint32 rels_found = 0;		// relations found so far this round
+	uint32 num_chunks = 0;
+	double q_time = 0.0;		// thread-seconds spent on the q_done special-q
+	int is_startup, stop_issuing = 0;
+	nfs_relset_t *set;
+	uint32 dups_start, bad_start;
+	nfs_qranges_t done_q;
+	uint32 next_done;
+	struct timeval stopt;
+	TIME_DIFF *	difference;
+	double t_time;
+
+	if (fobj->nfs_obj.rangeq > 0)
+		round_q = fobj->nfs_obj.rangeq;
+	else
+		round_q = job->qrange;
+	q_end = job->startq + round_q;
+
+	base_chunk = (uint32)ceil((double)round_q / (double)(THREADS * NFS_CHUNKS_PER_THREAD));
+	max_chunk = (uint32)ceil((double)round_q / (double)THREADS);
+	if (base_chunk < NFS_MIN_CHUNK_Q)
+		base_chunk = NFS_MIN_CHUNK_Q;
+
 	thread_data = (nfs_threaddata_t *)malloc(THREADS * sizeof(nfs_threaddata_t));
+
+	// allocate the queue of threads waiting for work
+	thread_queue = (int *)malloc(THREADS * sizeof(int));
+	threads_waiting = (int *)malloc(sizeof(int));
+
+	if (THREADS > 1)
+	{
+#if defined(WIN32) || defined(_WIN64)
+		queue_lock = CreateMutex(
+			NULL,              // default security attributes
+			FALSE,             // initially not owned
+			NULL);             // unnamed mutex
+		queue_events = (HANDLE *)malloc(THREADS * sizeof(HANDLE));
+#else
+		pthread_mutex_init(&queue_lock, NULL);
+		pthread_cond_init(&queue_cond, NULL);
+#endif
+	}
+
 	for (i=0; i<THREADS; i++)
 	{
 		sprintf(thread_data[i].outfilename, "rels%d.dat", i);
+		thread_data[i].tail_pos = 0;
+		thread_data[i].finished = 0;
 		thread_data[i].job.poly = job->poly; // no sense copying the whole struct
 		thread_data[i].job.rlim = job->rlim;
 		thread_data[i].job.alim = job->alim;
@@ -454,34 +660,34 @@ void do_sieving(fact_obj_t *fobj, nfs_job_t *job)
 		thread_data[i].job.lpba = job->lpba;
 		thread_data[i].job.mfbr = job->mfbr;
 		thread_data[i].job.mfba = job->mfba;
-		if (fobj->nfs_obj.rangeq > 0)
-			thread_data[i].job.qrange = ceil((double)fobj->nfs_obj.rangeq / (double)THREADS);
-		else
-			thread_data[i].job.qrange = ceil((double)job->qrange / (double)THREADS);
+		thread_data[i].job.qrange = 0;
 		thread_data[i].job.min_rels = job->min_rels;
-		thread_data[i].job.current_rels = job->current_rels;
+		thread_data[i].job.current_rels = 0;
 		thread_data[i].siever = fobj->nfs_obj.siever;
 		thread_data[i].job.startq = job->startq;
 		strcpy(thread_data[i].job.sievername, job->sievername);
 
 		thread_data[i].tindex = i;
 		thread_data[i].is_poly_select = 0;
+		thread_data[i].is_queued = 1;
 		thread_data[i].fobj = fobj;
-	}
-
-	/* activate the threads one at a time. The last is the
-			master thread (i.e. not a thread at all). */		
-	for (i = 0; i < THREADS - 1; i++)
-		nfs_start_worker_thread(thread_data + i, 0);
 
-	nfs_start_worker_thread(thread_data + i, 1);			
+		// assign all thread's a pointer to the waiting queue.  access to
+		// the array will be controlled by a mutex
+		thread_data[i].thread_queue = thread_queue;
+		thread_data[i].threads_waiting = threads_waiting;
 
-	// load threads with work
-	for (i = 0; i < THREADS; i++) 
-	{
-		nfs_threaddata_t *t = thread_data + i;
-		t->job.startq = job->startq;
-		job->startq += t->job.qrange;
+		if (THREADS > 1)
+		{
+#if defined(WIN32) || defined(_WIN64)
+			// assign a pointer to the mutex
+			thread_data[i].queue_lock = &queue_lock;
+			thread_data[i].queue_event = &queue_events[i];
+#else
+			thread_data[i].queue_lock = &queue_lock;
+			thread_data[i].queue_cond = &queue_cond;
+#endif
+		}
 	}
 
 	logfile = fopen(fobj->flogname, "a");
@@ -496,61 +702,279 @@ void do_sieving(fact_obj_t *fobj, nfs_job_t *job)
 		fclose(logfile);
 	}
 
-	// create a new lasieve process in each thread and watch it
-	for (i = 0; i < THREADS; i++) 
+	// the set of (a,b) seen lasts for the whole session, as does the
+	// background filter, which also loads the relations already in the
+	// savefile into the set.  it has to start before the savefile is 
+	// opened for appending.
+	if (job->relset == NULL)
+		job->relset = nfs_relset_new();
+	set = job->relset;
+	if (job->bgfilt == NULL)
+		job->bgfilt = nfs_bgfilt_start(fobj, job);
+	nfs_bgfilt_lock(job->bgfilt);
+	dups_start = set->dups;
+	bad_start = set->bad;
+	nfs_bgfilt_unlock(job->bgfilt);
+
+	// the savefile stays open for appending for the whole round
+	savefile_open(&fobj->nfs_obj.mobj->savefile, SAVEFILE_APPEND);
+	nfs_qranges_load(fobj, &done_q);
+	nfs_qranges_record(fobj, job->startq, job->startq);
+
+	if (THREADS > 1)
 	{
-		nfs_threaddata_t *t = thread_data + i;
-
-		if (i == THREADS - 1) {				
-			lasieve_launcher(t);
+		// Activate the worker threads one at a time.
+		// Initialize the work queue to say all threads are waiting for work
+		for (i = 0; i < THREADS; i++)
+		{
+			nfs_start_worker_thread(thread_data + i, 2);
+			thread_queue[i] = i;
 		}
-		else {
-			t->command = NFS_COMMAND_RUN;
+	}
+	*threads_waiting = THREADS;
+
+	if (THREADS > 1)
+	{
 #if defined(WIN32) || defined(_WIN64)
-			SetEvent(t->run_event);
+		// nothing
 #else
-			pthread_cond_signal(&t->run_cond);
-			pthread_mutex_unlock(&t->run_lock);
+		pthread_mutex_lock(&queue_lock);
 #endif
-		}
 	}
 
-	/* wait for each thread to finish */
+	is_startup = 1;
+	while (1)
+	{
+
+		// Process threads until there are no more waiting for their results to be collected
+		while (*threads_waiting > 0)
+		{
+			// one or more threads have just finished
+			// (or, on first loop, nothing has started yet)
+			int tid;
+			nfs_threaddata_t *t;
+
+			if (THREADS > 1)
+			{
+				// Pop a waiting thread off the queue (OK, it's stack not a queue)
+#if defined(WIN32) || defined(_WIN64)
+
+				WaitForSingleObject(
+					queue_lock,    // handle to mutex
+					INFINITE);  // no time-out interval
+#endif
+
+				tid = thread_queue[--(*threads_waiting)];
 
-	for (i = 0; i < THREADS; i++) {
-		nfs_threaddata_t *t = thread_data + i;
+#if defined(WIN32) || defined(_WIN64)
+				ReleaseMutex(queue_lock);
+#endif
+			}
+			else
+				tid = 0;
+
+			// pointer to this thread's data
+			t = thread_data + tid;
+
+			if (!is_startup)
+			{
+				// this thread is done, so decrement the count of working threads
+				// and collect its chunk
+				threads_working--;
+
+				gettimeofday(&stopt, NULL);
+				difference = my_difftime (&t->thread_start_time, &stopt);
+				t_time = ((double)difference->secs + (double)difference->usecs / 1000000);
+				free(difference);
+
+				// pick up whatever is left of this chunk's output, and if the
+				// siever got through all of it, record it as done
+				t->job.current_rels += nfs_ingest_rels(t->outfilename, &t->tail_pos, 1,
+					set, job->bgfilt, fobj->nfs_obj.mobj);
+				remove(t->outfilename);
+				if (t->finished)
+				{
+					savefile_flush(&fobj->nfs_obj.mobj->savefile);
+					nfs_qranges_record(fobj, t->job.startq, 
+						t->job.startq + t->job.qrange);
+				}
+
+				q_inflight -= t->job.qrange;
+				q_done += t->job.qrange;
+				q_time += t_time;
+				rels_found += t->job.current_rels;
+				num_chunks++;
+			}
+
+			// don't start any more chunks once the relations found, plus
+			// those expected from the chunks in flight, reach min_rels.
+			// a user specified range is always sieved in full.
+			if ((fobj->nfs_obj.rangeq == 0) && (job->min_rels > 0) && (q_done > 0) &&
+				((double)job->current_rels + (double)rels_found +
+				(double)rels_found / (double)q_done * (double)q_inflight >= (double)job->min_rels))
+			{
+				if ((VFLAG > 0) && !stop_issuing)
+					printf("nfs: expect to reach %u relations, stopping this round "
+					"at special-q %u\n", job->min_rels, job->startq);
+				stop_issuing = 1;
+			}
+
+			// or once the background filter thinks a matrix can be built
+			if ((fobj->nfs_obj.rangeq == 0) && job->bgfilt->ready)
+			{
+				if ((VFLAG > 0) && !stop_issuing)
+					printf("nfs: background filter expects a matrix, stopping this "
+					"round at special-q %u\n", job->startq);
+				stop_issuing = 1;
+			}
+
+			// don't sieve any chunks that were finished before a restart
+			job->startq = nfs_qranges_skip(&done_q, job->startq, &next_done);
+
+			if (!NFS_ABORT && !stop_issuing && (job->startq < q_end))
+			{
+				// size the next chunk.  once we have a measured rate aim for
+				// NFS_CHUNK_SECONDS per chunk, and toward the end of the round
+				// split what's left evenly so the threads finish together.
+				if (q_done > 0)
+					chunk = (uint32)((double)q_done / q_time * NFS_CHUNK_SECONDS);
+				else
+					chunk = base_chunk;
+
+				if (chunk > max_chunk)
+					chunk = max_chunk;
+				if (chunk > (uint32)ceil((double)(q_end - job->startq) / (double)THREADS))
+					chunk = (uint32)ceil((double)(q_end - job->startq) / (double)THREADS);
+				if (chunk < NFS_MIN_CHUNK_Q)
+					chunk = NFS_MIN_CHUNK_Q;
+				if (chunk > q_end - job->startq)
+					chunk = q_end - job->startq;
+				if (chunk > next_done - job->startq)
+					chunk = next_done - job->startq;
+
+				t->job.startq = job->startq;
+				t->job.qrange = chunk;
+				t->job.current_rels = 0;
+				t->tail_pos = 0;
+				t->finished = 0;
+				job->startq += chunk;
+
+				// make sure there is nothing stale for the tail to pick up
+				// before the siever starts writing
+				remove(t->outfilename);
+				q_inflight += chunk;
+				gettimeofday(&t->thread_start_time, NULL);
+
+				// signal the job to start
+				if (THREADS > 1)
+				{
+#if defined(WIN32) || defined(_WIN64)
+					thread_data[tid].command = NFS_COMMAND_RUN;
+					SetEvent(thread_data[tid].run_event);
+#else
+					pthread_mutex_lock(&thread_data[tid].run_lock);
+					thread_data[tid].command = NFS_COMMAND_RUN;
+					pthread_cond_signal(&thread_data[tid].run_cond);
+					pthread_mutex_unlock(&thread_data[tid].run_lock);
+#endif
+				}
 
-		if (i < THREADS - 1) {
+				// this thread is now busy, so increment the count of working threads
+				threads_working++;
+			}
+
+			if (THREADS == 1)
+				*threads_waiting = 0;
+
+		}
+
+		// after starting all chunks for the first time, reset this flag
+		if (is_startup)
+			is_startup = 0;
+
+		// if all threads are done, break out
+		if (threads_working == 0)
+			break;
+
+		if (THREADS > 1)
+		{
+#if !defined(WIN32) && !defined(_WIN64)
+			struct timespec wake;
+#endif
+
+			// stream in what the running sievers have written so far
+			for (i = 0; i < THREADS; i++)
+			{
+				nfs_threaddata_t *t = thread_data + i;
+
+				if (t->job.qrange > 0)
+					t->job.current_rels += nfs_ingest_rels(t->outfilename, 
+						&t->tail_pos, 0, set, job->bgfilt, fobj->nfs_obj.mobj);
+			}
+			savefile_flush(&fobj->nfs_obj.mobj->savefile);
+
+			// wait for a thread to finish and put itself in the waiting queue,
+			// or for the next time to check on the sievers' output
 #if defined(WIN32) || defined(_WIN64)
-			WaitForSingleObject(t->finish_event, INFINITE);
+			WaitForMultipleObjects(
+				THREADS,
+				queue_events,
+				FALSE,
+				NFS_INGEST_POLL_MS);
 #else
-			pthread_mutex_lock(&t->run_lock);
-			while (t->command != NFS_COMMAND_WAIT)
-				pthread_cond_wait(&t->run_cond, &t->run_lock);
+			gettimeofday(&stopt, NULL);
+			wake.tv_sec = stopt.tv_sec + NFS_INGEST_POLL_MS / 1000;
+			wake.tv_nsec = (stopt.tv_usec + (NFS_INGEST_POLL_MS % 1000) * 1000) * 1000;
+			if (wake.tv_nsec >= 1000000000)
+			{
+				wake.tv_sec++;
+				wake.tv_nsec -= 1000000000;
+			}
+			pthread_cond_timedwait(&queue_cond, &queue_lock, &wake);
 #endif
 		}
+		else
+		{
+			//do some work
+			lasieve_launcher(thread_data);
+			*threads_waiting = 1;
+		}
 	}
-		
-	//combine output
-	for (i = 0; i < THREADS; i++) 
+
+	if (THREADS > 1)
 	{
-		nfs_threaddata_t *t = thread_data + i;
-		savefile_concat(t->outfilename,fobj->nfs_obj.outputfile,fobj->nfs_obj.mobj);
+#if defined(WIN32) || defined(_WIN64)
+		// nothing
+#else
+		pthread_mutex_unlock(&queue_lock);
+#endif
+	}
 
-		// accumulate relation counts
-		job->current_rels += thread_data[i].job.current_rels;
+	// accumulate relation counts
+	job->current_rels += rels_found;
 
-		remove(thread_data[i].outfilename);
+	logfile = fopen(fobj->flogname, "a");
+	if (logfile != NULL)
+	{
+		logprint(logfile, "nfs: sieved %u special-q in %u chunks, found %u relations\n",
+			q_done, num_chunks, rels_found);
+		logprint(logfile, "nfs: dropped %u duplicate and %u malformed relations\n",
+			set->dups - dups_start, set->bad - bad_start);
+		fclose(logfile);
 	}
 
+	if (VFLAG > 0)
+		printf("nfs: dropped %u duplicate and %u malformed relations\n",
+			set->dups - dups_start, set->bad - bad_start);
+
 	if ((fid = fopen("rels.add", "r")) != NULL)
 	{
-		char tmpstr[1024];
-		uint32 count = 0;
+		long pos = 0;
+		uint32 count;
 
-		while (fgets(tmpstr, GSTR_MAXSIZE, fid) != NULL)
-			count++;
 		fclose(fid);
+		count = nfs_ingest_rels("rels.add", &pos, 1, set, job->bgfilt, fobj->nfs_obj.mobj);
+		job->current_rels += count;
 
 		if (VFLAG > 0) printf("nfs: adding %u rels from rels.add\n",count);
 
@@ -566,242 +990,41 @@ void do_sieving(fact_obj_t *fobj, nfs_job_t *job)
 			fclose(logfile);
 		}
 
-		savefile_concat("rels.add",fobj->nfs_obj.outputfile,fobj->nfs_obj.mobj);
 		remove("rels.add");
 	}
 
+	savefile_flush(&fobj->nfs_obj.mobj->savefile);
+	savefile_close(&fobj->nfs_obj.mobj->savefile);
+	nfs_qranges_free(&done_q);
+
 	//stop worker threads
-	for (i=0; i<THREADS - 1; i++)
+	for (i=0; i<THREADS; i++)
 	{
-		nfs_stop_worker_thread(thread_data + i, 0);
+		if (THREADS > 1)
+			nfs_stop_worker_thread(thread_data + i, 2);
 	}
-	nfs_stop_worker_thread(thread_data + i, 1);
 
 	//free the thread structure
 	free(thread_data);
+	free(thread_queue);
+	free(threads_waiting);
 
-	return;
-}
-
-/*
-void do_sieving_pool(fact_obj_t *fobj, nfs_job_t *job)
-{
-	nfs_threaddata_t *thread_data;		//an array of thread data objects
-	int i;
-	FILE *logfile;
-
-	// thread work-queue controls
-    int threads_working = 0;
-    int *thread_queue, *threads_waiting;
-#if defined(WIN32) || defined(_WIN64)
-	HANDLE queue_lock;
-	HANDLE *queue_events = NULL;
-#else
-    pthread_mutex_t queue_lock;
-    pthread_cond_t queue_cond;
-#endif
-
-	thread_data = (nfs_threaddata_t *)malloc(THREADS * sizeof(nfs_threaddata_t));
-
-	// allocate the queue of threads waiting for work
-    thread_queue = (int *)malloc(THREADS * sizeof(int));
-    threads_waiting = (int *)malloc(sizeof(int));
-
-	if (THREADS > 1)
-	{
-#if defined(WIN32) || defined(_WIN64)
-		queue_lock = CreateMutex( 
-			NULL,              // default security attributes
-			FALSE,             // initially not owned
-			NULL);             // unnamed mutex
-		queue_events = (HANDLE *)malloc(THREADS * sizeof(HANDLE));
-#else
-		pthread_mutex_init(&queue_lock, NULL);
-		pthread_cond_init(&queue_cond, NULL);
-#endif
-	}
-
-	logfile = fopen(fobj->flogname, "a");
-	if (logfile == NULL)
+#if defined(WIN32) || defined(_WIN64)
+	if (THREADS > 1)
 	{
-		printf("fopen error: %s\n", strerror(errno));
-		printf("could not open yafu logfile for appending\n");
+		CloseHandle(queue_lock);
+		free(queue_events);
 	}
-	else
+#else
+	if (THREADS > 1)
 	{
-		logprint(logfile, "nfs: commencing lattice sieving with %d threads\n",THREADS);
-		fclose(logfile);
-	}
-
-	thread_data = (nfs_threaddata_t *)malloc(THREADS * sizeof(nfs_threaddata_t));
-	for (i=0; i<THREADS; i++)
-	{
-		thread_data[i].fobj = fobj;
-		sprintf(thread_data[i].outfilename, "rels%d.dat", i);
-		thread_data[i].job.poly = job->poly; // no sense copying the whole struct
-		thread_data[i].job.rlim = job->rlim;
-		thread_data[i].job.alim = job->alim;
-		thread_data[i].job.rlambda = job->rlambda;
-		thread_data[i].job.alambda = job->alambda;
-		thread_data[i].job.lpbr = job->lpbr;
-		thread_data[i].job.lpba = job->lpba;
-		thread_data[i].job.mfbr = job->mfbr;
-		thread_data[i].job.mfba = job->mfba;
-		thread_data[i].job.min_rels = job->min_rels;
-		thread_data[i].job.current_rels = job->current_rels;
-		thread_data[i].siever = fobj->nfs_obj.siever;
-		thread_data[i].job.startq = job->startq;
-		strcpy(thread_data[i].job.sievername, job->sievername);
-		thread_data[i].is_poly_select = 0;
-		thread_data[i].fobj = fobj;
-		thread_data[i].tindex = i;
-
-		// todo: break this up into smaller chunks, in an effort to keep 
-		// threads from idleing less at the end of a range.  will need
-		// to compute and store the afb first
-		if (fobj->nfs_obj.rangeq > 0)
-			thread_data[i].job.qrange = ceil((double)fobj->nfs_obj.rangeq / (double)THREADS);
-		else
-			thread_data[i].job.qrange = ceil((double)job->qrange / (double)THREADS);
-
-		// assign all thread's a pointer to the waiting queue.  access to 
-		// the array will be controlled by a mutex
-        thread_data[i].thread_queue = thread_queue;
-        thread_data[i].threads_waiting = threads_waiting;
-
-		if (THREADS > 1)
-		{
-#if defined(WIN32) || defined(_WIN64)
-			// assign a pointer to the mutex
-			thread_data[i].queue_lock = &queue_lock;
-			thread_data[i].queue_event = &queue_events[i];
-#else
-			thread_data[i].queue_lock = &queue_lock;
-			thread_data[i].queue_cond = &queue_cond;
-#endif
-		}
+		pthread_mutex_destroy(&queue_lock);
+		pthread_cond_destroy(&queue_cond);
 	}
-
-
-	if (THREADS > 1)
-	{
-#if defined(WIN32) || defined(_WIN64)
-		// nothing
-#else
-		pthread_mutex_lock(&queue_lock);
-#endif
-	}
-
-    while (1)
-	{
-
-		// Process threads until there are no more waiting for their results to be collected
-		while (*threads_waiting > 0)
-		{
-			int tid;
-			
-			if (THREADS > 1)
-			{
-				// Pop a waiting thread off the queue (OK, it's stack not a queue)
-#if defined(WIN32) || defined(_WIN64)
-				WaitForSingleObject( 
-					queue_lock,    // handle to mutex
-					INFINITE);  // no time-out interval
 #endif
-  
-				tid = thread_queue[--(*threads_waiting)];
-
-#if defined(WIN32) || defined(_WIN64)
-				ReleaseMutex(queue_lock);
-#endif
-			}
-			else
-				tid = 0;
-
-			// Check whether the thread has any results to collect. This should only be false at the 
-			// very beginning, when the thread hasn't actually done anything yet.
-			if (thread_data[tid].dconf->buffered_rels)
-			{				
-				num_found = siqs_merge_data(thread_data[tid].dconf,static_conf);
-
-				//check whether to continue or not, and update the screen
-				updatecode = update_check(static_conf);
-
-				// this thread is done, so decrement the count of working threads
-				threads_working--;
-			}
-
-			// if we have enough relations, or if there was a break signal, stop dispatching
-			// any more threads
-			if (updatecode == 0 && num_found < num_needed) 
-			{
-
-				// generate a new poly A value for the thread we pulled out of the queue
-				// using its dconf.  this is done by the master thread because it also 
-				// stores the coefficients in a master list
-				static_conf->total_poly_a++;
-				new_poly_a(static_conf,thread_data[tid].dconf);
-
-				if (THREADS > 1)
-				{
-					// send the thread a signal to start processing the poly we just generated for it
-#if defined(WIN32) || defined(_WIN64)
-					thread_data[tid].command = COMMAND_RUN;
-					SetEvent(thread_data[tid].run_event);
-#else
-					pthread_mutex_lock(&thread_data[tid].run_lock);
-					thread_data[tid].command = COMMAND_RUN;
-					pthread_cond_signal(&thread_data[tid].run_cond);
-					pthread_mutex_unlock(&thread_data[tid].run_lock);
-#endif
-				}
-				
-				// this thread is now busy, so increment the count of working threads
-				threads_working++;
-			}
-
-			if (THREADS == 1)
-				*threads_waiting = 0;
-	
-		} // while (*threads_waiting > 0)
-
-		// if all threads are done, break out
-		if (threads_working == 0)
-			break;
-
-		if (THREADS > 1)
-		{
-			// wait for a thread to finish and put itself in the waiting queue
-#if defined(WIN32) || defined(_WIN64)
-			j = WaitForMultipleObjects(
-				THREADS,
-				queue_events,
-				FALSE,
-				INFINITE);
-#else
-			pthread_cond_wait(&queue_cond, &queue_lock);
-#endif
-		}
-		else
-		{
-			//do some work
-			nfs_threaddata_t *t = thread_data + 0;
-
-			lasieve_launcher(t);
-			*threads_waiting = 1;
-		}
-	}
-
-	//stop worker threads
-	for (i=0; i<THREADS; i++)
-	{
-		if (THREADS > 1)
-			nfs_stop_worker_thread(thread_data + i);
-	}
 
 	return;
 }
-*/
 
 void *lasieve_launcher(void *ptr)
 {
@@ -810,7 +1033,7 @@ void *lasieve_launcher(void *ptr)
 	//used in a multi-threaded environment
 	nfs_threaddata_t *thread_data = (nfs_threaddata_t *)ptr;
 	fact_obj_t *fobj = thread_data->fobj;
-	char syscmd[GSTR_MAXSIZE], tmpstr[GSTR_MAXSIZE], side[GSTR_MAXSIZE];	
+	char syscmd[GSTR_MAXSIZE], side[GSTR_MAXSIZE];	
 	FILE *fid;
 	int cmdret;
 
@@ -849,14 +1072,15 @@ void *lasieve_launcher(void *ptr)
 		if( NFS_ABORT < 1 )
 			NFS_ABORT = 1;
 
-	// count the relations produced
+	// only a clean exit means the whole range was sieved
+	thread_data->finished = (cmdret == 0);
+
+	// the relations produced are ingested and counted by the master
+	// thread (see do_sieving), here we just check that there are some
 	MySleep(100);
 	fid = fopen(thread_data->outfilename,"r");
 	if (fid != NULL)
 	{
-		thread_data->job.current_rels = 0;
-		while (fgets(tmpstr, GSTR_MAXSIZE, fid) != NULL)
-			thread_data->job.current_rels++;
 		fclose(fid);
 	}
 	else
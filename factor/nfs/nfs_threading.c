@@ -112,7 +112,8 @@ void *nfs_worker_thread_main(void *thread_data) {
 	*/
 
 	// specific to different structure of poly selection threading
-	if (t->is_poly_select)
+	// (and of queued lattice sieving)
+	if (t->is_poly_select || t->is_queued)
 	{
 #if defined(WIN32) || defined(_WIN64)
 		t->command = NFS_COMMAND_WAIT;
@@ -148,7 +149,7 @@ void *nfs_worker_thread_main(void *thread_data) {
 		/* signal completion */
 		t->command = NFS_COMMAND_WAIT;
 
-		if (t->is_poly_select)
+		if (t->is_poly_select || t->is_queued)
 		{
 #if defined(WIN32) || defined(_WIN64)
 
@@ -29,7 +29,15 @@ code to the public domain.
 // first few polynomials and the value which maximizes relation discover rate
 // is chosen.
 //#define OPT_DEBUG
-
+
+static dynamic_conf_t *alloc_result_shell(void);
+static void free_result_shell(dynamic_conf_t *shell);
+static void reset_result_counters(dynamic_conf_t *dconf);
+static void swap_result_shell(dynamic_conf_t *dconf, dynamic_conf_t *shell);
+static void notify_master(thread_sievedata_t *t);
+static void worker_sieve_polys(thread_sievedata_t *t);
+static void read_saved_params(static_conf_t *sconf);
+
 void SIQS(fact_obj_t *fobj)
 {
 	//the input fobj->N and this 'n' are pointers to memory which holds
@@ -45,8 +53,8 @@ void SIQS(fact_obj_t *fobj)
 	static_conf_t *static_conf;
 
     // thread work-queue controls
-    int threads_working = 0;
-    int *thread_queue, *threads_waiting;
+    int next_tid;
+    int *threads_waiting;
 #if defined(WIN32) || defined(_WIN64)
 	HANDLE queue_lock;
 	HANDLE *queue_events = NULL;
@@ -75,9 +83,10 @@ void SIQS(fact_obj_t *fobj)
 	int i;
 	clock_t start, stop;
 	double t_time;
-	struct timeval myTVend, optstart;
+	struct timeval myTVend, optstart, sqrtstart;
 	TIME_DIFF *	difference;
 	int updatecode = 0;
+	uint64 prof_t = 0;
 
 	//adaptive tf_small_cutoff variables
 	double rels_per_sec_avg = 0.0;
@@ -173,8 +182,7 @@ void SIQS(fact_obj_t *fobj)
 	static_conf = (static_conf_t *)malloc(sizeof(static_conf_t));
 	static_conf->obj = fobj;
 
-    // allocate the queue of threads waiting for work
-    thread_queue = (int *)malloc(THREADS * sizeof(int));
+    // allocate the count of thread notifications not yet seen by the master
     threads_waiting = (int *)malloc(sizeof(int));
 
 	if (THREADS > 1)
@@ -197,9 +205,9 @@ void SIQS(fact_obj_t *fobj)
 		thread_data[i].dconf = (dynamic_conf_t *)malloc(sizeof(dynamic_conf_t));
 		thread_data[i].sconf = static_conf;
 		thread_data[i].tindex = i;
-		// assign all thread's a pointer to the waiting queue.  access to 
-		// the array will be controlled by a mutex
-        thread_data[i].thread_queue = thread_queue;
+		// assign all thread's a pointer to the notification count.  access 
+		// to it will be controlled by a mutex
+        thread_data[i].thread_queue = NULL;
         thread_data[i].threads_waiting = threads_waiting;
 
 		if (THREADS > 1)
@@ -260,6 +268,7 @@ void SIQS(fact_obj_t *fobj)
 		static_conf->in_mem_relations = (siqs_r *)malloc(32768 * sizeof(siqs_r));
 		static_conf->buffered_rel_alloc = 32768;
 		static_conf->buffered_rels = 0;
+		qs_arena_init(&static_conf->in_mem_arena);
 	}
 	else
 		static_conf->in_mem = 0;
@@ -273,10 +282,17 @@ void SIQS(fact_obj_t *fobj)
 	siqs_check_restart(thread_data[0].dconf, static_conf);
 	print_siqs_splash(thread_data[0].dconf, static_conf);
 
+	//hand savefile output off to a background writer
+	if (static_conf->in_mem)
+		static_conf->writer = NULL;
+	else
+		static_conf->writer = qs_writer_start(&static_conf->obj->qs_obj.savefile);
+
 	//start the process
 	num_needed = static_conf->factor_base->B + static_conf->num_extra_relations;
 	num_found = static_conf->num_r;
 	static_conf->total_poly_a = -1;
+	static_conf->num_poly_a_gen = 0;
 
 #ifdef OPT_DEBUG
 	optfile = fopen("optfile.csv","a");
@@ -292,278 +308,263 @@ void SIQS(fact_obj_t *fobj)
 	num_meas = 0;
 	orig_value = static_conf->tf_small_cutoff;
 
+	// the pool of poly 'a' values is kept a few 'a' per thread deep
+	static_conf->stop_sieving = 0;
+	qs_apool_init(static_conf, QS_APOOL_DEPTH_PER_THREAD * THREADS);
+
 	if (THREADS > 1)
 	{
-		// Activate the worker threads one at a time. 
-		// Initialize the work queue to say all threads are waiting for work
-		for (i = 0; i < THREADS; i++) 
+		// Activate the worker threads one at a time, each with its
+		// own ring of result shells
+		for (i = 0; i < THREADS; i++)
 		{
+			for (j = 0; j < QS_RESULT_SLOTS; j++)
+				thread_data[i].results[j] = alloc_result_shell();
+			thread_data[i].res_head = 0;
+			thread_data[i].res_tail = 0;
 			start_worker_thread(thread_data + i);
-			thread_queue[i] = i;
 		}
 	}
-    *threads_waiting = THREADS;
+    *threads_waiting = 0;
 
           /*
             MASTER THREAD:
 
             Start N threads  // so there are really N+1 threads: N workers doing poly processing plus one master
-            initialize thread queue to contain all thread IDs
+            fill the poly 'a' pool
+            signal every thread with COMMAND_RUN
 
-            lock queue mutex
             while (1) {
 
-              while (waiting threads queue is non-empty) {
-                pull thread id T from queue
-
-                if (T has results) {   // only false on first dispatch to T
-                  siqs_merge_data(T)
+              for each thread T, starting with the last one merged {
+                while (T's result ring is non-empty) {
+                  siqs_merge_data(oldest shell in T's ring)
                   do SIQS opt code
-                  free T's sieving structures
+                  reset the shell's relation storage and counters
                   update_check()
-                  re-allocate sieving structure
-                  threads_working--
-                }
+                  hand the shell back to T
 
-                if (num_found < num_needed) {  // could optimize here to predict when enough threads are in flight
-                  new_poly_a(T)
-                  signal T to start with COMMAND_RUN (same as current code)
-                  threads_working++
+                  if (num_found >= num_needed) set stop_sieving
+                  else top up the poly 'a' pool
                 }
               }
 
-              if (threads_working == 0) break;
+              if (stop_sieving and all threads are waiting and all rings are empty) break;
 
-              // waiting threads queue is now empty
-              wait on thread queue condition (unlocks queue mutex)
-              // when cond_wait returns, a thread is waiting for work
+              lock queue mutex
+              wait until some thread has posted a notification
+              unlock queue mutex
             }
 
 
             WORKER THREADS:
 
-            while (1) {
-              wait for COMMAND_RUN (same as current code)
+            wait for COMMAND_RUN (same as current code)
+            while (!stop_sieving) {
+              take an 'a' from the pool, or generate one if the pool is empty
               process_poly()
-              set COMMAND_WAIT
-
-              lock queue mutex
-              add my TID to the queue
-              signal queue condition
-              unlock queue mutex
+              wait for a free shell in my result ring (only if the master is far behind)
+              swap my relation buffers and counters into it, and publish it
+              notify the master
             }
+            set COMMAND_WAIT and notify the master
            */
 
-        // Master thread begins with the workqueue locked
-
 	if (THREADS > 1)
 	{
+		if (num_found < num_needed)
+		{
+			// fill the pool and set all of the threads sieving.  from here on
+			// they draw their own 'a' values and never wait on the master
+			qs_apool_fill(static_conf);
+
+			for (i = 0; i < THREADS; i++)
+			{
 #if defined(WIN32) || defined(_WIN64)
-		// nothing
+				thread_data[i].command = COMMAND_RUN;
+				SetEvent(thread_data[i].run_event);
 #else
-		pthread_mutex_lock(&queue_lock);
+				pthread_mutex_lock(&thread_data[i].run_lock);
+				thread_data[i].command = COMMAND_RUN;
+				pthread_cond_signal(&thread_data[i].run_cond);
+				pthread_mutex_unlock(&thread_data[i].run_lock);
 #endif
+			}
+		}
+		else
+			static_conf->stop_sieving = 1;
 	}
 
+	next_tid = 0;
     while (1)
 	{
+		dynamic_conf_t *rconf = NULL;
+		thread_sievedata_t *t = NULL;
 
-		// Process threads until there are no more waiting for their results to be collected
-		while (*threads_waiting > 0)
+		if (THREADS == 1)
 		{
-			int tid;
-			
-			if (THREADS > 1)
+			// if we have enough relations, or if there was a break signal, stop
+			if ((updatecode != 0) || (num_found >= num_needed))
+				break;
+
+			QS_PROF_START(thread_data[0].dconf, prof_t);
+			qs_apool_get(static_conf, thread_data[0].dconf->curr_poly);
+			QS_PROF_LAP(thread_data[0].dconf, prof_t, QS_PROF_ROOTS);
+
+			//do some work
+			process_poly(thread_data);
+			rconf = thread_data[0].dconf;
+		}
+		else
+		{
+			// the threads are all finished once they have seen the stop flag
+			// and gone back to waiting.  check this before looking at the
+			// rings, so that a result posted just before a thread stopped
+			// isn't missed.
+			alldone = static_conf->stop_sieving;
+			for (j = 0; j < (uint32)THREADS; j++)
 			{
-				// Pop a waiting thread off the queue (OK, it's stack not a queue)
-#if defined(WIN32) || defined(_WIN64)
-				WaitForSingleObject( 
-					queue_lock,    // handle to mutex
-					INFINITE);  // no time-out interval
-#endif
-  
-				tid = thread_queue[--(*threads_waiting)];
+				if (thread_data[j].command != COMMAND_WAIT)
+					alldone = 0;
+			}
+			QS_BARRIER();
 
+			// take the oldest result from the next thread with any, staying
+			// on that thread until its ring is drained
+			for (j = 0; j < (uint32)THREADS; j++)
+			{
+				t = thread_data + ((next_tid + j) % THREADS);
+				if (t->res_tail != t->res_head)
+				{
+					QS_BARRIER();
+					rconf = t->results[t->res_tail % QS_RESULT_SLOTS];
+					next_tid = t->tindex;
+					break;
+				}
+			}
+
+			if (rconf == NULL)
+			{
+				if (alldone)
+					break;
+
+				// wait for a thread to post a result or finish
 #if defined(WIN32) || defined(_WIN64)
+				WaitForSingleObject(queue_lock, INFINITE);
+				j = *threads_waiting;
+				*threads_waiting = 0;
 				ReleaseMutex(queue_lock);
+
+				if (j == 0)
+				{
+					WaitForMultipleObjects(
+						THREADS,
+						queue_events,
+						FALSE,
+						INFINITE);
+				}
+#else
+				pthread_mutex_lock(&queue_lock);
+				while (*threads_waiting == 0)
+					pthread_cond_wait(&queue_cond, &queue_lock);
+				*threads_waiting = 0;
+				pthread_mutex_unlock(&queue_lock);
 #endif
+				continue;
 			}
-            else
-            {
-                tid = 0;
-            }
+		}
 
-			// Check whether the thread has any results to collect. This should only be false at the 
-			// very beginning, when the thread hasn't actually done anything yet.
-			if (thread_data[tid].dconf->buffered_rels)
-			{				
-				num_found = siqs_merge_data(thread_data[tid].dconf,static_conf);
+		QS_PROF_START(static_conf, prof_t);
+		num_found = siqs_merge_data(rconf, static_conf);
+		QS_PROF_LAP(static_conf, prof_t, QS_PROF_MERGE);
 
-				if (fobj->qs_obj.no_small_cutoff_opt == 0) 
-				{
-                    int	poly_start_num = 0;
+		if (fobj->qs_obj.no_small_cutoff_opt == 0) 
+		{
+			int poly_start_num = 0;
 
-					if (num_meas < 3)
-					{			
-						if (averaged_polys >= num_avg)
-						{
-							poly_start_num = static_conf->total_poly_a;
-							results[num_meas] = rels_per_sec_avg / (double)averaged_polys;						
+			if (num_meas < 3)
+			{			
+				if (averaged_polys >= num_avg)
+				{
+					poly_start_num = static_conf->total_poly_a;
+					results[num_meas] = rels_per_sec_avg / (double)averaged_polys;						
 
 #ifdef OPT_DEBUG
-							fprintf(optfile,"%d,%d,%f,%d\n",num_meas,static_conf->total_poly_a,
-									results[num_meas], static_conf->tf_small_cutoff);
+					fprintf(optfile,"%d,%d,%f,%d\n",num_meas,static_conf->total_poly_a,
+							results[num_meas], static_conf->tf_small_cutoff);
 #endif
 
-							rels_per_sec_avg = 0.0;
-							averaged_polys = 0;
+					rels_per_sec_avg = 0.0;
+					averaged_polys = 0;
 
-							if (num_meas == 0)
-							{
-								static_conf->tf_small_cutoff = orig_value + 5;
-							}
-							else if (num_meas == 1)
-							{
-								static_conf->tf_small_cutoff = orig_value - 5;
-							}
-							else
-							{
-								//we've got our three measurements, make a decision.
-								//the experimental results need to be convincingly better
-								//in order to switch to a different value.  2% for numbers
-								//with one LP, 5% for DLP.
-								if (static_conf->use_dlp)
-									results[0] *= 1.05;
-								else
-									results[0] *= 1.02;
-
-								if (results[0] > results[1])
-								{
-									if (results[0] > results[2])
-										static_conf->tf_small_cutoff = orig_value;
-									else
-										static_conf->tf_small_cutoff = orig_value - 5;
-								}
-								else
-								{
-									if (results[1] > results[2])
-										static_conf->tf_small_cutoff = orig_value + 5;
-									else
-										static_conf->tf_small_cutoff = orig_value - 5;
-								}	
-#ifdef OPT_DEBUG
-								fprintf(optfile,"final value = %d\n",static_conf->tf_small_cutoff);
-#endif
-							}
+					if (num_meas == 0)
+					{
+						static_conf->tf_small_cutoff = orig_value + 5;
+					}
+					else if (num_meas == 1)
+					{
+						static_conf->tf_small_cutoff = orig_value - 5;
+					}
+					else
+					{
+						//we've got our three measurements, make a decision.
+						//the experimental results need to be convincingly better
+						//in order to switch to a different value.  2% for numbers
+						//with one LP, 5% for DLP.
+						if (static_conf->use_dlp)
+							results[0] *= 1.05;
+						else
+							results[0] *= 1.02;
 
-							num_meas++;
+						if (results[0] > results[1])
+						{
+							if (results[0] > results[2])
+								static_conf->tf_small_cutoff = orig_value;
+							else
+								static_conf->tf_small_cutoff = orig_value - 5;
 						}
 						else
 						{
-							rels_per_sec_avg += thread_data[tid].dconf->rels_per_sec;
-							averaged_polys++;
-						}
-					}
-				}
-
-				// free sieving structure
-				for (j=0; j<thread_data[tid].dconf->buffered_rels; j++)
-					free(thread_data[tid].dconf->relation_buf[j].fb_offsets);
-				thread_data[tid].dconf->num = 0;
-				thread_data[tid].dconf->tot_poly = 0;
-				thread_data[tid].dconf->buffered_rels = 0;
-				thread_data[tid].dconf->attempted_squfof = 0;
-				thread_data[tid].dconf->failed_squfof = 0;
-				thread_data[tid].dconf->dlp_outside_range = 0;
-				thread_data[tid].dconf->dlp_prp = 0;
-				thread_data[tid].dconf->dlp_useful = 0;
-                thread_data[tid].dconf->total_blocks = 0;
-                thread_data[tid].dconf->total_reports = 0;
-                thread_data[tid].dconf->total_surviving_reports = 0;
-                thread_data[tid].dconf->lp_scan_failures = 0;
-                thread_data[tid].dconf->num_64bit_residue = 0;
-
-#ifdef HAVE_CUDA
-				thread_data[tid].dconf->num_squfof_cand = 0;
-#endif
-
-				//check whether to continue or not, and update the screen
-				updatecode = update_check(static_conf);
-
-				// this thread is done, so decrement the count of working threads
-				threads_working--;
-			}
-
-			// if we have enough relations, or if there was a break signal, stop dispatching
-			// any more threads
-			if ((updatecode == 0) && (num_found < num_needed)) 
-			{
-
-#ifdef QS_TIMING
-				gettimeofday (&qs_timing_start, NULL);
-#endif
-				// generate a new poly A value for the thread we pulled out of the queue
-				// using its dconf.  this is done by the master thread because it also 
-				// stores the coefficients in a master list
-				static_conf->total_poly_a++;
-				new_poly_a(static_conf,thread_data[tid].dconf);
-
-#ifdef QS_TIMING
-				gettimeofday (&qs_timing_stop, NULL);
-				qs_timing_diff = my_difftime (&qs_timing_start, &qs_timing_stop);
-
-				POLY_STG0 += ((double)qs_timing_diff->secs + (double)qs_timing_diff->usecs / 1000000);
-				free(qs_timing_diff);
+							if (results[1] > results[2])
+								static_conf->tf_small_cutoff = orig_value + 5;
+							else
+								static_conf->tf_small_cutoff = orig_value - 5;
+						}	
+#ifdef OPT_DEBUG
+						fprintf(optfile,"final value = %d\n",static_conf->tf_small_cutoff);
 #endif
+					}
 
-				if (THREADS > 1)
+					num_meas++;
+				}
+				else
 				{
-					// send the thread a signal to start processing the poly we just generated for it
-#if defined(WIN32) || defined(_WIN64)
-					thread_data[tid].command = COMMAND_RUN;
-					SetEvent(thread_data[tid].run_event);
-#else
-					pthread_mutex_lock(&thread_data[tid].run_lock);
-					thread_data[tid].command = COMMAND_RUN;
-					pthread_cond_signal(&thread_data[tid].run_cond);
-					pthread_mutex_unlock(&thread_data[tid].run_lock);
-#endif
+					rels_per_sec_avg += rconf->rels_per_sec;
+					averaged_polys++;
 				}
-				
-				// this thread is now busy, so increment the count of working threads
-				threads_working++;
 			}
+		}
 
-			if (THREADS == 1)
-				*threads_waiting = 0;
-	
-		} // while (*threads_waiting > 0)
+		// release the relation storage all at once
+		qs_arena_reset(&rconf->rel_arena);
+		reset_result_counters(rconf);
 
-		// if all threads are done, break out
-		if (threads_working == 0)
-			break;
+		//check whether to continue or not, and update the screen
+		updatecode = update_check(static_conf);
 
 		if (THREADS > 1)
 		{
-			// wait for a thread to finish and put itself in the waiting queue
-#if defined(WIN32) || defined(_WIN64)
-			j = WaitForMultipleObjects(
-				THREADS,
-				queue_events,
-				FALSE,
-				INFINITE);
-#else
-			pthread_cond_wait(&queue_cond, &queue_lock);
-#endif
-		}
-		else
-		{
-			//do some work
-			thread_sievedata_t *t = thread_data + 0;
-
-            //printf("processing polynomial\n");
-			process_poly(t);
-			*threads_waiting = 1;
+			// hand the shell back to its thread
+			QS_BARRIER();
+			t->res_tail++;
+
+			// if we have enough relations, or if there was a break signal,
+			// stop the threads after their current poly.  otherwise top up
+			// the pool while they are busy.
+			if ((updatecode != 0) || (num_found >= num_needed))
+				static_conf->stop_sieving = 1;
+			else
+				qs_apool_fill(static_conf);
 		}
 	}
 
@@ -577,20 +578,33 @@ void SIQS(fact_obj_t *fobj)
 	{
 		//static_conf->tot_poly += thread_data[i].dconf->tot_poly;
 		if (THREADS > 1)
+		{
 			stop_worker_thread(thread_data + i);
+			for (j = 0; j < QS_RESULT_SLOTS; j++)
+				free_result_shell(thread_data[i].results[j]);
+		}
+		qs_prof_merge(static_conf, thread_data[i].dconf);
 		free_sieve(thread_data[i].dconf);
 		free(thread_data[i].dconf->relation_buf);
+		qs_arena_free(&thread_data[i].dconf->rel_arena);
 #ifdef HAVE_CUDA
 		free(thread_data[i].dconf->squfof_candidates);
 		free(thread_data[i].dconf->buf_id);
 #endif
 	}
 
+	qs_apool_free(static_conf);
+
 #ifdef HAVE_CUDA
 	cuCtxDetach(static_conf->cuContext);
 #endif
 	
 	//finialize savefile
+	if (static_conf->writer != NULL)
+	{
+		qs_writer_stop(static_conf->writer);
+		static_conf->writer = NULL;
+	}
 	qs_savefile_flush(&static_conf->obj->qs_obj.savefile);
 	qs_savefile_close(&static_conf->obj->qs_obj.savefile);		
 	
@@ -603,7 +617,7 @@ void SIQS(fact_obj_t *fobj)
 	//can use it (unless we are doing in-mem)
 	if (!static_conf->in_mem)
 	{
-		for (i=0;i<static_conf->total_poly_a + 1;i++)
+		for (i=0;i<static_conf->num_poly_a_gen;i++)
 			mpz_clear(static_conf->poly_a_list[i]);
 		free(static_conf->poly_a_list);
 	}
@@ -652,8 +666,9 @@ void SIQS(fact_obj_t *fobj)
 	stop = clock();
 	static_conf->t_time1 = (double)(stop - start)/(double)CLOCKS_PER_SEC;
 
-	start = clock();
-	//sqrt stage
+	//sqrt stage.  it runs on several threads, so time it
+	//by the wall clock
+	gettimeofday (&sqrtstart, NULL);
 	if (bitfield != NULL && num_cycles > 0) 
 	{
 	
@@ -665,8 +680,10 @@ void SIQS(fact_obj_t *fobj)
 					
 	}
 
-	stop = clock();
-	static_conf->t_time2= (double)(stop - start)/(double)CLOCKS_PER_SEC;
+	gettimeofday (&myTVend, NULL);
+	difference = my_difftime (&sqrtstart, &myTVend);
+	static_conf->t_time2 = ((double)difference->secs + (double)difference->usecs / 1000000);
+	free(difference);
 
 	gettimeofday (&myTVend, NULL);
 	difference = my_difftime (&static_conf->totaltime_start, &myTVend);
@@ -715,7 +732,6 @@ done:
 	}
 	free(static_conf);
 	free(thread_data);
-    free(thread_queue);
     free(threads_waiting);
 
 #if defined(WIN32) || defined(_WIN64)
@@ -807,39 +823,21 @@ void *worker_thread_main(void *thread_data) {
 			pthread_cond_wait(&t->run_cond, &t->run_lock);
 		}
 #endif
-		/* do work */
-
-		if (t->command == COMMAND_RUN)
-			process_poly(t);
-		else if (t->command == COMMAND_END)
-			break;
-
-		/* signal completion */
-
-		t->command = COMMAND_WAIT;
-#if defined(WIN32) || defined(_WIN64)
-
-		WaitForSingleObject( 
-            *t->queue_lock,    // handle to mutex
-            INFINITE);  // no time-out interval
- 
-		t->thread_queue[(*(t->threads_waiting))++] = t->tindex;
-		SetEvent(*t->queue_event);
+		/* do work */
 
-		ReleaseMutex(*t->queue_lock);
-		
-#else
-		pthread_mutex_unlock(&t->run_lock);
-
-        // lock the work queue and insert my thread ID into it
-        // this tells the master that my results should be collected
-        // and I should be dispatched another polynomial
-        pthread_mutex_lock(t->queue_lock);
-        t->thread_queue[(*(t->threads_waiting))++] = t->tindex;
-        pthread_cond_signal(t->queue_cond);
-        pthread_mutex_unlock(t->queue_lock);
-#endif
-	}
+		if (t->command == COMMAND_RUN)
+			worker_sieve_polys(t);
+		else if (t->command == COMMAND_END)
+			break;
+
+		/* signal completion */
+
+		t->command = COMMAND_WAIT;
+#if !defined(WIN32) && !defined(_WIN64)
+		pthread_mutex_unlock(&t->run_lock);
+#endif
+		notify_master(t);
+	}
 
 #if defined(WIN32) || defined(_WIN64)
 	return 0;
@@ -848,6 +846,167 @@ void *worker_thread_main(void *thread_data) {
 #endif
 }
 
+static void notify_master(thread_sievedata_t *t)
+{
+	// bump the count of notifications and wake the master.
+	// this tells the master that I have results to be collected
+	// or that I have stopped sieving
+#if defined(WIN32) || defined(_WIN64)
+	WaitForSingleObject( 
+        *t->queue_lock,    // handle to mutex
+        INFINITE);  // no time-out interval
+
+	(*(t->threads_waiting))++;
+	SetEvent(*t->queue_event);
+
+	ReleaseMutex(*t->queue_lock);
+#else
+    pthread_mutex_lock(t->queue_lock);
+    (*(t->threads_waiting))++;
+    pthread_cond_signal(t->queue_cond);
+    pthread_mutex_unlock(t->queue_lock);
+#endif
+	return;
+}
+
+static void worker_sieve_polys(thread_sievedata_t *t)
+{
+	// sieve 'a' values drawn from the pool until the master has
+	// enough relations, handing the relations from each one back
+	// through this thread's result ring
+	static_conf_t *sconf = t->sconf;
+	dynamic_conf_t *dconf = t->dconf;
+
+	uint64 prof_t = 0;
+
+	while (!sconf->stop_sieving)
+	{
+		QS_PROF_START(dconf, prof_t);
+		qs_apool_get(sconf, dconf->curr_poly);
+		QS_PROF_LAP(dconf, prof_t, QS_PROF_ROOTS);
+		process_poly(t);
+
+		// the ring only fills up if the master falls far behind
+		while ((t->res_head - t->res_tail) >= QS_RESULT_SLOTS)
+			MySleep(1);
+
+		QS_BARRIER();
+		swap_result_shell(dconf, t->results[t->res_head % QS_RESULT_SLOTS]);
+		QS_BARRIER();
+		t->res_head++;
+
+		notify_master(t);
+	}
+
+	return;
+}
+
+static dynamic_conf_t *alloc_result_shell(void)
+{
+	// only the parts of a dynamic_conf_t that siqs_merge_data
+	// reads are allocated
+	dynamic_conf_t *shell = (dynamic_conf_t *)malloc(sizeof(dynamic_conf_t));
+
+	shell->curr_poly = (siqs_poly *)malloc(sizeof(siqs_poly));
+	mpz_init(shell->curr_poly->mpz_poly_a);
+	shell->relation_buf = (siqs_r *)malloc(32768 * sizeof(siqs_r));
+	shell->buffered_rel_alloc = 32768;
+	qs_arena_init(&shell->rel_arena);
+#ifdef HAVE_CUDA
+	shell->squfof_candidates = (uint64 *)malloc(32768 * sizeof(uint64));
+	shell->buf_id = (uint32 *)malloc(32768 * sizeof(uint32));
+#endif
+	reset_result_counters(shell);
+
+	return shell;
+}
+
+static void free_result_shell(dynamic_conf_t *shell)
+{
+	mpz_clear(shell->curr_poly->mpz_poly_a);
+	free(shell->curr_poly);
+	free(shell->relation_buf);
+	qs_arena_free(&shell->rel_arena);
+#ifdef HAVE_CUDA
+	free(shell->squfof_candidates);
+	free(shell->buf_id);
+#endif
+	free(shell);
+	return;
+}
+
+static void reset_result_counters(dynamic_conf_t *dconf)
+{
+	dconf->num = 0;
+	dconf->tot_poly = 0;
+	dconf->buffered_rels = 0;
+	dconf->attempted_squfof = 0;
+	dconf->failed_squfof = 0;
+	dconf->dlp_outside_range = 0;
+	dconf->dlp_prp = 0;
+	dconf->dlp_useful = 0;
+	dconf->attempted_tlp = 0;
+	dconf->tlp_useful = 0;
+    dconf->total_blocks = 0;
+    dconf->total_reports = 0;
+    dconf->total_surviving_reports = 0;
+    dconf->lp_scan_failures = 0;
+    dconf->num_64bit_residue = 0;
+	dconf->rels_per_sec = 0.0;
+
+#ifdef HAVE_CUDA
+	dconf->num_squfof_cand = 0;
+#endif
+	return;
+}
+
+static void swap_result_shell(dynamic_conf_t *dconf, dynamic_conf_t *shell)
+{
+	// trade this thread's relation storage for the (empty) storage
+	// in the shell, and move the counters across with it
+	siqs_r *relation_buf = shell->relation_buf;
+	uint32 buffered_rel_alloc = shell->buffered_rel_alloc;
+	qs_arena_t rel_arena = shell->rel_arena;
+#ifdef HAVE_CUDA
+	uint64 *squfof_candidates = shell->squfof_candidates;
+	uint32 *buf_id = shell->buf_id;
+#endif
+
+	shell->relation_buf = dconf->relation_buf;
+	shell->buffered_rel_alloc = dconf->buffered_rel_alloc;
+	shell->rel_arena = dconf->rel_arena;
+	dconf->relation_buf = relation_buf;
+	dconf->buffered_rel_alloc = buffered_rel_alloc;
+	dconf->rel_arena = rel_arena;
+#ifdef HAVE_CUDA
+	shell->squfof_candidates = dconf->squfof_candidates;
+	shell->buf_id = dconf->buf_id;
+	dconf->squfof_candidates = squfof_candidates;
+	dconf->buf_id = buf_id;
+	shell->num_squfof_cand = dconf->num_squfof_cand;
+#endif
+
+	mpz_set(shell->curr_poly->mpz_poly_a, dconf->curr_poly->mpz_poly_a);
+	shell->buffered_rels = dconf->buffered_rels;
+	shell->num = dconf->num;
+	shell->tot_poly = dconf->tot_poly;
+	shell->attempted_squfof = dconf->attempted_squfof;
+	shell->failed_squfof = dconf->failed_squfof;
+	shell->dlp_outside_range = dconf->dlp_outside_range;
+	shell->dlp_prp = dconf->dlp_prp;
+	shell->dlp_useful = dconf->dlp_useful;
+	shell->attempted_tlp = dconf->attempted_tlp;
+	shell->tlp_useful = dconf->tlp_useful;
+    shell->total_blocks = dconf->total_blocks;
+    shell->total_reports = dconf->total_reports;
+    shell->total_surviving_reports = dconf->total_surviving_reports;
+    shell->lp_scan_failures = dconf->lp_scan_failures;
+	shell->rels_per_sec = dconf->rels_per_sec;
+
+	reset_result_counters(dconf);
+	return;
+}
+
 void *process_poly(void *ptr)
 //void process_hypercube(static_conf_t *sconf,dynamic_conf_t *dconf)
 {
@@ -864,13 +1023,13 @@ void *process_poly(void *ptr)
     siqs_poly *poly = dconf->curr_poly;
     uint8 *sieve = dconf->sieve;
     fb_list *fb = sconf->factor_base;
-    lp_bucket *buckets = dconf->buckets;
     uint32 start_prime = sconf->sieve_small_fb_start;
     uint32 num_blocks = sconf->num_blocks;
     uint8 blockinit = sconf->blockinit;
 
     //locals
     uint32 i;
+    uint64 prof_t = 0;
 
     //to get relations per second
     double t_time;
@@ -883,11 +1042,8 @@ void *process_poly(void *ptr)
 
     //lock_thread_to_core();
 
-#ifdef QS_TIMING
-    gettimeofday (&qs_timing_start, NULL);
-#endif
-
     gettimeofday(&start, NULL);
+    QS_PROF_START(dconf, prof_t);
 
     // used to print a little more status info for huge jobs.
     if (sconf->digits_n > 110)
@@ -901,15 +1057,12 @@ void *process_poly(void *ptr)
     dconf->numB = 1;
     computeBl(sconf, dconf);
 
+    //the first poly's buckets are filled as usual, into the first set
+    dconf->buckets = dconf->bucket_sets;
+    dconf->batch_pos = 0;
+    dconf->batch_len = 1;
     firstRoots_ptr(sconf, dconf);
-
-#ifdef QS_TIMING
-    gettimeofday (&qs_timing_stop, NULL);
-    qs_timing_diff = my_difftime (&qs_timing_start, &qs_timing_stop);
-    POLY_STG1 += 
-        ((double)qs_timing_diff->secs + (double)qs_timing_diff->usecs / 1000000);
-    free(qs_timing_diff);
-#endif
+    QS_PROF_LAP(dconf, prof_t, QS_PROF_ROOTS);
 
     //loop over each possible b value, for the current a value
     for (; dconf->numB < dconf->maxB; dconf->numB++, dconf->tot_poly++)
@@ -927,8 +1080,10 @@ void *process_poly(void *ptr)
             set_aprime_roots(sconf, invalid_root_marker, poly->qlisort, poly->s, fb_sieve_p, 1);
             //printf("medsieve p\n"); fflush(stdout);
             med_sieve_ptr(sieve, fb_sieve_p, fb, start_prime, blockinit);
+            QS_PROF_LAP(dconf, prof_t, QS_PROF_MED_SIEVE);
             //printf("lpsieve p\n"); fflush(stdout);
-            lp_sieveblock(sieve, i, num_blocks, buckets, 0, dconf);
+            lp_sieveblock(sieve, i, num_blocks, dconf->buckets, 0, dconf);
+            QS_PROF_LAP(dconf, prof_t, QS_PROF_LP_SIEVE);
 
             //set the roots for the factors of a to force the following routine
             //to explicitly trial divide since we haven't found roots for them
@@ -936,6 +1091,7 @@ void *process_poly(void *ptr)
             set_aprime_roots(sconf, invalid_root_marker, poly->qlisort, poly->s, fb_sieve_p, 0);
             //printf("scan p\n"); fflush(stdout);
             scan_ptr(i, 0, sconf, dconf);
+            QS_PROF_START(dconf, prof_t);
 
             //set the roots for the factors of a such that
             //they will not be sieved.  we haven't found roots for them
@@ -943,8 +1099,10 @@ void *process_poly(void *ptr)
             set_aprime_roots(sconf, invalid_root_marker, poly->qlisort, poly->s, fb_sieve_n, 1);
             //printf("medsieve n\n"); fflush(stdout);
             med_sieve_ptr(sieve, fb_sieve_n, fb, start_prime, blockinit);
+            QS_PROF_LAP(dconf, prof_t, QS_PROF_MED_SIEVE);
             //printf("lpsieve n\n"); fflush(stdout);
-            lp_sieveblock(sieve, i, num_blocks, buckets, 1, dconf);
+            lp_sieveblock(sieve, i, num_blocks, dconf->buckets, 1, dconf);
+            QS_PROF_LAP(dconf, prof_t, QS_PROF_LP_SIEVE);
 
             //set the roots for the factors of a to force the following routine
             //to explicitly trial divide since we haven't found roots for them
@@ -952,6 +1110,7 @@ void *process_poly(void *ptr)
             set_aprime_roots(sconf, invalid_root_marker, poly->qlisort, poly->s, fb_sieve_n, 0);
             //printf("scan p\n"); fflush(stdout);
             scan_ptr(i, 1, sconf, dconf);
+            QS_PROF_START(dconf, prof_t);
 
         }
 
@@ -985,17 +1144,25 @@ void *process_poly(void *ptr)
         //next polynomial
         //use the stored Bl's and the gray code to find the next b
         //printf("next B\n"); fflush(stdout);
+        QS_PROF_START(dconf, prof_t);
         nextB(dconf, sconf);
         //and update the roots
         //printf("next roots\n"); fflush(stdout);
         nextRoots_ptr(sconf, dconf);
+        if (dconf->poly_batch > 1)
+            nextRoots_32k_batch(sconf, dconf);
+        QS_PROF_LAP(dconf, prof_t, QS_PROF_ROOTS);
 
     }
 
 
 
 #ifdef USE_VEC_SQUFOF
-    // vector SQUFOF if necessary
+    // vector SQUFOF if necessary.  the residues aren't screened with a
+    // batch gcd first: the dlp size window and the prp test in tdiv 
+    // leave few that won't split into two large primes (~5% at c79), 
+    // too few to pay for a remainder tree even over 1e5 residues.
+    QS_PROF_START(dconf, prof_t);
     if (sconf->use_dlp)
     {
         uint64 *f = dconf->residue_factors;
@@ -1101,6 +1268,7 @@ void *process_poly(void *ptr)
         }
         
     }
+    QS_PROF_LAP(dconf, prof_t, QS_PROF_SQUFOF);
 #endif
 
 
@@ -1128,13 +1296,14 @@ uint32 siqs_merge_data(dynamic_conf_t *dconf, static_conf_t *sconf)
 	//this table and save relations out to disk
 	uint32 i;
 	siqs_r *rel;
-	char buf[1024];
 
 	// save the A value.
-	if (!sconf->in_mem)
+	if (sconf->writer != NULL)
+		qs_writer_push_a(sconf->writer, dconf->curr_poly->mpz_poly_a);
+	else if (!sconf->in_mem)
 	{
-		gmp_sprintf(buf,"A 0x%Zx\n", dconf->curr_poly->mpz_poly_a);
-		qs_savefile_write_line(&sconf->obj->qs_obj.savefile,buf);
+		qs_savefile_write_a(&sconf->obj->qs_obj.savefile, 
+			dconf->curr_poly->mpz_poly_a);
 	}
 
 #ifdef HAVE_CUDA
@@ -1269,6 +1438,8 @@ uint32 siqs_merge_data(dynamic_conf_t *dconf, static_conf_t *sconf)
 	sconf->dlp_outside_range += dconf->dlp_outside_range;
 	sconf->dlp_prp += dconf->dlp_prp;
 	sconf->dlp_useful += dconf->dlp_useful;
+	sconf->attempted_tlp += dconf->attempted_tlp;
+	sconf->tlp_useful += dconf->tlp_useful;
     sconf->lp_scan_failures += dconf->lp_scan_failures;
 
 	//compute total relations found so far
@@ -1282,7 +1453,6 @@ uint32 siqs_merge_data(dynamic_conf_t *dconf, static_conf_t *sconf)
 int siqs_check_restart(dynamic_conf_t *dconf, static_conf_t *sconf)
 {
 	fact_obj_t *obj = sconf->obj;
-	char buf[1024];
 	int state = 0;
 
 	// if we want to do an in-memory factorization, then 
@@ -1314,9 +1484,11 @@ int siqs_check_restart(dynamic_conf_t *dconf, static_conf_t *sconf)
 	{
 		//no relations found, get ready for new factorization
 		//we'll be writing to the savefile as we go, so get it ready
+		obj->qs_obj.savefile.binary = obj->qs_obj.binary_savefile;
 		qs_savefile_open(&obj->qs_obj.savefile,SAVEFILE_WRITE);
-		gmp_sprintf(buf,"N 0x%Zx\n", sconf->obj->qs_obj.gmp_n);
-		qs_savefile_write_line(&obj->qs_obj.savefile,buf);
+		qs_savefile_write_header(&obj->qs_obj.savefile, 
+			sconf->obj->qs_obj.gmp_n, sconf->multiplier,
+			sconf->factor_base->B, sconf->large_prime_max, sconf->use_dlp);
 		qs_savefile_flush(&obj->qs_obj.savefile);
 		qs_savefile_close(&obj->qs_obj.savefile);
 		//and get ready for collecting relations
@@ -1331,7 +1503,7 @@ void print_siqs_splash(dynamic_conf_t *dconf, static_conf_t *sconf)
     //print some info to the screen and the log file
     char inst_set[16];
 
-#ifdef USE_AVX2
+#if defined(SIQS_AVX2_KERNELS)
     if (HAS_AVX2)
     {
         strcpy(inst_set, "AVX2");
@@ -1348,7 +1520,7 @@ void print_siqs_splash(dynamic_conf_t *dconf, static_conf_t *sconf)
     {
         strcpy(inst_set, "generic C");
     }
-#elif defined(USE_SSE41)
+#elif defined(SIQS_SSE41_KERNELS)
     if (HAS_SSE41)
     {
         strcpy(inst_set, "SSE4.1");
@@ -1388,12 +1560,25 @@ void print_siqs_splash(dynamic_conf_t *dconf, static_conf_t *sconf)
             printf("double large prime range from %" PRIu64 " to %" PRIu64 "\n",
                 sconf->max_fb2, sconf->large_prime_max2);
         }
+        if (sconf->use_dlp == 2)
+        {
+            printf("triple large prime range from %d to %d bits\n",
+                sconf->tlp_lower, sconf->tlp_upper);
+        }
         if (dconf->buckets->list != NULL)
         {
             printf("allocating %d large prime slices of factor base\n",
                 dconf->buckets->alloc_slices);
             printf("buckets hold %d elements\n", BUCKET_ALLOC);
+            if (dconf->poly_batch > 1)
+                printf("updating large prime roots %u polys at a time\n",
+                    dconf->poly_batch);
         }
+        printf("sieve arrays per thread: %1.1f MB in explicit huge pages, "
+            "%1.1f MB madvised for THP, %1.1f MB in normal pages\n",
+            (double)dconf->page_bytes[HUGE_PAGE_EXPLICIT] / 1048576.0,
+            (double)dconf->page_bytes[HUGE_PAGE_THP] / 1048576.0,
+            (double)dconf->page_bytes[HUGE_PAGE_NONE] / 1048576.0);
         printf("using %s enabled 32k sieve core\n", inst_set);
         printf("sieve interval: %d blocks of size %d\n",
             sconf->num_blocks, sconf->qs_blocksize);
@@ -1437,12 +1622,25 @@ void print_siqs_splash(dynamic_conf_t *dconf, static_conf_t *sconf)
 			logprint(sconf->obj->logfile,"double large prime cutoff: %" PRIu64 "\n",
 				sconf->large_prime_max2);
 		}
+		if (sconf->use_dlp == 2)
+		{
+			logprint(sconf->obj->logfile,"triple large prime range from %d to %d bits\n",
+				sconf->tlp_lower,sconf->tlp_upper);
+		}
 		if (dconf->buckets->list != NULL)
 		{
 			logprint(sconf->obj->logfile,"allocating %d large prime slices of factor base\n",
 				dconf->buckets->alloc_slices);
 			logprint(sconf->obj->logfile,"buckets hold %d elements\n",BUCKET_ALLOC);
+			if (dconf->poly_batch > 1)
+				logprint(sconf->obj->logfile,"updating large prime roots %u polys at a time\n",
+					dconf->poly_batch);
 		}
+		logprint(sconf->obj->logfile,"sieve arrays per thread: %1.1f MB in explicit huge pages, "
+			"%1.1f MB madvised for THP, %1.1f MB in normal pages\n",
+			(double)dconf->page_bytes[HUGE_PAGE_EXPLICIT] / 1048576.0,
+			(double)dconf->page_bytes[HUGE_PAGE_THP] / 1048576.0,
+			(double)dconf->page_bytes[HUGE_PAGE_NONE] / 1048576.0);
         logprint(sconf->obj->logfile,"using %s enabled 32k sieve core\n", inst_set);
 		logprint(sconf->obj->logfile,"sieve interval: %d blocks of size %d\n",
 			sconf->num_blocks,sconf->qs_blocksize);
@@ -1500,6 +1698,7 @@ int siqs_dynamic_init(dynamic_conf_t *dconf, static_conf_t *sconf)
 	dconf->relation_buf = (siqs_r *)malloc(32768 * sizeof(siqs_r));
 	dconf->buffered_rel_alloc = 32768;
 	dconf->buffered_rels = 0;
+	qs_arena_init(&dconf->rel_arena);
 #ifdef HAVE_CUDA
 	dconf->squfof_candidates = (uint64 *)malloc(32768 * sizeof(uint64));
 	dconf->buf_id = (uint32 *)malloc(32768 * sizeof(uint32));
@@ -1513,6 +1712,7 @@ int siqs_dynamic_init(dynamic_conf_t *dconf, static_conf_t *sconf)
 	}
 
 	//allocate the sieving factor bases
+	memset(dconf->page_bytes, 0, HUGE_PAGE_KINDS * sizeof(uint64));
 
 	dconf->comp_sieve_p = (sieve_fb_compressed *)malloc(sizeof(sieve_fb_compressed));
 	dconf->comp_sieve_n = (sieve_fb_compressed *)malloc(sizeof(sieve_fb_compressed));
@@ -1535,26 +1735,26 @@ int siqs_dynamic_init(dynamic_conf_t *dconf, static_conf_t *sconf)
 	dconf->comp_sieve_n->logp = (uint16 *)xmalloc_align(
 		(size_t)(sconf->factor_base->med_B * sizeof(uint16)));
 
-	dconf->fb_sieve_p = (sieve_fb *)xmalloc_align(
+	dconf->fb_sieve_p = (sieve_fb *)qs_big_alloc(dconf,
 		(size_t)(sconf->factor_base->B * sizeof(sieve_fb)));
-	dconf->fb_sieve_n = (sieve_fb *)xmalloc_align(
+	dconf->fb_sieve_n = (sieve_fb *)qs_big_alloc(dconf,
 		(size_t)(sconf->factor_base->B * sizeof(sieve_fb)));
 	
 	dconf->update_data.sm_firstroots1 = (uint16 *)xmalloc_align(
 		(size_t)(sconf->factor_base->med_B * sizeof(uint16)));
 	dconf->update_data.sm_firstroots2 = (uint16 *)xmalloc_align(
 		(size_t)(sconf->factor_base->med_B * sizeof(uint16)));
-	dconf->update_data.firstroots1 = (int *)xmalloc_align(
+	dconf->update_data.firstroots1 = (int *)qs_big_alloc(dconf,
 		(size_t)(sconf->factor_base->B * sizeof(int)));
-	dconf->update_data.firstroots2 = (int *)xmalloc_align(
+	dconf->update_data.firstroots2 = (int *)qs_big_alloc(dconf,
 		(size_t)(sconf->factor_base->B * sizeof(int)));
-	dconf->update_data.prime = (uint32 *)xmalloc_align(
+	dconf->update_data.prime = (uint32 *)qs_big_alloc(dconf,
 		(size_t)(sconf->factor_base->B * sizeof(uint32)));
-	dconf->update_data.logp = (uint8 *)xmalloc_align(
+	dconf->update_data.logp = (uint8 *)qs_big_alloc(dconf,
 		(size_t)(sconf->factor_base->B * sizeof(uint8)));
-	dconf->rootupdates = (int *)xmalloc_align(
+	dconf->rootupdates = (int *)qs_big_alloc(dconf,
 		(size_t)(MAX_A_FACTORS * sconf->factor_base->B * sizeof(int)));
-	dconf->sm_rootupdates = (uint16 *)xmalloc_align(
+	dconf->sm_rootupdates = (uint16 *)qs_big_alloc(dconf,
 		(size_t)(MAX_A_FACTORS * sconf->factor_base->B * sizeof(uint16)));
 
 
@@ -1620,24 +1820,44 @@ int siqs_dynamic_init(dynamic_conf_t *dconf, static_conf_t *sconf)
 	//check if we should use bucket sieving, and allocate structures if so
 	if (sconf->factor_base->B > sconf->factor_base->med_B)
 	{
-		dconf->buckets = (lp_bucket *)malloc(sizeof(lp_bucket));
+		//with -siqsbatch the large prime roots are updated for a few 
+		//polys at once, each poly needing its own set of buckets
+		dconf->poly_batch = 1;
+		if (sconf->obj->qs_obj.gbl_override_poly_batch_flag)
+			dconf->poly_batch = sconf->obj->qs_obj.gbl_override_poly_batch;
+		if (dconf->poly_batch < 1)
+			dconf->poly_batch = 1;
+		if (dconf->poly_batch > QS_MAX_POLY_BATCH)
+			dconf->poly_batch = QS_MAX_POLY_BATCH;
+
+		dconf->bucket_sets = (lp_bucket *)malloc(
+			dconf->poly_batch * sizeof(lp_bucket));
+		dconf->buckets = dconf->bucket_sets;
 
 		//test to see how many slices we'll need.
 		testRoots_ptr(sconf,dconf);
 
-		//initialize the bucket lists and auxilary info.
-		dconf->buckets->num = (uint32 *)xmalloc_align(
-			2 * sconf->num_blocks * dconf->buckets->alloc_slices * sizeof(uint32));
-		dconf->buckets->fb_bounds = (uint32 *)malloc(
-			dconf->buckets->alloc_slices * sizeof(uint32));
-		dconf->buckets->logp = (uint8 *)calloc(
-			dconf->buckets->alloc_slices, sizeof(uint8));
-		dconf->buckets->list_size = 2 * sconf->num_blocks * dconf->buckets->alloc_slices;
+		for (i = 0; i < dconf->poly_batch; i++)
+		{
+			lp_bucket *b = dconf->bucket_sets + i;
+
+			b->alloc_slices = dconf->buckets->alloc_slices;
+			b->num_slices = 0;
+
+			//initialize the bucket lists and auxilary info.
+			b->num = (uint32 *)qs_big_alloc(dconf,
+				2 * sconf->num_blocks * b->alloc_slices * sizeof(uint32));
+			b->fb_bounds = (uint32 *)malloc(
+				b->alloc_slices * sizeof(uint32));
+			b->logp = (uint8 *)calloc(
+				b->alloc_slices, sizeof(uint8));
+			b->list_size = 2 * sconf->num_blocks * b->alloc_slices;
 		
-		//now allocate the buckets
-		dconf->buckets->list = (uint32 *)xmalloc_align(
-			2 * sconf->num_blocks * dconf->buckets->alloc_slices * 
-			BUCKET_ALLOC * sizeof(uint32));
+			//now allocate the buckets
+			b->list = (uint32 *)qs_big_alloc(dconf,
+				2 * sconf->num_blocks * b->alloc_slices * 
+				BUCKET_ALLOC * sizeof(uint32));
+		}
 	}
 	else
 	{
@@ -1645,7 +1865,11 @@ int siqs_dynamic_init(dynamic_conf_t *dconf, static_conf_t *sconf)
 		dconf->buckets->list = NULL;
 		dconf->buckets->alloc_slices = 0;
 		dconf->buckets->num_slices = 0;
+		dconf->bucket_sets = dconf->buckets;
+		dconf->poly_batch = 1;
 	}
+	dconf->batch_pos = 0;
+	dconf->batch_len = 1;
 
 	if (VFLAG > 2)
 	{
@@ -1653,6 +1877,7 @@ int siqs_dynamic_init(dynamic_conf_t *dconf, static_conf_t *sconf)
 		memsize += dconf->buckets->alloc_slices * sizeof(uint32);
 		memsize += dconf->buckets->alloc_slices * sizeof(uint8);
 		memsize += 2 * sconf->num_blocks * dconf->buckets->alloc_slices * BUCKET_ALLOC * sizeof(uint32);
+		memsize *= dconf->poly_batch;
 		printf("\tbucket data: %d bytes\n",memsize);
 	}
 
@@ -1705,10 +1930,13 @@ int siqs_dynamic_init(dynamic_conf_t *dconf, static_conf_t *sconf)
 	dconf->dlp_outside_range = 0;
 	dconf->dlp_prp = 0;
 	dconf->dlp_useful = 0;
+	dconf->attempted_tlp = 0;
+	dconf->tlp_useful = 0;
 
 #ifdef USE_VEC_SQUFOF
-    dconf->unfactored_residue = (uint64 *)malloc(4096 * sizeof(uint64));
-    dconf->residue_factors = (uint64 *)malloc(4096 * sizeof(uint64));
+    dconf->residue_alloc = 4096;
+    dconf->unfactored_residue = (uint64 *)malloc(dconf->residue_alloc * sizeof(uint64));
+    dconf->residue_factors = (uint64 *)malloc(dconf->residue_alloc * sizeof(uint64));
     dconf->num_64bit_residue = 0;
 #endif
 
@@ -1727,10 +1955,49 @@ int siqs_dynamic_init(dynamic_conf_t *dconf, static_conf_t *sconf)
     dconf->total_reports = 0;
     dconf->total_surviving_reports = 0;
     dconf->total_blocks = 0;
+	dconf->do_prof = sconf->do_prof;
+	memset(dconf->prof, 0, QS_PROF_STAGES * sizeof(uint64));
 
 	return 0;
 }
 
+static void read_saved_params(static_conf_t *sconf)
+{
+	// if the savefile for this input records the parameters it was
+	// sieved with, check them and keep them in sconf->saved_params
+	// so that a resumed job sieves with the same ones.  Otherwise
+	// saved_params is left zero.
+	qs_savefile_params_t *p = &sconf->saved_params;
+	mpz_t tmpz;
+
+	mpz_init(tmpz);
+	if (!qs_savefile_read_header(sconf->obj->qs_obj.siqs_savefile, tmpz, p) ||
+		(mpz_cmp(tmpz, sconf->obj->qs_obj.gmp_n) != 0))
+		p->multiplier = 0;
+	mpz_clear(tmpz);
+
+	if (p->multiplier == 0)
+		return;
+
+	if ((p->version != QS_BIN_VERSION) || (p->fb_size == 0) ||
+		((p->fb_size & 15) != 0) || (p->large_prime_max == 0) || (p->dlp > 2))
+	{
+		printf("warning: savefile %s has unrecognized parameters "
+			"(version %u, %u fb primes, dlp mode %u), ignoring them\n",
+			sconf->obj->qs_obj.siqs_savefile, p->version, p->fb_size, p->dlp);
+		p->multiplier = 0;
+		return;
+	}
+
+	if (VFLAG > 0)
+		printf("resuming with saved parameters: multiplier %u, %u fb primes, "
+			"large prime bound %u, %s\n", p->multiplier, p->fb_size,
+			p->large_prime_max, 
+			p->dlp == 2 ? "TLP" : (p->dlp == 1 ? "DLP" : "SLP"));
+
+	return;
+}
+
 int siqs_static_init(static_conf_t *sconf, int is_tiny)
 {
 	//find the best parameters, multiplier, and factor base
@@ -1745,6 +2012,8 @@ int siqs_static_init(static_conf_t *sconf, int is_tiny)
 	uint32 closnuf;
 	double sum, avg, sd;
     uint32 dlp_cutoff;
+    uint32 tlp_cutoff;
+    uint32 dlp_mode;
 
     // this pretty much has to stay "8".  the reason is that many of the specialized routines
     // have picky requirements about how large or small the primes can be for them
@@ -1764,6 +2033,11 @@ int siqs_static_init(static_conf_t *sconf, int is_tiny)
 	// some things work different if the input is tiny
 	sconf->is_tiny = is_tiny;
 
+	// a resumed job has to use the parameters its savefile was made with
+	memset(&sconf->saved_params, 0, sizeof(qs_savefile_params_t));
+	if (!is_tiny)
+		read_saved_params(sconf);
+
 	//default parameters
 	sconf->fudge_factor = 1.3;
 	sconf->large_mult = 30;
@@ -1788,9 +2062,9 @@ int siqs_static_init(static_conf_t *sconf, int is_tiny)
         firstRoots_ptr = &firstRoots_32k;
         nextRoots_ptr = &nextRoots_32k;
 
-        // if the yafu library was both compiled with SSE41 code (USE_SSE41), and the user's 
-        // machine has SSE41 instructions (HAS_SSE41), then proceed with 4.1.
-#if defined(USE_AVX2)
+        // if this binary carries the SSE41 or AVX2 kernels (SIQS_SSE41_KERNELS, SIQS_AVX2_KERNELS),
+        // and the user's machine has those instructions (HAS_SSE41, HAS_AVX2), use them.
+#if defined(SIQS_AVX2_KERNELS)
         if (HAS_AVX2)
         {
             nextRoots_ptr = &nextRoots_32k_avx2;
@@ -1800,7 +2074,7 @@ int siqs_static_init(static_conf_t *sconf, int is_tiny)
             nextRoots_ptr = &nextRoots_32k_sse41;
         }
 
-#elif defined(USE_SSE41)
+#elif defined(SIQS_SSE41_KERNELS)
 		if (HAS_SSE41)
 		{
 			nextRoots_ptr = &nextRoots_32k_sse41;
@@ -1811,9 +2085,8 @@ int siqs_static_init(static_conf_t *sconf, int is_tiny)
 		testRoots_ptr = &testfirstRoots_32k;
 
         med_sieve_ptr = &med_sieveblock_32k;
-		// if the yafu library was both compiled with AVX2 code (USE_AVX2), and the user's 
-		// machine has AVX2 instructions (HAS_AVX2), then proceed with AVX2.
-#if defined(USE_AVX2)
+		// likewise for the med prime sieve
+#if defined(SIQS_AVX2_KERNELS)
 		if (HAS_AVX2)
 		{
 			med_sieve_ptr = &med_sieveblock_32k_avx2;
@@ -1823,7 +2096,7 @@ int siqs_static_init(static_conf_t *sconf, int is_tiny)
 			med_sieve_ptr = &med_sieveblock_32k_sse41;
 		}
 
-#elif defined(USE_SSE41)
+#elif defined(SIQS_SSE41_KERNELS)
 		if (HAS_SSE41)
 		{
 		    med_sieve_ptr = &med_sieveblock_32k_sse41;
@@ -1834,7 +2107,7 @@ int siqs_static_init(static_conf_t *sconf, int is_tiny)
         tdiv_med_ptr = &tdiv_medprimes_32k;
         resieve_med_ptr = &resieve_medprimes_32k;
 
-#if defined(USE_AVX2)
+#if defined(SIQS_AVX2_KERNELS)
 		if (HAS_AVX2)
 		{
 			tdiv_med_ptr = &tdiv_medprimes_32k_avx2;
@@ -1864,6 +2137,7 @@ int siqs_static_init(static_conf_t *sconf, int is_tiny)
 	sconf->vertices = 0;
 	sconf->num_cycles = 0;
 	sconf->num_relations = 0;
+	sconf->tlp_cycles = NULL;
 	//force this to happen for now, eventually should implement this flag
 	if (1 || !(sconf->obj->flags & MSIEVE_FLAG_SKIP_QS_CYCLES)) {
 		sconf->cycle_hashtable = (uint32 *)xcalloc(
@@ -1893,6 +2167,9 @@ int siqs_static_init(static_conf_t *sconf, int is_tiny)
 		//computations of root updates
 		sconf->factor_base->B += (16 - (sconf->factor_base->B % 16));
 
+		if (sconf->saved_params.multiplier != 0)
+			sconf->factor_base->B = sconf->saved_params.fb_size;
+
 		//allocate the space for the factor base elements
 		sconf->factor_base->list = (fb_element_siqs *)xmalloc_align(
 			(size_t)(sizeof(fb_element_siqs)));
@@ -1936,7 +2213,10 @@ int siqs_static_init(static_conf_t *sconf, int is_tiny)
 		}
 
 		//find multiplier
-		sconf->multiplier = (uint32)choose_multiplier_siqs(sconf->factor_base->B, sconf->n);
+		if (sconf->saved_params.multiplier != 0)
+			sconf->multiplier = sconf->saved_params.multiplier;
+		else
+			sconf->multiplier = (uint32)choose_multiplier_siqs(sconf->factor_base->B, sconf->n);
 		mpz_mul_ui(sconf->n, sconf->n, sconf->multiplier);
 
 		//sconf holds n*mul, so update its digit count and number of bits
@@ -1962,8 +2242,10 @@ int siqs_static_init(static_conf_t *sconf, int is_tiny)
 			mpz_clear(tmpz);
 
 			//and remove the multiplier we may have added, so that
-			//we can try again to build a factor base.
+			//we can try again to build a factor base.  The input 
+			//has changed, so any saved parameters no longer apply.
 			mpz_tdiv_q_ui(sconf->n, sconf->n, sconf->multiplier);
+			sconf->saved_params.multiplier = 0;
 			free(sconf->modsqrt_array);
 			align_free(sconf->factor_base->list->prime);
 			align_free(sconf->factor_base->list->small_inv);
@@ -2178,7 +2460,13 @@ int siqs_static_init(static_conf_t *sconf, int is_tiny)
 	//a couple limits
 	sconf->pmax = sconf->factor_base->list->prime[sconf->factor_base->B-1];
 
-	if ((4294967295ULL / sconf->large_mult) < sconf->pmax)
+	if (sconf->saved_params.multiplier != 0)
+	{
+		// same factor base, so the bound is an exact multiple of pmax
+		sconf->large_prime_max = sconf->saved_params.large_prime_max;
+		sconf->large_mult = MAX(1, sconf->large_prime_max / sconf->pmax);
+	}
+	else if ((4294967295ULL / sconf->large_mult) < sconf->pmax)
 	{
 		// job is so big that pmax * default large_mult won't fit in 32 bits
 		// reduce large_mult accordingly
@@ -2205,11 +2493,27 @@ int siqs_static_init(static_conf_t *sconf, int is_tiny)
     dlp_cutoff = 77;
 #endif
 
-    if ((sconf->digits_n >= dlp_cutoff) || sconf->obj->qs_obj.gbl_force_DLP)
+    // triple large primes only start to pay off for the largest inputs
+    tlp_cutoff = 100;
+
+    // a resumed job keeps the large prime variation it was started with
+    if (sconf->saved_params.multiplier != 0)
+        dlp_mode = sconf->saved_params.dlp;
+    else if ((sconf->digits_n >= tlp_cutoff) || sconf->obj->qs_obj.gbl_force_TLP)
+        dlp_mode = 2;
+    else if ((sconf->digits_n >= dlp_cutoff) || sconf->obj->qs_obj.gbl_force_DLP)
+        dlp_mode = 1;
+    else
+        dlp_mode = 0;
+
+    if (dlp_mode > 0)
 	{
 		sconf->use_dlp = 1;
 		scan_ptr = &check_relations_siqs_16;
 		sconf->scan_unrolling = 128;
+
+        if (dlp_mode == 2)
+            sconf->use_dlp = 2;
 	}
 	else
 	{
@@ -2230,6 +2534,20 @@ int siqs_static_init(static_conf_t *sconf, int is_tiny)
 		}
 		sconf->use_dlp = 0;
 	}
+
+#if defined(SIQS_FAT) && defined(__GNUC__)
+	// fat builds carry a second, avx2, build of the sieve scan
+	if (HAS_AVX2)
+	{
+		if (scan_ptr == &check_relations_siqs_4)
+			scan_ptr = &check_relations_siqs_4_avx2;
+		else if (scan_ptr == &check_relations_siqs_8)
+			scan_ptr = &check_relations_siqs_8_avx2;
+		else
+			scan_ptr = &check_relations_siqs_16_avx2;
+	}
+#endif
+
 	qs_savefile_init(&obj->qs_obj.savefile, sconf->obj->qs_obj.siqs_savefile);
 
 	//if we're using dlp, compute the range of residues which will
@@ -2242,6 +2560,16 @@ int siqs_static_init(static_conf_t *sconf, int is_tiny)
 		sconf->dlp_upper = spBits(sconf->large_prime_max2);
 	}
 
+	//likewise for residues that might split into three large primes
+	if (sconf->use_dlp == 2)
+	{
+		sconf->max_fb3 = (double)sconf->pmax * (double)sconf->pmax * (double)sconf->pmax;
+		sconf->tlp_lower = (uint32)(log(sconf->max_fb3) / log(2.0)) + 1;
+		sconf->large_prime_max3 = pow((double)sconf->large_prime_max,2.8);
+		sconf->tlp_upper = (uint32)(log(sconf->large_prime_max3) / log(2.0)) + 1;
+		sconf->tlp_cycles = qs_tlp_cycles_init(1);
+	}
+
 	//'a' values should be as close as possible to sqrt(2n)/M in order to make
 	//values of g_{a,b}(x) as uniform as possible
 	mpz_mul_2exp(sconf->target_a, sconf->n, 1);
@@ -2282,34 +2610,6 @@ int siqs_static_init(static_conf_t *sconf, int is_tiny)
     // inputs larger than this use a different method (below)
 
 
-#ifdef QS_TIMING
-	printf("%d primes not sieved in SPV\n",sconf->sieve_small_fb_start);
-	printf("%d primes in small_B range\n",
-		sconf->factor_base->med_B - sconf->sieve_small_fb_start);
-	printf("%d primes in med_B range\n",
-		sconf->factor_base->large_B - sconf->factor_base->med_B);
-	printf("%d primes in large_B range\n",
-		sconf->factor_base->B - sconf->factor_base->large_B);
-	printf("detailing QS timing profiling enabled\n");
-
-	TF_STG1 = 0;
-	TF_STG2 = 0;
-	TF_STG3 = 0;
-	TF_STG4 = 0;
-	TF_STG5 = 0;
-	TF_STG6 = 0;
-	TF_SPECIAL = 0;
-	SIEVE_STG1 = 0;
-	SIEVE_STG2 = 0;
-	POLY_STG0 = 0;
-	POLY_STG1 = 0;
-	POLY_STG2 = 0;
-	POLY_STG3 = 0;
-	POLY_STG4 = 0;
-	COUNT = 0;
-
-#endif
-
 	//contribution of all small primes we're skipping to a block's
 	//worth of sieving... compute the average per sieve location
 	sum = 0;
@@ -2328,9 +2628,9 @@ int siqs_static_init(static_conf_t *sconf, int is_tiny)
 
 	//this appears to work fairly well... paper mentioned doing it this
 	//way... find out and reference here.
-	sconf->tf_small_cutoff = (uint8)(avg + 2.5*sd);
+	sconf->tf_small_cutoff = (uint8)(avg + 2.5*sd + sconf->tf_small_adjust);
 
-    if ((sconf->use_dlp == 1) || sconf->obj->qs_obj.gbl_force_DLP)
+    if ((sconf->use_dlp > 0) || sconf->obj->qs_obj.gbl_force_DLP)
     {
         //empirically, these were observed to work fairly well.
         if(sconf->digits_n < 82)
@@ -2395,7 +2695,10 @@ int siqs_static_init(static_conf_t *sconf, int is_tiny)
 	sconf->dlp_outside_range = 0;
 	sconf->dlp_prp = 0;
 	sconf->dlp_useful = 0;
+	sconf->attempted_tlp = 0;
+	sconf->tlp_useful = 0;
 	sconf->total_poly_a = 0;	//track number of A polys used
+	sconf->num_poly_a_gen = 0;	//and the number generated
 	sconf->num_r = 0;			//total relations found
 	sconf->charcount = 0;		//characters on the screen
 
@@ -2410,6 +2713,8 @@ int siqs_static_init(static_conf_t *sconf, int is_tiny)
     sconf->total_surviving_reports = 0;
     sconf->total_blocks = 0;
     sconf->lp_scan_failures = 0;
+	sconf->do_prof = (is_tiny == 0) && sconf->obj->qs_obj.prof;
+	memset(sconf->prof, 0, QS_PROF_STAGES * sizeof(uint64));
 
 	//no factors so far...
 	sconf->factor_list.num_factors = 0;
@@ -2603,6 +2908,10 @@ int update_final(static_conf_t *sconf)
 					sconf->failed_squfof, sconf->attempted_squfof, 
 					sconf->dlp_outside_range, sconf->dlp_prp, sconf->dlp_useful);
 
+			if (sconf->use_dlp == 2)
+				printf("tlp: %u attempts, %u useful\n", 
+					sconf->attempted_tlp, sconf->tlp_useful);
+
             printf("total reports = %u, total surviving reports = %u\ntotal blocks sieved = %u,"
                 "avg surviving reports per block = %1.2f\n", sconf->total_reports,
                 sconf->total_surviving_reports, sconf->total_blocks,
@@ -2623,52 +2932,13 @@ int update_final(static_conf_t *sconf)
 				logprint(sieve_log, "squfof: %u failures, %u attempts, %u outside range, %u prp, %u useful\n", 
 					sconf->failed_squfof, sconf->attempted_squfof, 
 					sconf->dlp_outside_range, sconf->dlp_prp, sconf->dlp_useful);
+		if (sconf->use_dlp == 2)
+				logprint(sieve_log, "tlp: %u attempts, %u useful\n", 
+					sconf->attempted_tlp, sconf->tlp_useful);
 
-#ifdef QS_TIMING
-
-		printf("sieve time = %6.4f, relation time = %6.4f, poly_time = %6.4f\n",
-			SIEVE_STG1+SIEVE_STG2,
-			TF_STG1+TF_STG2+TF_STG3+TF_STG4+TF_STG5+TF_STG6,
-			POLY_STG0+POLY_STG1+POLY_STG2+POLY_STG3+POLY_STG4);
+		if (sconf->do_prof)
+			qs_prof_report(sconf);
 
-		if (sieve_log != NULL)
-			logprint(sieve_log,"sieve time = %6.4f, relation time = %6.4f, poly_time = %6.4f\n",
-				SIEVE_STG1+SIEVE_STG2,
-				TF_STG1+TF_STG2+TF_STG3+TF_STG4+TF_STG5+TF_STG6,
-				POLY_STG0+POLY_STG1+POLY_STG2+POLY_STG3+POLY_STG4);
-
-		printf("timing for SPV check = %1.3f\n",TF_STG1);
-		printf("timing for small prime trial division = %1.3f\n",TF_STG2);
-		printf("timing for medium prime trial division = %1.3f\n",TF_STG3+TF_STG4);
-		printf("timing for medium prime resieving test = %1.3f\n",TF_SPECIAL);
-		printf("timing for large prime trial division = %1.3f\n",TF_STG5);
-		printf("timing for LP splitting + buffering = %1.3f\n",TF_STG6);
-		printf("timing for poly a generation = %1.3f\n",POLY_STG0);
-		printf("timing for poly roots init = %1.3f\n",POLY_STG1);
-		printf("timing for poly update small primes = %1.3f\n",POLY_STG2);
-		printf("timing for poly sieve medium primes = %1.3f\n",POLY_STG3);
-		printf("timing for poly sieve large primes = %1.3f\n",POLY_STG4);
-		printf("timing for sieving small/medium primes = %1.3f\n",SIEVE_STG1);
-		printf("timing for sieving large primes = %1.3f\n",SIEVE_STG2);
-
-		if (sieve_log != NULL)
-		{
-			logprint(sieve_log,"timing for SPV check = %1.3f\n",TF_STG1);
-			logprint(sieve_log,"timing for small prime trial division = %1.3f\n",TF_STG2);
-			logprint(sieve_log,"timing for medium prime trial division = %1.3f\n",TF_STG3+TF_STG4);
-			logprint(sieve_log,"timing for large prime trial division = %1.3f\n",TF_STG5);
-			logprint(sieve_log,"timing for LP splitting + buffering = %1.3f\n",TF_STG6);
-			logprint(sieve_log,"timing for poly a generation = %1.3f\n",POLY_STG0);
-			logprint(sieve_log,"timing for poly roots init = %1.3f\n",POLY_STG1);
-			logprint(sieve_log,"timing for poly update small primes = %1.3f\n",POLY_STG2);
-			logprint(sieve_log,"timing for poly sieve medium primes = %1.3f\n",POLY_STG3);
-			logprint(sieve_log,"timing for poly sieve large primes = %1.3f\n",POLY_STG4);
-			logprint(sieve_log,"timing for sieving small/medium primes = %1.3f\n",SIEVE_STG1);
-			logprint(sieve_log,"timing for sieving large primes = %1.3f\n",SIEVE_STG2);
-		}
-		
-		
-#endif
 		fflush(stdout);
 		fflush(stderr);
 	}
@@ -2699,6 +2969,9 @@ int update_final(static_conf_t *sconf)
 
 	sconf->obj->qs_obj.rels_per_sec = (double)(sconf->num_relations + sconf->num_cycles) /
 		((double)difference->secs + (double)difference->usecs / 1000000);
+	sconf->obj->qs_obj.num_full = sconf->num_relations;
+	sconf->obj->qs_obj.num_partial = sconf->num_cycles;
+	sconf->obj->qs_obj.pmax = sconf->pmax;
 
 	if (sieve_log != NULL)	
 		fflush(sieve_log);
@@ -2716,8 +2989,8 @@ int free_sieve(dynamic_conf_t *dconf)
 
 	//can free sieving structures now
 	align_free(dconf->sieve);
-	align_free(dconf->fb_sieve_p);
-	align_free(dconf->fb_sieve_n);
+	huge_free(dconf->fb_sieve_p);
+	huge_free(dconf->fb_sieve_n);
 
 	align_free(dconf->comp_sieve_p->prime);
 	align_free(dconf->comp_sieve_p->root1);
@@ -2730,26 +3003,29 @@ int free_sieve(dynamic_conf_t *dconf)
 	free(dconf->comp_sieve_p);
 	free(dconf->comp_sieve_n);
 
-	align_free(dconf->rootupdates);
-	align_free(dconf->sm_rootupdates);
+	huge_free(dconf->rootupdates);
+	huge_free(dconf->sm_rootupdates);
 
 	align_free(dconf->update_data.sm_firstroots1);
 	align_free(dconf->update_data.sm_firstroots2);
-	align_free(dconf->update_data.firstroots1);
-	align_free(dconf->update_data.firstroots2);
-	align_free(dconf->update_data.prime);
-	align_free(dconf->update_data.logp);
+	huge_free(dconf->update_data.firstroots1);
+	huge_free(dconf->update_data.firstroots2);
+	huge_free(dconf->update_data.prime);
+	huge_free(dconf->update_data.logp);
 
-	if (dconf->buckets->list != NULL)
+	for (i = 0; i < dconf->poly_batch; i++)
 	{
-		align_free(dconf->buckets->list);
-		free(dconf->buckets->fb_bounds);
-		free(dconf->buckets->logp);
-		align_free(dconf->buckets->num);
-		free(dconf->buckets);
+		lp_bucket *b = dconf->bucket_sets + i;
+
+		if (b->list != NULL)
+		{
+			huge_free(b->list);
+			free(b->fb_bounds);
+			free(b->logp);
+			huge_free(b->num);
+		}
 	}
-	else
-		free(dconf->buckets);
+	free(dconf->bucket_sets);
 
 	//support data on the poly currently being sieved
 	free(dconf->curr_poly->gray);
@@ -2867,6 +3143,10 @@ int free_siqs(static_conf_t *sconf)
 	free(sconf->curr_poly);
 	mpz_clear(sconf->curr_a);	
     align_free(sconf->modsqrt_array);
+
+	//tlp cycle counter, if filtering didn't already get rid of it
+	qs_tlp_cycles_free(sconf->tlp_cycles);
+	sconf->tlp_cycles = NULL;
 	align_free(sconf->factor_base->list->prime);
 	align_free(sconf->factor_base->list->small_inv);
 	align_free(sconf->factor_base->list->correction);
@@ -2899,7 +3179,10 @@ int free_siqs(static_conf_t *sconf)
 	}
 
 	if (sconf->in_mem)
+	{
 		free(sconf->in_mem_relations);
+		qs_arena_free(&sconf->in_mem_arena);
+	}
 
 	mpz_clear(sconf->sqrt_n);
 	mpz_clear(sconf->n);
@@ -36,6 +36,18 @@ uint32 process_poly_a(static_conf_t *sconf)
 	//generate all poly b values associated with that a and
 	//store both a and all the b's in conf
 	//also check that the generated polys are valid.
+	return expand_poly_a(sconf, sconf->curr_a, &sconf->curr_b, 
+		&sconf->bpoly_alloc, sconf->curr_poly->qlisort, 
+		&sconf->curr_poly->s);
+}
+
+uint32 expand_poly_a(static_conf_t *sconf, mpz_t a, mpz_t **b_list, 
+	uint32 *b_alloc, int *qlisort, int *s)
+{
+	//the work of process_poly_a, with the b values, the factor base
+	//indices of the factors of a, and their number going to the
+	//given places instead of into conf.  conf is only read, so 
+	//several threads can do this at once with their own outputs.
 
 	//we will be reusing some routines here that are normally used
 	//during sieving, and expect a dynamic_conf structure as input which
@@ -67,7 +79,7 @@ uint32 process_poly_a(static_conf_t *sconf)
 	for (i=0;i<MAX_A_FACTORS;i++)
 		mpz_init(dconf->Bl[i]);
 
-	mpz_set(dconf->curr_poly->mpz_poly_a, sconf->curr_a);
+	mpz_set(dconf->curr_poly->mpz_poly_a, a);
 	
 	//then compute all the 'b' poly's for this 'a'
 	//and add them to the b-list
@@ -113,25 +125,25 @@ uint32 process_poly_a(static_conf_t *sconf)
 	//maxB
 
 	//free any we won't be needing
-	for (j = 0; (uint32)j < sconf->bpoly_alloc; j++)
-		mpz_clear(sconf->curr_b[j]);
+	for (j = 0; (uint32)j < *b_alloc; j++)
+		mpz_clear((*b_list)[j]);
 
 	//reallocate the size of the array
-	sconf->curr_b = (mpz_t *)realloc(sconf->curr_b, maxB * sizeof(mpz_t));
+	*b_list = (mpz_t *)realloc(*b_list, maxB * sizeof(mpz_t));
 
 	//allocate any additional we need
 	for (j = 0; j < maxB; j++)
-		mpz_init(sconf->curr_b[j]);
-	sconf->bpoly_alloc = maxB;
+		mpz_init((*b_list)[j]);
+	*b_alloc = maxB;
 
 	//generate all the b polys
-	generate_bpolys(sconf, dconf, maxB);
+	generate_bpolys(sconf, dconf, *b_list, maxB);
 
 	//we'll need to remember some things about the current poly,
-	//so copy those over to sconf first...
+	//so copy those over first...
 	for (j=0; j<dconf->curr_poly->s; j++)
-		sconf->curr_poly->qlisort[j] = dconf->curr_poly->qlisort[j];
-	sconf->curr_poly->s = dconf->curr_poly->s;
+		qlisort[j] = dconf->curr_poly->qlisort[j];
+	*s = dconf->curr_poly->s;
 
 	//then free the temp dynamic struct
 	free(dconf->curr_poly->gray);
@@ -189,7 +201,8 @@ int get_a_offsets(fb_list *fb, siqs_poly *poly, mpz_t tmp)
 	return 0;
 }
 
-void generate_bpolys(static_conf_t *sconf, dynamic_conf_t *dconf, int maxB)
+void generate_bpolys(static_conf_t *sconf, dynamic_conf_t *dconf, 
+	mpz_t *b_list, int maxB)
 {
 	//given poly, which contains the first value of poly_b, and
 	//info needed to generate the rest of the poly b's (namely,
@@ -203,7 +216,7 @@ void generate_bpolys(static_conf_t *sconf, dynamic_conf_t *dconf, int maxB)
 	for ( ; numB < maxB; numB++)
 	{
 		//zCopy(&dconf->curr_poly->poly_b,&sconf->curr_b[numB - 1]);
-		mpz_set(sconf->curr_b[numB - 1], dconf->curr_poly->mpz_poly_b);
+		mpz_set(b_list[numB - 1], dconf->curr_poly->mpz_poly_b);
 		dconf->numB = numB;
 		nextB(dconf, sconf);
 	}
@@ -211,53 +224,18 @@ void generate_bpolys(static_conf_t *sconf, dynamic_conf_t *dconf, int maxB)
 	return;
 }
 
-int process_rel(char *substr, fb_list *fb, mpz_t n,
+int process_rel(siqs_r *in, fb_list *fb, mpz_t n,
 				 static_conf_t *sconf, fact_obj_t *obj, siqs_r *rel)
 {
-	char *nextstr;
-	uint32 lp[2];
-	uint32 this_offset, this_id, this_num_factors, this_parity, this_val;
-	uint32 fb_offsets[MAX_SMOOTH_PRIMES];
+	//in is a relation as read from the savefile, without the
+	//factors of the poly 'a' value
+	uint32 *lp = in->large_prime;
+	uint32 *fb_offsets = in->fb_offsets;
+	uint32 this_num_factors = in->num_factors;
 	int i,j,k, err_code = 0;
 
 	rel->fb_offsets = (uint32 *)malloc(MAX_SMOOTH_PRIMES*sizeof(uint32));
 
-	//read the offset
-	this_offset = strtoul(substr,&nextstr,HEX);	//convert
-	substr = nextstr;
-
-	this_id = strtoul(substr,&nextstr,HEX);
-	substr = nextstr;
-
-	if (this_offset & 0x80000000)
-	{
-		this_parity = 1;
-		this_offset = (~this_offset) + 1;
-	}
-	else
-		this_parity = 0;
-
-	j=0;
-	do
-	{
-		this_val = strtoul(substr,&nextstr,HEX);
-		if (this_val == (uint32)(-1))
-			printf("error parsing relation: strtoul returned error code\n");
-		substr = nextstr;
-		fb_offsets[j] = this_val;
-		j++;
-	} while (substr[1] != 'L');
-	this_num_factors = j;
-
-	substr += 2;
-	this_val = strtoul(substr,&nextstr,HEX);
-	substr = nextstr;
-	lp[0] = this_val;
-
-	this_val = strtoul(substr,&nextstr,HEX);
-	substr = nextstr;
-	lp[1] = this_val;
-
 	 //combine the factors of the sieve value with
 	 //  the factors of the polynomial 'a' value; the 
 	 //  linear algebra code has to know about both.
@@ -283,23 +261,18 @@ int process_rel(char *substr, fb_list *fb, mpz_t n,
 	while (j < sconf->curr_poly->s)
 		rel->fb_offsets[k++] = sconf->curr_poly->qlisort[j++];
 	
-	rel->sieve_offset = this_offset;
+	rel->sieve_offset = in->sieve_offset;
 	rel->large_prime[0] = lp[0];
 	rel->large_prime[1] = lp[1];
-	rel->parity = this_parity;
+	rel->large_prime[2] = lp[2];
+	rel->parity = in->parity;
 	rel->num_factors = this_num_factors  + sconf->curr_poly->s;
-	rel->poly_idx = this_id;
+	rel->poly_idx = in->poly_idx;
 
 	if (!check_relation(sconf->curr_a,
 			sconf->curr_b[rel->poly_idx], rel, fb, n))
 	{
-		if (lp[0] != lp[1]) {
-			yafu_add_to_cycles(sconf, obj->flags, lp[0], lp[1]);
-			sconf->num_cycles++;
-		}
-		else {
-			sconf->num_relations++;
-		}
+		yafu_count_relation(sconf, obj->flags, lp);
 	}
 	else
 	{
@@ -312,45 +285,40 @@ int process_rel(char *substr, fb_list *fb, mpz_t n,
 
 int restart_siqs(static_conf_t *sconf, dynamic_conf_t *dconf)
 {
-	int i,j;
-	char *str, *substr;
-	FILE *data;
-	uint32 lp[2],pmax = sconf->large_prime_max / sconf->large_mult;
+	int i,j,k,type;
+	qs_savefile_t *savefile = &sconf->obj->qs_obj.savefile;
+	siqs_r rel;
+	uint32 fb_offsets[MAX_SMOOTH_PRIMES];
+	uint32 *lp = rel.large_prime;
+	uint32 pmax = sconf->large_prime_max / sconf->large_mult;
 	//fact_obj_t *obj = sconf->obj;
 
-	str = (char *)malloc(GSTR_MAXSIZE*sizeof(char));
-	data = fopen(sconf->obj->qs_obj.siqs_savefile,"r");
+	rel.fb_offsets = fb_offsets;
 	i=0;
 	j=0;
+	k=0;
 	
-	if (data != NULL)
+	if (qs_savefile_exists(savefile))
 	{	
-		fgets(str,1024,data);
-		substr = str + 2;
-		mpz_set_str(dconf->gmptmp1, substr, 0); //str2hexz(substr,&dconf->qstmp1);
+		qs_savefile_open(savefile, SAVEFILE_READ);
+		type = qs_savefile_read_entry(savefile, &rel, dconf->gmptmp1, 1);
+
 		// check against the input to SIQS, i.e., does not have a 
 		// multiplier applied (the file saved N does not include the multiplier).
-		if (mpz_cmp(dconf->gmptmp1, sconf->obj->qs_obj.gmp_n) == 0)
+		if ((type == 'N') && (mpz_cmp(dconf->gmptmp1, sconf->obj->qs_obj.gmp_n) == 0))
 		{
 			if (VFLAG > 1)
 				printf("restarting siqs from saved data set\n");
 			fflush(stdout);
 			fflush(stderr);
-			while (1)
+			while ((type = qs_savefile_read_entry(savefile, 
+				&rel, dconf->gmptmp1, 1)) >= 0)
 			{
-				//read a line
-				if (feof(data))
-					break;
-				fgets(str,1024,data);
-				substr = str + 2;
-
-				if (str[0] == 'R')
+				if (type == 'R')
 				{	
 					//process a relation
 					//just trying to figure out how many relations we have
 					//so read in the large primes and add to cycles
-					substr = strchr(substr,'L');
-					yafu_read_large_primes(substr,lp,lp+1);
 					if (sconf->use_dlp)
 					{
 						if ((lp[0] > 1) && (lp[0] < pmax))
@@ -364,16 +332,17 @@ int restart_siqs(static_conf_t *sconf, dynamic_conf_t *dconf)
 							continue;
 						}
 					}
-					if (lp[0] != lp[1]) 
+
+					// relations with three large primes are only 
+					// usable if we are still doing tlp
+					if ((lp[2] != 1) && (sconf->use_dlp != 2))
 					{
-						yafu_add_to_cycles(sconf, sconf->obj->flags, lp[0], lp[1]);
-						sconf->num_cycles++;
-					}
-					else {
-						sconf->num_relations++;
+						k++;
+						continue;
 					}
+					yafu_count_relation(sconf, sconf->obj->flags, lp);
 				}
-				else if (str[0] == 'A')
+				else if (type == 'A')
 				{
 					i++;
 				}
@@ -397,10 +366,18 @@ int restart_siqs(static_conf_t *sconf, dynamic_conf_t *dconf)
 				sconf->last_numcycles = sconf->num_cycles;
 			}
 
+			if (k > 0)
+			{
+				printf("warning: ignoring %d saved relations with three large primes; "
+					"resume with -forceTLP to use them\n", k);
+				if (sconf->obj->logfile != NULL)
+					logprint(sconf->obj->logfile, "warning: ignoring %d saved relations "
+						"with three large primes; resume with -forceTLP to use them\n", k);
+			}
+
 		}	
-		fclose(data);
+		qs_savefile_close(savefile);
 	}
-	free(str);
 
 	return 0;
 }
@@ -622,12 +599,1199 @@ void yafu_add_to_cycles(static_conf_t *conf, uint32 flags, uint32 prime1, uint32
 						&conf->vertices);
 }
 
+/**********************************************************
+These routines count (and after sieving, build) cycles 
+among relations with up to three large primes.
+**********************************************************/
+static uint32 qs_tlp_reduce_primes(uint32 *large_prime, uint32 *vec) {
+
+	/* sort the large primes of a relation and cancel
+	   any pair of repeated primes, leaving the vector
+	   over GF(2) of primes that appear an odd number of
+	   times. Unused primes (1) are dropped. Returns the
+	   number of primes left; zero means the relation
+	   is full */
+
+	uint32 p[3], tmp;
+	uint32 i, num = 0;
+
+	p[0] = large_prime[0];
+	p[1] = large_prime[1];
+	p[2] = large_prime[2];
+
+	if (p[0] > p[1]) { tmp = p[0]; p[0] = p[1]; p[1] = tmp; }
+	if (p[1] > p[2]) { tmp = p[1]; p[1] = p[2]; p[2] = tmp; }
+	if (p[0] > p[1]) { tmp = p[0]; p[0] = p[1]; p[1] = tmp; }
+
+	for (i = 0; i < 3; i++) {
+		if (p[i] == 1)
+			continue;
+
+		if (num > 0 && vec[num - 1] == p[i])
+			num--;
+		else
+			vec[num++] = p[i];
+	}
+
+	return num;
+}
+
+/*--------------------------------------------------------------------*/
+static uint32 qs_tlp_merge(uint32 *dest, uint32 *src1, uint32 n1,
+			uint32 *src2, uint32 n2) {
+
+	/* symmetric difference of two sorted lists, i.e.
+	   their sum over GF(2) */
+
+	uint32 i = 0, j = 0, k = 0;
+
+	while (i < n1 && j < n2) {
+		if (src1[i] < src2[j])
+			dest[k++] = src1[i++];
+		else if (src1[i] > src2[j])
+			dest[k++] = src2[j++];
+		else {
+			i++;
+			j++;
+		}
+	}
+	while (i < n1)
+		dest[k++] = src1[i++];
+	while (j < n2)
+		dest[k++] = src2[j++];
+
+	return k;
+}
+
+/*--------------------------------------------------------------------*/
+qs_tlp_cycles_t * qs_tlp_cycles_init(int track_rels) {
+
+	qs_tlp_cycles_t *t = (qs_tlp_cycles_t *)xmalloc(sizeof(qs_tlp_cycles_t));
+
+	t->hashtable = (uint32 *)xcalloc((size_t)(1 << QS_LOG2_CYCLE_HASH), 
+					sizeof(uint32));
+	t->num_pivots = 1;
+	t->pivot_alloc = 10000;
+	t->pivots = (qs_tlp_pivot_t *)xmalloc(t->pivot_alloc * 
+					sizeof(qs_tlp_pivot_t));
+	t->prime_pool_size = 0;
+	t->prime_pool_alloc = 10000;
+	t->prime_pool = (uint32 *)xmalloc(t->prime_pool_alloc * sizeof(uint32));
+	t->rel_pool_size = 0;
+	t->rel_pool_alloc = 0;
+	t->rel_pool = NULL;
+	if (track_rels) {
+		t->rel_pool_alloc = 10000;
+		t->rel_pool = (uint32 *)xmalloc(t->rel_pool_alloc * sizeof(uint32));
+	}
+	t->num_dropped = 0;
+
+	return t;
+}
+
+/*--------------------------------------------------------------------*/
+void qs_tlp_cycles_free(qs_tlp_cycles_t *t) {
+
+	if (t == NULL)
+		return;
+
+	free(t->hashtable);
+	free(t->pivots);
+	free(t->prime_pool);
+	if (t->rel_pool != NULL)
+		free(t->rel_pool);
+	free(t);
+}
+
+/*--------------------------------------------------------------------*/
+static int qs_tlp_add(qs_tlp_cycles_t *t, uint32 *vec, uint32 num_vec,
+			uint32 rel_id, uint32 *cycle, uint32 *cycle_len) {
+
+	/* reduce the vector of large primes of a partial
+	   relation against the pivots found so far. The
+	   smallest prime of the vector always cancels 
+	   against the pivot keyed by that prime, so each
+	   step strictly increases the smallest prime left.
+
+	   Returns 0 if the relation became a new pivot,
+	   1 if it reduced to zero (i.e. completed a cycle)
+	   and 2 if the reduction got too dense and the
+	   relation was dropped. When relations are tracked,
+	   a completed cycle is returned in 'cycle' */
+
+	uint32 vbuf[2][2 * QS_TLP_MAX_VECTOR];
+	uint32 rbuf[2][2 * QS_TLP_MAX_CYCLE];
+	uint32 nv = num_vec, nr = 1;
+	uint32 which = 0;
+	uint32 offset;
+	qs_tlp_pivot_t *pivot;
+
+	memcpy(vbuf[0], vec, num_vec * sizeof(uint32));
+	rbuf[0][0] = rel_id;
+
+	while (nv > 0) {
+
+		offset = t->hashtable[QS_HASH(vbuf[which][0])];
+		while (offset != 0) {
+			if (t->pivots[offset].prime == vbuf[which][0])
+				break;
+			offset = t->pivots[offset].next;
+		}
+
+		if (offset == 0) {
+
+			/* the smallest prime is new; the vector
+			   becomes the pivot for it */
+
+			if (t->num_pivots == t->pivot_alloc) {
+				t->pivot_alloc *= 2;
+				t->pivots = (qs_tlp_pivot_t *)xrealloc(t->pivots,
+					t->pivot_alloc * sizeof(qs_tlp_pivot_t));
+			}
+			if (t->prime_pool_size + nv >= t->prime_pool_alloc) {
+				t->prime_pool_alloc *= 2;
+				t->prime_pool = (uint32 *)xrealloc(t->prime_pool,
+					t->prime_pool_alloc * sizeof(uint32));
+			}
+
+			pivot = t->pivots + t->num_pivots;
+			pivot->prime = vbuf[which][0];
+			pivot->next = t->hashtable[QS_HASH(pivot->prime)];
+			t->hashtable[QS_HASH(pivot->prime)] = t->num_pivots++;
+
+			pivot->vec_start = t->prime_pool_size;
+			pivot->vec_len = (uint16)nv;
+			memcpy(t->prime_pool + t->prime_pool_size, vbuf[which],
+				nv * sizeof(uint32));
+			t->prime_pool_size += nv;
+
+			pivot->rel_start = 0;
+			pivot->rel_len = 0;
+			if (t->rel_pool != NULL) {
+				if (t->rel_pool_size + nr >= t->rel_pool_alloc) {
+					t->rel_pool_alloc *= 2;
+					t->rel_pool = (uint32 *)xrealloc(t->rel_pool,
+						t->rel_pool_alloc * sizeof(uint32));
+				}
+				pivot->rel_start = t->rel_pool_size;
+				pivot->rel_len = (uint16)nr;
+				memcpy(t->rel_pool + t->rel_pool_size, rbuf[which],
+					nr * sizeof(uint32));
+				t->rel_pool_size += nr;
+			}
+			return 0;
+		}
+
+		pivot = t->pivots + offset;
+		nv = qs_tlp_merge(vbuf[which ^ 1], vbuf[which], nv,
+				t->prime_pool + pivot->vec_start, pivot->vec_len);
+		if (t->rel_pool != NULL)
+			nr = qs_tlp_merge(rbuf[which ^ 1], rbuf[which], nr,
+				t->rel_pool + pivot->rel_start, pivot->rel_len);
+		which ^= 1;
+
+		if (nv > QS_TLP_MAX_VECTOR || nr > QS_TLP_MAX_CYCLE) {
+			t->num_dropped++;
+			return 2;
+		}
+	}
+
+	if (t->rel_pool != NULL) {
+		memcpy(cycle, rbuf[which], nr * sizeof(uint32));
+		*cycle_len = nr;
+	}
+	return 1;
+}
+
+/*--------------------------------------------------------------------*/
+void yafu_count_relation(static_conf_t *conf, uint32 flags, uint32 *large_prime) {
+
+	/* Top level routine for the bookkeeping of a new
+	   relation. With tlp, the number of cycles is the
+	   number of partial relations minus the rank of
+	   their large prime vectors; the rank is kept in
+	   'vertices' (relations too dense to reduce count
+	   towards it as well, which undercounts cycles)
+	   so that num_cycles + components - vertices still
+	   gives the number of cycles.
+
+	   The relation lists of the pivots are tracked here
+	   too, with the partials numbered in the order they
+	   arrive, so that a relation whose cycle would grow
+	   past QS_TLP_MAX_CYCLE is dropped exactly as when
+	   the cycles are built for real after sieving */
+
+	if (conf->use_dlp == 2) {
+		uint32 vec[3];
+		uint32 cycle[QS_TLP_MAX_CYCLE];
+		uint32 cycle_len;
+		uint32 num_vec = qs_tlp_reduce_primes(large_prime, vec);
+
+		if (num_vec == 0) {
+			conf->num_relations++;
+			return;
+		}
+
+		conf->num_cycles++;
+
+		/* the counter is retired once filtering starts */
+		if (conf->tlp_cycles == NULL)
+			return;
+
+		if ((flags & MSIEVE_FLAG_SKIP_QS_CYCLES) ||
+			(qs_tlp_add(conf->tlp_cycles, vec, num_vec, 
+				conf->num_cycles - 1, cycle, &cycle_len) != 1))
+			conf->vertices++;
+
+		return;
+	}
+
+	if (large_prime[0] != large_prime[1]) {
+		yafu_add_to_cycles(conf, flags, large_prime[0], large_prime[1]);
+		conf->num_cycles++;
+	}
+	else {
+		conf->num_relations++;
+	}
+}
+
+/*--------------------------------------------------------------------*/
+static uint32 qs_purge_singletons_tlp(fact_obj_t *obj, siqs_r *list, 
+				uint32 num_relations, static_conf_t *sconf) {
+	
+	/* singleton removal when relations can have three
+	   large primes. There is no graph from the sieving
+	   stage in this case, so first count the relations 
+	   each prime occurs in, then repeatedly remove the 
+	   relations containing a prime that occurs once */
+
+	uint32 *hashtable = sconf->cycle_hashtable;
+	qs_cycle_t *table;
+	uint32 vec[3];
+	uint32 num_left, num_vec;
+	uint32 i, j, k;
+	uint32 passes = 0;
+
+	if (VFLAG > 0)
+		printf("begin with %u relations\n", num_relations);
+	if (obj->logfile != NULL)
+		logprint(obj->logfile, "begin with %u relations\n", num_relations);
+
+	memset(hashtable, 0, sizeof(uint32) * (1 << QS_LOG2_CYCLE_HASH));
+	sconf->cycle_table_size = 1;
+
+	for (i = 0; i < num_relations; i++) {
+		num_vec = qs_tlp_reduce_primes(list[i].large_prime, vec);
+
+		if (sconf->cycle_table_size + 3 >= sconf->cycle_table_alloc) {
+			sconf->cycle_table_alloc *= 2;
+			sconf->cycle_table = (qs_cycle_t *)xrealloc(sconf->cycle_table,
+				sconf->cycle_table_alloc * sizeof(qs_cycle_t));
+		}
+		table = sconf->cycle_table;
+
+		for (k = 0; k < num_vec; k++) {
+			qs_cycle_t *entry = get_table_entry(table, hashtable,
+						vec[k], sconf->cycle_table_size);
+
+			if (entry == table + sconf->cycle_table_size)
+				sconf->cycle_table_size++;
+			entry->count++;
+		}
+	}
+	table = sconf->cycle_table;
+
+	do {
+		num_left = num_relations;
+
+		for (i = j = 0; i < num_relations; i++) {
+			num_vec = qs_tlp_reduce_primes(list[i].large_prime, vec);
+
+			for (k = 0; k < num_vec; k++) {
+				if (get_table_entry(table, hashtable, 
+						vec[k], 0)->count < 2)
+					break;
+			}
+
+			if (k == num_vec) {
+				list[j++] = list[i];
+				continue;
+			}
+
+			/* the relation is removed; so are its primes */
+
+			for (k = 0; k < num_vec; k++)
+				get_table_entry(table, hashtable, vec[k], 0)->count--;
+		}
+		num_relations = j;
+		passes++;
+
+	} while (num_left != num_relations);
+			
+	if (obj->logfile != NULL)
+		logprint(obj->logfile, "reduce to %u relations in %u passes\n", 
+				num_left, passes);
+	if (VFLAG > 0)
+		printf("reduce to %u relations in %u passes\n", 
+				num_left, passes);
+	return num_left;
+}
+
+/*--------------------------------------------------------------------*/
+static qs_la_col_t * qs_build_tlp_cycles(fact_obj_t *obj, 
+				siqs_r *relation_list, uint32 num_relations,
+				uint32 *num_cycles_out) {
+
+	/* build the cycles in a list of relations with up
+	   to three large primes. Full relations are trivial
+	   cycles. Partial relations are added sparsest first,
+	   and each one whose large primes reduce to nothing
+	   yields a cycle made of the relations that were
+	   combined along the way.
+
+	   The count made during sieving added the partials
+	   in a different order, so a relation it could use
+	   may be too dense to reduce here. Relations dropped
+	   for that reason get a second try at the end, when
+	   all the other pivots are in place */
+
+	qs_tlp_cycles_t *t = qs_tlp_cycles_init(1);
+	qs_la_col_t *cycle_list;
+	uint32 cycle[QS_TLP_MAX_CYCLE];
+	uint32 vec[3];
+	uint32 num_vec, cycle_len;
+	uint32 num_cycles = 0, cycle_alloc = 10000;
+	uint32 num_partial = 0;
+	uint32 *dropped;
+	uint32 num_dropped = 0, dropped_alloc = 1000;
+	uint32 retry_start = 0;
+	uint32 i, j, pass;
+
+	cycle_list = (qs_la_col_t *)xmalloc(cycle_alloc * sizeof(qs_la_col_t));
+	dropped = (uint32 *)xmalloc(dropped_alloc * sizeof(uint32));
+
+	for (pass = 0; pass <= 4; pass++) {
+		uint32 num_rels = num_relations;
+
+		if (pass == 4) {
+			retry_start = t->num_dropped;
+			num_rels = num_dropped;
+		}
+
+		for (j = 0; j < num_rels; j++) {
+			qs_la_col_t *c;
+
+			i = (pass == 4) ? dropped[j] : j;
+			num_vec = qs_tlp_reduce_primes(relation_list[i].large_prime, vec);
+			if ((pass < 4) && (num_vec != pass))
+				continue;
+
+			if (num_vec == 0) {
+				cycle[0] = i;
+				cycle_len = 1;
+			}
+			else {
+				int status;
+
+				if (pass < 4)
+					num_partial++;
+				status = qs_tlp_add(t, vec, num_vec, i, cycle, &cycle_len);
+				if ((status == 2) && (pass < 4)) {
+					if (num_dropped == dropped_alloc) {
+						dropped_alloc *= 2;
+						dropped = (uint32 *)xrealloc(dropped,
+							dropped_alloc * sizeof(uint32));
+					}
+					dropped[num_dropped++] = i;
+				}
+				if (status != 1)
+					continue;
+			}
+
+			if (num_cycles == cycle_alloc) {
+				cycle_alloc *= 2;
+				cycle_list = (qs_la_col_t *)xrealloc(cycle_list,
+						cycle_alloc * sizeof(qs_la_col_t));
+			}
+
+			c = cycle_list + num_cycles++;
+			c->cycle.num_relations = cycle_len;
+			c->cycle.list = (uint32 *)xmalloc(cycle_len * sizeof(uint32));
+			memcpy(c->cycle.list, cycle, cycle_len * sizeof(uint32));
+		}
+	}
+
+	/* only the relations dropped on their second try are lost */
+	num_dropped = t->num_dropped - retry_start;
+
+	if (obj->logfile != NULL)
+		logprint(obj->logfile, "found %u cycles from %u partial relations "
+			"(%u too dense)\n", num_cycles, num_partial, num_dropped);
+	if (VFLAG > 0)
+		printf("found %u cycles from %u partial relations (%u too dense)\n", 
+			num_cycles, num_partial, num_dropped);
+
+	free(dropped);
+	qs_tlp_cycles_free(t);
+
+	*num_cycles_out = num_cycles;
+	return cycle_list;
+}
+
 /*******************************************************************************
 These functions are used after sieving is complete to read in all
 relations and find/optimize all the cycles
 *******************************************************************************/
 #define NUM_CYCLE_BINS 8
 
+static int compare_relations(const void *x, const void *y);
+
+/*--------------------------------------------------------------------*/
+/* the filtering stage runs a few of its loops on THREADS threads.
+   A job is a function run once on each thread; threads tell
+   themselves apart by their id */
+
+typedef struct qs_filt_thread_s {
+	void (*work)(struct qs_filt_thread_s *t);
+	void *job;
+	uint32 id;
+	uint32 num_threads;
+
+#if defined(WIN32) || defined(_WIN64)
+	HANDLE thread_id;
+#else
+	pthread_t thread_id;
+#endif
+} qs_filt_thread_t;
+
+#if defined(WIN32) || defined(_WIN64)
+static DWORD WINAPI qs_filt_thread_main(LPVOID arg)
+#else
+static void *qs_filt_thread_main(void *arg)
+#endif
+{
+	qs_filt_thread_t *t = (qs_filt_thread_t *)arg;
+
+	t->work(t);
+
+#if defined(WIN32) || defined(_WIN64)
+	return 0;
+#else
+	return NULL;
+#endif
+}
+
+static void qs_filt_run(uint32 num_threads,
+			void (*work)(qs_filt_thread_t *t), void *job) {
+
+	qs_filt_thread_t *threads;
+	uint32 i;
+
+	threads = (qs_filt_thread_t *)xmalloc(num_threads *
+					sizeof(qs_filt_thread_t));
+	for (i = 0; i < num_threads; i++) {
+		threads[i].work = work;
+		threads[i].job = job;
+		threads[i].id = i;
+		threads[i].num_threads = num_threads;
+	}
+
+	if (num_threads == 1) {
+		work(threads);
+		free(threads);
+		return;
+	}
+
+#if defined(WIN32) || defined(_WIN64)
+	for (i = 0; i < num_threads; i++)
+		threads[i].thread_id = CreateThread(NULL, 0,
+				qs_filt_thread_main, threads + i, 0, NULL);
+	for (i = 0; i < num_threads; i++) {
+		WaitForSingleObject(threads[i].thread_id, INFINITE);
+		CloseHandle(threads[i].thread_id);
+	}
+#else
+	for (i = 0; i < num_threads; i++)
+		pthread_create(&threads[i].thread_id, NULL,
+				qs_filt_thread_main, threads + i);
+	for (i = 0; i < num_threads; i++)
+		pthread_join(threads[i].thread_id, NULL);
+#endif
+
+	free(threads);
+}
+
+static uint32 qs_filt_threads(uint32 num_items) {
+
+	/* don't bother with threads for small jobs */
+
+	if (THREADS < 2 || num_items < 10000)
+		return 1;
+	return (uint32)THREADS;
+}
+
+/*--------------------------------------------------------------------*/
+/* Relations are loaded from a savefile by mapping the file into
+   memory and cutting it into chunks that each start with a poly
+   'a' record, so that every chunk can be parsed, and have its
+   relations checked, without looking at any other. The chunks
+   are handed out to the threads and their results are put back
+   together in file order, so the outcome is the same as reading
+   the file from front to back */
+
+#define QS_LOAD_CHUNKS_PER_THREAD 4
+#define QS_LOAD_MIN_CHUNK (1 << 20)
+
+typedef struct {
+	uint8 *start;
+	uint8 *end;			/* the records in [start, end) */
+	uint32 num_a;			/* poly 'a' records in the chunk */
+	uint32 num_r;			/* relation records in the chunk */
+	uint32 a_base;			/* index of the first 'a' in the file */
+	uint32 r_base;			/* ordinal of the first relation */
+	uint32 num_tlp_skipped;		/* tlp relations we can't use */
+
+	/* first pass: the large primes of the relations */
+
+	siqs_r *lp_rels;
+	uint32 num_lp_rels;
+	uint32 lp_alloc;
+
+	/* second pass: the entries of the relation list that
+	   come from this chunk, and the polynomials they use */
+
+	uint32 rel_lo;
+	uint32 rel_hi;
+	poly_t *polys;
+	uint32 num_polys;
+	uint32 poly_alloc;
+} qs_load_chunk_t;
+
+typedef struct {
+	static_conf_t *sconf;
+	qs_savefile_map_t map;
+	qs_load_chunk_t *chunks;
+	uint32 num_chunks;
+	volatile uint32 next_chunk;
+	siqs_r *relation_list;
+	uint8 *status;			/* for each relation: 0 = not seen,
+					   1 = good, 2 = failed its check */
+} qs_load_job_t;
+
+static uint8 *qs_load_next_a(qs_load_job_t *job, uint8 *aligned,
+				uint8 *from, uint8 *end) {
+
+	/* find the first poly 'a' record at or after 'from'.
+	   Binary records can only be found by stepping from
+	   one to the next, starting at 'aligned' */
+
+	uint8 *p;
+
+	if (!job->map.binary) {
+		p = from - 1;
+		while (p < end) {
+			p = (uint8 *)memchr(p, '\n', end - p);
+			if (p == NULL || ++p == end)
+				return end;
+			if (*p == 'A')
+				return p;
+		}
+		return end;
+	}
+
+	p = aligned;
+	while (p < from)
+		qs_savefile_skip_entry(&job->map, &p, end);
+	while (p < end && *p != 'A')
+		qs_savefile_skip_entry(&job->map, &p, end);
+	return p;
+}
+
+static void qs_load_split(qs_load_job_t *job, uint32 num_threads) {
+
+	uint8 *end = job->map.base + job->map.size;
+	uint8 *pos = job->map.base;
+	uint32 fb_offsets[MAX_SMOOTH_PRIMES];
+	uint32 max_chunks, n;
+	uint64 target;
+	siqs_r rel;
+	mpz_t val;
+
+	/* skip over the magic number and the first entry */
+
+	if (job->map.binary)
+		pos += 4;
+	rel.fb_offsets = fb_offsets;
+	mpz_init(val);
+	qs_savefile_parse_entry(&job->map, &pos, end, &rel, val, 1);
+	mpz_clear(val);
+
+	max_chunks = num_threads * QS_LOAD_CHUNKS_PER_THREAD;
+	target = (uint64)(end - pos) / max_chunks;
+	if (target < QS_LOAD_MIN_CHUNK)
+		target = QS_LOAD_MIN_CHUNK;
+
+	job->chunks = (qs_load_chunk_t *)xmalloc(max_chunks *
+					sizeof(qs_load_chunk_t));
+	memset(job->chunks, 0, max_chunks * sizeof(qs_load_chunk_t));
+
+	n = 0;
+	job->chunks[0].start = pos;
+	while (n + 1 < max_chunks &&
+	       (uint64)(end - job->chunks[n].start) > target) {
+
+		uint8 *cut = qs_load_next_a(job, job->chunks[n].start,
+					job->chunks[n].start + target, end);
+		if (cut == end)
+			break;
+
+		job->chunks[n++].end = cut;
+		job->chunks[n].start = cut;
+	}
+	job->chunks[n++].end = end;
+	job->num_chunks = n;
+}
+
+static void qs_load_lp_work(qs_filt_thread_t *t) {
+
+	/* first pass: read the large primes of each relation */
+
+	qs_load_job_t *job = (qs_load_job_t *)t->job;
+	uint32 fb_offsets[MAX_SMOOTH_PRIMES];
+	siqs_r rel;
+	mpz_t a;
+	uint32 c;
+	int type;
+
+	rel.fb_offsets = fb_offsets;
+	mpz_init(a);
+
+	while ((c = QS_ATOMIC_INC(&job->next_chunk) - 1) < job->num_chunks) {
+		qs_load_chunk_t *chunk = job->chunks + c;
+		uint8 *pos = chunk->start;
+
+		while ((type = qs_savefile_parse_entry(&job->map, &pos,
+				chunk->end, &rel, a, 1)) >= 0) {
+
+			siqs_r *r;
+
+			if (type == 'A') {
+				chunk->num_a++;
+				continue;
+			}
+			if (type != 'R')
+				continue;
+
+			/* relations with three large primes can
+			   only be used by the tlp cycle code */
+			chunk->num_r++;
+			if ((rel.large_prime[2] != 1) &&
+			    (job->sconf->use_dlp != 2)) {
+				chunk->num_tlp_skipped++;
+				continue;
+			}
+
+			if (chunk->num_lp_rels == chunk->lp_alloc) {
+				chunk->lp_alloc = 3 * chunk->lp_alloc / 2 + 1000;
+				chunk->lp_rels = (siqs_r *)xrealloc(
+						chunk->lp_rels,
+						chunk->lp_alloc *
+						sizeof(siqs_r));
+			}
+			r = chunk->lp_rels + chunk->num_lp_rels++;
+			r->poly_idx = chunk->num_r - 1;
+			r->large_prime[0] = rel.large_prime[0];
+			r->large_prime[1] = rel.large_prime[1];
+			r->large_prime[2] = rel.large_prime[2];
+		}
+	}
+
+	mpz_clear(a);
+}
+
+static void qs_load_rel_work(qs_filt_thread_t *t) {
+
+	/* second pass: read in the relations that survived
+	   singleton removal, merge in the factors of their
+	   poly 'a' and verify them, and collect the poly 'b'
+	   values they use */
+
+	qs_load_job_t *job = (qs_load_job_t *)t->job;
+	static_conf_t *sconf = job->sconf;
+	uint32 in_fb_offsets[MAX_SMOOTH_PRIMES];
+	uint32 *final_poly_index = NULL;
+	int qlisort[MAX_A_FACTORS];
+	mpz_t *b_list = NULL;
+	uint32 b_alloc = 0;
+	uint32 num_b = 0;
+	siqs_r in_rel;
+	mpz_t a;
+	uint32 c;
+	int s = 0;
+
+	in_rel.fb_offsets = in_fb_offsets;
+	mpz_init(a);
+
+	while ((c = QS_ATOMIC_INC(&job->next_chunk) - 1) < job->num_chunks) {
+		qs_load_chunk_t *chunk = job->chunks + c;
+		uint8 *pos = chunk->start;
+		uint32 ordinal = chunk->r_base;
+		uint32 next = chunk->rel_lo;
+		uint32 a_idx = 0;
+		uint32 num_a = 0;
+		int type;
+
+		num_b = 0;
+		while (next < chunk->rel_hi &&
+		       (type = qs_savefile_parse_entry(&job->map, &pos,
+				chunk->end, &in_rel, a, 0)) >= 0) {
+
+			siqs_r *r;
+			uint32 i, j, k, b;
+
+			if (type == 'A') {
+				/* build all of the 'b' values for
+				   a new 'a'. If 'a' is bad, skip its
+				   relations */
+				a_idx = chunk->a_base + num_a++;
+				num_b = expand_poly_a(sconf, a, &b_list,
+						&b_alloc, qlisort, &s);
+				if (num_b == 0)
+					continue;
+
+				mpz_set(sconf->poly_a_list[a_idx], a);
+				final_poly_index = (uint32 *)xrealloc(
+						final_poly_index,
+						num_b * sizeof(uint32));
+				memset(final_poly_index, -1,
+						num_b * sizeof(uint32));
+				continue;
+			}
+			if (type != 'R')
+				continue;
+
+			/* check if this relation survived singleton
+			   removal, skipping over any that went
+			   missing */
+			while (next < chunk->rel_hi &&
+			       job->relation_list[next].poly_idx < ordinal)
+				next++;
+
+			if (next == chunk->rel_hi ||
+			    job->relation_list[next].poly_idx != ordinal++)
+				continue;
+
+			r = job->relation_list + next;
+			job->status[next++] = 2;
+			b = in_rel.poly_idx;
+			if (b >= num_b)
+				continue;
+
+			/* combine the factors of the sieve value with
+			   the factors of the polynomial 'a' value; the
+			   linear algebra code has to know about both.
+			   Because both lists are sorted, this is just
+			   a merge operation */
+
+			r->fb_offsets = (uint32 *)xmalloc(
+				(in_rel.num_factors + s) * sizeof(uint32));
+
+			i = j = k = 0;
+			while (i < in_rel.num_factors && j < (uint32)s) {
+				if (in_fb_offsets[i] < (uint32)qlisort[j])
+					r->fb_offsets[k++] = in_fb_offsets[i++];
+				else if (in_fb_offsets[i] > (uint32)qlisort[j])
+					r->fb_offsets[k++] = qlisort[j++];
+				else {
+					r->fb_offsets[k++] = in_fb_offsets[i++];
+					r->fb_offsets[k++] = qlisort[j++];
+				}
+			}
+			while (i < in_rel.num_factors)
+				r->fb_offsets[k++] = in_fb_offsets[i++];
+			while (j < (uint32)s)
+				r->fb_offsets[k++] = qlisort[j++];
+
+			r->num_factors = k;
+			r->sieve_offset = in_rel.sieve_offset;
+			r->parity = in_rel.parity;
+			r->large_prime[0] = in_rel.large_prime[0];
+			r->large_prime[1] = in_rel.large_prime[1];
+			r->large_prime[2] = in_rel.large_prime[2];
+
+			if (check_relation(a, b_list[b], r,
+					sconf->factor_base, sconf->n)) {
+				free(r->fb_offsets);
+				r->fb_offsets = NULL;
+				continue;
+			}
+
+			/* the first relation to use a 'b' value
+			   saves it */
+			if (final_poly_index[b] == (uint32)(-1)) {
+				poly_t *p;
+
+				if (chunk->num_polys == chunk->poly_alloc) {
+					chunk->poly_alloc = 2 * chunk->poly_alloc + 100;
+					chunk->polys = (poly_t *)xrealloc(
+							chunk->polys,
+							chunk->poly_alloc *
+							sizeof(poly_t));
+				}
+				p = chunk->polys + chunk->num_polys;
+				p->a_idx = a_idx;
+				mpz_init_set(p->b, b_list[b]);
+				final_poly_index[b] = chunk->num_polys++;
+			}
+			r->poly_idx = final_poly_index[b];
+			job->status[next - 1] = 1;
+		}
+	}
+
+	for (c = 0; c < b_alloc; c++)
+		mpz_clear(b_list[c]);
+	free(b_list);
+	free(final_poly_index);
+	mpz_clear(a);
+}
+
+static void qs_warn_tlp_skipped(fact_obj_t *obj, uint32 num_skipped) {
+
+	/* a run that used tlp was resumed without it */
+
+	if (num_skipped == 0)
+		return;
+
+	printf("warning: ignoring %u relations with three large primes; "
+		"resume with -forceTLP to use them\n", num_skipped);
+	if (obj->logfile != NULL)
+		logprint(obj->logfile, "warning: ignoring %u relations with three "
+			"large primes; resume with -forceTLP to use them\n", num_skipped);
+}
+
+static siqs_r * qs_load_large_primes(qs_load_job_t *job,
+			uint32 *num_relations_out, uint32 *total_poly_a_out) {
+
+	/* the parallel version of the first pass over the
+	   savefile. Chunks are cut here and reused by the
+	   second pass */
+
+	uint32 num_threads = qs_filt_threads(
+			(uint32)(job->map.size / QS_LOAD_MIN_CHUNK) * 10000);
+	uint32 c, num_relations, num_a, num_r, num_skipped;
+	siqs_r *relation_list;
+
+	qs_load_split(job, num_threads);
+	if (num_threads > job->num_chunks)
+		num_threads = job->num_chunks;
+
+	job->next_chunk = 0;
+	qs_filt_run(num_threads, qs_load_lp_work, job);
+
+	num_relations = num_a = num_r = num_skipped = 0;
+	for (c = 0; c < job->num_chunks; c++) {
+		job->chunks[c].a_base = num_a;
+		job->chunks[c].r_base = num_r;
+		num_a += job->chunks[c].num_a;
+		num_r += job->chunks[c].num_r;
+		num_relations += job->chunks[c].num_lp_rels;
+		num_skipped += job->chunks[c].num_tlp_skipped;
+	}
+	qs_warn_tlp_skipped(job->sconf->obj, num_skipped);
+
+	relation_list = (siqs_r *)xmalloc((num_relations + 1) * sizeof(siqs_r));
+	num_relations = 0;
+	for (c = 0; c < job->num_chunks; c++) {
+		qs_load_chunk_t *chunk = job->chunks + c;
+		uint32 i;
+
+		for (i = 0; i < chunk->num_lp_rels; i++) {
+			siqs_r *r = relation_list + num_relations++;
+
+			*r = chunk->lp_rels[i];
+			r->poly_idx += chunk->r_base;
+			r->fb_offsets = NULL;
+		}
+		free(chunk->lp_rels);
+		chunk->lp_rels = NULL;
+	}
+
+	*num_relations_out = num_relations;
+	*total_poly_a_out = num_a;
+	return relation_list;
+}
+
+static uint32 qs_load_relations(qs_load_job_t *job, siqs_r *relation_list,
+			uint32 num_relations, uint32 *num_poly_out) {
+
+	/* the parallel version of the second pass over the
+	   savefile. relation_list holds the ordinals of the
+	   relations to read, in increasing order; it is
+	   overwritten with the relations themselves */
+
+	static_conf_t *sconf = job->sconf;
+	fact_obj_t *obj = sconf->obj;
+	uint32 num_threads = qs_filt_threads(num_relations);
+	uint32 c, i, num_poly, num_saved;
+	uint32 *poly_base;
+
+	/* find the range of relation_list for each chunk */
+
+	for (c = i = 0; c < job->num_chunks; c++) {
+		qs_load_chunk_t *chunk = job->chunks + c;
+
+		chunk->rel_lo = i;
+		while (i < num_relations &&
+		       relation_list[i].poly_idx < chunk->r_base + chunk->num_r)
+			i++;
+		chunk->rel_hi = i;
+	}
+
+	job->relation_list = relation_list;
+	job->status = (uint8 *)xmalloc(num_relations + 1);
+	memset(job->status, 0, num_relations + 1);
+
+	if (num_threads > job->num_chunks)
+		num_threads = job->num_chunks;
+	job->next_chunk = 0;
+	qs_filt_run(num_threads, qs_load_rel_work, job);
+
+	/* concatenate the polynomials of all the chunks */
+
+	poly_base = (uint32 *)xmalloc(job->num_chunks * sizeof(uint32));
+	for (c = num_poly = 0; c < job->num_chunks; c++) {
+		poly_base[c] = num_poly;
+		num_poly += job->chunks[c].num_polys;
+	}
+
+	sconf->poly_list = (poly_t *)xmalloc((num_poly + 1) * sizeof(poly_t));
+	for (c = 0; c < job->num_chunks; c++) {
+		qs_load_chunk_t *chunk = job->chunks + c;
+
+		memcpy(sconf->poly_list + poly_base[c], chunk->polys,
+			chunk->num_polys * sizeof(poly_t));
+		free(chunk->polys);
+	}
+	sconf->poly_list_alloc = num_poly;
+
+	/* then squeeze out the relations that failed, and do
+	   the bookkeeping for the rest in file order */
+
+	for (c = num_saved = 0; c < job->num_chunks; c++) {
+		qs_load_chunk_t *chunk = job->chunks + c;
+
+		for (i = chunk->rel_lo; i < chunk->rel_hi; i++) {
+			siqs_r *r = relation_list + i;
+
+			if (job->status[i] == 2) {
+				if (obj->logfile != NULL)
+					logprint(obj->logfile,
+						"failed to read relation %d\n", i);
+				if (VFLAG > 0)
+					printf("failed to read relation %d\n", i);
+			}
+			if (job->status[i] != 1)
+				continue;
+
+			r->poly_idx += poly_base[c];
+			yafu_count_relation(sconf, obj->flags, r->large_prime);
+			relation_list[num_saved++] = *r;
+		}
+	}
+
+	free(poly_base);
+	free(job->status);
+	free(job->chunks);
+	*num_poly_out = num_poly;
+	return num_saved;
+}
+
+/*--------------------------------------------------------------------*/
+/* singleton and duplicate removal split the relation list
+   into one slice per thread */
+
+typedef struct {
+	siqs_r *list;
+	siqs_r *tmp;
+	uint32 *slice_start;		/* num_slices + 1 entries */
+	uint32 *slice_left;		/* relations kept in each slice */
+	uint32 num_slices;
+	uint32 width;			/* sorted runs are this many slices */
+	qs_cycle_t *table;
+	uint32 *hashtable;
+} qs_slice_job_t;
+
+static qs_cycle_t *find_table_entry(qs_cycle_t *table, uint32 *hashtable,
+				uint32 prime) {
+
+	/* get_table_entry for a prime that should already be
+	   in the table, without ever adding to it. Returns
+	   NULL if the prime is missing */
+
+	uint32 offset = hashtable[QS_HASH(prime)];
+
+	while (offset != 0) {
+		qs_cycle_t *entry = table + offset;
+		if (entry->prime == prime)
+			return entry;
+		offset = entry->next;
+	}
+	return NULL;
+}
+
+static void qs_singleton_work(qs_filt_thread_t *t) {
+
+	/* one pass of singleton removal over this thread's
+	   slice of the list. Counts in the graph are shared
+	   by all the threads; they only ever go down, so a
+	   relation that looks removable here is removable */
+
+	qs_slice_job_t *job = (qs_slice_job_t *)t->job;
+	siqs_r *list = job->list;
+	uint32 i, j, k;
+
+	for (i = j = job->slice_start[t->id]; 
+			i < job->slice_start[t->id + 1]; i++) {
+		siqs_r *r = list + i;
+		qs_cycle_t *entry;
+
+		/* full relations always survive */
+
+		if (r->large_prime[0] == r->large_prime[1]) {
+			list[j++] = list[i];
+			continue;
+		}
+
+		for (k = 0; k < 2; k++) {
+			entry = find_table_entry(job->table, job->hashtable,
+						r->large_prime[k]);
+
+			/* if the relation is due to be removed,
+			   decrement the count of its other prime */
+
+			if (entry == NULL || entry->count < 2) {
+				entry = find_table_entry(job->table, 
+						job->hashtable, 
+						r->large_prime[k ^ 1]);
+				if (entry != NULL) {
+					if (t->num_threads > 1)
+						QS_ATOMIC_DEC(&entry->count);
+					else
+						entry->count--;
+				}
+				break;
+			}
+		}
+
+		if (k == 2)
+			list[j++] = list[i];
+	}
+
+	job->slice_left[t->id] = j - job->slice_start[t->id];
+}
+
+static void qs_slice_init(qs_slice_job_t *job, siqs_r *list, 
+			uint32 num_relations, uint32 num_slices) {
+
+	uint32 i;
+
+	memset(job, 0, sizeof(qs_slice_job_t));
+	job->list = list;
+	job->num_slices = num_slices;
+	job->slice_start = (uint32 *)xmalloc((num_slices + 1) * sizeof(uint32));
+	job->slice_left = (uint32 *)xmalloc(num_slices * sizeof(uint32));
+	for (i = 0; i <= num_slices; i++)
+		job->slice_start[i] = (uint32)((uint64)num_relations * i / num_slices);
+}
+
+static void qs_slice_free(qs_slice_job_t *job) {
+	free(job->slice_start);
+	free(job->slice_left);
+}
+
+static void qs_merge_runs(siqs_r *dest, siqs_r *src1, uint32 n1,
+			siqs_r *src2, uint32 n2) {
+
+	while (n1 && n2) {
+		if (compare_relations(src1, src2) <= 0) {
+			*dest++ = *src1++;
+			n1--;
+		}
+		else {
+			*dest++ = *src2++;
+			n2--;
+		}
+	}
+	memcpy(dest, src1, n1 * sizeof(siqs_r));
+	memcpy(dest + n1, src2, n2 * sizeof(siqs_r));
+}
+
+static void qs_sort_work(qs_filt_thread_t *t) {
+
+	/* with width 0, sort this thread's slice. Otherwise
+	   merge pairs of sorted runs of 'width' slices each
+	   from list into tmp */
+
+	qs_slice_job_t *job = (qs_slice_job_t *)t->job;
+	uint32 *start = job->slice_start;
+	uint32 w = job->width;
+	uint32 i;
+
+	if (w == 0) {
+		qsort(job->list + start[t->id], 
+			(size_t)(start[t->id + 1] - start[t->id]),
+			sizeof(siqs_r), compare_relations);
+		return;
+	}
+
+	for (i = 2 * w * t->id; i < job->num_slices; 
+				i += 2 * w * t->num_threads) {
+		uint32 lo = start[i];
+		uint32 mid = start[MIN(i + w, job->num_slices)];
+		uint32 hi = start[MIN(i + 2 * w, job->num_slices)];
+
+		qs_merge_runs(job->tmp + lo, job->list + lo, mid - lo,
+				job->list + mid, hi - mid);
+	}
+}
+
+static void qs_sort_relations(siqs_r *rlist, uint32 num_relations) {
+
+	/* sort a list of relations with compare_relations,
+	   using all the threads for big lists */
+
+	uint32 num_threads = qs_filt_threads(num_relations);
+	qs_slice_job_t job;
+	siqs_r *tmp;
+
+	if (num_threads == 1) {
+		qsort(rlist, (size_t)num_relations,
+			sizeof(siqs_r), compare_relations);
+		return;
+	}
+
+	qs_slice_init(&job, rlist, num_relations, num_threads);
+	job.tmp = tmp = (siqs_r *)xmalloc(num_relations * sizeof(siqs_r));
+	qs_filt_run(num_threads, qs_sort_work, &job);
+
+	for (job.width = 1; job.width < job.num_slices; job.width *= 2) {
+		siqs_r *swap;
+
+		qs_filt_run(MIN(num_threads, 
+			(job.num_slices + 2 * job.width - 1) / (2 * job.width)),
+			qs_sort_work, &job);
+		swap = job.list;
+		job.list = job.tmp;
+		job.tmp = swap;
+	}
+
+	if (job.list != rlist)
+		memcpy(rlist, job.list, num_relations * sizeof(siqs_r));
+
+	free(tmp);
+	qs_slice_free(&job);
+}
+
 void yafu_qs_filter_relations(static_conf_t *sconf) {
 
 	/* Perform all of the postprocessing on the list
@@ -653,11 +1817,16 @@ void yafu_qs_filter_relations(static_conf_t *sconf) {
 	uint32 total_poly_a;
 	uint32 poly_saved;
 	uint32 cycle_bins[NUM_CYCLE_BINS+1] = {0};
-	char buf[LINE_BUF_SIZE];
-	char *subbuf;
+	siqs_r in_rel;
+	uint32 in_fb_offsets[MAX_SMOOTH_PRIMES];
+	int type;
 	uint32 last_id;
 	int first, last_poly;
 	uint32 this_rel = 0;
+	uint32 rel_ordinal = 0;
+	uint32 num_tlp_skipped = 0;
+	qs_load_job_t load;
+	int use_map = 0;
 
  	/* Rather than reading all the relations in and 
 	   then removing singletons, read only the large 
@@ -669,30 +1838,51 @@ void yafu_qs_filter_relations(static_conf_t *sconf) {
 
 	i = 0;
 	total_poly_a = 0;
+	in_rel.fb_offsets = in_fb_offsets;
 
-	if (!sconf->in_mem)
+	if (!sconf->in_mem &&
+		(qs_savefile_map(obj->qs_obj.savefile.name, &load.map) == 0))
+	{
+		/* the whole savefile is in memory; read it in 
+		   pieces on all threads */
+		use_map = 1;
+		load.sconf = sconf;
+		relation_list = qs_load_large_primes(&load, 
+			&num_relations, &total_poly_a);
+	}
+	else if (!sconf->in_mem)
 	{
 		/* skip over the first line */
 		qs_savefile_open(&obj->qs_obj.savefile, SAVEFILE_READ);
-		qs_savefile_read_line(buf, sizeof(buf), &obj->qs_obj.savefile);
+		qs_savefile_read_entry(&obj->qs_obj.savefile, &in_rel, 
+			sconf->curr_a, 1);
 
 		//we don't know beforehand how many rels to expect, so start
 		//with some amount and allow it to increase as we read them
 		relation_list = (siqs_r *)xmalloc(10000 * sizeof(siqs_r));
 		curr_rel = 10000;
-		while (!qs_savefile_eof(&obj->qs_obj.savefile)) {
-			char *start;
+		while ((type = qs_savefile_read_entry(&obj->qs_obj.savefile, 
+			&in_rel, sconf->curr_a, 1)) >= 0) {
 
-			switch (buf[0]) {
+			switch (type) {
 			case 'A':
 				total_poly_a++;
 				break;
 
 			case 'R':
-				start = strchr(buf, 'L');
-				if (start != NULL) {
-					uint32 prime1, prime2;
-					yafu_read_large_primes(start, &prime1, &prime2);
+				{
+					uint32 prime1 = in_rel.large_prime[0];
+					uint32 prime2 = in_rel.large_prime[1];
+					uint32 prime3 = in_rel.large_prime[2];
+
+					/* relations with three large primes can
+					   only be used by the tlp cycle code */
+					if ((prime3 != 1) && (sconf->use_dlp != 2)) {
+						rel_ordinal++;
+						num_tlp_skipped++;
+						break;
+					}
+
 					if (i == curr_rel) {
 						curr_rel = 3 * curr_rel / 2;
 						relation_list = (siqs_r *)xrealloc(
@@ -700,17 +1890,17 @@ void yafu_qs_filter_relations(static_conf_t *sconf) {
 								curr_rel *
 								sizeof(siqs_r));
 					}
-					relation_list[i].poly_idx = i;
+					relation_list[i].poly_idx = rel_ordinal++;
 					relation_list[i].large_prime[0] = prime1;
 					relation_list[i].large_prime[1] = prime2;
+					relation_list[i].large_prime[2] = prime3;
 					i++;
 				}
 				break;
 			}
-
-			qs_savefile_read_line(buf, sizeof(buf), &obj->qs_obj.savefile);
 		}
 		num_relations = i;
+		qs_warn_tlp_skipped(obj, num_tlp_skipped);
 	}
 	else
 	{
@@ -720,13 +1910,28 @@ void yafu_qs_filter_relations(static_conf_t *sconf) {
 			relation_list[i].poly_idx = i;
 			relation_list[i].large_prime[0] = sconf->in_mem_relations[i].large_prime[0];
 			relation_list[i].large_prime[1] = sconf->in_mem_relations[i].large_prime[1];
+			relation_list[i].large_prime[2] = sconf->in_mem_relations[i].large_prime[2];
 		}
 		total_poly_a = sconf->total_poly_a;
 		num_relations = sconf->buffered_rels;
 	}
 		
-	num_relations = qs_purge_singletons(obj, relation_list, num_relations,
-					table, hashtable);
+	if (sconf->use_dlp == 2)
+	{
+		/* the cycle counter used during sieving is no
+		   longer needed; the cycles are rebuilt below */
+		qs_tlp_cycles_free(sconf->tlp_cycles);
+		sconf->tlp_cycles = NULL;
+
+		num_relations = qs_purge_singletons_tlp(obj, relation_list, 
+						num_relations, sconf);
+		table = sconf->cycle_table;
+	}
+	else
+	{
+		num_relations = qs_purge_singletons(obj, relation_list, num_relations,
+						table, hashtable);
+	}
 
 	relation_list = (siqs_r *)xrealloc(relation_list, num_relations * 
 							sizeof(siqs_r));
@@ -766,6 +1971,15 @@ void yafu_qs_filter_relations(static_conf_t *sconf) {
 	if (VFLAG > 0)
 		printf("attempting to read %u relations\n", num_relations);
 
+	if (use_map)
+	{
+		free(sconf->poly_list);
+		curr_saved = qs_load_relations(&load, relation_list, 
+			num_relations, &i);
+		qs_savefile_unmap(&load.map);
+		goto relations_loaded;
+	}
+
 	/* Read in the relations and the polynomials they use
 	   at the same time. */
 
@@ -776,7 +1990,6 @@ void yafu_qs_filter_relations(static_conf_t *sconf) {
 
 	first = 1;
 	while (curr_expected < num_relations) {
-		char *tmp;
 		uint32 bad_A_val = 0;
 		siqs_r *r;
 		siqs_r *rel;
@@ -784,9 +1997,10 @@ void yafu_qs_filter_relations(static_conf_t *sconf) {
 		/* read in the next entity */
 		if (!sconf->in_mem)
 		{
-			if (qs_savefile_eof(&obj->qs_obj.savefile))
+			type = qs_savefile_read_entry(&obj->qs_obj.savefile, 
+				&in_rel, sconf->curr_a, 0);
+			if (type < 0)
 				break;
-			qs_savefile_read_line(buf, sizeof(buf), &obj->qs_obj.savefile);
 		}
 		else
 		{
@@ -800,23 +2014,19 @@ void yafu_qs_filter_relations(static_conf_t *sconf) {
 
 			rel = sconf->in_mem_relations + this_rel++;
 			if (rel->poly_idx < last_id)
-				buf[0] = 'A';
+				type = 'A';
 			else
-				buf[0] = 'R';
+				type = 'R';
 
 			last_id = rel->poly_idx;
 		}
 
-		switch (buf[0]) {
+		switch (type) {
 		case 'A':
-			/* Read in a new 'a' value */
+			/* a new 'a' value (already read into curr_a if 
+			   it came from the savefile) */
 			/* build all of the 'b' values associated with it */
-			if (!sconf->in_mem)
-			{
-				subbuf = buf + 2;	//skip the A and a space
-				mpz_set_str(sconf->curr_a, subbuf, 0);
-			}
-			else
+			if (sconf->in_mem)
 			{
 				last_poly++;
 				this_rel--;
@@ -854,17 +2064,8 @@ void yafu_qs_filter_relations(static_conf_t *sconf) {
 				continue;
 
 			// corrupted rel?
-			if (!sconf->in_mem)
-			{
-				tmp = strchr(buf, 'L');
-				if (tmp == NULL)
-					break;
-			}
-			else
-			{
-				if (rel->large_prime[0] == 0)
-					break;
-			}
+			if (sconf->in_mem && (rel->large_prime[0] == 0))
+				break;
 
 			/* Check if this relation is needed. If it
 			   survived singleton removal then its 
@@ -894,11 +2095,10 @@ void yafu_qs_filter_relations(static_conf_t *sconf) {
 
 			if (!sconf->in_mem)
 			{
-				/* convert the ASCII text of the relation to a
-				relation_t, verifying correctness in the process */
+				/* merge in the poly 'a' factors, verifying 
+				correctness in the process */
 				r = relation_list + curr_saved;
-				subbuf = buf + 2;	//skip over the R and a space
-				if (process_rel(subbuf, sconf->factor_base,
+				if (process_rel(&in_rel, sconf->factor_base,
 					sconf->n, sconf, sconf->obj, r)) {
 
 						if (obj->logfile != NULL)
@@ -948,6 +2148,7 @@ void yafu_qs_filter_relations(static_conf_t *sconf) {
 				r->num_factors = rel->num_factors + sconf->curr_poly->s;
 				r->large_prime[0] = rel->large_prime[0];
 				r->large_prime[1] = rel->large_prime[1];
+				r->large_prime[2] = rel->large_prime[2];
 				r->parity = rel->parity;
 				r->sieve_offset = rel->sieve_offset;
 				r->poly_idx = rel->poly_idx;
@@ -955,14 +2156,7 @@ void yafu_qs_filter_relations(static_conf_t *sconf) {
 				if (!check_relation(sconf->curr_a,
 						sconf->curr_b[r->poly_idx], r, sconf->factor_base, sconf->n))
 				{
-					if (r->large_prime[0] != r->large_prime[1]) {
-						yafu_add_to_cycles(sconf, obj->flags, 
-							r->large_prime[0], r->large_prime[1]);
-						sconf->num_cycles++;
-					}
-					else {
-						sconf->num_relations++;
-					}
+					yafu_count_relation(sconf, obj->flags, r->large_prime);
 				}
 
 			}
@@ -1001,6 +2195,7 @@ void yafu_qs_filter_relations(static_conf_t *sconf) {
 	/* update the structures with the counts of relations
 	   and polynomials actually recovered */
 
+relations_loaded:
 	num_relations = curr_saved;
 	if (obj->logfile != NULL)
 	{
@@ -1013,7 +2208,7 @@ void yafu_qs_filter_relations(static_conf_t *sconf) {
 		printf("recovered %u polynomials\n", i);
 	}
 
-	if (!sconf->in_mem)
+	if (!sconf->in_mem && !use_map)
 		qs_savefile_close(&obj->qs_obj.savefile);
 
 	free(final_poly_index);
@@ -1027,6 +2222,17 @@ void yafu_qs_filter_relations(static_conf_t *sconf) {
 	num_relations = qs_purge_duplicate_relations(obj, 
 				relation_list, num_relations);
 
+	/* relations with three large primes do not form a graph;
+	   their cycles are found by linear algebra on the large
+	   primes instead */
+
+	if (sconf->use_dlp == 2)
+	{
+		cycle_list = qs_build_tlp_cycles(obj, relation_list, 
+				num_relations, &num_cycles);
+		goto sort_cycles;
+	}
+
 	memset(hashtable, 0, sizeof(uint32) * (1 << QS_LOG2_CYCLE_HASH));
 	sconf->vertices = 0;
 	sconf->components = 0;
@@ -1213,6 +2419,8 @@ void yafu_qs_filter_relations(static_conf_t *sconf) {
 	if (VFLAG > 0)
 		printf("found %u cycles in %u passes\n", num_cycles, passes);
 	
+ sort_cycles:
+
 	/* sort the list of cycles so that the cycles with
 	   the largest number of relations will come last. 
 	   If the linear algebra code skips any cycles it
@@ -1283,6 +2491,11 @@ static int compare_relations(const void *x, const void *y) {
 	siqs_r *yy = (siqs_r *)y;
 	uint32 i;
 
+	if (xx->large_prime[2] > yy->large_prime[2])
+		return 1;
+	if (xx->large_prime[2] < yy->large_prime[2])
+		return -1;
+
 	if (xx->large_prime[1] > yy->large_prime[1])
 		return 1;
 	if (xx->large_prime[1] < yy->large_prime[1])
@@ -1319,8 +2532,7 @@ uint32 qs_purge_duplicate_relations(fact_obj_t *obj,
 	if (num_relations < 2)
 		return num_relations;
 
-	qsort(rlist, (size_t)num_relations,
-		sizeof(siqs_r), compare_relations);
+	qs_sort_relations(rlist, num_relations);
 
 	for (i = 1, j = 0; i < num_relations; i++) {
 		if (compare_relations(rlist + j, rlist + i) == 0)
@@ -1345,13 +2557,15 @@ uint32 qs_purge_duplicate_relations(fact_obj_t *obj,
 	return j;
 }
 
-void yafu_read_large_primes(char *buf, uint32 *prime1, uint32 *prime2) {
+void yafu_read_large_primes(char *buf, uint32 *prime1, uint32 *prime2, 
+	uint32 *prime3) {
 
 	char *next_field;
-	uint32 p1, p2;
+	uint32 p1, p2, p3;
 
 	*prime1 = p1 = 1;
 	*prime2 = p2 = 2;
+	*prime3 = p3 = 1;
 	if (*buf != 'L')
 		return;
 
@@ -1368,17 +2582,32 @@ void yafu_read_large_primes(char *buf, uint32 *prime1, uint32 *prime2) {
 
 	while (isspace(*buf))
 		buf++;
-	if (isxdigit(*buf))
+	if (isxdigit(*buf)) {
 		p2 = strtoul(buf, &next_field, 16);
+		buf = next_field;
+
+		/* tlp relations have a third prime */
+		while (isspace(*buf))
+			buf++;
+		if (isxdigit(*buf))
+			p3 = strtoul(buf, &next_field, 16);
+	}
 	
-	if (p1 < p2) {
-		*prime1 = p1;
-		*prime2 = p2;
+	if (p1 > p2) {
+		uint32 tmp = p1; p1 = p2; p2 = tmp;
 	}
-	else {
-		*prime1 = p2;
-		*prime2 = p1;
+	if (p3 != 1) {
+		if (p2 > p3) {
+			uint32 tmp = p2; p2 = p3; p3 = tmp;
+		}
+		if (p1 > p2) {
+			uint32 tmp = p1; p1 = p2; p2 = tmp;
+		}
 	}
+
+	*prime1 = p1;
+	*prime2 = p2;
+	*prime3 = p3;
 }
 
 uint32 qs_purge_singletons(fact_obj_t *obj, siqs_r *list, 
@@ -1392,8 +2621,10 @@ uint32 qs_purge_singletons(fact_obj_t *obj, siqs_r *list,
 	   this process must be iterated until no more relations
 	   are removed */
 
+	uint32 num_threads = qs_filt_threads(num_relations);
+	qs_slice_job_t job;
 	uint32 num_left;
-	uint32 i, j, k;
+	uint32 i, j;
 	uint32 passes = 0;
 
 	if (VFLAG > 0)
@@ -1404,45 +2635,23 @@ uint32 qs_purge_singletons(fact_obj_t *obj, siqs_r *list,
 	do {
 		num_left = num_relations;
 
-		/* for each relation */
-
-		for (i = j = 0; i < num_relations; i++) {
-			siqs_r *r = list + i;
-			uint32 prime;
-			qs_cycle_t *entry;
+		/* each thread squeezes the removed relations out
+		   of its own slice of the list, then the slices
+		   are joined back up */
 
-			/* full relations always survive */
+		qs_slice_init(&job, list, num_relations, num_threads);
+		job.table = table;
+		job.hashtable = hashtable;
+		qs_filt_run(num_threads, qs_singleton_work, &job);
 
-			if (r->large_prime[0] == r->large_prime[1]) {
-				list[j++] = list[i];
-				continue;
-			}
-
-			/* for each prime in that relation */
-
-			for (k = 0; k < 2; k++) {
-				prime = r->large_prime[k];
-				entry = get_table_entry(table, hashtable,
-							prime, 0);
-
-				/* if the relation is due to be removed,
-				   decrement the count of its other
-				   primes in the graph. The following is
-				   specialized for two primes */
-
-				if (entry->count < 2) {
-					prime = r->large_prime[k ^ 1];
-					entry = get_table_entry(table, 
-								hashtable, 
-								prime, 0);
-					entry->count--;
-					break;
-				}
-			}
-
-			if (k == 2)
-				list[j++] = list[i];
+		for (i = j = 0; i < num_threads; i++) {
+			if (j != job.slice_start[i])
+				memmove(list + j, list + job.slice_start[i],
+					job.slice_left[i] * sizeof(siqs_r));
+			j += job.slice_left[i];
 		}
+		qs_slice_free(&job);
+
 		num_relations = j;
 		passes++;
 
@@ -0,0 +1,45 @@
+/*----------------------------------------------------------------------
+This source distribution is placed in the public domain by its author,
+Ben Buhrow. You may use it for any purpose, free of charge,
+without having to notify anyone. I disclaim any responsibility for any
+errors.
+
+Optionally, please be nice and tell me if you find this source to be
+useful. Again optionally, if you add to the functionality present here
+please consider making those additions public too, so that others may 
+benefit from your work.	
+
+Some parts of the code (and also this header), included in this 
+distribution have been reused from other sources. In particular I 
+have benefitted greatly from the work of Jason Papadopoulos's msieve @ 
+www.boo.net/~jasonp, Scott Contini's mpqs implementation, and Tom St. 
+Denis Tom's Fast Math library.  Many thanks to their kind donation of 
+code to the public domain.
+       				   --bbuhrow@gmail.com 11/24/09
+----------------------------------------------------------------------*/
+
+// included first by the sse4.1 and avx2 siqs kernel files, after 
+// defining SIQS_KERNEL_SSE41 or SIQS_KERNEL_AVX2.  in a fat build 
+// (make FAT=1) everything else is compiled for the baseline x86-64 
+// target; this turns on the kernel's instruction set for the rest of 
+// its file only.  siqs_static_init points at these kernels only on 
+// cpus that have the instructions (HAS_SSE41 / HAS_AVX2).
+
+#if defined(SIQS_FAT) && defined(__GNUC__)
+
+#if defined(SIQS_KERNEL_AVX2)
+	#ifndef USE_AVX2
+	#define USE_AVX2
+	#endif
+	#ifndef USE_SSE41
+	#define USE_SSE41
+	#endif
+	#pragma GCC target("avx2")
+#elif defined(SIQS_KERNEL_SSE41)
+	#ifndef USE_SSE41
+	#define USE_SSE41
+	#endif
+	#pragma GCC target("sse4.1")
+#endif
+
+#endif
@@ -134,14 +134,6 @@ void lp_sieveblock(uint8 *sieve, uint32 bnum, uint32 numblocks,
 
 #endif
 
-#ifdef QS_TIMING
-	gettimeofday (&qs_timing_stop, NULL);
-	qs_timing_diff = my_difftime (&qs_timing_start, &qs_timing_stop);
-
-	SIEVE_STG2 += ((double)qs_timing_diff->secs + (double)qs_timing_diff->usecs / 1000000);
-	free(qs_timing_diff);
-#endif
-
 	return;
 }
 
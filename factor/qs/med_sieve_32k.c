@@ -51,10 +51,6 @@ void med_sieveblock_32k(uint8 *sieve, sieve_fb_compressed *fb, fb_list *full_fb,
 
 	med_B = full_fb->med_B;
 	
-#ifdef QS_TIMING
-	gettimeofday(&qs_timing_start, NULL);
-#endif
-
 	//initialize the block
 	BLOCK_INIT;
 
@@ -231,16 +227,6 @@ void med_sieveblock_32k(uint8 *sieve, sieve_fb_compressed *fb, fb_list *full_fb,
 #endif
 
 
-#ifdef QS_TIMING
-	gettimeofday (&qs_timing_stop, NULL);
-	qs_timing_diff = my_difftime (&qs_timing_start, &qs_timing_stop);
-
-	SIEVE_STG1 += ((double)qs_timing_diff->secs + (double)qs_timing_diff->usecs / 1000000);
-	free(qs_timing_diff);
-
-	gettimeofday(&qs_timing_start, NULL);
-#endif
-
 	return;
 
 }
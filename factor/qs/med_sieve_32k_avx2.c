@@ -18,6 +18,8 @@ code to the public domain.
        				   --bbuhrow@gmail.com 11/24/09
 ----------------------------------------------------------------------*/
 
+#define SIQS_KERNEL_AVX2
+#include "kernel_target.h"
 #include "common.h"
 
 // protect avx2 code under MSVC builds.  USE_AVX2 should be manually
@@ -612,7 +614,7 @@ code to the public domain.
         "movl	%%r8d, 40(%%r12,1) \n\t"		/* copy out final value of i */ \
         :																\
         : "g"(&asm_input)												\
-        : "rax", "rbx", "rcx", "rdx", "rdi", "rsi", "r8", "r9", "r10", "r11", "r12", "r13", "r14", "memory", "cc");
+        : "rax", "rbx", "rcx", "rdx", "rdi", "rsi", "r8", "r9", "r10", "r11", "r12", "r13", "r14", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "memory", "cc");
 
 
 #if defined(_MSC_VER)
@@ -645,10 +647,6 @@ void med_sieveblock_32k_avx2(uint8 *sieve, sieve_fb_compressed *fb, fb_list *ful
 
     CLEAN_AVX2;
 	
-#ifdef QS_TIMING
-	gettimeofday(&qs_timing_start, NULL);
-#endif
-
 	//initialize the block
 	BLOCK_INIT;
 
@@ -808,16 +806,6 @@ void med_sieveblock_32k_avx2(uint8 *sieve, sieve_fb_compressed *fb, fb_list *ful
     CLEAN_AVX2;
 
 
-#ifdef QS_TIMING
-	gettimeofday (&qs_timing_stop, NULL);
-	qs_timing_diff = my_difftime (&qs_timing_start, &qs_timing_stop);
-
-	SIEVE_STG1 += ((double)qs_timing_diff->secs + (double)qs_timing_diff->usecs / 1000000);
-	free(qs_timing_diff);
-
-	gettimeofday(&qs_timing_start, NULL);
-#endif
-
 	return;
 
 }
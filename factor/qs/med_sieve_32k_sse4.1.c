@@ -18,6 +18,8 @@ code to the public domain.
        				   --bbuhrow@gmail.com 11/24/09
 ----------------------------------------------------------------------*/
 
+#define SIQS_KERNEL_SSE41
+#include "kernel_target.h"
 #include "yafu.h"
 #include "qs.h"
 #include "sieve_macros_32k.h"
@@ -55,10 +57,6 @@ void med_sieveblock_32k_sse41(uint8 *sieve, sieve_fb_compressed *fb, fb_list *fu
 
 	med_B = full_fb->med_B;
 	
-#ifdef QS_TIMING
-	gettimeofday(&qs_timing_start, NULL);
-#endif
-
 	//initialize the block
 	BLOCK_INIT;
 
@@ -206,16 +204,6 @@ void med_sieveblock_32k_sse41(uint8 *sieve, sieve_fb_compressed *fb, fb_list *fu
 	_SSE41_SMALL_PRIME_SIEVE;
 
 
-#ifdef QS_TIMING
-	gettimeofday (&qs_timing_stop, NULL);
-	qs_timing_diff = my_difftime (&qs_timing_start, &qs_timing_stop);
-
-	SIEVE_STG1 += ((double)qs_timing_diff->secs + (double)qs_timing_diff->usecs / 1000000);
-	free(qs_timing_diff);
-
-	gettimeofday(&qs_timing_start, NULL);
-#endif
-
 	return;
 
 }
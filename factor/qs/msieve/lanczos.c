@@ -36,7 +36,8 @@ static const uint64 qs_bitmask[64] = {
    the first QS_POST_LANCZOS_ROWS rows are handled in a separate
    Gauss elimination phase after the Lanczos iteration
    completes. This means the lanczos code will produce about
-   64 - QS_POST_LANCZOS_ROWS dependencies on average. 
+   QS_VBITS - QS_POST_LANCZOS_ROWS dependencies on average 
+   (of which at most 64 are returned). 
    
    The code will still work if QS_POST_LANCZOS_ROWS is 0, but I 
    don't know why you would want to do that. The first rows are 
@@ -191,63 +192,88 @@ static uint64 * yafu_form_post_lanczos_matrix(fact_obj_t *obj, uint32 *nrows,
 }
 
 /*-------------------------------------------------------------------*/
-static void yafu_mul_64x64_64x64(uint64 *a, uint64 *b, uint64 *c ) {
+static void yafu_mul_BxB_BxB(qs_v_t *a, qs_v_t *b, qs_v_t *c ) {
 
-	/* c[][] = x[][] * y[][], where all operands are 64 x 64
-	   (i.e. contain 64 words of 64 bits each). The result
-	   may overwrite a or b. */
+	/* c[][] = x[][] * y[][], where all operands are B x B
+	   (i.e. contain QS_VBITS vectors of QS_VBITS bits each). 
+	   The result may overwrite a or b. This is a
+	   small instance of the N x B product below */
 
-	uint64 ai, bj, accum;
-	uint64 tmp[64];
-	uint32 i, j;
+	qs_v_t tmp[QS_VBITS];
 
-	for (i = 0; i < 64; i++) {
-		j = 0;
-		accum = 0;
-		ai = a[i];
-
-		while (ai) {
-			bj = b[j];
-			if (ai & 1)
-				accum ^= bj;
-			ai >>= 1;
-			j++;
-		}
+	memset(tmp, 0, sizeof(tmp));
+	yafu_mul_NxB_BxB_acc(a, b, tmp, QS_VBITS);
+	memcpy(c, tmp, sizeof(tmp));
+}
+
+/*-----------------------------------------------------------------------*/
+static void yafu_transpose_64x64(uint64 *a) {
 
-		tmp[i] = accum;
+	/* transpose a 64 x 64 bit matrix in place, by
+	   swapping successively smaller off-diagonal blocks */
+
+	uint32 j, k;
+	uint64 m, t;
+
+	for (j = 32, m = 0x00000000ffffffffULL; j; j >>= 1, m ^= m << j) {
+		for (k = 0; k < 64; k = ((k | j) + 1) & ~j) {
+			t = ((a[k] >> j) ^ a[k | j]) & m;
+			a[k | j] ^= t;
+			a[k] ^= t << j;
+		}
 	}
-	memcpy(c, tmp, sizeof(tmp));
 }
 
 /*-----------------------------------------------------------------------*/
-static void yafu_transpose_64x64(uint64 *a, uint64 *b) {
+static void yafu_transpose_BxB(qs_v_t *a, qs_v_t *b) {
 
-	uint32 i, j;
-	uint64 tmp[64] = {0};
-
-	for (i = 0; i < 64; i++) {
-		uint64 word = a[i];
-		uint64 mask = qs_bitmask[i];
-		for (j = 0; j < 64; j++) {
-			if (word & qs_bitmask[j])
-				tmp[j] |= mask;
+	/* transpose one 64 x 64 block at a time */
+
+	uint32 i, j, k;
+	uint64 m[64];
+	qs_v_t tmp[QS_VBITS];
+
+	for (i = 0; i < QS_VWORDS; i++) {
+		for (j = 0; j < QS_VWORDS; j++) {
+			for (k = 0; k < 64; k++)
+				m[k] = a[64 * i + k].w[j];
+			yafu_transpose_64x64(m);
+			for (k = 0; k < 64; k++)
+				tmp[64 * j + k].w[i] = m[k];
 		}
 	}
 	memcpy(b, tmp, sizeof(tmp));
 }
 
 /*-------------------------------------------------------------------*/
-void yafu_mul_Nx64_64x64_acc(uint64 *v, uint64 *x,
-			uint64 *y, uint32 n) {
+static void yafu_mul_table_init(qs_v_t *x, qs_v_t *c) {
 
-	/* let v[][] be a n x 64 matrix with elements in GF(2), 
-	   represented as an array of n 64-bit words. Let c[][]
-	   be an 8 x 256 scratch matrix of 64-bit words.
-	   This code multiplies v[][] by the 64x64 matrix 
-	   x[][], then XORs the n x 64 result into y[][] */
+	/* for 0 <= j < 256, c[j] is the product of the 8-bit 
+	   row vector j with the 8 x B matrix x[][]. Each entry
+	   is one more vector away from an earlier one */
 
-	uint32 i, j, k;
-	uint64 c[8 * 256];
+	uint32 j, k;
+
+	c[0] = qs_v_zero();
+	for (j = 1; j < 256; j++) {
+		for (k = 0; !(j & ((uint32)1 << k)); k++)
+			;
+		c[j] = qs_v_xor(c[j ^ ((uint32)1 << k)], x[k]);
+	}
+}
+
+/*-------------------------------------------------------------------*/
+void yafu_mul_NxB_BxB_acc(qs_v_t *v, qs_v_t *x,
+			qs_v_t *y, uint32 n) {
+
+	/* let v[][] be a n x B matrix with elements in GF(2), 
+	   represented as an array of n vectors of QS_VBITS bits. 
+	   Let c[][] be a (B/8) x 256 scratch matrix of vectors.
+	   This code multiplies v[][] by the B x B matrix 
+	   x[][], then XORs the n x B result into y[][] */
+
+	uint32 i, j;
+	qs_v_t c[8 * QS_VWORDS * 256];
 
 	/* fill c[][] with a bunch of "partial matrix multiplies". 
 	   For 0<=i<256, the j_th row of c[][] contains the matrix 
@@ -256,27 +282,14 @@ void yafu_mul_Nx64_64x64_acc(uint64 *v, uint64 *x,
 	   	( i << (8*j) ) * x[][]
 
 	   where the quantity in parentheses is considered a 
-	   1 x 64 vector of elements in GF(2). The resulting
+	   1 x B vector of elements in GF(2). The resulting
 	   table will dramatically speed up matrix multiplies
 	   by x[][]. */
 
-	for (i = 0; i < 8; i++) {
-		uint64 *xtmp = x + 8 * i;
-		uint64 *ctmp = c + 256 * i;
-
-		for (j = 0; j < 256; j++) {
-			uint64 accum = 0;
-			uint32 index = j;
-
-			for (k = 0; k < 8; k++) {
-				if (index & ((uint32)1 << k))
-					accum ^= xtmp[k];
-			}
-			ctmp[j] = accum;
-		}
-	}
+	for (i = 0; i < 8 * QS_VWORDS; i++)
+		yafu_mul_table_init(x + 8 * i, c + 256 * i);
 
-#if (defined(__GNUC__) || defined(__ICL)) && \
+#if QS_VBITS == 64 && (defined(__GNUC__) || defined(__ICL)) && \
 	defined(__i386__) && defined(HAS_MMX)
 	i = 0;
 	asm volatile(".p2align 4,,7                        \n\t"
@@ -312,7 +325,7 @@ void yafu_mul_Nx64_64x64_acc(uint64 *v, uint64 *x,
 			:"r"(v), "r"(c), "r"(y), "g"(n)
 			:"%eax", "%ecx", "%mm0", "%mm1", "memory");
 
-#elif defined(_MSC_VER) && !defined(_WIN64)
+#elif QS_VBITS == 64 && defined(_MSC_VER) && !defined(_WIN64)
 	i = 0;
 	__asm
 	{
@@ -353,32 +366,91 @@ void yafu_mul_Nx64_64x64_acc(uint64 *v, uint64 *x,
 	}
 #else
 	for (i = 0; i < n; i++) {
-		uint64 word = v[i];
-		y[i] ^=  c[ 0*256 + ((uint8)(word >>  0)) ]
-		       ^ c[ 1*256 + ((uint8)(word >>  8)) ]
-		       ^ c[ 2*256 + ((uint8)(word >> 16)) ]
-		       ^ c[ 3*256 + ((uint8)(word >> 24)) ]
-		       ^ c[ 4*256 + ((uint8)(word >> 32)) ]
-		       ^ c[ 5*256 + ((uint8)(word >> 40)) ]
-		       ^ c[ 6*256 + ((uint8)(word >> 48)) ]
-		       ^ c[ 7*256 + ((uint8)(word >> 56)) ];
+		qs_v_t accum = y[i];
+
+		for (j = 0; j < QS_VWORDS; j++) {
+			uint64 word = v[i].w[j];
+			qs_v_t *ctmp = c + 8 * 256 * j;
+
+			accum = qs_v_xor(accum, 
+				qs_v_xor(qs_v_xor(
+				  qs_v_xor(ctmp[ 0*256 + ((uint8)(word >>  0)) ],
+				           ctmp[ 1*256 + ((uint8)(word >>  8)) ]),
+				  qs_v_xor(ctmp[ 2*256 + ((uint8)(word >> 16)) ],
+				           ctmp[ 3*256 + ((uint8)(word >> 24)) ])),
+				qs_v_xor(
+				  qs_v_xor(ctmp[ 4*256 + ((uint8)(word >> 32)) ],
+				           ctmp[ 5*256 + ((uint8)(word >> 40)) ]),
+				  qs_v_xor(ctmp[ 6*256 + ((uint8)(word >> 48)) ],
+				           ctmp[ 7*256 + ((uint8)(word >> 56)) ]))));
+		}
+		y[i] = accum;
 	}
 #endif
 }
 
 /*-------------------------------------------------------------------*/
-void yafu_mul_64xN_Nx64(uint64 *x, uint64 *y,
-		   uint64 *xy, uint32 n) {
+void yafu_mul_Nx64_64xB_acc(uint64 *v, qs_v_t *x,
+			qs_v_t *y, uint32 n) {
 
-	/* Let x and y be n x 64 matrices. This routine computes
-	   the 64 x 64 matrix xy[][] given by transpose(x) * y */
+	/* as above, for a n x 64 matrix v[][] (i.e. one
+	   64-bit word per row) and a 64 x B matrix x[][] */
 
 	uint32 i;
-	uint64 c[8 * 256] = {0};
+	qs_v_t c[8 * 256];
+
+	for (i = 0; i < 8; i++)
+		yafu_mul_table_init(x + 8 * i, c + 256 * i);
 
-	memset(xy, 0, 64 * sizeof(uint64));
+	for (i = 0; i < n; i++) {
+		uint64 word = v[i];
+		y[i] = qs_v_xor(y[i], 
+			qs_v_xor(qs_v_xor(
+			  qs_v_xor(c[ 0*256 + ((uint8)(word >>  0)) ],
+			           c[ 1*256 + ((uint8)(word >>  8)) ]),
+			  qs_v_xor(c[ 2*256 + ((uint8)(word >> 16)) ],
+			           c[ 3*256 + ((uint8)(word >> 24)) ])),
+			qs_v_xor(
+			  qs_v_xor(c[ 4*256 + ((uint8)(word >> 32)) ],
+			           c[ 5*256 + ((uint8)(word >> 40)) ]),
+			  qs_v_xor(c[ 6*256 + ((uint8)(word >> 48)) ],
+			           c[ 7*256 + ((uint8)(word >> 56)) ]))));
+	}
+}
+
+/*-------------------------------------------------------------------*/
+static void yafu_mul_table_fold(qs_v_t *c, qs_v_t *xy) {
+
+	/* c[] holds, for each 8-bit value j, the sum of the
+	   rows of y[][] whose 8 bits of x[][] equal j. Bit k of 
+	   those 8 turns this into rows k of x'*y */
+
+	uint32 j, k;
 
-#if (defined(__GNUC__) || defined(__ICL)) && \
+	for (k = 0; k < 8; k++) {
+		qs_v_t a = qs_v_zero();
+
+		for (j = 0; j < 256; j++) {
+			if ((j >> k) & 1)
+				a = qs_v_xor(a, c[j]);
+		}
+		xy[k] = a;
+	}
+}
+
+/*-------------------------------------------------------------------*/
+void yafu_mul_BxN_NxB(qs_v_t *x, qs_v_t *y,
+		   qs_v_t *xy, uint32 n) {
+
+	/* Let x and y be n x B matrices. This routine computes
+	   the B x B matrix xy[][] given by transpose(x) * y */
+
+	uint32 i, j;
+	qs_v_t c[8 * QS_VWORDS * 256];
+
+	memset(c, 0, sizeof(c));
+
+#if QS_VBITS == 64 && (defined(__GNUC__) || defined(__ICL)) && \
 	defined(__i386__) && defined(HAS_MMX)
 	i = 0;
 	asm volatile(".p2align 4,,7                        \n\t"
@@ -427,7 +499,7 @@ void yafu_mul_64xN_Nx64(uint64 *x, uint64 *y,
 			:"r"(x), "r"(c), "r"(y), "g"(n)
 			:"%eax", "%ecx", "%mm0", "%mm1", "memory");
 
-#elif defined(_MSC_VER) && !defined(_WIN64)
+#elif QS_VBITS == 64 && defined(_MSC_VER) && !defined(_WIN64)
 	i = 0;
 	__asm
 	{
@@ -482,54 +554,64 @@ void yafu_mul_64xN_Nx64(uint64 *x, uint64 *y,
 #else
 
 	for (i = 0; i < n; i++) {
-		uint64 xi = x[i];
-		uint64 yi = y[i];
-		c[ 0*256 + ((uint8) xi       ) ] ^= yi;
-		c[ 1*256 + ((uint8)(xi >>  8)) ] ^= yi;
-		c[ 2*256 + ((uint8)(xi >> 16)) ] ^= yi;
-		c[ 3*256 + ((uint8)(xi >> 24)) ] ^= yi;
-		c[ 4*256 + ((uint8)(xi >> 32)) ] ^= yi;
-		c[ 5*256 + ((uint8)(xi >> 40)) ] ^= yi;
-		c[ 6*256 + ((uint8)(xi >> 48)) ] ^= yi;
-		c[ 7*256 + ((uint8)(xi >> 56)) ] ^= yi;
+		qs_v_t yi = y[i];
+
+		for (j = 0; j < QS_VWORDS; j++) {
+			uint64 xi = x[i].w[j];
+			qs_v_t *ctmp = c + 8 * 256 * j;
+
+			#define _txor(k) ctmp[k*256 + (uint8)(xi >> (8*k))] = \
+				qs_v_xor(ctmp[k*256 + (uint8)(xi >> (8*k))], yi)
+
+			_txor(0); _txor(1); _txor(2); _txor(3);
+			_txor(4); _txor(5); _txor(6); _txor(7);
+
+			#undef _txor
+		}
 	}
 #endif
 
-	for(i = 0; i < 8; i++) {
+	for (i = 0; i < 8 * QS_VWORDS; i++)
+		yafu_mul_table_fold(c + 256 * i, xy + 8 * i);
+}
 
-		uint32 j;
-		uint64 a0, a1, a2, a3, a4, a5, a6, a7;
+/*-------------------------------------------------------------------*/
+void yafu_mul_64xN_NxB(uint64 *x, qs_v_t *y,
+		   qs_v_t *xy, uint32 n) {
 
-		a0 = a1 = a2 = a3 = 0;
-		a4 = a5 = a6 = a7 = 0;
+	/* as above, for a n x 64 matrix x[][] (i.e. one
+	   64-bit word per row); xy[][] is 64 x B */
 
-		for (j = 0; j < 256; j++) {
-			if ((j >> i) & 1) {
-				a0 ^= c[0*256 + j];
-				a1 ^= c[1*256 + j];
-				a2 ^= c[2*256 + j];
-				a3 ^= c[3*256 + j];
-				a4 ^= c[4*256 + j];
-				a5 ^= c[5*256 + j];
-				a6 ^= c[6*256 + j];
-				a7 ^= c[7*256 + j];
-			}
-		}
+	uint32 i;
+	qs_v_t c[8 * 256];
+
+	memset(c, 0, sizeof(c));
+
+	for (i = 0; i < n; i++) {
+		uint64 xi = x[i];
+		qs_v_t yi = y[i];
+
+		#define _txor(k) c[k*256 + (uint8)(xi >> (8*k))] = \
+			qs_v_xor(c[k*256 + (uint8)(xi >> (8*k))], yi)
+
+		_txor(0); _txor(1); _txor(2); _txor(3);
+		_txor(4); _txor(5); _txor(6); _txor(7);
 
-		xy[ 0] = a0; xy[ 8] = a1; xy[16] = a2; xy[24] = a3;
-		xy[32] = a4; xy[40] = a5; xy[48] = a6; xy[56] = a7;
-		xy++;
+		#undef _txor
 	}
+
+	for (i = 0; i < 8; i++)
+		yafu_mul_table_fold(c + 256 * i, xy + 8 * i);
 }
 
 /*-------------------------------------------------------------------*/
 static uint32 yafu_find_nonsingular_sub(fact_obj_t *obj,
-				uint64 *t, uint32 *s, 
+				qs_v_t *t, uint32 *s, 
 				uint32 *last_s, uint32 last_dim, 
-				uint64 *w) {
+				qs_v_t *w) {
 
-	/* given a 64x64 matrix t[][] (i.e. sixty-four
-	   64-bit words) and a list of 'last_dim' column 
+	/* given a B x B matrix t[][] (i.e. QS_VBITS
+	   vectors) and a list of 'last_dim' column 
 	   indices enumerated in last_s[]: 
 	   
 	     - find a submatrix of t that is invertible 
@@ -538,44 +620,45 @@ static uint32 yafu_find_nonsingular_sub(fact_obj_t *obj,
 
 	uint32 i, j;
 	uint32 dim;
-	uint32 cols[64];
-	uint64 M[64][2];
-	uint64 mask, *row_i, *row_j;
-	uint64 m0, m1;
+	uint32 cols[QS_VBITS];
+	qs_v_t M[QS_VBITS][2];
+	qs_v_t mask, *row_i, *row_j;
+	qs_v_t m0, m1;
+	uint32 pivot;
 
-	/* M = [t | I] for I the 64x64 identity matrix */
+	/* M = [t | I] for I the B x B identity matrix */
 
-	for (i = 0; i < 64; i++) {
+	for (i = 0; i < QS_VBITS; i++) {
 		M[i][0] = t[i]; 
-		M[i][1] = qs_bitmask[i];
+		M[i][1] = qs_v_bit(i);
 	}
 
 	/* put the column indices from last_s[] into the
 	   back of cols[], and copy to the beginning of cols[]
 	   any column indices not in last_s[] */
 
-	mask = 0;
+	mask = qs_v_zero();
 	for (i = 0; i < last_dim; i++) {
-		cols[63 - i] = last_s[i];
-		mask |= qs_bitmask[last_s[i]];
+		cols[QS_VBITS - 1 - i] = last_s[i];
+		mask = qs_v_or(mask, qs_v_bit(last_s[i]));
 	}
-	for (i = j = 0; i < 64; i++) {
-		if (!(mask & qs_bitmask[i]))
+	for (i = j = 0; i < QS_VBITS; i++) {
+		if (!qs_v_test(mask, i))
 			cols[j++] = i;
 	}
 
 	/* compute the inverse of t[][] */
 
-	for (i = dim = 0; i < 64; i++) {
+	for (i = dim = 0; i < QS_VBITS; i++) {
 	
 		/* find the next pivot row and put in row i */
 
-		mask = qs_bitmask[cols[i]];
+		pivot = cols[i];
 		row_i = M[cols[i]];
 
-		for (j = i; j < 64; j++) {
+		for (j = i; j < QS_VBITS; j++) {
 			row_j = M[cols[j]];
-			if (row_j[0] & mask) {
+			if (qs_v_test(row_j[0], pivot)) {
 				m0 = row_j[0];
 				m1 = row_j[1];
 				row_j[0] = row_i[0];
@@ -589,12 +672,13 @@ static uint32 yafu_find_nonsingular_sub(fact_obj_t *obj,
 		/* if a pivot row was found, eliminate the pivot
 		   column from all other rows */
 
-		if (j < 64) {
-			for (j = 0; j < 64; j++) {
+		if (j < QS_VBITS) {
+			for (j = 0; j < QS_VBITS; j++) {
 				row_j = M[cols[j]];
-				if ((row_i != row_j) && (row_j[0] & mask)) {
-					row_j[0] ^= row_i[0];
-					row_j[1] ^= row_i[1];
+				if ((row_i != row_j) && 
+				    qs_v_test(row_j[0], pivot)) {
+					row_j[0] = qs_v_xor(row_j[0], row_i[0]);
+					row_j[1] = qs_v_xor(row_j[1], row_i[1]);
 				}
 			}
 
@@ -608,9 +692,9 @@ static uint32 yafu_find_nonsingular_sub(fact_obj_t *obj,
 		/* otherwise, use the right-hand half of M[]
 		   to compensate for the absence of a pivot column */
 
-		for (j = i; j < 64; j++) {
+		for (j = i; j < QS_VBITS; j++) {
 			row_j = M[cols[j]];
-			if (row_j[1] & mask) {
+			if (qs_v_test(row_j[1], pivot)) {
 				m0 = row_j[0];
 				m1 = row_j[1];
 				row_j[0] = row_i[0];
@@ -621,7 +705,7 @@ static uint32 yafu_find_nonsingular_sub(fact_obj_t *obj,
 			}
 		}
 				
-		if (j == 64) {
+		if (j == QS_VBITS) {
 			printf("lanczos error: submatrix "
 					"is not invertible\n");
 			logprint(obj->logfile, "lanczos error: submatrix "
@@ -632,56 +716,59 @@ static uint32 yafu_find_nonsingular_sub(fact_obj_t *obj,
 		/* eliminate the pivot column from the other rows
 		   of the inverse */
 
-		for (j = 0; j < 64; j++) {
+		for (j = 0; j < QS_VBITS; j++) {
 			row_j = M[cols[j]];
-			if ((row_i != row_j) && (row_j[1] & mask)) {
-				row_j[0] ^= row_i[0];
-				row_j[1] ^= row_i[1];
+			if ((row_i != row_j) && 
+			    qs_v_test(row_j[1], pivot)) {
+				row_j[0] = qs_v_xor(row_j[0], row_i[0]);
+				row_j[1] = qs_v_xor(row_j[1], row_i[1]);
 			}
 		}
 
 		/* wipe out the pivot row */
 
-		row_i[0] = row_i[1] = 0;
+		row_i[0] = row_i[1] = qs_v_zero();
 	}
 
 	/* the right-hand half of M[] is the desired inverse */
 	
-	for (i = 0; i < 64; i++) 
+	for (i = 0; i < QS_VBITS; i++) 
 		w[i] = M[i][1];
 
 	return dim;
 }
 
 /*-----------------------------------------------------------------------*/
-static void yafu_transpose_vector(uint32 ncols, uint64 *v, uint64 **trans) {
+static void yafu_transpose_vector(uint32 ncols, qs_v_t *v, uint64 **trans) {
 
 	/* Hideously inefficent routine to transpose a
-	   vector v[] of 64-bit words into a 2-D array
+	   vector v[] of B-bit vectors into a 2-D array
 	   trans[][] of 64-bit words */
 
-	uint32 i, j;
+	uint32 i, j, k;
 	uint32 col;
 	uint64 mask, word;
 
 	for (i = 0; i < ncols; i++) {
 		col = i / 64;
 		mask = qs_bitmask[i % 64];
-		word = v[i];
-		j = 0;
-		while (word) {
-			if (word & 1)
-				trans[j][col] |= mask;
-			word = word >> 1;
-			j++;
+		for (k = 0; k < QS_VWORDS; k++) {
+			word = v[i].w[k];
+			j = 64 * k;
+			while (word) {
+				if (word & 1)
+					trans[j][col] |= mask;
+				word = word >> 1;
+				j++;
+			}
 		}
 	}
 }
 
 /*-----------------------------------------------------------------------*/
 static uint32 yafu_combine_cols(uint32 ncols, 
-			uint64 *x, uint64 *v, 
-			uint64 *ax, uint64 *av) {
+			qs_v_t *x, qs_v_t *v, 
+			qs_v_t *ax, qs_v_t *av) {
 
 	/* Once the block Lanczos iteration has finished, 
 	   x[] and v[] will contain mostly nullspace vectors
@@ -699,11 +786,11 @@ static uint32 yafu_combine_cols(uint32 ncols,
 
 	uint32 i, j, k, bitpos, col, col_words;
 	uint64 mask;
-	uint64 *matrix[128], *amatrix[128], *tmp;
+	uint64 *matrix[2 * QS_VBITS], *amatrix[2 * QS_VBITS], *tmp;
 
 	col_words = (ncols + 63) / 64;
 
-	for (i = 0; i < 128; i++) {
+	for (i = 0; i < 2 * QS_VBITS; i++) {
 		matrix[i] = (uint64 *)xcalloc((size_t)col_words, 
 					     sizeof(uint64));
 		amatrix[i] = (uint64 *)xcalloc((size_t)col_words, 
@@ -716,21 +803,21 @@ static uint32 yafu_combine_cols(uint32 ncols,
 
 	yafu_transpose_vector(ncols, x, matrix);
 	yafu_transpose_vector(ncols, ax, amatrix);
-	yafu_transpose_vector(ncols, v, matrix + 64);
-	yafu_transpose_vector(ncols, av, amatrix + 64);
+	yafu_transpose_vector(ncols, v, matrix + QS_VBITS);
+	yafu_transpose_vector(ncols, av, amatrix + QS_VBITS);
 
 	/* Keep eliminating rows until the unprocessed part
 	   of amatrix[][] is all zero. The rows where this
 	   happens correspond to linearly dependent vectors
 	   in the nullspace */
 
-	for (i = bitpos = 0; i < 128 && bitpos < ncols; bitpos++) {
+	for (i = bitpos = 0; i < 2 * QS_VBITS && bitpos < ncols; bitpos++) {
 
 		/* find the next pivot row */
 
 		mask = qs_bitmask[bitpos % 64];
 		col = bitpos / 64;
-		for (j = i; j < 128; j++) {
+		for (j = i; j < 2 * QS_VBITS; j++) {
 			if (amatrix[j][col] & mask) {
 				tmp = matrix[i];
 				matrix[i] = matrix[j];
@@ -741,13 +828,13 @@ static uint32 yafu_combine_cols(uint32 ncols,
 				break;
 			}
 		}
-		if (j == 128)
+		if (j == 2 * QS_VBITS)
 			continue;
 
 		/* a pivot was found; eliminate it from the
 		   remaining rows */
 
-		for (j++; j < 128; j++) {
+		for (j++; j < 2 * QS_VBITS; j++) {
 			if (amatrix[j][col] & mask) {
 
 				/* Note that the entire row, *not*
@@ -765,41 +852,42 @@ static uint32 yafu_combine_cols(uint32 ncols,
 		i++;
 	}
 
-	/* transpose rows i to 64 back into x[]. Pack the
+	/* transpose rows i to B back into x[]. Pack the
 	   dependencies into the low-order bits of x[] */
 
 	for (j = 0; j < ncols; j++) {
-		uint64 word = 0;
+		qs_v_t word = qs_v_zero();
 
 		col = j / 64;
 		mask = qs_bitmask[j % 64];
 
-		for (k = i; k < 64; k++) {
+		for (k = i; k < QS_VBITS; k++) {
 			if (matrix[k][col] & mask)
-				word |= qs_bitmask[k - i];
+				word.w[(k - i) / 64] |= qs_bitmask[(k - i) % 64];
 		}
 		x[j] = word;
 	}
 
-	for (j = 0; j < 128; j++) {
+	for (j = 0; j < 2 * QS_VBITS; j++) {
 		free(matrix[j]);
 		free(amatrix[j]);
 	}
 
-	if (i > 64)
+	if (i > QS_VBITS)
 		return 0;
-	return 64 - i;
+	return QS_VBITS - i;
 }
 
 /*-----------------------------------------------------------------------*/
 static void yafu_dump_lanczos_state(fact_obj_t *obj, 
-			uint64 *x, uint64 **vt_v0, uint64 **v, 
-			uint64 **vt_a_v, uint64 **vt_a2_v, uint64 **winv,
+			qs_v_t *x, qs_v_t **vt_v0, qs_v_t **v, 
+			qs_v_t **vt_a_v, qs_v_t **vt_a2_v, qs_v_t **winv,
 			uint32 n, uint32 dim_solved, uint32 iter,
-			uint32 s[2][64], uint32 dim1) {
+			uint32 s[2][QS_VBITS], uint32 dim1) {
 
 	char buf[256];
 	FILE *dump_fp;
+	uint32 vbits = QS_VBITS;
 
 	
 	sprintf(buf, "%s.chk", obj->savefile_name);
@@ -810,34 +898,35 @@ static void yafu_dump_lanczos_state(fact_obj_t *obj,
 	}
 
 	fwrite(&n, sizeof(uint32), (size_t)1, dump_fp);
+	fwrite(&vbits, sizeof(uint32), (size_t)1, dump_fp);
 	fwrite(&dim_solved, sizeof(uint32), (size_t)1, dump_fp);
 	fwrite(&iter, sizeof(uint32), (size_t)1, dump_fp);
 
-	fwrite(vt_a_v[1], sizeof(uint64), (size_t)64, dump_fp);
-	fwrite(vt_a2_v[1], sizeof(uint64), (size_t)64, dump_fp);
-	fwrite(winv[1], sizeof(uint64), (size_t)64, dump_fp);
-	fwrite(winv[2], sizeof(uint64), (size_t)64, dump_fp);
-	fwrite(vt_v0[0], sizeof(uint64), (size_t)64, dump_fp);
-	fwrite(vt_v0[1], sizeof(uint64), (size_t)64, dump_fp);
-	fwrite(vt_v0[2], sizeof(uint64), (size_t)64, dump_fp);
-	fwrite(s[1], sizeof(uint32), (size_t)64, dump_fp);
+	fwrite(vt_a_v[1], sizeof(qs_v_t), (size_t)QS_VBITS, dump_fp);
+	fwrite(vt_a2_v[1], sizeof(qs_v_t), (size_t)QS_VBITS, dump_fp);
+	fwrite(winv[1], sizeof(qs_v_t), (size_t)QS_VBITS, dump_fp);
+	fwrite(winv[2], sizeof(qs_v_t), (size_t)QS_VBITS, dump_fp);
+	fwrite(vt_v0[0], sizeof(qs_v_t), (size_t)QS_VBITS, dump_fp);
+	fwrite(vt_v0[1], sizeof(qs_v_t), (size_t)QS_VBITS, dump_fp);
+	fwrite(vt_v0[2], sizeof(qs_v_t), (size_t)QS_VBITS, dump_fp);
+	fwrite(s[1], sizeof(uint32), (size_t)QS_VBITS, dump_fp);
 	fwrite(&dim1, sizeof(uint32), (size_t)1, dump_fp);
 
-	fwrite(x, sizeof(uint64), (size_t)n, dump_fp);
-	fwrite(v[0], sizeof(uint64), (size_t)n, dump_fp);
-	fwrite(v[1], sizeof(uint64), (size_t)n, dump_fp);
-	fwrite(v[2], sizeof(uint64), (size_t)n, dump_fp);
+	fwrite(x, sizeof(qs_v_t), (size_t)n, dump_fp);
+	fwrite(v[0], sizeof(qs_v_t), (size_t)n, dump_fp);
+	fwrite(v[1], sizeof(qs_v_t), (size_t)n, dump_fp);
+	fwrite(v[2], sizeof(qs_v_t), (size_t)n, dump_fp);
 	fclose(dump_fp);
 }
 
 /*-----------------------------------------------------------------------*/
 static void yafu_read_lanczos_state(fact_obj_t *obj, 
-			uint64 *x, uint64 **vt_v0, uint64 **v, 
-			uint64 **vt_a_v, uint64 **vt_a2_v, uint64 **winv,
+			qs_v_t *x, qs_v_t **vt_v0, qs_v_t **v, 
+			qs_v_t **vt_a_v, qs_v_t **vt_a2_v, qs_v_t **winv,
 			uint32 n, uint32 *dim_solved, uint32 *iter,
-			uint32 s[2][64], uint32 *dim1) {
+			uint32 s[2][QS_VBITS], uint32 *dim1) {
 
-	uint32 read_n;
+	uint32 read_n, read_vbits;
 	uint32 status;
 	char buf[256];
 	FILE *dump_fp;
@@ -856,23 +945,37 @@ static void yafu_read_lanczos_state(fact_obj_t *obj,
 		printf("error: unexpected vector size\n");
 		exit(-1);
 	}
+	fread(&read_vbits, sizeof(uint32), (size_t)1, dump_fp);
+	if (read_vbits != QS_VBITS) {
+		printf("error: checkpoint uses %u-bit vectors, "
+			"this build uses %u\n", read_vbits, QS_VBITS);
+		exit(-1);
+	}
 	status &= (fread(dim_solved, sizeof(uint32), (size_t)1, dump_fp) == 1);
 	status &= (fread(iter, sizeof(uint32), (size_t)1, dump_fp) == 1);
 
-	status &= (fread(vt_a_v[1], sizeof(uint64), (size_t)64, dump_fp) == 64);
-	status &= (fread(vt_a2_v[1], sizeof(uint64), (size_t)64, dump_fp)==64);
-	status &= (fread(winv[1], sizeof(uint64), (size_t)64, dump_fp) == 64);
-	status &= (fread(winv[2], sizeof(uint64), (size_t)64, dump_fp) == 64);
-	status &= (fread(vt_v0[0], sizeof(uint64), (size_t)64, dump_fp) == 64);
-	status &= (fread(vt_v0[1], sizeof(uint64), (size_t)64, dump_fp) == 64);
-	status &= (fread(vt_v0[2], sizeof(uint64), (size_t)64, dump_fp) == 64);
-	status &= (fread(s[1], sizeof(uint32), (size_t)64, dump_fp) == 64);
+	status &= (fread(vt_a_v[1], sizeof(qs_v_t), (size_t)QS_VBITS, 
+					dump_fp) == QS_VBITS);
+	status &= (fread(vt_a2_v[1], sizeof(qs_v_t), (size_t)QS_VBITS, 
+					dump_fp) == QS_VBITS);
+	status &= (fread(winv[1], sizeof(qs_v_t), (size_t)QS_VBITS, 
+					dump_fp) == QS_VBITS);
+	status &= (fread(winv[2], sizeof(qs_v_t), (size_t)QS_VBITS, 
+					dump_fp) == QS_VBITS);
+	status &= (fread(vt_v0[0], sizeof(qs_v_t), (size_t)QS_VBITS, 
+					dump_fp) == QS_VBITS);
+	status &= (fread(vt_v0[1], sizeof(qs_v_t), (size_t)QS_VBITS, 
+					dump_fp) == QS_VBITS);
+	status &= (fread(vt_v0[2], sizeof(qs_v_t), (size_t)QS_VBITS, 
+					dump_fp) == QS_VBITS);
+	status &= (fread(s[1], sizeof(uint32), (size_t)QS_VBITS, 
+					dump_fp) == QS_VBITS);
 	status &= (fread(dim1, sizeof(uint32), (size_t)1, dump_fp) == 1);
 
-	status &= (fread(x, sizeof(uint64), (size_t)n, dump_fp) == n);
-	status &= (fread(v[0], sizeof(uint64), (size_t)n, dump_fp) == n);
-	status &= (fread(v[1], sizeof(uint64), (size_t)n, dump_fp) == n);
-	status &= (fread(v[2], sizeof(uint64), (size_t)n, dump_fp) == n);
+	status &= (fread(x, sizeof(qs_v_t), (size_t)n, dump_fp) == n);
+	status &= (fread(v[0], sizeof(qs_v_t), (size_t)n, dump_fp) == n);
+	status &= (fread(v[1], sizeof(qs_v_t), (size_t)n, dump_fp) == n);
+	status &= (fread(v[2], sizeof(qs_v_t), (size_t)n, dump_fp) == n);
 
 	fclose(dump_fp);
 	if (status == 0) {
@@ -884,44 +987,47 @@ static void yafu_read_lanczos_state(fact_obj_t *obj,
 /*-----------------------------------------------------------------------*/
 static void yafu_init_lanczos_state(fact_obj_t *obj, 
 			qs_packed_matrix_t *packed_matrix,
-			uint64 *x, uint64 *v0, uint64 **vt_v0, uint64 **v, 
-			uint64 **vt_a_v, uint64 **vt_a2_v, uint64 **winv,
-			uint32 n, uint32 s[2][64], uint32 *dim1) {
+			qs_v_t *x, qs_v_t *v0, qs_v_t **vt_v0, qs_v_t **v, 
+			qs_v_t **vt_a_v, qs_v_t **vt_a2_v, qs_v_t **winv,
+			uint32 n, uint32 s[2][QS_VBITS], uint32 *dim1) {
 
-	uint32 i;
+	uint32 i, j;
 
 	/* The computed solution 'x' starts off random,
 	   and v[0] starts off as B*x. This initial copy
 	   of v[0] must be saved off separately */
 	
 	for (i = 0; i < n; i++) {
-		x[i] = v[0][i] = 
+		for (j = 0; j < QS_VWORDS; j++) {
+			x[i].w[j] = 
 			  (uint64)(get_rand(&obj->seed1, &obj->seed2)) << 32 |
-		          (uint64)(get_rand(&obj->seed1, &obj->seed2));
+			  (uint64)(get_rand(&obj->seed1, &obj->seed2));
+		}
+		v[0][i] = x[i];
 	}
 
-	yafu_mul_MxN_Nx64(packed_matrix, v[0], v[1]);
-	yafu_mul_trans_MxN_Nx64(packed_matrix, v[1], v[0]);
-	memcpy(v0, v[0], n * sizeof(uint64));
+	yafu_mul_MxN_NxB(packed_matrix, v[0], v[1]);
+	yafu_mul_trans_MxN_NxB(packed_matrix, v[1], v[0]);
+	memcpy(v0, v[0], n * sizeof(qs_v_t));
 
 	/* Subscripts larger than zero represent past versions of 
 	   these quantities, which start off empty (except for the 
 	   past version of s[], which contains all the column 
 	   indices) */
 	   
-	memset(v[1], 0, n * sizeof(uint64));
-	memset(v[2], 0, n * sizeof(uint64));
-	for (i = 0; i < 64; i++) {
+	memset(v[1], 0, n * sizeof(qs_v_t));
+	memset(v[2], 0, n * sizeof(qs_v_t));
+	for (i = 0; i < QS_VBITS; i++) {
 		s[1][i] = i;
-		vt_a_v[1][i] = 0;
-		vt_a2_v[1][i] = 0;
-		winv[1][i] = 0;
-		winv[2][i] = 0;
-		vt_v0[0][i] = 0;
-		vt_v0[1][i] = 0;
-		vt_v0[2][i] = 0;
+		vt_a_v[1][i] = qs_v_zero();
+		vt_a2_v[1][i] = qs_v_zero();
+		winv[1][i] = qs_v_zero();
+		winv[2][i] = qs_v_zero();
+		vt_v0[0][i] = qs_v_zero();
+		vt_v0[1][i] = qs_v_zero();
+		vt_v0[2][i] = qs_v_zero();
 	}
-	*dim1 = 64;
+	*dim1 = QS_VBITS;
 }
 
 /*-----------------------------------------------------------------------*/
@@ -936,16 +1042,17 @@ static uint64 * yafu_block_lanczos_core(fact_obj_t *obj,
 	   vectors, is returned */
 
 	uint32 n = packed_matrix->ncols;
-	uint64 *vnext, *v[3], *x, *v0;
-	uint64 *winv[3], *vt_v0_next;
-	uint64 *vt_a_v[2], *vt_a2_v[2], *vt_v0[3];
-	uint64 *scratch;
-	uint64 *tmp;
-	uint32 s[2][64];
-	uint64 d[64], e[64], f[64], f2[64];
+	qs_v_t *vnext, *v[3], *x, *v0;
+	qs_v_t *winv[3], *vt_v0_next;
+	qs_v_t *vt_a_v[2], *vt_a2_v[2], *vt_v0[3];
+	qs_v_t *scratch;
+	qs_v_t *tmp;
+	uint64 *deps;
+	uint32 s[2][QS_VBITS];
+	qs_v_t d[QS_VBITS], e[QS_VBITS], f[QS_VBITS], f2[QS_VBITS];
 	uint32 i, iter;
 	uint32 dim0, dim1;
-	uint64 mask0, mask1;
+	qs_v_t mask0, mask1;
 
 	uint32 dim_solved = 0;
 	uint32 first_dim_solved = 0;
@@ -957,52 +1064,56 @@ static uint64 * yafu_block_lanczos_core(fact_obj_t *obj,
 	if (packed_matrix->num_threads > 1)
 	{	
 		if (VFLAG > 0)
-			printf("commencing Lanczos iteration (%u threads)\n",
-					packed_matrix->num_threads);
+			printf("commencing Lanczos iteration (%u threads, "
+					"%u-bit vectors)\n",
+					packed_matrix->num_threads, QS_VBITS);
 		if (obj->logfile != NULL)
-			logprint(obj->logfile, "commencing Lanczos iteration (%u threads)\n",
-					packed_matrix->num_threads);
+			logprint(obj->logfile, "commencing Lanczos iteration "
+					"(%u threads, %u-bit vectors)\n",
+					packed_matrix->num_threads, QS_VBITS);
 	}
 	else
 	{
 		if (VFLAG > 0)
-			printf("commencing Lanczos iteration\n");
+			printf("commencing Lanczos iteration (%u-bit vectors)\n",
+					QS_VBITS);
 		if (obj->logfile != NULL)
-			logprint(obj->logfile, "commencing Lanczos iteration\n");
+			logprint(obj->logfile, "commencing Lanczos iteration "
+					"(%u-bit vectors)\n", QS_VBITS);
 	}
 
-	/* allocate all the 64x64 variables */
+	/* allocate all the B x B variables */
 
-	winv[0] = (uint64 *)xmalloc(64 * sizeof(uint64));
-	winv[1] = (uint64 *)xmalloc(64 * sizeof(uint64));
-	winv[2] = (uint64 *)xmalloc(64 * sizeof(uint64));
-	vt_a_v[0] = (uint64 *)xmalloc(64 * sizeof(uint64));
-	vt_a_v[1] = (uint64 *)xmalloc(64 * sizeof(uint64));
-	vt_a2_v[0] = (uint64 *)xmalloc(64 * sizeof(uint64));
-	vt_a2_v[1] = (uint64 *)xmalloc(64 * sizeof(uint64));
-	vt_v0[0] = (uint64 *)xmalloc(64 * sizeof(uint64));
-	vt_v0[1] = (uint64 *)xmalloc(64 * sizeof(uint64));
-	vt_v0[2] = (uint64 *)xmalloc(64 * sizeof(uint64));
-	vt_v0_next = (uint64 *)xmalloc(64 * sizeof(uint64));
+	winv[0] = (qs_v_t *)xmalloc(QS_VBITS * sizeof(qs_v_t));
+	winv[1] = (qs_v_t *)xmalloc(QS_VBITS * sizeof(qs_v_t));
+	winv[2] = (qs_v_t *)xmalloc(QS_VBITS * sizeof(qs_v_t));
+	vt_a_v[0] = (qs_v_t *)xmalloc(QS_VBITS * sizeof(qs_v_t));
+	vt_a_v[1] = (qs_v_t *)xmalloc(QS_VBITS * sizeof(qs_v_t));
+	vt_a2_v[0] = (qs_v_t *)xmalloc(QS_VBITS * sizeof(qs_v_t));
+	vt_a2_v[1] = (qs_v_t *)xmalloc(QS_VBITS * sizeof(qs_v_t));
+	vt_v0[0] = (qs_v_t *)xmalloc(QS_VBITS * sizeof(qs_v_t));
+	vt_v0[1] = (qs_v_t *)xmalloc(QS_VBITS * sizeof(qs_v_t));
+	vt_v0[2] = (qs_v_t *)xmalloc(QS_VBITS * sizeof(qs_v_t));
+	vt_v0_next = (qs_v_t *)xmalloc(QS_VBITS * sizeof(qs_v_t));
 
 	/* allocate all of the size-n variables except v0,
 	   which will be freed if it's not needed */
 
-	v[0] = (uint64 *)xmalloc(n * sizeof(uint64));
-	v[1] = (uint64 *)xmalloc(n * sizeof(uint64));
-	v[2] = (uint64 *)xmalloc(n * sizeof(uint64));
-	vnext = (uint64 *)xmalloc(n * sizeof(uint64));
-	x = (uint64 *)xmalloc(n * sizeof(uint64));
-	scratch = (uint64 *)xmalloc(n * sizeof(uint64));
+	v[0] = (qs_v_t *)xmalloc(n * sizeof(qs_v_t));
+	v[1] = (qs_v_t *)xmalloc(n * sizeof(qs_v_t));
+	v[2] = (qs_v_t *)xmalloc(n * sizeof(qs_v_t));
+	vnext = (qs_v_t *)xmalloc(n * sizeof(qs_v_t));
+	x = (qs_v_t *)xmalloc(n * sizeof(qs_v_t));
+	scratch = (qs_v_t *)xmalloc(n * sizeof(qs_v_t));
 	v0 = NULL;
 
 	if (VFLAG > 0)
 		printf("memory use: %.1f MB\n", (double)
-			((6 * n * sizeof(uint64) +
+			((6 * n * sizeof(qs_v_t) +
 			 yafu_packed_matrix_sizeof(packed_matrix))) / 1048576);
 	if (obj->logfile != NULL)
 		logprint(obj->logfile, "memory use: %.1f MB\n", (double)
-			((6 * n * sizeof(uint64) +
+			((6 * n * sizeof(qs_v_t) +
 			 yafu_packed_matrix_sizeof(packed_matrix))) / 1048576);
 
 	/* initialize */
@@ -1022,14 +1133,14 @@ static uint64 * yafu_block_lanczos_core(fact_obj_t *obj,
 				iter, dim_solved);
 	}
 	else {
-		v0 = (uint64 *)xmalloc(n * sizeof(uint64));
+		v0 = (qs_v_t *)xmalloc(n * sizeof(qs_v_t));
 		yafu_init_lanczos_state(obj, packed_matrix, x, v0, vt_v0, v, 
 				vt_a_v, vt_a2_v, winv, n, s, &dim1);
 	}
 
-	mask1 = 0;
+	mask1 = qs_v_zero();
 	for (i = 0; i < dim1; i++)
-		mask1 |= qs_bitmask[s[1][i]];
+		mask1 = qs_v_or(mask1, qs_v_bit(s[1][i]));
 
 	/* determine if the solver will run long enough that
 	   it would be worthwhile to report progress */
@@ -1059,22 +1170,22 @@ static uint64 * yafu_block_lanczos_core(fact_obj_t *obj,
 		   version of B, or B'B (apostrophe means 
 		   transpose). Use "A" to refer to B'B  */
 
-		yafu_mul_MxN_Nx64(packed_matrix, v[0], scratch);
-		yafu_mul_trans_MxN_Nx64(packed_matrix, scratch, vnext);
+		yafu_mul_MxN_NxB(packed_matrix, v[0], scratch);
+		yafu_mul_trans_MxN_NxB(packed_matrix, scratch, vnext);
 
 		/* compute v0'*A*v0 and (A*v0)'(A*v0) */
 
-		yafu_mul_64xN_Nx64(v[0], vnext, vt_a_v[0], n);
-		yafu_mul_64xN_Nx64(vnext, vnext, vt_a2_v[0], n);
+		yafu_mul_BxN_NxB(v[0], vnext, vt_a_v[0], n);
+		yafu_mul_BxN_NxB(vnext, vnext, vt_a2_v[0], n);
 
 		/* if the former is orthogonal to itself, then
 		   the iteration has finished */
 
-		for (i = 0; i < 64; i++) {
-			if (vt_a_v[0][i] != 0)
+		for (i = 0; i < QS_VBITS; i++) {
+			if (!qs_v_is_zero(vt_a_v[0][i]))
 				break;
 		}
-		if (i == 64)
+		if (i == QS_VBITS)
 			break;
 
 		/* Find the size-'dim0' nonsingular submatrix
@@ -1090,9 +1201,9 @@ static uint64 * yafu_block_lanczos_core(fact_obj_t *obj,
 		   that participates in the inverted submatrix
 		   computed above */
 
-		mask0 = 0;
+		mask0 = qs_v_zero();
 		for (i = 0; i < dim0; i++)
-			mask0 |= qs_bitmask[s[0][i]];
+			mask0 = qs_v_or(mask0, qs_v_bit(s[0][i]));
 
 		/* The block Lanczos recurrence depends on all columns
 		   of v'Av appearing in the current and/or previous iteration. 
@@ -1108,8 +1219,8 @@ static uint64 * yafu_block_lanczos_core(fact_obj_t *obj,
 		   slightly less than the number of rows, not the number
 		   of columns (=n) */
 	
-		if (dim_solved < packed_matrix->nrows - 64) {
-			if ((mask0 | mask1) != (uint64)(-1)) {
+		if (dim_solved + QS_VBITS < packed_matrix->nrows) {
+			if (!qs_v_is_all_ones(qs_v_or(mask0, mask1))) {
 				printf("lanczos error (dim = %u): "
 						"not all columns used\n",
 						dim_solved);
@@ -1125,19 +1236,19 @@ static uint64 * yafu_block_lanczos_core(fact_obj_t *obj,
 		/* begin the computation of the next v. First mask
 		   off the vectors that are included in this iteration */
 
-		if (mask0 != (uint64)(-1)) {
+		if (!qs_v_is_all_ones(mask0)) {
 			for (i = 0; i < n; i++)
-				vnext[i] = vnext[i] & mask0;
+				vnext[i] = qs_v_and(vnext[i], mask0);
 		}
 
 		/* begin the computation of the next v' * v0. For 
 		   the first three iterations, this requires a full 
 		   inner product. For all succeeding iterations, the 
-		   next v' * v0 is the sum of three 64x64 products 
+		   next v' * v0 is the sum of three B x B products 
 		   and is stored in vt_v0_next. */
 
 		if (iter < 4) {
-			yafu_mul_64xN_Nx64(v[0], v0, vt_v0[0], n);
+			yafu_mul_BxN_NxB(v[0], v0, vt_v0[0], n);
 		}
 		else if (iter == 4) {
 			free(v0);
@@ -1146,63 +1257,65 @@ static uint64 * yafu_block_lanczos_core(fact_obj_t *obj,
 
 		/* compute d, fold it into vnext and update v'*v0 */
 
-		for (i = 0; i < 64; i++)
-			d[i] = (vt_a2_v[0][i] & mask0) ^ vt_a_v[0][i];
+		for (i = 0; i < QS_VBITS; i++)
+			d[i] = qs_v_xor(qs_v_and(vt_a2_v[0][i], mask0), 
+					vt_a_v[0][i]);
 
-		yafu_mul_64x64_64x64(winv[0], d, d);
+		yafu_mul_BxB_BxB(winv[0], d, d);
 
-		for (i = 0; i < 64; i++)
-			d[i] = d[i] ^ qs_bitmask[i];
+		for (i = 0; i < QS_VBITS; i++)
+			d[i] = qs_v_xor(d[i], qs_v_bit(i));
 
-		yafu_mul_Nx64_64x64_acc(v[0], d, vnext, n);
+		yafu_mul_NxB_BxB_acc(v[0], d, vnext, n);
 
-		yafu_transpose_64x64(d, d);
-		yafu_mul_64x64_64x64(d, vt_v0[0], vt_v0_next);
+		yafu_transpose_BxB(d, d);
+		yafu_mul_BxB_BxB(d, vt_v0[0], vt_v0_next);
 
 		/* compute e, fold it into vnext and update v'*v0 */
 
-		yafu_mul_64x64_64x64(winv[1], vt_a_v[0], e);
+		yafu_mul_BxB_BxB(winv[1], vt_a_v[0], e);
 
-		for (i = 0; i < 64; i++)
-			e[i] = e[i] & mask0;
+		for (i = 0; i < QS_VBITS; i++)
+			e[i] = qs_v_and(e[i], mask0);
 
-		yafu_mul_Nx64_64x64_acc(v[1], e, vnext, n);
+		yafu_mul_NxB_BxB_acc(v[1], e, vnext, n);
 
-		yafu_transpose_64x64(e, e);
-		yafu_mul_64x64_64x64(e, vt_v0[1], e);
-		for (i = 0; i < 64; i++)
-			vt_v0_next[i] = vt_v0_next[i] ^ e[i];
+		yafu_transpose_BxB(e, e);
+		yafu_mul_BxB_BxB(e, vt_v0[1], e);
+		for (i = 0; i < QS_VBITS; i++)
+			vt_v0_next[i] = qs_v_xor(vt_v0_next[i], e[i]);
 
 		/* compute f, fold it in. Montgomery shows that 
 		   this is unnecessary (f would be zero) if the 
 		   previous value of v had full rank */
 
-		if (mask1 != (uint64)(-1)) {
-			yafu_mul_64x64_64x64(vt_a_v[1], winv[1], f);
+		if (!qs_v_is_all_ones(mask1)) {
+			yafu_mul_BxB_BxB(vt_a_v[1], winv[1], f);
 
-			for (i = 0; i < 64; i++)
-				f[i] = f[i] ^ qs_bitmask[i];
+			for (i = 0; i < QS_VBITS; i++)
+				f[i] = qs_v_xor(f[i], qs_v_bit(i));
 
-			yafu_mul_64x64_64x64(winv[2], f, f);
+			yafu_mul_BxB_BxB(winv[2], f, f);
 
-			for (i = 0; i < 64; i++)
-				f2[i] = ((vt_a2_v[1][i] & mask1) ^ 
-					  vt_a_v[1][i]) & mask0;
+			for (i = 0; i < QS_VBITS; i++)
+				f2[i] = qs_v_and(qs_v_xor(
+					  qs_v_and(vt_a2_v[1][i], mask1),
+					  vt_a_v[1][i]), mask0);
 
-			yafu_mul_64x64_64x64(f, f2, f);
+			yafu_mul_BxB_BxB(f, f2, f);
 
-			yafu_mul_Nx64_64x64_acc(v[2], f, vnext, n);
+			yafu_mul_NxB_BxB_acc(v[2], f, vnext, n);
 
-			yafu_transpose_64x64(f, f);
-			yafu_mul_64x64_64x64(f, vt_v0[2], f);
-			for (i = 0; i < 64; i++)
-				vt_v0_next[i] = vt_v0_next[i] ^ f[i];
+			yafu_transpose_BxB(f, f);
+			yafu_mul_BxB_BxB(f, vt_v0[2], f);
+			for (i = 0; i < QS_VBITS; i++)
+				vt_v0_next[i] = qs_v_xor(vt_v0_next[i], f[i]);
 		}
 
 		/* update the computed solution 'x' */
 
-		yafu_mul_64x64_64x64(winv[0], vt_v0[0], d);
-		yafu_mul_Nx64_64x64_acc(v[0], d, x, n);
+		yafu_mul_BxB_BxB(winv[0], vt_v0[0], d);
+		yafu_mul_NxB_BxB_acc(v[0], d, x, n);
 
 		/* rotate all the variables */
 
@@ -1227,7 +1340,7 @@ static uint64 * yafu_block_lanczos_core(fact_obj_t *obj,
 		
 		tmp = vt_a2_v[1]; vt_a2_v[1] = vt_a2_v[0]; vt_a2_v[0] = tmp;
 
-		memcpy(s[1], s[0], 64 * sizeof(uint32));
+		memcpy(s[1], s[0], QS_VBITS * sizeof(uint32));
 		mask1 = mask0;
 		dim1 = dim0;
 
@@ -1319,29 +1432,29 @@ static uint64 * yafu_block_lanczos_core(fact_obj_t *obj,
 	   collection of nullspace vectors. Begin by multiplying
 	   the output from the iteration by B */
 
-	yafu_mul_MxN_Nx64(packed_matrix, x, v[1]);
-	yafu_mul_MxN_Nx64(packed_matrix, v[0], v[2]);
+	yafu_mul_MxN_NxB(packed_matrix, x, v[1]);
+	yafu_mul_MxN_NxB(packed_matrix, v[0], v[2]);
 
 	/* if necessary, add in the contribution of the
 	   first few rows that were originally in B. We 
-	   expect there to be about 64 - QS_POST_LANCZOS_ROWS 
+	   expect there to be about QS_VBITS - QS_POST_LANCZOS_ROWS 
 	   bit vectors that are in the nullspace of B and
 	   post_lanczos_matrix simultaneously */
 
 	if (post_lanczos_matrix) {
 		for (i = 0; i < QS_POST_LANCZOS_ROWS; i++) {
-			uint64 accum0 = 0;
-			uint64 accum1 = 0;
+			qs_v_t accum0 = qs_v_zero();
+			qs_v_t accum1 = qs_v_zero();
+			uint64 mask = qs_bitmask[i];
 			uint32 j;
-			mask0 = qs_bitmask[i];
 			for (j = 0; j < n; j++) {
-				if (post_lanczos_matrix[j] & mask0) {
-					accum0 ^= x[j];
-					accum1 ^= v[0][j];
+				if (post_lanczos_matrix[j] & mask) {
+					accum0 = qs_v_xor(accum0, x[j]);
+					accum1 = qs_v_xor(accum1, v[0][j]);
 				}
 			}
-			v[1][i] ^= accum0;
-			v[2][i] ^= accum1;
+			v[1][i] = qs_v_xor(v[1][i], accum0);
+			v[2][i] = qs_v_xor(v[2][i], accum1);
 		}
 	}
 
@@ -1349,10 +1462,10 @@ static uint64 * yafu_block_lanczos_core(fact_obj_t *obj,
 
 	/* verify that these really are linear dependencies of B */
 
-	yafu_mul_MxN_Nx64(packed_matrix, x, v[0]);
+	yafu_mul_MxN_NxB(packed_matrix, x, v[0]);
 
 	for (i = 0; i < n; i++) {
-		if (v[0][i] != 0)
+		if (!qs_v_is_zero(v[0][i]))
 			break;
 	}
 	if (i < n) {
@@ -1361,13 +1474,22 @@ static uint64 * yafu_block_lanczos_core(fact_obj_t *obj,
 			logprint(obj->logfile, "lanczos error: dependencies don't work\n");
 		exit(-1);
 	}
+
+	/* the dependencies are packed into the low bits of x;
+	   the square root only ever needs a few of them, so 
+	   hand back (up to) the first 64 as one word per column */
+
+	if (*num_deps_found > 64)
+		*num_deps_found = 64;
+
+	deps = (uint64 *)xmalloc(n * sizeof(uint64));
+	for (i = 0; i < n; i++)
+		deps[i] = x[i].w[0];
 	
+	free(x);
 	free(v[0]);
 	free(v[1]);
 	free(v[2]);
-	//x isn't freed in this code path... but freeing it causes
-	//segfaults sometimes, and I don't want to debug this...
-	//free(x);
 
 	if (*num_deps_found == 0)
 	{
@@ -1386,7 +1508,7 @@ static uint64 * yafu_block_lanczos_core(fact_obj_t *obj,
 			logprint(obj->logfile, "recovered %u nontrivial dependencies\n", 
 			*num_deps_found);
 	}
-	return x;
+	return deps;
 }
 
 /*-----------------------------------------------------------------------*/
@@ -21,22 +21,22 @@ Purpose:	Port into Yafu-1.14.
 
 /*-------------------------------------------------------------------*/
 static void yafu_mul_unpacked(qs_packed_matrix_t *matrix,
-			  uint64 *x, uint64 *b) {
+			  qs_v_t *x, qs_v_t *b) {
 
 	uint32 ncols = matrix->ncols;
 	uint32 num_dense_rows = matrix->num_dense_rows;
 	qs_la_col_t *A = matrix->unpacked_cols;
 	uint32 i, j;
 	
-	memset(b, 0, ncols * sizeof(uint64));
+	memset(b, 0, ncols * sizeof(qs_v_t));
 	
 	for (i = 0; i < ncols; i++) {
 		qs_la_col_t *col = A + i;
 		uint32 *row_entries = col->data;
-		uint64 tmp = x[i];
+		qs_v_t tmp = x[i];
 
 		for (j = 0; j < col->weight; j++) {
-			b[row_entries[j]] ^= tmp;
+			b[row_entries[j]] = qs_v_xor(b[row_entries[j]], tmp);
 		}
 	}
 
@@ -44,12 +44,12 @@ static void yafu_mul_unpacked(qs_packed_matrix_t *matrix,
 		for (i = 0; i < ncols; i++) {
 			qs_la_col_t *col = A + i;
 			uint32 *row_entries = col->data + col->weight;
-			uint64 tmp = x[i];
+			qs_v_t tmp = x[i];
 	
 			for (j = 0; j < num_dense_rows; j++) {
 				if (row_entries[j / 32] & 
 						((uint32)1 << (j % 32))) {
-					b[j] ^= tmp;
+					b[j] = qs_v_xor(b[j], tmp);
 				}
 			}
 		}
@@ -58,7 +58,7 @@ static void yafu_mul_unpacked(qs_packed_matrix_t *matrix,
 
 /*-------------------------------------------------------------------*/
 static void yafu_mul_trans_unpacked(qs_packed_matrix_t *matrix,
-				uint64 *x, uint64 *b) {
+				qs_v_t *x, qs_v_t *b) {
 
 	uint32 ncols = matrix->ncols;
 	uint32 num_dense_rows = matrix->num_dense_rows;
@@ -68,10 +68,10 @@ static void yafu_mul_trans_unpacked(qs_packed_matrix_t *matrix,
 	for (i = 0; i < ncols; i++) {
 		qs_la_col_t *col = A + i;
 		uint32 *row_entries = col->data;
-		uint64 accum = 0;
+		qs_v_t accum = qs_v_zero();
 
 		for (j = 0; j < col->weight; j++) {
-			accum ^= x[row_entries[j]];
+			accum = qs_v_xor(accum, x[row_entries[j]]);
 		}
 		b[i] = accum;
 	}
@@ -80,12 +80,12 @@ static void yafu_mul_trans_unpacked(qs_packed_matrix_t *matrix,
 		for (i = 0; i < ncols; i++) {
 			qs_la_col_t *col = A + i;
 			uint32 *row_entries = col->data + col->weight;
-			uint64 accum = b[i];
+			qs_v_t accum = b[i];
 	
 			for (j = 0; j < num_dense_rows; j++) {
 				if (row_entries[j / 32] &
 						((uint32)1 << (j % 32))) {
-					accum ^= x[j];
+					accum = qs_v_xor(accum, x[j]);
 				}
 			}
 			b[i] = accum;
@@ -94,7 +94,7 @@ static void yafu_mul_trans_unpacked(qs_packed_matrix_t *matrix,
 }
 
 /*-------------------------------------------------------------------*/
-static void yafu_mul_packed(qs_packed_matrix_t *matrix, uint64 *x, uint64 *b) {
+static void yafu_mul_packed(qs_packed_matrix_t *matrix, qs_v_t *x, qs_v_t *b) {
 
 	uint32 i;
 	uint32 ncols = matrix->ncols;
@@ -109,7 +109,7 @@ static void yafu_mul_packed(qs_packed_matrix_t *matrix, uint64 *x, uint64 *b) {
 		t->x = x;
 		if (i == 0)
 			t->b = b;
-		memset(t->b, 0, ncols * sizeof(uint64));
+		memset(t->b, 0, ncols * sizeof(qs_v_t));
 
 		/* fire off each part of the matrix multiply
 		   in a separate thread from the thread pool, 
@@ -149,11 +149,11 @@ static void yafu_mul_packed(qs_packed_matrix_t *matrix, uint64 *x, uint64 *b) {
 		}
 
 		if (i > 0) {
-			uint64 *curr_b = t->b;
+			qs_v_t *curr_b = t->b;
 			uint32 j;
 
 			for (j = 0; j < ncols; j++)
-				b[j] ^= curr_b[j];
+				b[j] = qs_v_xor(b[j], curr_b[j]);
 		}
 	}
 
@@ -167,13 +167,13 @@ static void yafu_mul_packed(qs_packed_matrix_t *matrix, uint64 *x, uint64 *b) {
 }
 
 /*-------------------------------------------------------------------*/
-void yafu_mul_trans_packed(qs_packed_matrix_t *matrix, uint64 *x, uint64 *b) {
+void yafu_mul_trans_packed(qs_packed_matrix_t *matrix, qs_v_t *x, qs_v_t *b) {
 
 	uint32 i;
 	uint32 ncols = matrix->ncols;
-	uint64 *tmp_b[QS_MAX_THREADS];
+	qs_v_t *tmp_b[QS_MAX_THREADS];
 
-	memset(b, 0, ncols * sizeof(uint64));
+	memset(b, 0, ncols * sizeof(qs_v_t));
 	
 	for (i = 0; i < matrix->num_threads; i++) {
 		qs_msieve_thread_data_t *t = matrix->thread_data + i;
@@ -266,7 +266,7 @@ static void yafu_matrix_thread_init(qs_msieve_thread_data_t *t) {
 	   scratch space, it's provided by calling code */
 
 	if (t->my_oid > 0)
-		t->b = (uint64 *)xmalloc(t->ncols_in * sizeof(uint64));
+		t->b = (qs_v_t *)xmalloc(t->ncols_in * sizeof(qs_v_t));
 
 	/* pack the dense rows 64 at a time */
 
@@ -596,7 +596,7 @@ void yafu_packed_matrix_init(fact_obj_t *obj,
 	   cores share the same cache, but multicore processors 
 	   typically have pretty big caches anyway */
 
-	block_size = obj->cache_size2 / (3 * sizeof(uint64));
+	block_size = obj->cache_size2 / (3 * sizeof(qs_v_t));
 	block_size = MIN(block_size, ncols / 2.5);
 	block_size = MIN(block_size, 65536);
 	if (block_size == 0)
@@ -706,7 +706,7 @@ size_t yafu_packed_matrix_sizeof(qs_packed_matrix_t *p) {
 		for (i = 0; i < p->num_threads; i++) {
 			qs_msieve_thread_data_t *t = p->thread_data + i;
 
-			mem_use += p->ncols * sizeof(uint64) +
+			mem_use += p->ncols * sizeof(qs_v_t) +
 				   t->num_blocks * sizeof(qs_packed_block_t) +
 				   t->ncols * sizeof(uint64) *
 					((t->num_dense_rows + 63) / 64);
@@ -729,7 +729,7 @@ size_t yafu_packed_matrix_sizeof(qs_packed_matrix_t *p) {
 }
 
 /*-------------------------------------------------------------------*/
-void yafu_mul_MxN_Nx64(qs_packed_matrix_t *A, uint64 *x, uint64 *b) {
+void yafu_mul_MxN_NxB(qs_packed_matrix_t *A, qs_v_t *x, qs_v_t *b) {
 
 	/* Multiply the vector x[] by the matrix A (stored
 	   columnwise) and put the result in b[]. */
@@ -741,7 +741,7 @@ void yafu_mul_MxN_Nx64(qs_packed_matrix_t *A, uint64 *x, uint64 *b) {
 }
 
 /*-------------------------------------------------------------------*/
-void yafu_mul_trans_MxN_Nx64(qs_packed_matrix_t *A, uint64 *x, uint64 *b) {
+void yafu_mul_trans_MxN_NxB(qs_packed_matrix_t *A, qs_v_t *x, qs_v_t *b) {
 
 	/* Multiply the vector x[] by the transpose of the
 	   matrix A and put the result in b[]. Since A is stored
@@ -19,12 +19,12 @@ benefit from your work.
 /*-------------------------------------------------------------------*/
 
 static void yafu_mul_one_med_block(qs_packed_block_t *curr_block,
-			uint64 *curr_col, uint64 *curr_b) {
+			qs_v_t *curr_col, qs_v_t *curr_b) {
 
 	uint16 *entries = curr_block->med_entries;
 	
 	while (1) {
-		uint64 accum;
+		qs_v_t accum;
 
 #if defined(GCC_ASM64X)
 		uint64 i = 0;
@@ -49,7 +49,10 @@ static void yafu_mul_one_med_block(qs_packed_block_t *curr_block,
 		   minimize the number of memory accesses and calculate
 		   pointers as early as possible */
 
-#if defined(GCC_ASM32A) && defined(HAS_MMX) && defined(NDEBUG)
+		/* the assembly versions only handle 64-bit vectors */
+
+#if QS_VBITS == 64 && defined(GCC_ASM32A) && \
+	defined(HAS_MMX) && defined(NDEBUG)
 
 	#define _txor(k)				\
 		"movzwl %%ax, %%edx		\n\t"	\
@@ -81,14 +84,14 @@ static void yafu_mul_one_med_block(qs_packed_block_t *curr_block,
 		"pxor %%mm0, %0			\n\t"
 		"1:				\n\t"
 
-		:"=y"(accum), "+r"(i)
+		:"=y"(accum.w[0]), "+r"(i)
 		:"r"(curr_col), "r"(entries),
 		 "g"(count & (uint32)(~15))
 		:"%eax", "%ecx", "%edx", "%mm0", "memory", "cc");
 
 	#undef _txor
 
-#elif defined(GCC_ASM64X)
+#elif QS_VBITS == 64 && defined(GCC_ASM64X)
 
     #define _txor(k)				\
 		"movzwq %%ax, %%rdx		\n\t"	\
@@ -120,14 +123,14 @@ static void yafu_mul_one_med_block(qs_packed_block_t *curr_block,
 		"xorq %%rsi, %0			\n\t"
 		"1:				\n\t"
 
-		:"=r"(accum), "+r"(i)
+		:"=r"(accum.w[0]), "+r"(i)
 		:"r"(curr_col), "r"(entries), 
 		 "g"(count & (uint64)(~15))
 		:"%rax", "%rcx", "%rdx", "%rsi", "memory", "cc");
 
 	#undef _txor
 
-#elif defined(MSC_ASM32A) && defined(HAS_MMX)
+#elif QS_VBITS == 64 && defined(MSC_ASM32A) && defined(HAS_MMX)
 
 	#define _txor(k)				\
 	    ASM_M movzx edx, ax				\
@@ -170,37 +173,30 @@ static void yafu_mul_one_med_block(qs_packed_block_t *curr_block,
 	#undef _txor
 
 #else
-	accum = 0;
+	#define _txor(k) qs_v_xor(curr_col[entries[i+2+(k)]], \
+				  curr_col[entries[i+2+(k)+1]])
+
+	accum = qs_v_zero();
 	for (i = 0; i < (count & (uint32)(~15)); i += 16) {
-		accum ^= curr_col[entries[i+2+0]] ^
-		         curr_col[entries[i+2+1]] ^
-		         curr_col[entries[i+2+2]] ^
-		         curr_col[entries[i+2+3]] ^
-		         curr_col[entries[i+2+4]] ^
-		         curr_col[entries[i+2+5]] ^
-		         curr_col[entries[i+2+6]] ^
-		         curr_col[entries[i+2+7]] ^
-		         curr_col[entries[i+2+8]] ^
-		         curr_col[entries[i+2+9]] ^
-		         curr_col[entries[i+2+10]] ^
-		         curr_col[entries[i+2+11]] ^
-		         curr_col[entries[i+2+12]] ^
-		         curr_col[entries[i+2+13]] ^
-		         curr_col[entries[i+2+14]] ^
-		         curr_col[entries[i+2+15]];
+		accum = qs_v_xor(accum, qs_v_xor(
+			 qs_v_xor(qs_v_xor(_txor( 0), _txor( 2)),
+			          qs_v_xor(_txor( 4), _txor( 6))),
+			 qs_v_xor(qs_v_xor(_txor( 8), _txor(10)),
+			          qs_v_xor(_txor(12), _txor(14)))));
 	}
 
+	#undef _txor
 #endif
 		for (; i < count; i++)
-			accum ^= curr_col[entries[i+2]];
-		curr_b[row] ^= accum;
+			accum = qs_v_xor(accum, curr_col[entries[i+2]]);
+		curr_b[row] = qs_v_xor(curr_b[row], accum);
 		entries += count + 2;
 	}
 }
 
 /*-------------------------------------------------------------------*/
 static void yafu_mul_one_block(qs_packed_block_t *curr_block,
-			uint64 *curr_col, uint64 *curr_b) {
+			qs_v_t *curr_col, qs_v_t *curr_b) {
 
 	uint32 i = 0; 
 	uint32 j = 0;
@@ -218,7 +214,7 @@ static void yafu_mul_one_block(qs_packed_block_t *curr_block,
 	   with a single 32-bit load and extra arithmetic to
 	   unpack the array indices */
 
-#if defined(GCC_ASM32A) && defined(HAS_MMX)
+#if QS_VBITS == 64 && defined(GCC_ASM32A) && defined(HAS_MMX)
 
 	#define _txor(x)				\
 		"movl 4*" #x "(%1,%0,4), %%eax  \n\t"	\
@@ -249,7 +245,7 @@ static void yafu_mul_one_block(qs_packed_block_t *curr_block,
 		 "g"(num_entries & (uint32)(~15))
 		:"%eax", "%ecx", "%mm0", "memory", "cc");
 
-#elif defined(MSC_ASM32A) && defined(HAS_MMX)
+#elif QS_VBITS == 64 && defined(MSC_ASM32A) && defined(HAS_MMX)
 
 	#define _txor(x)				\
 		ASM_M mov	eax, [4*x+edi+esi*4]	\
@@ -284,8 +280,9 @@ static void yafu_mul_one_block(qs_packed_block_t *curr_block,
 	}
 
 #else
-	#define _txor(x) curr_b[entries[i+x].row_off] ^= \
-				 curr_col[entries[i+x].col_off]
+	#define _txor(x) curr_b[entries[i+x].row_off] = \
+			qs_v_xor(curr_b[entries[i+x].row_off], \
+				 curr_col[entries[i+x].col_off])
 
 	for (i = 0; i < (num_entries & (uint32)(~15)); i += 16) {
 		#ifdef MANUAL_PREFETCH
@@ -303,15 +300,15 @@ static void yafu_mul_one_block(qs_packed_block_t *curr_block,
 	for (; i < num_entries; i++) {
 		j = entries[i].row_off;
 		k = entries[i].col_off;
-		curr_b[j] ^= curr_col[k];
+		curr_b[j] = qs_v_xor(curr_b[j], curr_col[k]);
 	}
 }
 
 /*-------------------------------------------------------------------*/
 void yafu_mul_packed_core(qs_msieve_thread_data_t *t) {
 
-	uint64 *x = t->x;
-	uint64 *b = t->b;
+	qs_v_t *x = t->x;
+	qs_v_t *b = t->b;
 	uint32 i;
 	
 	/* proceed block by block. We assume that blocks access
@@ -335,7 +332,7 @@ void yafu_mul_packed_core(qs_msieve_thread_data_t *t) {
 	/* multiply the densest few rows by x (in batches of 64 rows) */
 
 	for (i = 0; i < (t->num_dense_rows + 63) / 64; i++) {
-		yafu_mul_64xN_Nx64(t->dense_blocks[i], 
+		yafu_mul_64xN_NxB(t->dense_blocks[i], 
 				x + t->blocks[0].start_col, 
 				b + 64 * i, t->ncols);
 	}
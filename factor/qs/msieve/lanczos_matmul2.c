@@ -18,12 +18,12 @@ benefit from your work.
 
 /*-------------------------------------------------------------------*/
 static void yafu_mul_trans_one_med_block(qs_packed_block_t *curr_block,
-			uint64 *curr_row, uint64 *curr_b) {
+			qs_v_t *curr_row, qs_v_t *curr_b) {
 
 	uint16 *entries = curr_block->med_entries;
 	
 	while (1) {
-		uint64 t;
+		qs_v_t t;
 #if defined(GCC_ASM64X)
 		uint64 i = 0;
 		uint64 row = entries[0];
@@ -49,7 +49,10 @@ static void yafu_mul_trans_one_med_block(qs_packed_block_t *curr_block,
 		   minimize the number of memory accesses and calculate
 		   pointers as early as possible */
 
-#if defined(GCC_ASM32A) && defined(HAS_MMX) && defined(NDEBUG)
+		/* the assembly versions only handle 64-bit vectors */
+
+#if QS_VBITS == 64 && defined(GCC_ASM32A) && \
+	defined(HAS_MMX) && defined(NDEBUG)
 
 	#define _txor(k)				\
 		"movl 2*(2+2+(" #k "))(%2,%0,2), %%ecx	\n\t"	\
@@ -86,12 +89,12 @@ static void yafu_mul_trans_one_med_block(qs_packed_block_t *curr_block,
 		"1:				\n\t"
 		:"+r"(i)
 		:"r"(curr_b), "r"(entries),
-		 "g"(count & (uint32)(~15)), "y"(t)
+		 "g"(count & (uint32)(~15)), "y"(t.w[0])
 		:"%eax", "%ecx", "%edx", "%mm0", "%mm1", "memory", "cc");
 
 	#undef _txor
 
-#elif defined(GCC_ASM64X)
+#elif QS_VBITS == 64 && defined(GCC_ASM64X)
 
 	#define _txor(k)				\
 		"movzwq %%r8w, %%r9          	\n\t"	\
@@ -133,13 +136,13 @@ static void yafu_mul_trans_one_med_block(qs_packed_block_t *curr_block,
 		"1:				\n\t"
 		:"+r"(i)
 		:"r"(curr_b), "r"(entries),
-		 "g"(count & (uint64)(~15)), "r"(t)
+		 "g"(count & (uint64)(~15)), "r"(t.w[0])
 		:"%r8", "%r9", "%r10", "%r11", 
 		 "%r12", "%r13", "%r14", "%r15", "memory", "cc");
 
 	#undef _txor
 
-#elif defined(MSC_ASM32A) && defined(HAS_MMX)
+#elif QS_VBITS == 64 && defined(MSC_ASM32A) && defined(HAS_MMX)
 
 	#define _txor(k)				\
 		ASM_M mov ecx, [2*(2+2+k)+ebx+esi*2]	\
@@ -186,34 +189,27 @@ static void yafu_mul_trans_one_med_block(qs_packed_block_t *curr_block,
 	#undef _txor
 
 #else
+	#define _txor(k) curr_b[entries[i+2+(k)]] = \
+				qs_v_xor(curr_b[entries[i+2+(k)]], t)
+
 		for (i = 0; i < (count & (uint32)(~15)); i += 16) {
-			curr_b[entries[i+2+ 0]] ^= t;
-			curr_b[entries[i+2+ 1]] ^= t;
-			curr_b[entries[i+2+ 2]] ^= t;
-			curr_b[entries[i+2+ 3]] ^= t;
-			curr_b[entries[i+2+ 4]] ^= t;
-			curr_b[entries[i+2+ 5]] ^= t;
-			curr_b[entries[i+2+ 6]] ^= t;
-			curr_b[entries[i+2+ 7]] ^= t;
-			curr_b[entries[i+2+ 8]] ^= t;
-			curr_b[entries[i+2+ 9]] ^= t;
-			curr_b[entries[i+2+10]] ^= t;
-			curr_b[entries[i+2+11]] ^= t;
-			curr_b[entries[i+2+12]] ^= t;
-			curr_b[entries[i+2+13]] ^= t;
-			curr_b[entries[i+2+14]] ^= t;
-			curr_b[entries[i+2+15]] ^= t;
+			_txor( 0); _txor( 1); _txor( 2); _txor( 3);
+			_txor( 4); _txor( 5); _txor( 6); _txor( 7);
+			_txor( 8); _txor( 9); _txor(10); _txor(11);
+			_txor(12); _txor(13); _txor(14); _txor(15);
 		}
+
+	#undef _txor
 #endif
 		for (; i < count; i++)
-			curr_b[entries[i+2]] ^= t;
+			curr_b[entries[i+2]] = qs_v_xor(curr_b[entries[i+2]], t);
 		entries += count + 2;
 	}
 }
 
 /*-------------------------------------------------------------------*/
 static void yafu_mul_trans_one_block(qs_packed_block_t *curr_block,
-				uint64 *curr_row, uint64 *curr_b) {
+				qs_v_t *curr_row, qs_v_t *curr_b) {
 
 	uint32 i = 0;
 	uint32 j = 0;
@@ -230,7 +226,7 @@ static void yafu_mul_trans_one_block(qs_packed_block_t *curr_block,
 	   more xor operations. Also convert two 16-bit reads into
 	   a single 32-bit read with unpacking arithmetic */
 
-#if defined(GCC_ASM32A) && defined(HAS_MMX)
+#if QS_VBITS == 64 && defined(GCC_ASM32A) && defined(HAS_MMX)
 
 	#define _txor(x)				\
 		"movl 4*" #x "(%1,%0,4), %%eax    \n\t"	\
@@ -261,7 +257,7 @@ static void yafu_mul_trans_one_block(qs_packed_block_t *curr_block,
 		 "g"(num_entries & (uint32)(~15))
 		:"%eax", "%ecx", "%mm0", "memory", "cc");
 
-#elif defined(MSC_ASM32A) && defined(HAS_MMX)
+#elif QS_VBITS == 64 && defined(MSC_ASM32A) && defined(HAS_MMX)
 
 	#define _txor(x)			\
 		ASM_M mov eax,[4*x+edi+esi*4]	\
@@ -296,8 +292,9 @@ static void yafu_mul_trans_one_block(qs_packed_block_t *curr_block,
 	}
 
 #else
-	#define _txor(x) curr_b[entries[i+x].col_off] ^= \
-				 curr_row[entries[i+x].row_off]	
+	#define _txor(x) curr_b[entries[i+x].col_off] = \
+			qs_v_xor(curr_b[entries[i+x].col_off], \
+				 curr_row[entries[i+x].row_off])
 
 	for (i = 0; i < (num_entries & (uint32)(~15)); i += 16) {
 		#ifdef MANUAL_PREFETCH
@@ -314,15 +311,15 @@ static void yafu_mul_trans_one_block(qs_packed_block_t *curr_block,
 	for (; i < num_entries; i++) {
 		j = entries[i].row_off;
 		k = entries[i].col_off;
-		curr_b[k] ^= curr_row[j];
+		curr_b[k] = qs_v_xor(curr_b[k], curr_row[j]);
 	}
 }
 
 /*-------------------------------------------------------------------*/
 void yafu_mul_trans_packed_core(qs_msieve_thread_data_t *t) {
 
-	uint64 *x = t->x;
-	uint64 *b = t->b;
+	qs_v_t *x = t->x;
+	qs_v_t *b = t->b;
 	uint32 i;
 	
 	/* you would think that doing the matrix multiply
@@ -346,7 +343,7 @@ void yafu_mul_trans_packed_core(qs_msieve_thread_data_t *t) {
 	/* multiply the densest few rows by x (in batches of 64 rows) */
 
 	for (i = 0; i < (t->num_dense_rows + 63) / 64; i++) {
-		yafu_mul_Nx64_64x64_acc(t->dense_blocks[i], x + 64 * i, 
+		yafu_mul_Nx64_64xB_acc(t->dense_blocks[i], x + 64 * i, 
 				   b + t->blocks[0].start_col, t->ncols);
 	}
 }
@@ -225,6 +225,319 @@ static void yafu_combine_cliques(uint32 num_dense_rows,
 	*ncols_out = j;
 }
 
+/*------------------------------------------------------------------*/
+/* clique removal and merging only pay off for matrices
+   that are big enough; the merged matrix still ends up
+   above QS_MIN_NCOLS_TO_PACK */
+
+#define QS_MIN_NCOLS_TO_MERGE 18000
+#define QS_MERGE_MAX_ROW_WEIGHT 8
+#define QS_DEFAULT_TARGET_DENSITY 80
+
+typedef struct {
+	uint32 cost;
+	uint32 row;
+} qs_merge_cand_t;
+
+static int yafu_compare_merge_cost(const void *x, const void *y) {
+	qs_merge_cand_t *xx = (qs_merge_cand_t *)x;
+	qs_merge_cand_t *yy = (qs_merge_cand_t *)y;
+	if (xx->cost != yy->cost)
+		return (xx->cost > yy->cost) ? 1 : -1;
+	return (xx->row > yy->row) ? 1 : (xx->row < yy->row) ? -1 : 0;
+}
+
+static uint32 yafu_add_col(qs_la_col_t *dest, qs_la_col_t *src,
+			uint32 num_dense_rows, uint32 *merge_array,
+			qs_row_count_t *counts) {
+
+	/* replace column dest with dest + src (both sorted),
+	   keeping the row counts up to date. Returns the new
+	   weight of dest */
+
+	uint32 i, j, k;
+	uint32 dense_row_words = (num_dense_rows + 31) / 32;
+
+	i = j = k = 0;
+	while (i < dest->weight && j < src->weight) {
+		uint32 a = dest->data[i];
+		uint32 b = src->data[j];
+		if (a < b) {
+			merge_array[k++] = a;
+			i++;
+		}
+		else if (a > b) {
+			merge_array[k++] = b;
+			counts[b].count++;
+			j++;
+		}
+		else {
+			counts[a].count--;
+			i++; 
+			j++;
+		}
+	}
+	for (; i < dest->weight; i++)
+		merge_array[k++] = dest->data[i];
+	for (; j < src->weight; j++) {
+		merge_array[k++] = src->data[j];
+		counts[src->data[j]].count++;
+	}
+	for (i = 0; i < dense_row_words; i++) {
+		merge_array[k + i] = dest->data[dest->weight + i] ^
+					src->data[src->weight + i];
+	}
+
+	free(dest->data);
+	dest->data = (uint32 *)xmalloc((k + dense_row_words) * 
+					sizeof(uint32));
+	memcpy(dest->data, merge_array, 
+			(k + dense_row_words) * sizeof(uint32));
+	dest->weight = k;
+
+	/* the relations of src now also belong to dest */
+
+	dest->cycle.list = (uint32 *)xrealloc(dest->cycle.list, 
+				(dest->cycle.num_relations +
+				 src->cycle.num_relations) *
+				sizeof(uint32));
+	memcpy(dest->cycle.list + dest->cycle.num_relations,
+		src->cycle.list, src->cycle.num_relations * 
+				sizeof(uint32));
+	dest->cycle.num_relations += src->cycle.num_relations;
+	return k;
+}
+
+static uint32 yafu_merge_cols(fact_obj_t *obj, uint32 nrows,
+			uint32 num_dense_rows, uint32 *ncols_out, 
+			qs_la_col_t *cols, qs_row_count_t *counts) {
+
+	/* Structured Gaussian elimination. A row of weight r
+	   can be eliminated by adding the lightest column
+	   containing it (the pivot, weight w) to the other
+	   r-1 columns and then deleting the pivot. This removes
+	   one row and one column, and changes the matrix weight
+	   by about (r-2)*w - 2*(r-1); rows of weight 2 always
+	   make the matrix lighter. Light rows are eliminated in
+	   order of increasing (Markowitz) cost for as long as the
+	   average column weight stays below a target density,
+	   since the Lanczos iteration costs about (matrix dimension)
+	   * (matrix weight). 
+	   
+	   Each pass finds the light rows and their columns 
+	   from scratch, then performs as many merges as it can 
+	   before that information goes stale: once a merge 
+	   toggles a row, the row is left for the next pass */
+
+	uint32 i, j, k;
+	uint32 ncols = *ncols_out;
+	uint32 ncols_alive = ncols;
+	uint32 target_density = QS_DEFAULT_TARGET_DENSITY;
+	uint32 *row_start;
+	uint32 *row_cols;
+	uint8 *row_dirty;
+	uint32 *merge_array;
+	qs_merge_cand_t *cand;
+	uint32 num_cand;
+	uint32 total_merged = 0;
+	uint32 passes = 0;
+	uint64 weight = 0;
+
+	if (obj->qs_obj.gbl_override_la_density_flag)
+		target_density = obj->qs_obj.gbl_override_la_density;
+
+	for (i = 0; i < ncols; i++) {
+		qsort(cols[i].data, (size_t)cols[i].weight, 
+				sizeof(uint32), yafu_compare_uint32);
+		weight += cols[i].weight;
+	}
+
+	row_start = (uint32 *)xmalloc((nrows + 1) * sizeof(uint32));
+	row_dirty = (uint8 *)xmalloc(nrows * sizeof(uint8));
+	merge_array = (uint32 *)xmalloc((2 * QS_MAX_COL_WEIGHT +
+				(num_dense_rows + 31) / 32) * sizeof(uint32));
+
+	while (weight < (uint64)target_density * ncols_alive) {
+		uint32 num_merged = 0;
+
+		/* list the columns of each light row */
+
+		memset(row_start, 0, (nrows + 1) * sizeof(uint32));
+		for (i = 0; i < ncols; i++) {
+			qs_la_col_t *c = cols + i;
+			if (c->data == NULL)
+				continue;
+			for (j = 0; j < c->weight; j++) {
+				uint32 r = counts[c->data[j]].count;
+				if (r >= 2 && r <= QS_MERGE_MAX_ROW_WEIGHT)
+					row_start[c->data[j] + 1]++;
+			}
+		}
+		for (i = num_cand = 0; i < nrows; i++) {
+			if (row_start[i + 1])
+				num_cand++;
+			row_start[i + 1] += row_start[i];
+		}
+		if (num_cand == 0)
+			break;
+
+		row_cols = (uint32 *)xmalloc(row_start[nrows] * sizeof(uint32));
+		for (i = 0; i < ncols; i++) {
+			qs_la_col_t *c = cols + i;
+			if (c->data == NULL)
+				continue;
+			for (j = 0; j < c->weight; j++) {
+				uint32 r = counts[c->data[j]].count;
+				if (r >= 2 && r <= QS_MERGE_MAX_ROW_WEIGHT)
+					row_cols[row_start[c->data[j]]++] = i;
+			}
+		}
+
+		/* row_start[] now points to the end of each list */
+
+		for (i = nrows; i; i--)
+			row_start[i] = row_start[i - 1];
+		row_start[0] = 0;
+
+		/* rank the light rows by their cost */
+
+		cand = (qs_merge_cand_t *)xmalloc(num_cand * 
+						sizeof(qs_merge_cand_t));
+		for (i = num_cand = 0; i < nrows; i++) {
+			uint32 r = row_start[i + 1] - row_start[i];
+			uint32 w = (uint32)(-1);
+
+			if (r == 0)
+				continue;
+			for (j = row_start[i]; j < row_start[i + 1]; j++)
+				w = MIN(w, cols[row_cols[j]].weight);
+
+			cand[num_cand].cost = (r - 2) * w + 
+					2 * (QS_MERGE_MAX_ROW_WEIGHT - r);
+			cand[num_cand++].row = i;
+		}
+		qsort(cand, (size_t)num_cand, sizeof(qs_merge_cand_t), 
+				yafu_compare_merge_cost);
+		memset(row_dirty, 0, nrows * sizeof(uint8));
+
+		for (i = 0; i < num_cand; i++) {
+			uint32 row = cand[i].row;
+			uint32 *rc = row_cols + row_start[row];
+			uint32 r = row_start[row + 1] - row_start[row];
+			uint32 pivot = rc[0];
+			qs_la_col_t *p;
+			int64 delta;
+
+			/* skip rows touched by an earlier merge 
+			   in this pass; an untouched row still lives 
+			   in exactly the columns that were listed */
+
+			if (row_dirty[row])
+				continue;
+
+			for (j = 1; j < r; j++) {
+				if (cols[rc[j]].weight < cols[pivot].weight)
+					pivot = rc[j];
+			}
+			p = cols + pivot;
+
+			delta = (int64)(r - 2) * p->weight - 2 * (r - 1);
+			if ((int64)weight + delta > 
+			    (int64)target_density * (ncols_alive - 1))
+				continue;
+
+			for (j = 0; j < r; j++) {
+				if (cols[rc[j]].weight + p->weight >= 
+						2 * QS_MAX_COL_WEIGHT)
+					break;
+			}
+			if (j < r)
+				continue;
+
+			/* add the pivot to the other columns, 
+			   then delete it */
+
+			for (j = 0; j < r; j++) {
+				qs_la_col_t *c = cols + rc[j];
+				if (rc[j] == pivot)
+					continue;
+				weight -= c->weight;
+				weight += yafu_add_col(c, p, num_dense_rows,
+						merge_array, counts);
+			}
+
+			for (j = 0; j < p->weight; j++) {
+				counts[p->data[j]].count--;
+				row_dirty[p->data[j]] = 1;
+			}
+			weight -= p->weight;
+			free(p->data);
+			p->data = NULL;
+			free(p->cycle.list);
+			p->cycle.list = NULL;
+			ncols_alive--;
+			num_merged++;
+		}
+
+		free(cand);
+		free(row_cols);
+		passes++;
+		total_merged += num_merged;
+		if (num_merged == 0)
+			break;
+	}
+
+	free(row_start);
+	free(row_dirty);
+	free(merge_array);
+
+	/* squeeze out the deleted columns */
+
+	for (i = k = 0; i < ncols; i++) {
+		if (cols[i].data != NULL)
+			cols[k++] = cols[i];
+	}
+	*ncols_out = k;
+
+	if (total_merged) {
+		if (VFLAG > 0)
+			printf("merged %u rows in %u passes, "
+				"weight %1.2f/col\n", total_merged, passes,
+				(double)weight / k);
+		if (obj->logfile != NULL)
+			logprint(obj->logfile, "merged %u rows in %u passes, "
+				"weight %1.2f/col\n", total_merged, passes,
+				(double)weight / k);
+	}
+	return total_merged;
+}
+
+/*------------------------------------------------------------------*/
+static uint32 yafu_merge_pass(fact_obj_t *obj, uint32 nrows,
+			uint32 num_dense_rows, uint32 *merged,
+			uint32 *ncols, qs_la_col_t *cols, 
+			qs_row_count_t *counts) {
+
+	/* Called once the pruning in reduce_qs_matrix has 
+	   converged. Merging can leave singleton rows behind, 
+	   so it is done once on a large enough matrix and the 
+	   pruning is then repeated. Returns nonzero if that 
+	   is needed. The heaviest columns are left at the end 
+	   of cols[], where the pruning expects them */
+
+	if (*merged || *ncols < QS_MIN_NCOLS_TO_MERGE)
+		return 0;
+
+	*merged = 1;
+	if (yafu_merge_cols(obj, nrows, num_dense_rows, 
+				ncols, cols, counts) == 0)
+		return 0;
+
+	qsort(cols, (size_t)(*ncols), sizeof(qs_la_col_t), 
+			yafu_compare_weight);
+	return 1;
+}
+
 /*------------------------------------------------------------------*/
 void reduce_qs_matrix(fact_obj_t *obj, uint32 *nrows, 
 		uint32 num_dense_rows, uint32 *ncols, 
@@ -246,10 +559,14 @@ void reduce_qs_matrix(fact_obj_t *obj, uint32 *nrows,
 	   to find any nontrivial dependencies. I've also seen cases
 	   where cliques *must* be merged in order to find nontrivial
 	   dependencies; this seems to happen for matrices that are large
-	   and very sparse */
+	   and very sparse. 
+	   
+	   Large matrices then go through a merge phase that eliminates 
+	   light rows, and the pruning is repeated on the result */
 
 	uint32 r, c, i, j, k;
 	uint32 passes;
+	uint32 merged = 0;
 	qs_row_count_t *counts;
 	uint32 reduced_rows;
 	uint32 reduced_cols;
@@ -306,7 +623,7 @@ void reduce_qs_matrix(fact_obj_t *obj, uint32 *nrows,
 			/* if the matrix is big enough, collapse most 
 			   of the cliques that it contains */
 
-			if (reduced_cols >= QS_MIN_NCOLS_TO_PACK) {
+			if (reduced_cols >= QS_MIN_NCOLS_TO_MERGE) {
 				yafu_combine_cliques(num_dense_rows, 
 						&reduced_cols, 
 						cols, counts);
@@ -351,7 +668,9 @@ void reduce_qs_matrix(fact_obj_t *obj, uint32 *nrows,
 
 		passes++;
 
-	} while (r != reduced_rows);
+	} while (r != reduced_rows ||
+		 yafu_merge_pass(obj, *nrows, num_dense_rows, &merged,
+				&reduced_cols, cols, counts));
 
 	/* if the linear system was underdetermined going
 	   into this routine, the pruning above will likely
@@ -63,6 +63,9 @@ void qs_savefile_free(qs_savefile_t *s) {
 /*--------------------------------------------------------------------*/
 void qs_savefile_open(qs_savefile_t *s, uint32 flags) {
 	
+	FILE *check_fp;
+	uint8 magic[4];
+
 #if defined(WIN32) || defined(_WIN64)
 	DWORD access_arg, open_arg;
 
@@ -120,6 +123,22 @@ void qs_savefile_open(qs_savefile_t *s, uint32 flags) {
 
 	s->buf_off = 0;
 	s->buf[0] = 0;
+
+	/* an existing, nonempty savefile decides the relation 
+	   format; a new one gets whatever the caller picked */
+	if (flags != SAVEFILE_WRITE) {
+		check_fp = fopen(s->name, "rb");
+		if (check_fp != NULL) {
+			size_t n = fread(magic, 1, 4, check_fp);
+			if (n > 0)
+				s->binary = (n == 4 && 
+					memcmp(magic, QS_BIN_MAGIC, 4) == 0);
+			fclose(check_fp);
+		}
+	}
+
+	if ((flags & SAVEFILE_READ) && s->binary)
+		qs_savefile_read_bytes(magic, 4, s);
 }
 
 /*--------------------------------------------------------------------*/
@@ -211,6 +230,49 @@ void qs_savefile_write_line(qs_savefile_t *s, char *buf) {
 	s->buf_off += sprintf(s->buf + s->buf_off, "%s", buf);
 }
 
+/*--------------------------------------------------------------------*/
+void qs_savefile_write_bytes(qs_savefile_t *s, uint8 *buf, uint32 len) {
+
+	/* binary records may contain zeros, so unlike
+	   write_line this can't lean on string functions */
+	if (s->buf_off + len + 1 >= SAVEFILE_BUF_SIZE)
+		qs_savefile_flush(s);
+
+	memcpy(s->buf + s->buf_off, buf, len);
+	s->buf_off += len;
+	s->buf[s->buf_off] = 0;
+}
+
+/*--------------------------------------------------------------------*/
+uint32 qs_savefile_read_bytes(uint8 *buf, uint32 len, qs_savefile_t *s) {
+
+#if defined(WIN32) || defined(_WIN64)
+	uint32 i = 0;
+
+	while (i < len) {
+		if (s->buf_off == s->read_size) {	/* sbuf ran out? */
+			DWORD num_read;
+
+			if (s->eof)
+				break;
+			ReadFile(s->file_handle, s->buf, 
+					SAVEFILE_BUF_SIZE, 
+					&num_read, NULL);
+			s->read_size = num_read;
+			s->buf_off = 0;
+			if (num_read == 0) {
+				s->eof = 1;
+				break;
+			}
+		}
+		buf[i++] = s->buf[s->buf_off++];
+	}
+	return i;
+#else
+	return (uint32)fread(buf, 1, len, s->fp);
+#endif
+}
+
 /*--------------------------------------------------------------------*/
 void qs_savefile_flush(qs_savefile_t *s) {
 
@@ -222,7 +284,7 @@ void qs_savefile_flush(qs_savefile_t *s) {
 	}
 	FlushFileBuffers(s->file_handle);
 #else
-	fprintf(s->fp, "%s", s->buf);
+	fwrite(s->buf, 1, s->buf_off, s->fp);
 	fflush(s->fp);
 #endif
 
@@ -230,6 +292,17 @@ void qs_savefile_flush(qs_savefile_t *s) {
 	s->buf[0] = 0;
 }
 
+/*--------------------------------------------------------------------*/
+void qs_savefile_sync(qs_savefile_t *s) {
+
+	/* flush, and then make sure the data actually reaches
+	   the disk (on windows, flush already does this) */
+	qs_savefile_flush(s);
+#if !defined(WIN32) && !defined(_WIN64)
+	fsync(fileno(s->fp));
+#endif
+}
+
 /*--------------------------------------------------------------------*/
 void qs_savefile_rewind(qs_savefile_t *s) {
 
@@ -243,5 +316,10 @@ void qs_savefile_rewind(qs_savefile_t *s) {
 #else
 	rewind(s->fp);
 #endif
+
+	if (s->binary) {
+		uint8 magic[4];
+		qs_savefile_read_bytes(magic, 4, s);
+	}
 }
 
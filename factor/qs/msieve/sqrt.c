@@ -17,6 +17,431 @@ Purpose:	Port into Yafu-1.14.
 
 #include "qs.h"
 
+/* X and Y are products of many small numbers. Rather than
+   reduce mod n after every one of them, the numbers are
+   first multiplied together in groups of 2^SQRT_TREE_LEVELS
+   by a small product tree, and only the product of a group
+   is multiplied into the accumulator and reduced */
+
+#define SQRT_TREE_LEVELS 3
+
+typedef struct {
+	mpz_t level[SQRT_TREE_LEVELS];	/* level[k] holds a product
+					   of 2^k numbers, if bit k
+					   of count is set */
+	mpz_t carry;
+	mpz_t acc;
+	uint32 count;
+} sqrt_prod_t;
+
+typedef struct {
+
+	/* shared by all threads */
+
+	fact_obj_t *obj;
+	mpz_ptr n;
+	fb_element_siqs *factor_base;
+	uint32 fb_size;
+	qs_la_col_t *vectors;
+	uint32 vsize;
+	siqs_r *relation_list;
+	uint64 *null_vectors;
+	uint32 multiplier;
+	mpz_t *poly_a_list;
+	poly_t *poly_list;
+	factor_list_t *factor_list;
+	uint32 max_relations;
+
+	uint32 next_dep;	/* next dependency to hand out */
+	volatile uint32 done;	/* set when n is completely factored */
+	mpz_t tmpn;
+
+#if defined(WIN32) || defined(_WIN64)
+	HANDLE lock;
+#else
+	pthread_mutex_t lock;
+#endif
+
+} sqrt_job_t;
+
+typedef struct {
+	sqrt_job_t *job;
+
+	/* scratch space for one dependency */
+
+	uint32 *fb_counts;
+	uint32 *large_primes;
+	mpz_t factor, tmp, tmp2;
+	sqrt_prod_t x, y;
+
+#if defined(WIN32) || defined(_WIN64)
+	HANDLE thread_id;
+#else
+	pthread_t thread_id;
+#endif
+
+} sqrt_thread_t;
+
+static void sqrt_prod_init(sqrt_prod_t *p) {
+
+	uint32 k;
+
+	for (k = 0; k < SQRT_TREE_LEVELS; k++)
+		mpz_init(p->level[k]);
+	mpz_init(p->carry);
+	mpz_init_set_ui(p->acc, 1);
+	p->count = 0;
+}
+
+static void sqrt_prod_clear(sqrt_prod_t *p) {
+
+	uint32 k;
+
+	for (k = 0; k < SQRT_TREE_LEVELS; k++)
+		mpz_clear(p->level[k]);
+	mpz_clear(p->carry);
+	mpz_clear(p->acc);
+}
+
+static void sqrt_prod_push(sqrt_prod_t *p, mpz_t n) {
+
+	/* add p->carry to the tree. Like incrementing a
+	   binary counter, it combines with every full level
+	   below the first empty one */
+
+	uint32 k;
+
+	for (k = 0; k < SQRT_TREE_LEVELS && (p->count & (1 << k)); k++)
+		mpz_mul(p->carry, p->carry, p->level[k]);
+
+	if (k == SQRT_TREE_LEVELS) {
+		mpz_mul(p->acc, p->acc, p->carry);
+		mpz_tdiv_r(p->acc, p->acc, n);
+		p->count = 0;
+	}
+	else {
+		mpz_swap(p->level[k], p->carry);
+		p->count++;
+	}
+}
+
+static void sqrt_prod_push_ui(sqrt_prod_t *p, uint32 v, mpz_t n) {
+	mpz_set_ui(p->carry, v);
+	sqrt_prod_push(p, n);
+}
+
+static void sqrt_prod_finish(sqrt_prod_t *p, mpz_t n) {
+
+	/* multiply the partial levels into the accumulator */
+
+	uint32 k;
+
+	for (k = 0; k < SQRT_TREE_LEVELS; k++) {
+		if (p->count & (1 << k)) {
+			mpz_mul(p->acc, p->acc, p->level[k]);
+			mpz_tdiv_r(p->acc, p->acc, n);
+		}
+	}
+	p->count = 0;
+}
+
+static void sqrt_lock(sqrt_job_t *job) {
+#if defined(WIN32) || defined(_WIN64)
+	WaitForSingleObject(job->lock, INFINITE);
+#else
+	pthread_mutex_lock(&job->lock);
+#endif
+}
+
+static void sqrt_unlock(sqrt_job_t *job) {
+#if defined(WIN32) || defined(_WIN64)
+	ReleaseMutex(job->lock);
+#else
+	pthread_mutex_unlock(&job->lock);
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+static uint32 sqrt_one_dependency(sqrt_thread_t *t, uint64 mask) {
+
+	/* compute X and Y for one dependency, leaving them in
+	   t->x.acc and t->y.acc. Returns 0 if another thread
+	   finished the factorization in the meantime */
+
+	sqrt_job_t *job = t->job;
+	mpz_ptr n = job->n;
+	uint32 *fb_counts = t->fb_counts;
+	uint32 *large_primes = t->large_primes;
+	uint32 i, j, k, m;
+	uint32 num_large_primes, num_relations, prime;
+	siqs_r *relation;
+
+	memset(fb_counts, 0, job->fb_size * sizeof(uint32));
+	mpz_set_ui(t->x.acc, 1);
+	mpz_set_ui(t->y.acc, 1);
+	t->x.count = 0;
+	t->y.count = 0;
+
+	/* For each sieve relation */
+	for (i = 0; i < job->vsize; i++) {
+
+		/* If the relation is not scheduled to
+		   contribute to x and y, skip it */
+
+		if (!(job->null_vectors[i] & mask))
+			continue;
+
+		if (job->done)
+			return 0;
+
+		/* compute the number of sieve_values */
+
+		num_large_primes = 0;
+		num_relations = job->vectors[i].cycle.num_relations;
+
+		/* for all sieve values */
+
+		for (j = 0; j < num_relations; j++) {
+			mpz_ptr a, b;
+			poly_t *poly;
+			uint32 sieve_offset;
+			uint32 sign_of_index;
+
+			relation = &job->relation_list[job->vectors[i].cycle.list[j]];
+
+			/* reconstruct a[i], b[i], x[i] and
+			   the sign of x[i]. Drop the subscript
+			   from here on. */
+
+			poly = job->poly_list + relation->poly_idx;
+			b = poly->b;
+			a = job->poly_a_list[poly->a_idx];
+			sieve_offset = relation->sieve_offset;
+			sign_of_index = relation->parity;
+
+			/* Form (a * sieve_offset + b). Note that
+			   sieve_offset can be negative; in that
+			   case the minus sign is implicit. We don't
+			   have to normalize mod n because there
+			   are an even number of negative values
+			   to multiply together */
+
+			mpz_mul_ui(t->x.carry, a, sieve_offset);
+
+			if (sign_of_index == POSITIVE)
+				mpz_add(t->x.carry, t->x.carry, b);
+			else
+				mpz_sub(t->x.carry, t->x.carry, b);
+
+			/* multiply the sum into x */
+			sqrt_prod_push(&t->x, n);
+
+			/* do not multiply the factors associated
+			   with this relation into y; instead, just
+			   update the count for each factor base
+			   prime. Unlike ordinary MPQS, the list
+			   of factors is for the complete factor-
+			   ization of a*(a*x^2+b*x+c), so the 'a'
+			   in front need not be treated separately */
+
+			for (k = 0; k < relation->num_factors; k++)
+				fb_counts[relation->fb_offsets[k]]++;
+
+			/* if the sieve value contains one or more
+			   large primes, accumulate them in a
+			   dedicated table. Do not multiply them
+			   into y until all of the sieve values
+			   for this relation have been processed */
+
+			for (k = 0; k < 3; k++) {
+				prime = relation->large_prime[k];
+				if (prime == 1)
+					continue;
+
+				for (m = 0; m < num_large_primes; m++) {
+					if (prime == large_primes[2*m]){
+						large_primes[2*m+1]++;
+						break;
+					}
+				}
+				if (m == num_large_primes) {
+					large_primes[2*m] = prime;
+					large_primes[2*m+1] = 1;
+					num_large_primes++;
+				}
+			}
+		}
+
+		for (j = 0; j < num_large_primes; j++) {
+			for (k = 0; k < large_primes[2*j+1]/2; k++)
+				sqrt_prod_push_ui(&t->y, large_primes[2 * j], n);
+		}
+	}
+
+	sqrt_prod_finish(&t->x, n);
+
+	/* For each factor base prime p, compute
+		p ^ ((number of times p occurs in y) / 2) mod n
+	   then multiply it into y. This is enormously
+	   more efficient than multiplying by one p at a time */
+
+	for (i = MIN_FB_OFFSET; i < job->fb_size; i++) {
+		uint32 mask2 = 0x80000000;
+		uint32 exponent = fb_counts[i] / 2;
+		uint32 prime = job->factor_base->prime[i];
+
+
+		if (fb_counts[i] &0x1)
+			printf("odd exponent found\n");
+
+
+		if (exponent == 0)
+			continue;
+
+		if (exponent == 1) {
+			sqrt_prod_push_ui(&t->y, prime, n);
+			continue;
+		}
+
+		mpz_set_ui(t->tmp, prime);
+		mpz_set_ui(t->factor, prime);
+
+		while (!(exponent & mask2))
+			mask2 >>= 1;
+		for (mask2 >>= 1; mask2; mask2 >>= 1) {
+			mpz_mul(t->tmp, t->tmp, t->tmp);
+			mpz_tdiv_r(t->tmp, t->tmp, n);
+
+			if (exponent & mask2) {
+				mpz_mul(t->tmp, t->tmp, t->factor);
+				mpz_tdiv_r(t->tmp, t->tmp, n);
+			}
+		}
+		mpz_set(t->y.carry, t->tmp);
+		sqrt_prod_push(&t->y, n);
+	}
+
+	sqrt_prod_finish(&t->y, n);
+	return 1;
+}
+
+/*--------------------------------------------------------------------*/
+static uint32 sqrt_save_factor(sqrt_job_t *job, mpz_t tmp, mpz_t tmp2) {
+
+	/* tmp is a nontrivial gcd from one of the dependencies.
+	   Add it to the factor list; returns 1 if that completes
+	   the factorization. Called with the lock held */
+
+	uint32 multiplier = job->multiplier;
+	int bits;
+
+	/* remove any factors of the multiplier
+	   before saving tmp, and don't save at all
+	   if tmp contains *only* multiplier factors */
+	if (multiplier > 1) {
+		uint32 ignore_me = spGCD(multiplier,
+				mpz_tdiv_ui(tmp, multiplier));
+		if (ignore_me > 1) {
+			mpz_tdiv_q_ui(tmp, tmp, ignore_me);
+			if (mpz_cmp_ui(tmp, 1) == 0)
+				return 0;
+		}
+	}
+
+	//ignore composite factors for now...
+	if (!is_mpz_prp(tmp))
+		return 0;
+
+	//add the factor to our global list
+	bits = yafu_factor_list_add(job->obj, job->factor_list, tmp);
+
+	//check if only the multiplier remains
+	if (abs(bits) < 8)
+		return 1;
+
+	//divide the factor out of our number
+	mpz_tdiv_q(tmp2, job->tmpn, tmp);
+
+	//check if the remaining number is prime
+	if (is_mpz_prp(tmp2))
+	{
+		//add it to our global factor list
+		bits = yafu_factor_list_add(job->obj, job->factor_list, tmp2);
+
+		//then bail
+		return 1;
+	}
+
+	//divide out the multiplier from the remaining number
+	if (multiplier > 1) {
+		uint32 ignore_me = spGCD(multiplier,
+				mpz_tdiv_ui(tmp2, multiplier));
+		if (ignore_me > 1) {
+			mpz_tdiv_q_ui(tmp, tmp2, ignore_me);
+
+			//check again if the remaining number is prime
+			if (is_mpz_prp(tmp))
+			{
+				//add it to our global factor list
+				bits = yafu_factor_list_add(job->obj, job->factor_list, tmp);
+
+				//then bail
+				return 1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+/*--------------------------------------------------------------------*/
+#if defined(WIN32) || defined(_WIN64)
+static DWORD WINAPI sqrt_thread_main(LPVOID arg)
+#else
+static void *sqrt_thread_main(void *arg)
+#endif
+{
+	sqrt_thread_t *t = (sqrt_thread_t *)arg;
+	sqrt_job_t *job = t->job;
+	uint32 dep;
+
+	while (1) {
+
+		sqrt_lock(job);
+		dep = job->next_dep++;
+		sqrt_unlock(job);
+
+		if (job->done || dep >= 64)
+			break;
+
+		if (sqrt_one_dependency(t, (uint64)1 << dep) == 0)
+			break;
+
+		/* compute gcd(x+y, n). If it's not 1 or n, save it
+		   (and stop processing dependencies if the product
+		   of all the probable prime factors found so far equals
+		   n). See the comments in Pari's MPQS code for a proof
+		   that it isn't necessary to also check gcd(x-y, n) */
+
+		mpz_add(t->tmp, t->x.acc, t->y.acc);
+		mpz_gcd(t->tmp, t->tmp, job->n);
+		if ((mpz_cmp(t->tmp, job->n) != 0) &&
+		    (mpz_cmp_ui(t->tmp, 1) != 0)) {
+
+			sqrt_lock(job);
+			if (!job->done && sqrt_save_factor(job, t->tmp, t->tmp2))
+				job->done = 1;
+			sqrt_unlock(job);
+		}
+	}
+
+#if defined(WIN32) || defined(_WIN64)
+	return 0;
+#else
+	return NULL;
+#endif
+}
+
 /*--------------------------------------------------------------------*/
 uint32 yafu_find_factors(fact_obj_t *obj, mpz_t n, 
 		fb_element_siqs *factor_base, uint32 fb_size,
@@ -58,250 +483,112 @@ uint32 yafu_find_factors(fact_obj_t *obj, mpz_t n,
 	   Note that the code doesn't stop with one nontrivial
 	   factor; it prints them all. If you go to so much work
 	   and the other dependencies are there for free, why not
-	   use them? */
-
-	mpz_t factor, x, y, tmp, tmp2, sum, tmpn;
-	uint32 i, j, k, m;
-	uint64 mask;
-	uint32 *fb_counts;
-	uint32 large_primes[200], num_large_primes;
-	uint32 num_relations, prime;
-	siqs_r *relation;
-	uint32 factor_found = 0;
-	int bits;
-
-	mpz_init(factor);
-	mpz_init(x);
-	mpz_init(y);
-	mpz_init(tmp);
-	mpz_init(tmp2);
-	mpz_init(sum);
-	mpz_init(tmpn);
-	
-	fb_counts = (uint32 *)malloc(fb_size * sizeof(uint32));
-	mpz_set(tmpn, n);
-
-	bits = 0;
-	/* For each dependency */
-	for (mask = 1; mask; mask <<= 1) {
-		memset(fb_counts, 0, fb_size * sizeof(uint32));
-		mpz_set_ui(x, 1);
-		mpz_set_ui(y, 1);
-
-		/* For each sieve relation */
-		for (i = 0; i < vsize; i++) {
-
-			/* If the relation is not scheduled to
-			   contribute to x and y, skip it */
-
-			if (!(null_vectors[i] & mask))
-				continue;
-			
-			/* compute the number of sieve_values */
-
-			num_large_primes = 0;
-			num_relations = vectors[i].cycle.num_relations;
-
-			/* for all sieve values */
-
-			for (j = 0; j < num_relations; j++) {
-				mpz_ptr a, b;
-				poly_t *poly;
-				uint32 sieve_offset;
-				uint32 sign_of_index;
-
-				relation = &relation_list[vectors[i].cycle.list[j]];
-				
-				/* reconstruct a[i], b[i], x[i] and
-				   the sign of x[i]. Drop the subscript
-				   from here on. */
-
-				poly = poly_list + relation->poly_idx;
-				b = poly->b;
-				a = poly_a_list[poly->a_idx];
-				//sieve_offset = relation->sieve_offset & 
-				//				0x7fffffff;
-				//sign_of_index = relation->sieve_offset >> 31;
-				sieve_offset = relation->sieve_offset;
-				sign_of_index = relation->parity;
-
-				/* Form (a * sieve_offset + b). Note that 
-				   sieve_offset can be negative; in that
-				   case the minus sign is implicit. We don't
-				   have to normalize mod n because there
-				   are an even number of negative values
-				   to multiply together */
-	
-				mpz_mul_ui(sum, a, sieve_offset); //zShortMul(a,sieve_offset,&sum);
-
-				if (sign_of_index == POSITIVE)
-					mpz_add(sum, sum, b); //zAdd(&sum,b,&tmp);
-				else
-					mpz_sub(sum, sum, b); //zSub(&sum,b,&tmp);
-	
-				/* multiply the sum into x */	
-				mpz_mul(x, x, sum); //zModMul(&x,&sum,n,&x);
-				mpz_tdiv_r(x, x, n); 
-	
-				/* do not multiply the factors associated 
-				   with this relation into y; instead, just 
-				   update the count for each factor base 
-				   prime. Unlike ordinary MPQS, the list
-				   of factors is for the complete factor-
-				   ization of a*(a*x^2+b*x+c), so the 'a' 
-				   in front need not be treated separately */
-	
-				for (k = 0; k < relation->num_factors; k++)
-					fb_counts[relation->fb_offsets[k]]++;
-					
-				/* if the sieve value contains one or more
-				   large primes, accumulate them in a 
-				   dedicated table. Do not multiply them
-				   into y until all of the sieve values
-				   for this relation have been processed */
-
-				for (k = 0; k < 2; k++) {
-					prime = relation->large_prime[k];
-					if (prime == 1)
-						continue;
-
-					for (m = 0; m < num_large_primes; m++) {
-						if (prime == large_primes[2*m]){
-							large_primes[2*m+1]++;
-							break;
-						}
-					}
-					if (m == num_large_primes) {
-						large_primes[2*m] = prime;
-						large_primes[2*m+1] = 1;
-						num_large_primes++;
-					}
-				}
-			}
-
-			for (j = 0; j < num_large_primes; j++) {
-				for (k = 0; k < large_primes[2*j+1]/2; k++) {
-					mpz_set_ui(factor, large_primes[2 * j]); //factor.val[0] = large_primes[2*j];
-					mpz_mul(y, y, factor); //zModMul(&y,&factor,n,&y);  
-					mpz_tdiv_r(y, y, n);
-				}
-			}
-		}
-
-		/* For each factor base prime p, compute 
-			p ^ ((number of times p occurs in y) / 2) mod n
-		   then multiply it into y. This is enormously
-		   more efficient than multiplying by one p at a time */
-
-		for (i = MIN_FB_OFFSET; i < fb_size; i++) {
-			uint32 mask2 = 0x80000000;
-			uint32 exponent = fb_counts[i] / 2;
-			uint32 prime = factor_base->prime[i];
-
-			
-			if (fb_counts[i] &0x1)
-				printf("odd exponent found\n");
-				
-
-			if (exponent == 0)
-				continue;
-
-			mpz_set_ui(tmp, prime); 
-			mpz_set_ui(factor, prime);
-
-			while (!(exponent & mask2))
-				mask2 >>= 1;
-			for (mask2 >>= 1; mask2; mask2 >>= 1) {
-				mpz_mul(tmp, tmp, tmp); //zModMul(&tmp,&tmp,n,&tmp2);
-				mpz_tdiv_r(tmp, tmp, n);
-				
-				if (exponent & mask2) {
-					mpz_mul(tmp, tmp, factor); //zModMul(&tmp,&factor,n,&tmp); 
-					mpz_tdiv_r(tmp, tmp, n);
-				}
-			}
-			mpz_mul(y, tmp, y); //zModMul(&tmp,&y,n,&y);  
-			mpz_tdiv_r(y, y, n);
-		}
-
-		/* compute gcd(x+y, n). If it's not 1 or n, save it 
-		   (and stop processing dependencies if the product 
-		   of all the probable prime factors found so far equals 
-		   n). See the comments in Pari's MPQS code for a proof 
-		   that it isn't necessary to also check gcd(x-y, n) */
-
-		mpz_add(tmp, x, y); //zAdd(&x,&y,&tmp);
-		mpz_gcd(tmp, tmp, n); //zLEGCD(&tmp,n,&tmp2);
-		if ((mpz_cmp(tmp, n) != 0) && (mpz_cmp_ui(tmp, 1) != 0)) {
-
-			/* remove any factors of the multiplier 
-			   before saving tmp, and don't save at all
-			   if tmp contains *only* multiplier factors */
-			if (multiplier > 1) {
-				uint32 ignore_me = spGCD(multiplier,
-						mpz_tdiv_ui(tmp, multiplier)); //zShortMod(&tmp, multiplier));
-				if (ignore_me > 1) {
-					mpz_tdiv_q_ui(tmp, tmp, ignore_me); //zShortDiv(&tmp, ignore_me, &tmp2);
-					if (mpz_cmp_ui(tmp, 1) == 0)
-						continue;
-				}
-			}
-
-			//ignore composite factors for now...
-			if (!is_mpz_prp(tmp))
-				continue;
-
-			//add the factor to our global list
-			bits = yafu_factor_list_add(obj, factor_list, tmp);
-
-			//check if only the multiplier remains
-			if (abs(bits) < 8)
-				break;
+	   use them? 
+
+	   The dependencies are independent of each other, so they
+	   are handed out to THREADS threads, each with its own 
+	   scratch space. Factors go into factor_list under a lock,
+	   and once n is completely factored the threads stop, 
+	   including the ones in the middle of a dependency */
+
+	sqrt_job_t job;
+	sqrt_thread_t *threads;
+	uint32 i, num_threads;
+
+	job.obj = obj;
+	job.n = n;
+	job.factor_base = factor_base;
+	job.fb_size = fb_size;
+	job.vectors = vectors;
+	job.vsize = vsize;
+	job.relation_list = relation_list;
+	job.null_vectors = null_vectors;
+	job.multiplier = multiplier;
+	job.poly_a_list = poly_a_list;
+	job.poly_list = poly_list;
+	job.factor_list = factor_list;
+	job.next_dep = 0;
+	job.done = 0;
+	mpz_init_set(job.tmpn, n);
+
+	/* size the table of large primes for the longest
+	   cycle; every relation contributes up to 3 primes */
+
+	job.max_relations = 0;
+	for (i = 0; i < vsize; i++) {
+		if (vectors[i].cycle.num_relations > job.max_relations)
+			job.max_relations = vectors[i].cycle.num_relations;
+	}
 
-			//divide the factor out of our number
-			mpz_tdiv_q(tmp2, tmpn, tmp); //zDiv(&tmpn, &tmp, &tmp2, &tmp3);
+	num_threads = THREADS;
+	if (num_threads < 1)
+		num_threads = 1;
+	if (num_threads > 64)
+		num_threads = 64;
+
+	threads = (sqrt_thread_t *)xmalloc(num_threads * sizeof(sqrt_thread_t));
+	for (i = 0; i < num_threads; i++) {
+		sqrt_thread_t *t = threads + i;
+
+		t->job = &job;
+		t->fb_counts = (uint32 *)xmalloc(fb_size * sizeof(uint32));
+		t->large_primes = (uint32 *)xmalloc(2 * 3 *
+					job.max_relations * sizeof(uint32));
+		mpz_init(t->factor);
+		mpz_init(t->tmp);
+		mpz_init(t->tmp2);
+		sqrt_prod_init(&t->x);
+		sqrt_prod_init(&t->y);
+	}
 
-			//check if the remaining number is prime
-			if (is_mpz_prp(tmp2))
-			{
-				//add it to our global factor list
-				//printf("remaining cofactor is prime\n");
-				bits = yafu_factor_list_add(obj, factor_list, tmp2);
+#if defined(WIN32) || defined(_WIN64)
+	job.lock = CreateMutex(NULL, FALSE, NULL);
+#else
+	pthread_mutex_init(&job.lock, NULL);
+#endif
 
-				//then bail
-				break;
-			}
+	/* with one thread, run the dependencies one after
+	   another on this one */
 
-			//divide out the multiplier from the remaining number
-			if (multiplier > 1) {
-				uint32 ignore_me = spGCD(multiplier,
-						mpz_tdiv_ui(tmp2, multiplier));
-				if (ignore_me > 1) {
-					mpz_tdiv_q_ui(tmp, tmp2, ignore_me);
-
-					//check again if the remaining number is prime
-					if (is_mpz_prp(tmp))
-					{
-						//add it to our global factor list
-						//printf("remaining cofactor is prime after removing multiplier\n");
-						bits = yafu_factor_list_add(obj, factor_list, tmp);
-
-						//then bail
-						break;
-					}
-				}
-			}
+	if (num_threads == 1) {
+		sqrt_thread_main(threads);
+	}
+	else {
+#if defined(WIN32) || defined(_WIN64)
+		for (i = 0; i < num_threads; i++)
+			threads[i].thread_id = CreateThread(NULL, 0,
+					sqrt_thread_main, threads + i, 0, NULL);
+		for (i = 0; i < num_threads; i++) {
+			WaitForSingleObject(threads[i].thread_id, INFINITE);
+			CloseHandle(threads[i].thread_id);
 		}
+#else
+		for (i = 0; i < num_threads; i++)
+			pthread_create(&threads[i].thread_id, NULL,
+					sqrt_thread_main, threads + i);
+		for (i = 0; i < num_threads; i++)
+			pthread_join(threads[i].thread_id, NULL);
+#endif
 	}
 
-	free(fb_counts);
-	mpz_clear(factor);
-	mpz_clear(x);
-	mpz_clear(y);
-	mpz_clear(tmp);
-	mpz_clear(tmp2);
-	mpz_clear(tmpn);
-	mpz_clear(sum);
-	return factor_found;
+#if defined(WIN32) || defined(_WIN64)
+	CloseHandle(job.lock);
+#else
+	pthread_mutex_destroy(&job.lock);
+#endif
+
+	for (i = 0; i < num_threads; i++) {
+		sqrt_thread_t *t = threads + i;
+
+		free(t->fb_counts);
+		free(t->large_primes);
+		mpz_clear(t->factor);
+		mpz_clear(t->tmp);
+		mpz_clear(t->tmp2);
+		sqrt_prod_clear(&t->x);
+		sqrt_prod_clear(&t->y);
+	}
+	free(threads);
+	mpz_clear(job.tmpn);
+	return 0;
 }
-
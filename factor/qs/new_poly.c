@@ -26,7 +26,7 @@ code to the public domain.
 
 //#define POLYA_DEBUG
 
-void new_poly_a(static_conf_t *sconf, dynamic_conf_t *dconf)
+static void generate_poly_a(static_conf_t *sconf, siqs_poly *poly)
 {
 	/*the goal of this routine is to generate a new poly_a value from elements of the factor base
 	subject to a few constraints.  first, the number of fb elements used should always be greater than
@@ -70,7 +70,6 @@ void new_poly_a(static_conf_t *sconf, dynamic_conf_t *dconf)
 	*/
 
 	//unpack stuff from the job data structure
-	siqs_poly *poly = dconf->curr_poly;
 	mpz_ptr target_a = sconf->target_a;
 	fb_list *fb = sconf->factor_base;
 
@@ -435,7 +434,7 @@ void new_poly_a(static_conf_t *sconf, dynamic_conf_t *dconf)
 		{ 
 			// if not a duplicate
 			found_a_factor = 0;
-			for (j=0; j< (int)sconf->total_poly_a; j++)
+			for (j=0; j< (int)sconf->num_poly_a_gen; j++)
 			{
 				if (mpz_cmp(poly_a,sconf->poly_a_list[j]) == 0)
 				{
@@ -488,9 +487,10 @@ done:
 
 	//record this a in the list
 	sconf->poly_a_list = (mpz_t *)realloc(sconf->poly_a_list,
-		(sconf->total_poly_a + 1) * sizeof(mpz_t));
-	mpz_init(sconf->poly_a_list[sconf->total_poly_a]);
-	mpz_set(sconf->poly_a_list[sconf->total_poly_a], poly_a);
+		(sconf->num_poly_a_gen + 1) * sizeof(mpz_t));
+	mpz_init(sconf->poly_a_list[sconf->num_poly_a_gen]);
+	mpz_set(sconf->poly_a_list[sconf->num_poly_a_gen], poly_a);
+	sconf->num_poly_a_gen++;
 
 	//sort the indices of factors of 'a'
 	qsort(poly->qlisort,poly->s,sizeof(int),&qcomp_int);
@@ -503,6 +503,129 @@ done:
 	return;
 }
 
+void new_poly_a(static_conf_t *sconf, dynamic_conf_t *dconf)
+{
+	//generate a new poly a directly into this dconf.  the caller
+	//is responsible for advancing sconf->total_poly_a
+	generate_poly_a(sconf, dconf->curr_poly);
+	return;
+}
+
+void qs_apool_init(static_conf_t *sconf, int depth)
+{
+	qs_apool_t *pool = &sconf->apool;
+	int i;
+
+	pool->polys = (siqs_poly *)malloc(depth * sizeof(siqs_poly));
+	for (i = 0; i < depth; i++)
+	{
+		mpz_init(pool->polys[i].mpz_poly_a);
+		pool->polys[i].qlisort = (int *)malloc(MAX_A_FACTORS * sizeof(int));
+		pool->polys[i].s = 0;
+	}
+	pool->depth = depth;
+	pool->count = 0;
+
+#if defined(WIN32) || defined(_WIN64)
+	pool->lock = CreateMutex(NULL, FALSE, NULL);
+#else
+	pthread_mutex_init(&pool->lock, NULL);
+#endif
+
+	return;
+}
+
+static void apool_lock(qs_apool_t *pool)
+{
+#if defined(WIN32) || defined(_WIN64)
+	WaitForSingleObject(pool->lock, INFINITE);
+#else
+	pthread_mutex_lock(&pool->lock);
+#endif
+	return;
+}
+
+static void apool_unlock(qs_apool_t *pool)
+{
+#if defined(WIN32) || defined(_WIN64)
+	ReleaseMutex(pool->lock);
+#else
+	pthread_mutex_unlock(&pool->lock);
+#endif
+	return;
+}
+
+void qs_apool_fill(static_conf_t *sconf)
+{
+	//called by the master to top up the pool.  the lock is dropped
+	//between 'a' values so sieving threads are never kept waiting
+	//for more than one generation
+	qs_apool_t *pool = &sconf->apool;
+
+	while (!sconf->stop_sieving)
+	{
+		apool_lock(pool);
+		if (pool->count >= pool->depth)
+		{
+			apool_unlock(pool);
+			break;
+		}
+
+		generate_poly_a(sconf, &pool->polys[pool->count]);
+		pool->count++;
+		apool_unlock(pool);
+	}
+
+	return;
+}
+
+void qs_apool_get(static_conf_t *sconf, siqs_poly *poly)
+{
+	//take the next 'a' value for a sieving thread, generating one
+	//if the master hasn't kept up.  only 'a' values taken here are
+	//counted in total_poly_a; those left in the pool are never sieved
+	qs_apool_t *pool = &sconf->apool;
+	siqs_poly *src;
+
+	apool_lock(pool);
+	sconf->total_poly_a++;
+	if (pool->count == 0)
+	{
+		generate_poly_a(sconf, poly);
+	}
+	else
+	{
+		src = &pool->polys[--pool->count];
+		mpz_set(poly->mpz_poly_a, src->mpz_poly_a);
+		memcpy(poly->qlisort, src->qlisort, MAX_A_FACTORS * sizeof(int));
+		poly->s = src->s;
+	}
+	apool_unlock(pool);
+
+	return;
+}
+
+void qs_apool_free(static_conf_t *sconf)
+{
+	qs_apool_t *pool = &sconf->apool;
+	int i;
+
+	for (i = 0; i < pool->depth; i++)
+	{
+		mpz_clear(pool->polys[i].mpz_poly_a);
+		free(pool->polys[i].qlisort);
+	}
+	free(pool->polys);
+
+#if defined(WIN32) || defined(_WIN64)
+	CloseHandle(pool->lock);
+#else
+	pthread_mutex_destroy(&pool->lock);
+#endif
+
+	return;
+}
+
 void computeBl(static_conf_t *sconf, dynamic_conf_t *dconf)
 {
 	//ql = array of factors of a
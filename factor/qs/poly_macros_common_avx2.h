@@ -136,7 +136,9 @@
 			: "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7", "xmm8", "rax", "rsi", "rbx", "rcx", "rdx",	\
 			"r8", "r9", "r10", "r11", "r12", "r15", "cc", "memory");
 
-#define CLEAN_AVX2 __asm__ volatile ("vzeroupper   \n\t");
+#define CLEAN_AVX2 __asm__ volatile ("vzeroupper   \n\t" ::: \
+    "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7", \
+    "xmm8", "xmm9", "xmm10", "xmm11", "xmm12", "xmm13", "xmm14", "xmm15");
 
 #elif defined (_MSC_VER) && defined(_WIN64)
 
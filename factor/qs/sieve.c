@@ -1184,10 +1184,6 @@ void lp_sieveblock(uint8 *sieve, sieve_fb_compressed *fb, fb_list *full_fb, uint
 	fb_14bit_B = full_fb->fb_14bit_B;
 	fb_15bit_B = full_fb->fb_15bit_B;
 	
-#ifdef QS_TIMING
-	gettimeofday(&qs_timing_start, NULL);
-#endif
-
 	//initialize the block
 	memset(sieve,s_init,BLOCKSIZE);
 
@@ -1710,16 +1706,6 @@ void lp_sieveblock(uint8 *sieve, sieve_fb_compressed *fb, fb_list *full_fb, uint
 #endif	
 
 
-#ifdef QS_TIMING
-		gettimeofday (&qs_timing_stop, NULL);
-		qs_timing_diff = my_difftime (&qs_timing_start, &qs_timing_stop);
-
-		SIEVE_STG1 += ((double)qs_timing_diff->secs + (double)qs_timing_diff->usecs / 1000000);
-		free(qs_timing_diff);
-
-		gettimeofday(&qs_timing_start, NULL);
-#endif
-
 
 	//finally, dump the buckets into the now cached 
 	//sieve block in prefetched batches
@@ -1829,14 +1815,6 @@ void lp_sieveblock(uint8 *sieve, sieve_fb_compressed *fb, fb_list *full_fb, uint
 
 #endif
 
-#ifdef QS_TIMING
-		gettimeofday (&qs_timing_stop, NULL);
-		qs_timing_diff = my_difftime (&qs_timing_start, &qs_timing_stop);
-
-		SIEVE_STG2 += ((double)qs_timing_diff->secs + (double)qs_timing_diff->usecs / 1000000);
-		free(qs_timing_diff);
-#endif
-
 }
 
 void test_block_siqs(uint8 *sieve, sieve_fb *fb, uint32 start_prime)
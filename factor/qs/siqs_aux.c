@@ -247,11 +247,10 @@ uint32 make_fb_siqs(static_conf_t *sconf)
 }
 
 #define NUM_PARAM_ROWS 30
-void get_params(static_conf_t *sconf)
+void get_dummy_params(int bits, uint32 *B, uint32 *M, uint32 *NB)
 {
-	int bits,i;
+	int i;
 	double scale;
-	fb_list *fb = sconf->factor_base;
 
 	//parameter table
 	//bits, fb primes, lp mulitplier, 64k blocks
@@ -357,15 +356,13 @@ void get_params(static_conf_t *sconf)
 	//factor base bound.  use the closest parameter for lp multiplier
 	//and number of blocks.
 
-	bits = sconf->obj->bits;
-
-	fb->B = 0;
+	*B = 0;
 	if (bits <= param_table[0][0])
 	{
 		scale = (double)bits / (double)param_table[0][0];
-		fb->B = (uint32)(scale * (double)(param_table[0][1]));		
-		sconf->large_mult = 40;
-		sconf->num_blocks = 1;
+		*B = (uint32)(scale * (double)(param_table[0][1]));		
+		*M = 40;
+		*NB = 1;
 	}
 	else
 	{
@@ -375,38 +372,83 @@ void get_params(static_conf_t *sconf)
 			{
 				scale = (double)(param_table[i+1][0] - bits) /
 					(double)(param_table[i+1][0] - param_table[i][0]);
-				fb->B = param_table[i+1][1] - 
+				*B = param_table[i+1][1] - 
 					(uint32)(scale * (double)(param_table[i+1][1] - param_table[i][1]));
 				
-				//sconf->large_mult = (uint32)((double)param_table[i+1][2] - 
+				//*M = (uint32)((double)param_table[i+1][2] - 
 				//	(scale * (double)(param_table[i+1][2] - param_table[i][2])) + 0.5);
-				sconf->large_mult = (uint32)((param_table[i+1][2] + param_table[i][2])/2.0 + 0.5);
-				//sconf->num_blocks = (uint32)((double)param_table[i+1][3] - 
+				*M = (uint32)((param_table[i+1][2] + param_table[i][2])/2.0 + 0.5);
+				//*NB = (uint32)((double)param_table[i+1][3] - 
 				//	(scale * (double)(param_table[i+1][3] - param_table[i][3])) + 0.5);
-				sconf->num_blocks = (uint32)((param_table[i+1][3] + param_table[i][3])/2.0 + 0.5);
+				*NB = (uint32)((param_table[i+1][3] + param_table[i][3])/2.0 + 0.5);
 			}
 		}
 	}
 
-	if (fb->B == 0)
+	if (*B == 0)
 	{
 		//off the end of the table, extrapolate based on the slope of 
 		//the last two
 
 		scale = (double)(param_table[NUM_PARAM_ROWS-1][1] - param_table[NUM_PARAM_ROWS-2][1]) /
 			(double)(param_table[NUM_PARAM_ROWS-1][0] - param_table[NUM_PARAM_ROWS-2][0]);
-		fb->B = (uint32)(((double)bits - param_table[NUM_PARAM_ROWS-1][0]) * 
+		*B = (uint32)(((double)bits - param_table[NUM_PARAM_ROWS-1][0]) * 
 			scale + param_table[NUM_PARAM_ROWS-1][1]);
-		sconf->large_mult = param_table[NUM_PARAM_ROWS-1][2];	//reuse last one
+		*M = param_table[NUM_PARAM_ROWS-1][2];	//reuse last one
 
 		scale = (double)(param_table[NUM_PARAM_ROWS-1][3] - param_table[NUM_PARAM_ROWS-2][3]) /
 			(double)(param_table[NUM_PARAM_ROWS-1][0] - param_table[NUM_PARAM_ROWS-2][0]);
-		//sconf->num_blocks = param_table[NUM_PARAM_ROWS-1][3];	//reuse last one
-		sconf->num_blocks = (uint32)(((double)bits - param_table[NUM_PARAM_ROWS-1][0]) * 
+		//*NB = param_table[NUM_PARAM_ROWS-1][3];	//reuse last one
+		*NB = (uint32)(((double)bits - param_table[NUM_PARAM_ROWS-1][0]) * 
 			scale + param_table[NUM_PARAM_ROWS-1][3]);
 
 	}
 
+	return;
+}
+
+//siqs parameters tuned for this machine by siqstune(), sorted by size.
+//bits, fb primes, lp multiplier, blocks, tf_small_cutoff adjustment
+static int qs_tuned[QS_MAX_TUNED_ROWS][5];
+static int qs_num_tuned = 0;
+
+void get_params(static_conf_t *sconf)
+{
+	int bits,i;
+	double scale;
+	fb_list *fb = sconf->factor_base;
+
+	bits = sconf->obj->bits;
+
+	get_dummy_params(bits, &fb->B, &sconf->large_mult, &sconf->num_blocks);
+	sconf->tf_small_adjust = 0;
+
+	//a table tuned on this machine takes precedence over the defaults,
+	//within the range of sizes that it covers.  interpolate the factor
+	//base size, and use the closest row for everything else.
+	if ((qs_num_tuned > 1) && (bits >= qs_tuned[0][0]) && 
+		(bits <= qs_tuned[qs_num_tuned - 1][0]))
+	{
+		i = 0;
+		while ((i < qs_num_tuned - 2) && (bits > qs_tuned[i + 1][0]))
+			i++;
+
+		scale = (double)(bits - qs_tuned[i][0]) /
+			(double)(qs_tuned[i + 1][0] - qs_tuned[i][0]);
+		fb->B = (uint32)((double)qs_tuned[i][1] + 
+			scale * (double)(qs_tuned[i + 1][1] - qs_tuned[i][1]));
+
+		if (scale > 0.5)
+			i++;
+		sconf->large_mult = qs_tuned[i][2];
+		sconf->num_blocks = qs_tuned[i][3];
+		sconf->tf_small_adjust = qs_tuned[i][4];
+
+		if (VFLAG > 1)
+			printf("using siqs parameters tuned for this machine (%s)\n", 
+				QS_TUNE_FILE);
+	}
+
     // make B divisible by 16
     while ((fb->B & 15) != 0)
     {
@@ -427,6 +469,272 @@ void get_params(static_conf_t *sconf)
 	if (sconf->obj->qs_obj.gbl_override_lpmult_flag)
 		sconf->large_mult = sconf->obj->qs_obj.gbl_override_lpmult;
 
+	if (sconf->obj->qs_obj.gbl_override_tfsmall_flag)
+		sconf->tf_small_adjust = sconf->obj->qs_obj.gbl_override_tfsmall;
+
+	return;
+}
+
+#if defined(_WIN64)
+#define QS_TUNE_OS "WIN64"
+#elif defined(WIN32)
+#define QS_TUNE_OS "WIN32"
+#elif BITS_PER_DIGIT == 64
+#define QS_TUNE_OS "LINUX64"
+#else
+#define QS_TUNE_OS "LINUX32"
+#endif
+
+static int qs_read_tuned_line(char *line, int *row)
+{
+	//a tuning file line looks like
+	//siqs_params=<cpu>,<os>,bits,fb primes,lp multiplier,blocks,tf adjustment
+	//return 1 if it is one for this cpu and os, and parse it into row
+	char str[1024];
+	char *ptr, *comma;
+
+	if (strncmp(line, "siqs_params=", 12) != 0)
+		return 0;
+
+	strncpy(str, line + 12, 1023);
+	str[1023] = '\0';
+
+	//cpu id string, up to the first comma
+	ptr = str;
+	comma = strchr(ptr, ',');
+	if (comma == NULL)
+		return 0;
+	*comma = '\0';
+	if (strcmp(ptr, CPU_ID_STR) != 0)
+		return 0;
+
+	//then the os string
+	ptr = comma + 1;
+	comma = strchr(ptr, ',');
+	if (comma == NULL)
+		return 0;
+	*comma = '\0';
+	if (strcmp(ptr, QS_TUNE_OS) != 0)
+		return 0;
+
+	if (sscanf(comma + 1, "%d,%d,%d,%d,%d", 
+		&row[0], &row[1], &row[2], &row[3], &row[4]) != 5)
+		return 0;
+
+	if ((row[0] <= 0) || (row[1] <= 0) || (row[2] <= 0) || (row[3] <= 0))
+		return 0;
+
+	return 1;
+}
+
+static int qcomp_tuned(const void *x, const void *y)
+{
+	int *xx = (int *)x;
+	int *yy = (int *)y;
+	
+	return xx[0] - yy[0];
+}
+
+int qs_load_tuned_params(char *fname)
+{
+	//load the rows of a siqstune() file that belong to this machine,
+	//which get_params then prefers over the built in table
+	FILE *in;
+	char str[1024];
+	int row[5];
+	int i, j;
+
+	qs_num_tuned = 0;
+	in = fopen(fname, "r");
+	if (in == NULL)
+		return 0;
+
+	while (fgets(str, 1024, in) != NULL)
+	{
+		if (!qs_read_tuned_line(str, row))
+			continue;
+
+		if (qs_num_tuned == QS_MAX_TUNED_ROWS)
+			break;
+
+		memcpy(qs_tuned[qs_num_tuned++], row, 5 * sizeof(int));
+	}
+	fclose(in);
+
+	//sort by size and drop any repeated sizes
+	qsort(qs_tuned, qs_num_tuned, 5 * sizeof(int), &qcomp_tuned);
+	for (i = 0, j = 0; i < qs_num_tuned; i++)
+	{
+		if ((j > 0) && (qs_tuned[j - 1][0] == qs_tuned[i][0]))
+			continue;
+		memcpy(qs_tuned[j++], qs_tuned[i], 5 * sizeof(int));
+	}
+	qs_num_tuned = j;
+
+	return qs_num_tuned;
+}
+
+int qs_save_tuned_params(char *fname, int rows[][5], int num_rows)
+{
+	//replace this machine's rows in the tuning file with new ones,
+	//keeping those of any other machines sharing the file
+	FILE *in, *out;
+	char str[1024];
+	int row[5];
+	int i;
+
+	out = fopen("_tmp_siqs.ini", "w");
+	if (out == NULL)
+	{
+		printf("could not open _tmp_siqs.ini for writing\n");
+		return -1;
+	}
+
+	in = fopen(fname, "r");
+	if (in != NULL)
+	{
+		while (fgets(str, 1024, in) != NULL)
+		{
+			if (qs_read_tuned_line(str, row))
+				continue;
+			fputs(str, out);
+		}
+		fclose(in);
+	}
+	else
+	{
+		fprintf(out, "%% siqs parameters found by siqstune()\n");
+		fprintf(out, "%% cpu,os,bits,fb primes,lp multiplier,blocks,tf_small_cutoff adjustment\n");
+	}
+
+	for (i = 0; i < num_rows; i++)
+	{
+		fprintf(out, "siqs_params=%s,%s,%d,%d,%d,%d,%d\n", CPU_ID_STR, QS_TUNE_OS,
+			rows[i][0], rows[i][1], rows[i][2], rows[i][3], rows[i][4]);
+	}
+	fclose(out);
+
+	// swap old with new
+	remove(fname);
+	rename("_tmp_siqs.ini", fname);
+
+	return num_rows;
+}
+
+static const char *qs_prof_names[QS_PROF_STAGES] = {
+	"roots", "med_sieve", "lp_sieve", "scan", "tdiv_small", "tdiv_med",
+	"resieve", "tdiv_lp", "residue", "squfof", "merge" };
+
+void qs_prof_merge(static_conf_t *sconf, dynamic_conf_t *dconf)
+{
+	//fold one thread's stage counters into the totals.  called from the
+	//master thread once the worker has stopped, so no locking is needed.
+	int i;
+
+	if (!sconf->do_prof)
+		return;
+
+	for (i = 0; i < QS_PROF_STAGES; i++)
+		sconf->prof[i] += dconf->prof[i];
+
+	return;
+}
+
+void qs_prof_report(static_conf_t *sconf)
+{
+	//print the per-stage cycle breakdown and append it to the profile
+	//file, as one json object per run or as csv rows if the filename
+	//ends in .csv
+	FILE *sieve_log = sconf->obj->logfile;
+	FILE *out;
+	char *fname = sconf->obj->qs_obj.prof_file;
+	uint64 total = 0;
+	double secs, pct;
+	int i, digits, csv, len;
+
+	for (i = 0; i < QS_PROF_STAGES; i++)
+		total += sconf->prof[i];
+	if (total == 0)
+		total = 1;
+
+	digits = gmp_base10(sconf->obj->qs_obj.gmp_n);
+
+	if (VFLAG > 0)
+	{
+		printf("siqs stage profile (all threads, %d MHz clock):\n", 
+			(int)MEAS_CPU_FREQUENCY);
+		for (i = 0; i < QS_PROF_STAGES; i++)
+		{
+			secs = (double)sconf->prof[i] / (MEAS_CPU_FREQUENCY * 1e6);
+			pct = 100.0 * (double)sconf->prof[i] / (double)total;
+			printf("\t%-12s %16" PRIu64 " cycles, %8.3f sec, %5.1f%%\n",
+				qs_prof_names[i], sconf->prof[i], secs, pct);
+		}
+	}
+
+	if (sieve_log != NULL)
+	{
+		for (i = 0; i < QS_PROF_STAGES; i++)
+		{
+			secs = (double)sconf->prof[i] / (MEAS_CPU_FREQUENCY * 1e6);
+			pct = 100.0 * (double)sconf->prof[i] / (double)total;
+			logprint(sieve_log, "profile: %s = %" PRIu64 " cycles, %1.3f sec, %1.1f%%\n",
+				qs_prof_names[i], sconf->prof[i], secs, pct);
+		}
+	}
+
+	if (strlen(fname) == 0)
+		return;
+
+	len = (int)strlen(fname);
+	csv = (len > 4) && (strcmp(fname + len - 4, ".csv") == 0);
+
+	out = fopen(fname, "r");
+	if (out != NULL)
+	{
+		fclose(out);
+		out = fopen(fname, "a");
+	}
+	else
+	{
+		out = fopen(fname, "a");
+		if ((out != NULL) && csv)
+			fprintf(out, "digits,threads,cpu_mhz,polys,stage,cycles,seconds,percent\n");
+	}
+
+	if (out == NULL)
+	{
+		printf("could not open %s for writing\n", fname);
+		return;
+	}
+
+	if (csv)
+	{
+		for (i = 0; i < QS_PROF_STAGES; i++)
+		{
+			secs = (double)sconf->prof[i] / (MEAS_CPU_FREQUENCY * 1e6);
+			pct = 100.0 * (double)sconf->prof[i] / (double)total;
+			fprintf(out, "%d,%d,%d,%u,%s,%" PRIu64 ",%1.4f,%1.2f\n",
+				digits, THREADS, (int)MEAS_CPU_FREQUENCY, sconf->tot_poly,
+				qs_prof_names[i], sconf->prof[i], secs, pct);
+		}
+	}
+	else
+	{
+		fprintf(out, "{\"digits\": %d, \"threads\": %d, \"cpu_mhz\": %d, "
+			"\"polys\": %u, \"full\": %u, \"partial\": %u, \"stages\": {",
+			digits, THREADS, (int)MEAS_CPU_FREQUENCY, sconf->tot_poly,
+			sconf->num_relations, sconf->num_cycles);
+		for (i = 0; i < QS_PROF_STAGES; i++)
+		{
+			secs = (double)sconf->prof[i] / (MEAS_CPU_FREQUENCY * 1e6);
+			fprintf(out, "%s\"%s\": {\"cycles\": %" PRIu64 ", \"seconds\": %1.4f}",
+				i == 0 ? "" : ", ", qs_prof_names[i], sconf->prof[i], secs);
+		}
+		fprintf(out, "}}\n");
+	}
+
+	fclose(out);
 	return;
 }
 
@@ -548,6 +856,88 @@ uint32 yafu_factor_list_add(fact_obj_t *obj, factor_list_t *list,
 	return bitsleft;
 }
 
+void qs_arena_init(qs_arena_t *arena)
+{
+	arena->blocks = NULL;
+	arena->num_blocks = 0;
+	arena->curr_block = 0;
+	arena->used = 0;
+	return;
+}
+
+uint32 *qs_arena_alloc(qs_arena_t *arena, uint32 num_words)
+{
+	uint32 *ptr;
+
+	if (num_words > QS_ARENA_BLOCK_WORDS)
+	{
+		printf("relation arena request of %u words is too large\n", num_words);
+		exit(-1);
+	}
+
+	//move on to the next block if this one can't hold the request
+	if (arena->used + num_words > QS_ARENA_BLOCK_WORDS)
+	{
+		arena->curr_block++;
+		arena->used = 0;
+	}
+
+	if (arena->curr_block == arena->num_blocks)
+	{
+		arena->blocks = (uint32 **)realloc(arena->blocks, 
+			(arena->num_blocks + 1) * sizeof(uint32 *));
+		if (arena->blocks == NULL)
+		{
+			printf("error re-allocating relation arena\n");
+			exit(-1);
+		}
+		arena->blocks[arena->num_blocks] = (uint32 *)malloc(
+			QS_ARENA_BLOCK_WORDS * sizeof(uint32));
+		if (arena->blocks[arena->num_blocks] == NULL)
+		{
+			printf("error allocating relation arena block\n");
+			exit(-1);
+		}
+		arena->num_blocks++;
+	}
+
+	ptr = arena->blocks[arena->curr_block] + arena->used;
+	arena->used += num_words;
+	return ptr;
+}
+
+void qs_arena_reset(qs_arena_t *arena)
+{
+	//everything handed out so far is released at once; the
+	//blocks themselves are kept for reuse
+	arena->curr_block = 0;
+	arena->used = 0;
+	return;
+}
+
+void qs_arena_free(qs_arena_t *arena)
+{
+	uint32 i;
+
+	for (i=0; i<arena->num_blocks; i++)
+		free(arena->blocks[i]);
+	free(arena->blocks);
+	qs_arena_init(arena);
+	return;
+}
+
+void *qs_big_alloc(dynamic_conf_t *dconf, size_t len)
+{
+	//the bucket lists and the factor base/root update arrays are 
+	//scattered into all over, so back them with huge pages if we can
+	//and keep track of what we got for the splash screen.
+	int kind;
+	void *ptr = xmalloc_huge(len, &kind);
+
+	dconf->page_bytes[kind] += len;
+	return ptr;
+}
+
 void siqsexit(int sig)
 {
 	printf("\nAborting...\n");
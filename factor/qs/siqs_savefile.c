@@ -0,0 +1,985 @@
+/*----------------------------------------------------------------------
+This source distribution is placed in the public domain by its author,
+Ben Buhrow. You may use it for any purpose, free of charge,
+without having to notify anyone. I disclaim any responsibility for any
+errors.
+
+Optionally, please be nice and tell me if you find this source to be
+useful. Again optionally, if you add to the functionality present here
+please consider making those additions public too, so that others may
+benefit from your work.
+
+Some parts of the code (and also this header), included in this
+distribution have been reused from other sources. In particular I
+have benefitted greatly from the work of Jason Papadopoulos's msieve @
+www.boo.net/~jasonp, Scott Contini's mpqs implementation, and Tom St.
+Denis Tom's Fast Math library.  Many thanks to their kind donation of
+code to the public domain.
+       				   --bbuhrow@gmail.com 11/24/09
+----------------------------------------------------------------------*/
+
+#include "yafu.h"
+#include "qs.h"
+#include "factor.h"
+#include "util.h"
+#include "gmp_xface.h"
+
+#if !defined(WIN32) && !defined(_WIN64)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/* reading and writing of the entries in a siqs savefile.  There
+   are two formats.  The text format is one line per entry:
+
+	N 0x<n>
+	P <version> <multiplier> <fb size> <large prime bound> <dlp mode>
+	A 0x<poly a>
+	R [-]<offset> <poly b index> <fb index> ... L <lp1> <lp2> [<lp3>]
+
+   with everything in hex.  The P line is left out when the
+   parameters are not known.  The binary format starts with the 4
+   bytes QS_BIN_MAGIC, followed by a sequence of records:
+
+	<type byte> <varint payload length> <payload>
+
+   where the type is one of 'N', 'A' or 'R' as above.  A zero
+   multiplier in the N record means the parameters are not known.  Integers in a
+   payload are LEB128-style varints.  The payloads are:
+
+	N: version, multiplier, fb size, large prime bound, dlp mode,
+	   then the hex digits of n
+	A: the hex digits of the poly a
+	R: (offset << 1) | parity, poly b index, number of fb indices,
+	   the fb indices as zigzag-encoded differences from the previous
+	   index, then the three large primes (1 for unused)
+
+   The length prefix lets a reader step over a record that was only
+   partly written when a run was interrupted */
+
+#define QS_BIN_MAX_RECORD 4096
+
+static uint32 put_varint(uint8 *buf, uint64 val)
+{
+	uint32 i = 0;
+
+	while (val >= 0x80)
+	{
+		buf[i++] = (uint8)(val | 0x80);
+		val >>= 7;
+	}
+	buf[i++] = (uint8)val;
+	return i;
+}
+
+static uint64 get_varint(uint8 **buf, uint8 *end, int *err)
+{
+	uint64 val = 0;
+	int shift = 0;
+	uint8 *ptr = *buf;
+
+	while (ptr < end)
+	{
+		val |= ((uint64)(*ptr & 0x7f)) << shift;
+		if ((*ptr++ & 0x80) == 0)
+		{
+			*buf = ptr;
+			return val;
+		}
+		shift += 7;
+		if (shift > 63)
+			break;
+	}
+
+	*err = 1;
+	*buf = end;
+	return 0;
+}
+
+static void write_record(qs_savefile_t *s, uint8 type, uint8 *payload, uint32 len)
+{
+	uint8 hdr[16];
+	uint32 i;
+
+	hdr[0] = type;
+	i = 1 + put_varint(hdr + 1, len);
+	qs_savefile_write_bytes(s, hdr, i);
+	qs_savefile_write_bytes(s, payload, len);
+	return;
+}
+
+void qs_savefile_write_header(qs_savefile_t *s, mpz_t n, uint32 multiplier,
+	uint32 fb_size, uint32 large_prime_max, uint32 dlp)
+{
+	char buf[GSTR_MAXSIZE];
+	uint8 *payload;
+	uint32 i;
+
+	if (!s->binary)
+	{
+		gmp_sprintf(buf, "N 0x%Zx\n", n);
+		qs_savefile_write_line(s, buf);
+		if (multiplier > 0)
+		{
+			sprintf(buf, "P %x %x %x %x %x\n", QS_BIN_VERSION,
+				multiplier, fb_size, large_prime_max, dlp);
+			qs_savefile_write_line(s, buf);
+		}
+		return;
+	}
+
+	payload = (uint8 *)xmalloc(mpz_sizeinbase(n, 16) + 64);
+	i = put_varint(payload, QS_BIN_VERSION);
+	i += put_varint(payload + i, multiplier);
+	i += put_varint(payload + i, fb_size);
+	i += put_varint(payload + i, large_prime_max);
+	i += put_varint(payload + i, dlp);
+	mpz_get_str((char *)payload + i, 16, n);
+	i += strlen((char *)payload + i);
+
+	qs_savefile_write_bytes(s, (uint8 *)QS_BIN_MAGIC, 4);
+	write_record(s, 'N', payload, i);
+	free(payload);
+	return;
+}
+
+void qs_savefile_write_a(qs_savefile_t *s, mpz_t a)
+{
+	char buf[1024];
+
+	if (!s->binary)
+	{
+		gmp_sprintf(buf, "A 0x%Zx\n", a);
+		qs_savefile_write_line(s, buf);
+		return;
+	}
+
+	mpz_get_str(buf, 16, a);
+	write_record(s, 'A', (uint8 *)buf, (uint32)strlen(buf));
+	return;
+}
+
+void qs_savefile_write_rel(qs_savefile_t *s, siqs_r *rel)
+{
+	uint8 payload[QS_BIN_MAX_RECORD];
+	char *buf = (char *)payload;
+	uint32 i, k;
+
+	if (!s->binary)
+	{
+		i = sprintf(buf, "R ");
+
+		if (rel->parity)
+			i += sprintf(buf + i, "-%x ", rel->sieve_offset);
+		else
+			i += sprintf(buf + i, "%x ", rel->sieve_offset);
+
+		i += sprintf(buf + i, "%x ", rel->poly_idx);
+
+		for (k = 0; k < rel->num_factors; k++)
+			i += sprintf(buf + i, "%x ", rel->fb_offsets[k]);
+
+		// tlp relations are already sorted, and carry a third prime
+		if (rel->large_prime[2] != 1)
+			i += sprintf(buf + i, "L %x %x %x\n", rel->large_prime[0],
+				rel->large_prime[1], rel->large_prime[2]);
+		else if (rel->large_prime[0] < rel->large_prime[1])
+			i += sprintf(buf + i, "L %x %x\n", rel->large_prime[0],
+				rel->large_prime[1]);
+		else
+			i += sprintf(buf + i, "L %x %x\n", rel->large_prime[1],
+				rel->large_prime[0]);
+
+		qs_savefile_write_line(s, buf);
+		return;
+	}
+
+	i = put_varint(payload, ((uint64)rel->sieve_offset << 1) | rel->parity);
+	i += put_varint(payload + i, rel->poly_idx);
+	i += put_varint(payload + i, rel->num_factors);
+	for (k = 0; k < rel->num_factors; k++)
+	{
+		int64 d = (int64)rel->fb_offsets[k] -
+			(int64)(k > 0 ? rel->fb_offsets[k-1] : 0);
+		i += put_varint(payload + i, (uint64)((d << 1) ^ (d >> 63)));
+	}
+
+	// large primes go out in the same order as in the text format
+	if ((rel->large_prime[2] == 1) && (rel->large_prime[0] > rel->large_prime[1]))
+	{
+		i += put_varint(payload + i, rel->large_prime[1]);
+		i += put_varint(payload + i, rel->large_prime[0]);
+	}
+	else
+	{
+		i += put_varint(payload + i, rel->large_prime[0]);
+		i += put_varint(payload + i, rel->large_prime[1]);
+	}
+	i += put_varint(payload + i, rel->large_prime[2]);
+
+	write_record(s, 'R', payload, i);
+	return;
+}
+
+static void sort_large_primes(uint32 *lp)
+{
+	uint32 tmp;
+
+	if (lp[0] > lp[1]) {
+		tmp = lp[0]; lp[0] = lp[1]; lp[1] = tmp;
+	}
+	if (lp[2] != 1) {
+		if (lp[1] > lp[2]) {
+			tmp = lp[1]; lp[1] = lp[2]; lp[2] = tmp;
+		}
+		if (lp[0] > lp[1]) {
+			tmp = lp[0]; lp[0] = lp[1]; lp[1] = tmp;
+		}
+	}
+	return;
+}
+
+static int parse_text_rel(char *buf, siqs_r *rel, int lp_only)
+{
+	char *substr, *nextstr, *lpstr;
+	uint32 this_val;
+	int j;
+
+	lpstr = strchr(buf, 'L');
+	if (lpstr == NULL)
+		return 0;
+
+	if (lp_only)
+	{
+		yafu_read_large_primes(lpstr, rel->large_prime,
+			rel->large_prime + 1, rel->large_prime + 2);
+		return 'R';
+	}
+
+	substr = buf + 2;	//skip over the R and a space
+	while (isspace(*substr))
+		substr++;
+
+	// look at the sign directly so that an offset of -0 survives
+	rel->parity = 0;
+	if (*substr == '-')
+	{
+		rel->parity = 1;
+		substr++;
+	}
+	rel->sieve_offset = strtoul(substr, &nextstr, HEX);
+	substr = nextstr;
+
+	rel->poly_idx = strtoul(substr, &nextstr, HEX);
+	substr = nextstr;
+
+	j = 0;
+	while ((substr < lpstr - 1) && (j < MAX_SMOOTH_PRIMES))
+	{
+		this_val = strtoul(substr, &nextstr, HEX);
+		if (nextstr == substr)
+			break;
+		substr = nextstr;
+		rel->fb_offsets[j++] = this_val;
+	}
+	rel->num_factors = j;
+
+	substr = lpstr + 1;
+	rel->large_prime[0] = strtoul(substr, &nextstr, HEX);
+	substr = nextstr;
+	rel->large_prime[1] = strtoul(substr, &nextstr, HEX);
+	substr = nextstr;
+
+	//tlp relations have a third large prime
+	rel->large_prime[2] = strtoul(substr, &nextstr, HEX);
+	if (nextstr == substr)
+		rel->large_prime[2] = 1;
+
+	return 'R';
+}
+
+static int parse_bin_rel(uint8 *ptr, uint8 *end, siqs_r *rel, int lp_only)
+{
+	uint64 val;
+	uint32 k, num_factors, last = 0;
+	int err = 0;
+
+	val = get_varint(&ptr, end, &err);
+	rel->parity = (uint32)(val & 1);
+	rel->sieve_offset = (uint32)(val >> 1);
+	rel->poly_idx = (uint32)get_varint(&ptr, end, &err);
+	num_factors = (uint32)get_varint(&ptr, end, &err);
+	if (err || (num_factors > MAX_SMOOTH_PRIMES))
+		return 0;
+
+	rel->num_factors = num_factors;
+	for (k = 0; k < num_factors; k++)
+	{
+		val = get_varint(&ptr, end, &err);
+		last += (uint32)((val >> 1) ^ (~(val & 1) + 1));
+		if (!lp_only)
+			rel->fb_offsets[k] = last;
+	}
+	for (k = 0; k < 3; k++)
+		rel->large_prime[k] = (uint32)get_varint(&ptr, end, &err);
+
+	if (err)
+		return 0;
+
+	if (lp_only)
+		sort_large_primes(rel->large_prime);
+
+	return 'R';
+}
+
+static int parse_text_entry(char *buf, siqs_r *rel, mpz_t val, int lp_only,
+	qs_savefile_params_t *params)
+{
+	qs_savefile_params_t p;
+
+	switch (buf[0])
+	{
+	case 'N':
+	case 'A':
+		if (mpz_set_str(val, buf + 2, 0) < 0)
+			return 0;
+		return buf[0];
+
+	case 'P':
+		if (sscanf(buf + 2, "%x %x %x %x %x", &p.version, &p.multiplier,
+			&p.fb_size, &p.large_prime_max, &p.dlp) != 5)
+			return 0;
+		if (params != NULL)
+			*params = p;
+		return 'P';
+
+	case 'R':
+		return parse_text_rel(buf, rel, lp_only);
+
+	default:
+		return 0;
+	}
+}
+
+static int parse_bin_entry(uint8 type, uint8 *ptr, uint8 *end, siqs_r *rel, 
+	mpz_t val, int lp_only, qs_savefile_params_t *params)
+{
+	char buf[QS_BIN_MAX_RECORD + 1];
+	qs_savefile_params_t p;
+	int err = 0;
+
+	switch (type)
+	{
+	case 'N':
+		// the version and parameters
+		p.version = (uint32)get_varint(&ptr, end, &err);
+		p.multiplier = (uint32)get_varint(&ptr, end, &err);
+		p.fb_size = (uint32)get_varint(&ptr, end, &err);
+		p.large_prime_max = (uint32)get_varint(&ptr, end, &err);
+		p.dlp = (uint32)get_varint(&ptr, end, &err);
+		if (err)
+			return 0;
+		if (params != NULL)
+			*params = p;
+		// fall through to read the hex digits
+	case 'A':
+		// the payload may be read-only, so terminate a copy of it
+		memcpy(buf, ptr, end - ptr);
+		buf[end - ptr] = '\0';
+		if (mpz_set_str(val, buf, 16) < 0)
+			return 0;
+		return type;
+
+	case 'R':
+		return parse_bin_rel(ptr, end, rel, lp_only);
+
+	default:
+		return 0;
+	}
+}
+
+int qs_savefile_read_entry(qs_savefile_t *s, siqs_r *rel, mpz_t val, int lp_only)
+{
+	/* read the next entry from the savefile, in either format.
+	   Returns the type of the entry ('N', 'P', 'A' or 'R'), 0 for a
+	   corrupt entry that should be skipped, or -1 at the end of
+	   the file.  An 'N' or 'A' value is returned in val.  A relation
+	   is returned in rel, whose fb_offsets must have room for
+	   MAX_SMOOTH_PRIMES entries; with lp_only, only the (sorted)
+	   large primes are filled in.  Header parameters go to s->params */
+
+	uint8 payload[QS_BIN_MAX_RECORD + 1];
+	uint8 *ptr, *end;
+	uint32 len;
+	int err = 0;
+
+	if (!s->binary)
+	{
+		char *buf = (char *)payload;
+
+		buf[0] = 0;
+		qs_savefile_read_line(buf, QS_BIN_MAX_RECORD, s);
+		if (buf[0] == 0)
+			return -1;
+
+		return parse_text_entry(buf, rel, val, lp_only, &s->params);
+	}
+
+	if (qs_savefile_read_bytes(payload, 1, s) != 1)
+		return -1;
+
+	// the payload length
+	for (ptr = payload + 1; ptr < payload + 11; ptr++)
+	{
+		if (qs_savefile_read_bytes(ptr, 1, s) != 1)
+			return -1;
+		if ((*ptr & 0x80) == 0)
+			break;
+	}
+	end = ptr + 1;
+	ptr = payload + 1;
+	len = (uint32)get_varint(&ptr, end, &err);
+	if (err || (len > QS_BIN_MAX_RECORD))
+		return -1;
+
+	if (qs_savefile_read_bytes(payload + 1, len, s) != len)
+		return -1;
+
+	return parse_bin_entry(payload[0], payload + 1, payload + 1 + len, 
+		rel, val, lp_only, &s->params);
+}
+
+int qs_savefile_map(char *filename, qs_savefile_map_t *m)
+{
+	/* map a whole savefile into memory for the filtering stage,
+	   which can then parse it from several threads at once.
+	   Returns 0 on success; on failure the caller falls back to 
+	   reading the file as a stream */
+
+	memset(m, 0, sizeof(qs_savefile_map_t));
+
+#if defined(WIN32) || defined(_WIN64)
+	{
+		LARGE_INTEGER sz;
+
+		m->file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, 
+			NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (m->file == INVALID_HANDLE_VALUE)
+			return 1;
+		GetFileSizeEx(m->file, &sz);
+		m->size = (uint64)sz.QuadPart;
+		if (m->size == 0)
+		{
+			CloseHandle(m->file);
+			return 1;
+		}
+
+		m->map = CreateFileMappingA(m->file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (m->map == NULL)
+		{
+			CloseHandle(m->file);
+			return 1;
+		}
+		m->base = (uint8 *)MapViewOfFile(m->map, FILE_MAP_READ, 0, 0, 0);
+		if (m->base == NULL)
+		{
+			CloseHandle(m->map);
+			CloseHandle(m->file);
+			return 1;
+		}
+	}
+#else
+	{
+		struct stat st;
+
+		m->fd = open(filename, O_RDONLY);
+		if (m->fd < 0)
+			return 1;
+		fstat(m->fd, &st);
+		m->size = (uint64)st.st_size;
+		if (m->size == 0)
+		{
+			close(m->fd);
+			return 1;
+		}
+
+		m->base = (uint8 *)mmap(NULL, m->size, PROT_READ, MAP_SHARED, m->fd, 0);
+		if (m->base == (uint8 *)MAP_FAILED)
+		{
+			close(m->fd);
+			return 1;
+		}
+		madvise(m->base, m->size, MADV_SEQUENTIAL);
+	}
+#endif
+
+	m->binary = ((m->size >= 4) && (memcmp(m->base, QS_BIN_MAGIC, 4) == 0));
+	return 0;
+}
+
+void qs_savefile_unmap(qs_savefile_map_t *m)
+{
+#if defined(WIN32) || defined(_WIN64)
+	UnmapViewOfFile(m->base);
+	CloseHandle(m->map);
+	CloseHandle(m->file);
+#else
+	munmap(m->base, m->size);
+	close(m->fd);
+#endif
+	memset(m, 0, sizeof(qs_savefile_map_t));
+	return;
+}
+
+int qs_savefile_parse_entry(qs_savefile_map_t *m, uint8 **pos, uint8 *end, 
+	siqs_r *rel, mpz_t val, int lp_only)
+{
+	/* the same as qs_savefile_read_entry, for the entry at *pos
+	   in a mapped savefile.  *pos is advanced past the entry; 
+	   entries are not allowed to run past end */
+
+	uint8 *ptr = *pos;
+	uint8 *rec_end;
+	uint8 type;
+	uint32 len;
+	int err = 0;
+
+	if (ptr >= end)
+		return -1;
+
+	if (!m->binary)
+	{
+		char buf[QS_BIN_MAX_RECORD + 1];
+
+		rec_end = (uint8 *)memchr(ptr, '\n', end - ptr);
+		if (rec_end == NULL)
+			rec_end = end;
+		else
+			rec_end++;
+		*pos = rec_end;
+
+		len = (uint32)(rec_end - ptr);
+		if (len > QS_BIN_MAX_RECORD)
+			len = QS_BIN_MAX_RECORD;
+		memcpy(buf, ptr, len);
+		buf[len] = '\0';
+
+		return parse_text_entry(buf, rel, val, lp_only, NULL);
+	}
+
+	type = *ptr++;
+	len = (uint32)get_varint(&ptr, end, &err);
+	if (err || (len > QS_BIN_MAX_RECORD) || (ptr + len > end))
+	{
+		*pos = end;
+		return -1;
+	}
+	*pos = ptr + len;
+
+	return parse_bin_entry(type, ptr, ptr + len, rel, val, lp_only, NULL);
+}
+
+int qs_savefile_skip_entry(qs_savefile_map_t *m, uint8 **pos, uint8 *end)
+{
+	/* step *pos over the entry there without parsing it.
+	   Returns the entry type, or -1 at the end */
+
+	uint8 *ptr = *pos;
+	uint8 type;
+	uint64 len;
+	int err = 0;
+
+	if (ptr >= end)
+		return -1;
+
+	if (!m->binary)
+	{
+		uint8 *rec_end = (uint8 *)memchr(ptr, '\n', end - ptr);
+
+		*pos = (rec_end == NULL) ? end : rec_end + 1;
+		return *ptr;
+	}
+
+	type = *ptr++;
+	len = get_varint(&ptr, end, &err);
+	if (err || (len > (uint64)(end - ptr)))
+	{
+		*pos = end;
+		return -1;
+	}
+	*pos = ptr + len;
+	return type;
+}
+
+int qs_savefile_read_header(char *filename, mpz_t n, 
+	qs_savefile_params_t *params)
+{
+	/* read the input and the sieving parameters recorded at the top
+	   of a savefile.  Returns 1 on success, 0 if there is no (usable)
+	   file.  params is zeroed if the file does not record them */
+
+	qs_savefile_t s;
+	siqs_r rel;
+	uint32 fb_offsets[MAX_SMOOTH_PRIMES];
+	mpz_t tmp;
+	int type;
+
+	memset(params, 0, sizeof(qs_savefile_params_t));
+	qs_savefile_init(&s, filename);
+	if (!qs_savefile_exists(&s))
+	{
+		qs_savefile_free(&s);
+		return 0;
+	}
+
+	rel.fb_offsets = fb_offsets;
+	qs_savefile_open(&s, SAVEFILE_READ);
+	type = qs_savefile_read_entry(&s, &rel, n, 1);
+
+	// in the text format the parameters are on the next line
+	if ((type == 'N') && !s.binary)
+	{
+		mpz_init(tmp);
+		qs_savefile_read_entry(&s, &rel, tmp, 1);
+		mpz_clear(tmp);
+	}
+
+	qs_savefile_close(&s);
+	if (type == 'N')
+		*params = s.params;
+	qs_savefile_free(&s);
+
+	return (type == 'N');
+}
+
+int qs_savefile_read_n(char *filename, mpz_t n)
+{
+	/* read the input recorded at the top of a savefile.
+	   Returns 1 on success, 0 if there is no (usable) file */
+
+	qs_savefile_params_t params;
+
+	return qs_savefile_read_header(filename, n, &params);
+}
+
+int qs_savefile_convert(char *infile, char *outfile)
+{
+	/* copy a savefile to the other format.  Returns the number
+	   of relations copied, or -1 if the input could not be read.
+	   The header parameters are carried over */
+
+	qs_savefile_t in, out;
+	qs_savefile_params_t params;
+	siqs_r rel;
+	uint32 fb_offsets[MAX_SMOOTH_PRIMES];
+	uint32 num_rels = 0, num_bad = 0;
+	mpz_t val;
+	int type;
+
+	mpz_init(val);
+	qs_savefile_read_header(infile, val, &params);
+	qs_savefile_init(&in, infile);
+	qs_savefile_init(&out, outfile);
+	if (!qs_savefile_exists(&in))
+	{
+		printf("savefile %s not found\n", infile);
+		qs_savefile_free(&in);
+		qs_savefile_free(&out);
+		mpz_clear(val);
+		return -1;
+	}
+
+	rel.fb_offsets = fb_offsets;
+	qs_savefile_open(&in, SAVEFILE_READ);
+
+	type = qs_savefile_read_entry(&in, &rel, val, 0);
+	if (type != 'N')
+	{
+		printf("savefile %s has no header\n", infile);
+		qs_savefile_close(&in);
+		qs_savefile_free(&in);
+		qs_savefile_free(&out);
+		mpz_clear(val);
+		return -1;
+	}
+
+	out.binary = !in.binary;
+	qs_savefile_open(&out, SAVEFILE_WRITE);
+	qs_savefile_write_header(&out, val, params.multiplier, 
+		params.fb_size, params.large_prime_max, params.dlp);
+
+	while ((type = qs_savefile_read_entry(&in, &rel, val, 0)) >= 0)
+	{
+		switch (type)
+		{
+		case 'A':
+			qs_savefile_write_a(&out, val);
+			break;
+		case 'R':
+			qs_savefile_write_rel(&out, &rel);
+			num_rels++;
+			break;
+		case 'P':
+			break;
+		default:
+			num_bad++;
+			break;
+		}
+	}
+
+	qs_savefile_flush(&out);
+	qs_savefile_close(&out);
+	qs_savefile_close(&in);
+
+	printf("converted %u relations from %s (%s) to %s (%s)\n",
+		num_rels, infile, in.binary ? "binary" : "text",
+		outfile, out.binary ? "binary" : "text");
+	if (num_bad > 0)
+		printf("skipped %u unreadable entries\n", num_bad);
+
+	qs_savefile_free(&in);
+	qs_savefile_free(&out);
+	mpz_clear(val);
+	return num_rels;
+}
+
+/* the background savefile writer.  The ring indices only ever
+   increase; a slot is free when head - tail < QS_WRITER_SLOTS.
+   Each side publishes its index only after it is done with the
+   slot, with a full barrier in between.  A side that finds the
+   ring empty (writer) or full (master) sleeps until the other
+   signals it; the check is repeated under the lock so that a
+   signal can't be missed */
+
+static void writer_signal(qs_writer_t *w, int not_full)
+{
+#if defined(WIN32) || defined(_WIN64)
+	SetEvent(not_full ? w->not_full : w->not_empty);
+#else
+	pthread_mutex_lock(&w->lock);
+	pthread_cond_signal(not_full ? &w->not_full : &w->not_empty);
+	pthread_mutex_unlock(&w->lock);
+#endif
+	return;
+}
+
+static void writer_wait_records(qs_writer_t *w, uint32 seconds)
+{
+	// wait until the master adds a record or is done, or 
+	// (if seconds is nonzero) until that many seconds pass
+#if defined(WIN32) || defined(_WIN64)
+	if ((w->tail == w->head) && !w->done)
+		WaitForSingleObject(w->not_empty, seconds ? seconds * 1000 : INFINITE);
+#else
+	pthread_mutex_lock(&w->lock);
+	if (seconds)
+	{
+		struct timeval now;
+		struct timespec until;
+
+		gettimeofday(&now, NULL);
+		until.tv_sec = now.tv_sec + seconds;
+		until.tv_nsec = now.tv_usec * 1000;
+		while ((w->tail == w->head) && !w->done)
+		{
+			if (pthread_cond_timedwait(&w->not_empty, &w->lock, &until) != 0)
+				break;
+		}
+	}
+	else
+	{
+		while ((w->tail == w->head) && !w->done)
+			pthread_cond_wait(&w->not_empty, &w->lock);
+	}
+	pthread_mutex_unlock(&w->lock);
+#endif
+	return;
+}
+
+#if defined(WIN32) || defined(_WIN64)
+static DWORD WINAPI writer_thread_main(LPVOID arg)
+#else
+static void *writer_thread_main(void *arg)
+#endif
+{
+	qs_writer_t *w = (qs_writer_t *)arg;
+	time_t last_sync = time(NULL);
+	int pending = 0;
+
+	while (1)
+	{
+		if (w->tail != w->head)
+		{
+			qs_writer_rec_t *rec;
+
+			QS_BARRIER();
+			rec = w->slots + (w->tail % QS_WRITER_SLOTS);
+			if (rec->type == 'A')
+			{
+				mpz_import(w->a, rec->a_words, -1, sizeof(uint32), 0, 0, 
+					rec->data.a);
+				qs_savefile_write_a(w->savefile, w->a);
+			}
+			else
+			{
+				rec->rel.fb_offsets = rec->data.fb;
+				qs_savefile_write_rel(w->savefile, &rec->rel);
+			}
+			QS_BARRIER();
+			w->tail++;
+			pending = 1;
+
+			// the master may be waiting for room.  The barrier 
+			// orders our tail store before the head load, and the 
+			// master does the reverse, so one of us sees the other
+			QS_BARRIER();
+			if (w->head - w->tail == QS_WRITER_SLOTS - 1)
+				writer_signal(w, 1);
+			continue;
+		}
+
+		// caught up with the master
+		if (pending && (time(NULL) - last_sync >= QS_WRITER_SYNC_SECONDS))
+		{
+			qs_savefile_sync(w->savefile);
+			last_sync = time(NULL);
+			pending = 0;
+		}
+
+		if (w->done)
+		{
+			// one last look, in case records came in 
+			// before done was set
+			QS_BARRIER();
+			if (w->tail == w->head)
+				break;
+			continue;
+		}
+
+		// sleep until there is more to write, waking up in time
+		// to sync anything written since the last sync
+		writer_wait_records(w, pending ? QS_WRITER_SYNC_SECONDS : 0);
+	}
+
+	qs_savefile_sync(w->savefile);
+
+#if defined(WIN32) || defined(_WIN64)
+	return 0;
+#else
+	return NULL;
+#endif
+}
+
+qs_writer_t * qs_writer_start(qs_savefile_t *s)
+{
+	qs_writer_t *w = (qs_writer_t *)xmalloc(sizeof(qs_writer_t));
+
+	w->slots = (qs_writer_rec_t *)xmalloc(QS_WRITER_SLOTS * sizeof(qs_writer_rec_t));
+	w->head = 0;
+	w->tail = 0;
+	w->done = 0;
+	w->savefile = s;
+	mpz_init(w->a);
+
+#if defined(WIN32) || defined(_WIN64)
+	w->not_empty = CreateEvent(NULL, FALSE, FALSE, NULL);
+	w->not_full = CreateEvent(NULL, FALSE, FALSE, NULL);
+	w->thread_id = CreateThread(NULL, 0, writer_thread_main, w, 0, NULL);
+#else
+	pthread_mutex_init(&w->lock, NULL);
+	pthread_cond_init(&w->not_empty, NULL);
+	pthread_cond_init(&w->not_full, NULL);
+	pthread_create(&w->thread_id, NULL, writer_thread_main, w);
+#endif
+
+	return w;
+}
+
+static qs_writer_rec_t * writer_next_slot(qs_writer_t *w)
+{
+	// wait for the writer if the ring is full
+#if defined(WIN32) || defined(_WIN64)
+	while (w->head - w->tail >= QS_WRITER_SLOTS)
+		WaitForSingleObject(w->not_full, INFINITE);
+#else
+	if (w->head - w->tail >= QS_WRITER_SLOTS)
+	{
+		pthread_mutex_lock(&w->lock);
+		while (w->head - w->tail >= QS_WRITER_SLOTS)
+			pthread_cond_wait(&w->not_full, &w->lock);
+		pthread_mutex_unlock(&w->lock);
+	}
+#endif
+
+	QS_BARRIER();
+	return w->slots + (w->head % QS_WRITER_SLOTS);
+}
+
+static void writer_publish(qs_writer_t *w)
+{
+	QS_BARRIER();
+	w->head++;
+
+	// the writer may be waiting for something to do
+	QS_BARRIER();
+	if (w->head - w->tail == 1)
+		writer_signal(w, 0);
+	return;
+}
+
+void qs_writer_push_a(qs_writer_t *w, mpz_t a)
+{
+	qs_writer_rec_t *rec = writer_next_slot(w);
+	size_t words;
+
+	if (mpz_sizeinbase(a, 2) > 32 * MAX_SMOOTH_PRIMES)
+	{
+		printf("poly a too large for the savefile writer\n");
+		exit(-1);
+	}
+
+	// just copy the words; the writer thread does the formatting
+	rec->type = 'A';
+	mpz_export(rec->data.a, &words, -1, sizeof(uint32), 0, 0, a);
+	rec->a_words = (uint32)words;
+	writer_publish(w);
+	return;
+}
+
+void qs_writer_push_rel(qs_writer_t *w, siqs_r *rel)
+{
+	qs_writer_rec_t *rec = writer_next_slot(w);
+	uint32 k;
+
+	rec->type = 'R';
+	rec->rel = *rel;
+	for (k = 0; k < rel->num_factors; k++)
+		rec->data.fb[k] = rel->fb_offsets[k];
+	writer_publish(w);
+	return;
+}
+
+void qs_writer_stop(qs_writer_t *w)
+{
+	// let the writer drain the ring, then wait for it to finish
+	QS_BARRIER();
+	w->done = 1;
+	writer_signal(w, 0);
+
+#if defined(WIN32) || defined(_WIN64)
+	WaitForSingleObject(w->thread_id, INFINITE);
+	CloseHandle(w->thread_id);
+	CloseHandle(w->not_empty);
+	CloseHandle(w->not_full);
+#else
+	pthread_join(w->thread_id, NULL);
+	pthread_mutex_destroy(&w->lock);
+	pthread_cond_destroy(&w->not_empty);
+	pthread_cond_destroy(&w->not_full);
+#endif
+
+	mpz_clear(w->a);
+	free(w->slots);
+	free(w);
+	return;
+}
@@ -26,7 +26,8 @@ code to the public domain.
 
 int check_relation(mpz_t a, mpz_t b, siqs_r *r, fb_list *fb, mpz_t n)
 {
-	int offset, lp[2], parity, num_factors;
+	int offset, parity, num_factors;
+	uint32 lp[3];
 	int j,retval;
 	mpz_t Q, RHS;
 
@@ -36,11 +37,13 @@ int check_relation(mpz_t a, mpz_t b, siqs_r *r, fb_list *fb, mpz_t n)
 	offset = r->sieve_offset;
 	lp[0] = r->large_prime[0];
 	lp[1] = r->large_prime[1];
+	lp[2] = r->large_prime[2];
 	parity = r->parity;
 	num_factors = r->num_factors;
 
 	mpz_set_ui(RHS, lp[0]);
 	mpz_mul_ui(RHS, RHS, lp[1]);
+	mpz_mul_ui(RHS, RHS, lp[2]);
 	for (j=0; j<num_factors; j++)
 		mpz_mul_ui(RHS, RHS, fb->list->prime[r->fb_offsets[j]]);
 
@@ -294,261 +297,242 @@ void siqsbench(fact_obj_t *fobj)
 	return;
 }
 
-void get_dummy_params(int bits, uint32 *B, uint32 *M, uint32 *NB)
+static double siqstune_trial(mpz_t n, uint32 B, uint32 M, uint32 NB, int tf_adj,
+	uint32 seconds)
 {
-	int i;
-	double scale;
-
-	//parameter table
-	//bits, fb primes, lp mulitplier, 64k blocks
-	int param_table[22][4] = {
-		{140,	600,	40,	1},
-		{149,	875,	40,	1},
-		{165,	1228,	50,	1},
-		{181,	2247,	50,	1},
-		{198,	3485,	60,	2},
-		{215,	6357,	60,	2},	
-		{232,	12132,	70,	3},
-		{248,	26379,	80,	4},
-		{265,	42871,	90,	6},
-		{281,	55137,	100,	8},
-		{298,	65244,	120,	10},
-		{310,	78247,	120,	12},
-		{320,	90678,	140,	14},
-		{330,	105000, 150,    18},
-		{340,	125000, 150,    21},
-		{350,	155000, 150,    25},
-		{360,	195000, 150,    29},
-		{370,	250000, 150,    34},
-		{380,	310000, 150,    40},
-		{390,	380000, 150,    47},
-		{400,	460000, 150,    55},
-		{410,	550000, 150,    64},
-	};
-
-	//linear interpolation according to bit size to determine
-	//factor base bound.  use the closest parameter for lp multiplier
-	//and number of blocks.
-
-	if (bits <= param_table[0][0])
+	//sieve n for a few seconds with the given parameters, and return an
+	//estimate of how long it would take to finish sieving.  
+	fact_obj_t *fobj;
+	struct timeval start, stop;
+	TIME_DIFF *difference;
+	double t_time, est, fr, pr, pmax, s1, k, a;
+
+	fobj = (fact_obj_t *)malloc(sizeof(fact_obj_t));
+	init_factobj(fobj);
+
+	//force these parameters into SIQS
+	fobj->qs_obj.gbl_override_B_flag = 1;
+	fobj->qs_obj.gbl_override_B = B;
+	fobj->qs_obj.gbl_override_blocks_flag = 1;
+	fobj->qs_obj.gbl_override_blocks = NB;
+	fobj->qs_obj.gbl_override_lpmult_flag = 1;
+	fobj->qs_obj.gbl_override_lpmult = M;
+	fobj->qs_obj.gbl_override_tfsmall_flag = 1;
+	fobj->qs_obj.gbl_override_tfsmall = tf_adj;
+	fobj->qs_obj.gbl_override_time_flag = 1;
+	fobj->qs_obj.gbl_override_time = seconds;
+
+	//hold the cutoff where it is put, and never resume an old trial
+	fobj->qs_obj.no_small_cutoff_opt = 1;
+	strcpy(fobj->qs_obj.siqs_savefile, "siqstune.dat");
+	remove(fobj->qs_obj.siqs_savefile);
+	fobj->qs_obj.qs_time = 0;
+
+	mpz_set(fobj->qs_obj.gmp_n, n);
+	gettimeofday(&start, NULL);
+	SIQS(fobj);
+	gettimeofday(&stop, NULL);
+	difference = my_difftime(&start, &stop);
+	t_time = ((double)difference->secs + (double)difference->usecs / 1000000);
+	free(difference);
+
+	if (fobj->qs_obj.qs_time > 0)
 	{
-		scale = (double)bits / (double)param_table[0][0];
-		*B = (uint32)(scale * (double)(param_table[0][1]));		
-		*M = 40;
-		*NB = 1;
+		//small jobs finish within the time limit
+		est = fobj->qs_obj.qs_time;
 	}
 	else
 	{
-		for (i=0;i<22;i++)
-		{
-			if (bits > param_table[i][0] && bits <= param_table[i+1][0])
-			{
-				scale = (double)(param_table[i+1][0] - bits) /
-					(double)(param_table[i+1][0] - param_table[i][0]);
-				*B = param_table[i+1][1] - 
-					(uint32)(scale * (double)(param_table[i+1][1] - param_table[i][1]));
-				
-				*M = (uint32)((param_table[i+1][2] + param_table[i][2])/2.0 + 0.5);
-				*NB = (uint32)((param_table[i+1][3] + param_table[i][3])/2.0 + 0.5);
-			}
-		}
+		//full relations arrive at a constant rate, while the number of
+		//cycles grows as the square of the number of partials.  with
+		//large primes from pmax to lpmult * pmax appearing with 
+		//probability ~ 1/p, P partials make about P^2 / 2k cycles, where
+		//k = pmax * ln(pmax) * ln(ln(lpmult * pmax) / ln(pmax))^2.
+		//solve fr * t + (pr * t)^2 / 2k = B for the time t.
+		fr = (double)fobj->qs_obj.num_full / t_time;
+		pr = (double)fobj->qs_obj.num_partial / t_time;
+		pmax = (double)fobj->qs_obj.pmax;
+		s1 = log(log((double)M * pmax) / log(pmax));
+		k = pmax * log(pmax) * s1 * s1;
+		a = pr * pr / (2 * k);
+
+		if (a > 0)
+			est = (sqrt(fr * fr + 4 * a * (double)B) - fr) / (2 * a);
+		else if (fr > 0)
+			est = (double)B / fr;
+		else
+			est = 1e30;
 	}
 
-	if (*B == 0)
-	{
-		//off the end of the table, extrapolate based on the slope of 
-		//the last two
-
-		scale = (double)(param_table[21][1] - param_table[20][1]) /
-			(double)(param_table[21][0] - param_table[20][0]);
-		*B = (uint32)(((double)bits - param_table[21][0]) * 
-			scale + param_table[21][1]);
-		*M = param_table[21][2];	//reuse last one
-
-		scale = (double)(param_table[21][3] - param_table[20][3]) /
-			(double)(param_table[21][0] - param_table[20][0]);
-		*NB = (uint32)(((double)bits - param_table[21][0]) * 
-			scale + param_table[21][3]);
-	}
+	remove(fobj->qs_obj.siqs_savefile);
+	clear_factor_list(fobj);
+	free_factobj(fobj);
+	free(fobj);
 
-	return;
+	printf("B = %u, blocks = %u, lpmult = %u, tf_small adj = %d: "
+		"estimated sieving time %1.2f sec\n", B, NB, M, tf_adj, est);
+	fflush(stdout);
+
+	return est;
 }
 
-/*
+#define TUNE_MIN_BITS 160
+#define TUNE_STEP_BITS 20
 void siqstune(int bits)
 {
-	FILE *res;
-	char fstr[80];
-	int i,x,y,w,n;
-	z input;
-	uint32 B, M, NB;
-	//dimension 1 = number of primes
-	//dimension 2 = number of blocks
-	//dimension 3 = large prime multiplier
-	uint32 Bvec[5], NBvec[3];
-	fact_obj_t *fobj;
-	double rels_per_sec, qs_time, tot_time;
-	double rels_per_sec_norm[45], qs_time_norm[45], tot_time_norm[45];
+	//find siqs parameters for this machine.  at sizes from TUNE_MIN_BITS
+	//up to bits, starting from the built in defaults, sieve a random
+	//semiprime for a few seconds over a grid of factor base sizes and
+	//block counts, then try the large prime multiplier and the small 
+	//prime variation cutoff either side of the best.  the factor base 
+	//sizes are smoothed over all sizes, and everything is written to 
+	//QS_TUNE_FILE, where get_params will find it from now on.
+	int rows[QS_MAX_TUNED_ROWS][5];
+	double x[QS_MAX_TUNED_ROWS], y[QS_MAX_TUNED_ROWS];
+	double est[3][3], best, t, u, slope, intercept;
+	double Bscale[3] = {0.8, 1.0, 1.25};
+	uint32 Bvec[3], NBvec[3], Mvec[2];
+	uint32 B, M, NB, seconds;
+	int tfvec[2] = {-4, 4};
+	int i, j, n, bx, by, tf, num_rows, tmpT, tmpV;
+	mpz_t input;
+
+	if (bits < TUNE_MIN_BITS + TUNE_STEP_BITS)
+	{
+		printf("siqstune needs a size of at least %d bits\n", 
+			TUNE_MIN_BITS + TUNE_STEP_BITS);
+		return;
+	}
 
-	zInit(&input);
+	tmpT = THREADS;
+	tmpV = VFLAG;
+	if (THREADS != 1)
+		printf("Setting THREADS = 1 for tuning\n");
+	THREADS = 1;
 
-	for (n=150; n <= 275; n+=25)
+	mpz_init(input);
+	num_rows = 0;
+	for (n = TUNE_MIN_BITS; (n <= bits) && (num_rows < QS_MAX_TUNED_ROWS); 
+		n += TUNE_STEP_BITS)
 	{
-		for (i=0; i<5; i++)
+		//always finish on the requested size
+		if ((n < bits) && (n + TUNE_STEP_BITS > bits))
+			n = bits;
+
+		build_RSA(n, input);
+		get_dummy_params(n, &B, &M, &NB);
+		seconds = 5 + (n - TUNE_MIN_BITS) / 8;
+
+		gmp_printf("\n==== tuning siqs at %d bits, %u sec per trial ====\n"
+			"N = %Zd\n", n, seconds, input);
+
+		for (i = 0; i < 3; i++)
+			Bvec[i] = (uint32)(Bscale[i] * (double)B);
+		NBvec[0] = (uint32)MAX(floor((double)NB * 0.5 + 0.5), 1);
+		NBvec[1] = NB;
+		NBvec[2] = (uint32)ceil((double)NB * 1.5);
+
+		VFLAG = -1;
+
+		//est[0][0] is filled first, so the running best is always 
+		//an entry that has already been measured
+		bx = by = 0;
+		for (i = 0; i < 3; i++)
 		{
-			//pick a random N bits number
-			build_RSA(n, &input);
-
-			//get the default parameters for this input
-			get_dummy_params(n, &B, &M, &NB);
-
-			//adjust for various architectures
-			if (BLOCKSIZE == 32768)
-				NB *= 2;
-			if (BLOCKSIZE == 16384)
-				NB *= 4;
-
-			//and adjust for really small jobs
-			if (bits <= 140)
-				NB = 1;
-			
-			//build up the test vector.  
-			//vary # of blocks +/- 20%
-			//vary # of primes +/- 10% and +/- 5%
-			//vary lp mult +/- 20%
-			//Bvec[0] = (uint32)((double)B * 0.9);
-			Bvec[0] = (uint32)((double)B * 0.95); 
-			Bvec[1] = (uint32)((double)B * 1);
-			Bvec[2] = (uint32)((double)B * 1.05); 
-			//Bvec[4] = (uint32)((double)B * 1.1);
-
-			//Mvec[0] = (uint32)(floor((double)M * 0.8));
-			//Mvec[1] = (uint32)((double)M * 1); 
-			//Mvec[2] = (uint32)(ceil((double)M * 1.2));
-
-			NBvec[0] = (uint32)MAX(floor(((double)NB * 0.8)),1);
-			NBvec[1] = (uint32)MAX(((double)NB * 1),1); 
-			NBvec[2] = (uint32)MAX(ceil(((double)NB * 1.2)),1);
-
-			sprintf(fstr,"tune_results_%d.csv",n);
-			res = fopen(fstr,"a");
-			fprintf(res,"N: %s\n",z2decstr(&input,&gstr1));
-			fclose(res);
-
-			//loop over the test vectors
-			for (x=0; x<3; x++)
+			for (j = 0; j < 3; j++)
 			{
-				for (y=0; y<3; y++)
+				if ((j > 0) && (NBvec[j] == NBvec[j - 1]))
+					est[i][j] = est[i][j - 1];
+				else
+					est[i][j] = siqstune_trial(input, Bvec[i], M, 
+						NBvec[j], 0, seconds);
+
+				if (est[i][j] < est[bx][by])
 				{
-					//for (w=0; w<3; w++)
-					//{
-
-						//new factorization object
-						fobj = (fact_obj_t *)malloc(sizeof(fact_obj_t));
-						init_factobj(fobj);
-
-						//force these parameters into SIQS
-						fobj->qs_obj.gbl_override_B_flag = 1;
-						fobj->qs_obj.gbl_override_B = Bvec[x];
-
-						fobj->qs_obj.gbl_override_blocks_flag = 1;
-						fobj->qs_obj.gbl_override_blocks = NBvec[y];
-
-						//gbl_override_lpmult_flag = 1;
-						//gbl_override_lpmult = Mvec[w];
-
-						//notification of progress
-						//printf("\n\n================ RUN %d of %d =================\n\n",
-						//	i*45 + x*9 + y*3 + w + 1,3*5*3*3);
-						printf("\n\n================ RUN %d of %d =================\n\n",
-							i*9 + x*3 + y + 1,5*3*3);
-
-						//run siqs
-						mp2gmp(&input,fobj->qs_obj.gmp_n);
-						SIQS(fobj);
-
-						//get timing from fact_obj
-						rels_per_sec = fobj->qs_obj.rels_per_sec;
-						qs_time = fobj->qs_obj.qs_time;
-						tot_time = fobj->qs_obj.total_time;
-						rels_per_sec_norm[i*9 + x*3 + y] = fobj->qs_obj.rels_per_sec;
-						qs_time_norm[i*9 + x*3 + y] = fobj->qs_obj.qs_time;
-						tot_time_norm[i*9 + x*3 + y] = fobj->qs_obj.total_time;					
-
-						//clean up
-						system("rm siqs.dat");
-						free_factobj(fobj);
-						free(fobj);
-
-					//}
+					bx = i;
+					by = j;
 				}
 			}
+		}
+		best = est[bx][by];
 
-			sprintf(fstr,"tune_results_%d.csv",n);
-			res = fopen(fstr,"a");
-			fprintf(res,"# primes,# blocks,rels/sec,qs time,tot time,norm rels/sec,"
-				"norm qs time,norm tot time\n");
-			for (y=0; y<3; y++)
+		//large prime multiplier either side of the default
+		Mvec[0] = (uint32)(0.75 * (double)M);
+		Mvec[1] = (uint32)(1.33 * (double)M);
+		j = M;
+		for (i = 0; i < 2; i++)
+		{
+			t = siqstune_trial(input, Bvec[bx], Mvec[i], NBvec[by], 0, seconds);
+			if (t < best)
 			{
-				for (w=0; w<3; w++)
-				{
-					
-					//fprintf(res,"%d,%d,%d,%f,%f,%f,%f,%f,%f\n",
-					//	Bvec[x],
-					//	NBvec[y],
-					//	Mvec[w],
-					//	rels_per_sec_norm[x*9 + y*3 + w],
-					//	qs_time_norm[x*9 + y*3 + w],
-					//	tot_time_norm[x*9 + y*3 + w],
-					//	rels_per_sec_norm[x*9 + y*3 + w] / rels_per_sec_norm[2*9 + 1*3 + 1],
-					//	qs_time_norm[x*9 + y*3 + w] / qs_time_norm[2*9 + 1*3 + 1],
-					//	tot_time_norm[x*9 + y*3 + w] / tot_time_norm[2*9 + 1*3 + 1]);
-						
-					fprintf(res,"%d,%d,%f,%f,%f,%f,%f,%f\n",
-						Bvec[y],
-						NBvec[w],
-						rels_per_sec_norm[i*9 + y*3 + w],
-						qs_time_norm[i*9 + y*3 + w],
-						tot_time_norm[i*9 + y*3 + w],
-						rels_per_sec_norm[i*9 + y*3 + w] / rels_per_sec_norm[i*9 + 1*3 + 1],
-						qs_time_norm[i*9 + y*3 + w] / qs_time_norm[i*9 + 1*3 + 1],
-						tot_time_norm[i*9 + y*3 + w] / tot_time_norm[i*9 + 1*3 + 1]);
-				}
+				best = t;
+				j = Mvec[i];
 			}
-			fclose(res);
 		}
+		M = j;
 
-		//write to results file
-		sprintf(fstr,"tune_results_%d.csv",n);
-		res = fopen(fstr,"a");
-		fprintf(res,"AVERAGES\n");
-		fprintf(res,"# primes,# blocks,avg rels/sec norm,avg qs time norm,avg tot time norm\n");
-		for (x=0; x<3; x++)
+		//then the small prime variation cutoff
+		tf = 0;
+		for (i = 0; i < 2; i++)
 		{
-			for (y=0; y<3; y++)
+			t = siqstune_trial(input, Bvec[bx], M, NBvec[by], tfvec[i], seconds);
+			if (t < best)
 			{
-				rels_per_sec = 0;
-				qs_time = 0;
-				tot_time = 0;
-				for (w=0; w<5; w++)
-				{
-					rels_per_sec += rels_per_sec_norm[w*9 + x*3 + y] / rels_per_sec_norm[w*9 + 1*3 + 1];
-					qs_time += qs_time_norm[w*9 + x*3 + y] / qs_time_norm[w*9 + 1*3 + 1];
-					tot_time += tot_time_norm[w*9 + x*3 + y] / tot_time_norm[w*9 + 1*3 + 1];
-				}
-				fprintf(res,"%d,%d,%f,%f,%f\n",
-					Bvec[x],
-					NBvec[y],
-					rels_per_sec / 5,
-					qs_time / 5,
-					tot_time / 5);
+				best = t;
+				tf = tfvec[i];
 			}
 		}
-		fclose(res);
+		VFLAG = tmpV;
+
+		//the B grid is evenly spaced in log(B), so if the middle point is 
+		//the best put B at the vertex of the parabola through all three
+		if ((est[1][by] < est[0][by]) && (est[1][by] < est[2][by]))
+		{
+			u = (est[0][by] - est[2][by]) / 
+				(2 * (est[0][by] - 2 * est[1][by] + est[2][by]));
+			rows[num_rows][1] = (int)((double)B * pow(Bscale[2], u));
+		}
+		else
+			rows[num_rows][1] = Bvec[bx];
+
+		rows[num_rows][0] = n;
+		rows[num_rows][2] = M;
+		rows[num_rows][3] = NBvec[by];
+		rows[num_rows][4] = tf;
+
+		//remember how far the factor base moved from the default
+		x[num_rows] = n;
+		y[num_rows] = (double)rows[num_rows][1] / (double)B;
+		num_rows++;
+	}
+	mpz_clear(input);
+
+	THREADS = tmpT;
+
+	//individual trials are noisy: fit the log of the factor base scaling 
+	//to a line over all of the sizes
+	if (num_rows > 2)
+	{
+		best_linear_fit(x, y, num_rows, &slope, &intercept);
+		for (i = 0; i < num_rows; i++)
+		{
+			get_dummy_params(rows[i][0], &B, &M, &NB);
+			rows[i][1] = (int)((double)B * exp(slope * x[i] + intercept));
+		}
+	}
+
+	printf("\n==== tuned siqs parameters ====\n");
+	printf("bits,fb primes,lp multiplier,blocks,tf_small adj\n");
+	for (i = 0; i < num_rows; i++)
+		printf("%d,%d,%d,%d,%d\n", rows[i][0], rows[i][1], 
+			rows[i][2], rows[i][3], rows[i][4]);
+
+	if (qs_save_tuned_params(QS_TUNE_FILE, rows, num_rows) > 0)
+	{
+		qs_load_tuned_params(QS_TUNE_FILE);
+		printf("saved to %s\n", QS_TUNE_FILE);
 	}
 
-	zFree(&input);
 	return;
 }
-*/
 
@@ -24,6 +24,10 @@ code to the public domain.
 #include "util.h"
 #include "common.h"
 
+#if defined(_MSC_VER) && defined(_WIN64)
+#include <intrin.h>
+#endif
+
 //#define SIQSDEBUG 1
 
 /*
@@ -48,12 +52,26 @@ depending on the version (2^13 for 32k version, 2^14 for 64k).
 by scanning the buckets for sieve hits equal to the current block location.
 
 6) If applicable/appropriate, factor a remaining composite with squfof
+(double large primes) or rho + squfof (triple large primes)
 
 this file contains code implementing 6) as well as other auxiliary routines
 
 
 */
 
+// bounds on the effort spent splitting a tlp residue.  residues in
+// the tlp range whose factors are all below the large prime bound 
+// have a smallest factor p < large_prime_max, which rho finds in
+// about 1.25*sqrt(p) iterations.  It gives up after 
+// TLP_RHO_ITER_SCALE*sqrt(large_prime_max), which is enough to split
+// all of a sample of 30 bit p1*p2*p3, where a fixed cap of 8192 
+// lost 14% of them.
+#define TLP_RHO_ITER_SCALE 2
+#define TLP_RHO_BATCH 128
+
+static int tdiv_split_tlp(mpz_t q, uint32 *large_prime,
+	static_conf_t *sconf, dynamic_conf_t *dconf);
+
 
 
 void trial_divide_Q_siqs(uint32 report_num,  uint8 parity, 
@@ -74,10 +92,6 @@ void trial_divide_Q_siqs(uint32 report_num,  uint8 parity,
 	smooth_num = dconf->smooth_num[report_num];
 	block_loc = dconf->reports[report_num];
 	
-#ifdef QS_TIMING
-	gettimeofday(&qs_timing_start, NULL);
-#endif
-
 	offset = (bnum << sconf->qs_blockbits) + block_loc;
 
 	if (parity)
@@ -111,10 +125,11 @@ void trial_divide_Q_siqs(uint32 report_num,  uint8 parity,
 	if ((mpz_size(dconf->Qvals[report_num]) == 1) && 
 		(mpz_cmp_ui(dconf->Qvals[report_num], sconf->large_prime_max) < 0))
 	{
-		uint32 large_prime[2];
+		uint32 large_prime[3];
 		
 		large_prime[0] = (uint32)mpz_get_ui(dconf->Qvals[report_num]); //Q->val[0];
 		large_prime[1] = 1;
+		large_prime[2] = 1;
 
 		//add this one
 		if (sconf->is_tiny)
@@ -131,20 +146,33 @@ void trial_divide_Q_siqs(uint32 report_num,  uint8 parity,
                 fb_offsets, poly_id, parity, dconf, polya_factors, it, 1);
         }
 
-#ifdef QS_TIMING
-		gettimeofday (&qs_timing_stop, NULL);
-		qs_timing_diff = my_difftime (&qs_timing_start, &qs_timing_stop);
-
-		TF_STG6 += ((double)qs_timing_diff->secs + (double)qs_timing_diff->usecs / 1000000);
-		free(qs_timing_diff);
-#endif
-
 		return;
 	}
 
 	if (sconf->use_dlp == 0)
 		return;
 
+	if (sconf->use_dlp == 2)
+	{
+		// residues in the tlp range are above the dlp range
+		double qd = mpz_get_d(dconf->Qvals[report_num]);
+
+		if ((qd > sconf->max_fb3) && (qd < sconf->large_prime_max3))
+		{
+			uint32 large_prime[3];
+
+			if (tdiv_split_tlp(dconf->Qvals[report_num], large_prime, sconf, dconf))
+			{
+				//add this one
+				dconf->tlp_useful++;
+				buffer_relation(offset, large_prime, smooth_num + 1,
+					fb_offsets, poly_id, parity, dconf, polya_factors, it, 1);
+			}
+
+			return;
+		}
+	}
+
 	//quick check if Q is way too big for DLP (more than 64 bits)	
 	if (mpz_sizeinbase(dconf->Qvals[report_num], 2) >= 64)
 		return;
@@ -180,13 +208,6 @@ void trial_divide_Q_siqs(uint32 report_num,  uint8 parity,
 		//more sure.
 		if (res == 1)
 		{
-#ifdef QS_TIMING
-			gettimeofday (&qs_timing_stop, NULL);
-			qs_timing_diff = my_difftime (&qs_timing_start, &qs_timing_stop);
-
-			TF_STG6 += ((double)qs_timing_diff->secs + (double)qs_timing_diff->usecs / 1000000);
-			free(qs_timing_diff);
-#endif
 			dconf->dlp_prp++;
 			return;
 		}
@@ -194,7 +215,7 @@ void trial_divide_Q_siqs(uint32 report_num,  uint8 parity,
 		//try to find a double large prime
 #ifdef HAVE_CUDA
 		{
-			uint32 large_prime[2] = {1,1};
+			uint32 large_prime[3] = {1,1,1};
 		
 			// remember the residue and the relation it is associated with
 			dconf->buf_id[dconf->num_squfof_cand] = dconf->buffered_rels;
@@ -218,10 +239,11 @@ void trial_divide_Q_siqs(uint32 report_num,  uint8 parity,
 		f64 = sp_shanks_loop(dconf->gmptmp1, sconf->obj);
 		if (f64 > 1 && f64 != q64)
 		{
-			uint32 large_prime[2];
+			uint32 large_prime[3];
 
 			large_prime[0] = (uint32)f64;
 			large_prime[1] = (uint32)(q64 / f64);
+			large_prime[2] = 1;
 
             if (large_prime[0] < sconf->large_prime_max
                 && large_prime[1] < sconf->large_prime_max)
@@ -250,14 +272,6 @@ void trial_divide_Q_siqs(uint32 report_num,  uint8 parity,
         dconf->dlp_outside_range++;
     }
 
-#ifdef QS_TIMING
-	gettimeofday (&qs_timing_stop, NULL);
-	qs_timing_diff = my_difftime (&qs_timing_start, &qs_timing_stop);
-
-	TF_STG6 += ((double)qs_timing_diff->secs + (double)qs_timing_diff->usecs / 1000000);
-	free(qs_timing_diff);
-#endif
-	
 	return;
 }
 
@@ -299,8 +313,8 @@ void buffer_relation(uint32 offset, uint32 *large_prime, uint32 num_factors,
     rel->parity = parity;
     rel->poly_idx = poly_id;
 
-    rel->fb_offsets = (uint32 *)malloc(
-        (num_polya_factors + num_factors) * sizeof(uint32));
+    rel->fb_offsets = qs_arena_alloc(&conf->rel_arena, 
+        num_polya_factors + num_factors);
 
     //merge in extra factors of the apoly factors
     i = j = k = 0;
@@ -327,9 +341,18 @@ void buffer_relation(uint32 offset, uint32 *large_prime, uint32 num_factors,
 
     if (unfactored_residue > 1)
     {
-        if (conf->num_64bit_residue >= 4096)
+        if (conf->num_64bit_residue >= conf->residue_alloc)
         {
-            printf("uh-oh, too many residues\n"); fflush(stdout);
+            conf->residue_alloc *= 2;
+            conf->unfactored_residue = (uint64 *)realloc(conf->unfactored_residue,
+                conf->residue_alloc * sizeof(uint64));
+            conf->residue_factors = (uint64 *)realloc(conf->residue_factors,
+                conf->residue_alloc * sizeof(uint64));
+            if ((conf->unfactored_residue == NULL) || (conf->residue_factors == NULL))
+            {
+                printf("error re-allocating storage of unfactored residues\n");
+                exit(-1);
+            }
         }
 
         //printf("adding %lu to unfactored residue list in position %d, relation %d\n", 
@@ -339,18 +362,21 @@ void buffer_relation(uint32 offset, uint32 *large_prime, uint32 num_factors,
 
         // use this to signify we need to add factors later.
         rel->large_prime[0] = 0xffffffff;
+        rel->large_prime[2] = 1;
         conf->num_64bit_residue++;
     }
     else
     {
         rel->large_prime[0] = large_prime[0];
         rel->large_prime[1] = large_prime[1];
+        rel->large_prime[2] = large_prime[2];
     }
 
 #else
     
     rel->large_prime[0] = large_prime[0];
 	rel->large_prime[1] = large_prime[1];
+	rel->large_prime[2] = large_prime[2];
 
 #endif
 
@@ -363,9 +389,8 @@ void save_relation_siqs(uint32 offset, uint32 *large_prime, uint32 num_factors,
 						  uint32 *fb_offsets, uint32 poly_id, uint32 parity,
 						  static_conf_t *conf)
 {
-	char buf[1024];
 	fact_obj_t *obj = conf->obj;
-	uint32 i, k;
+	uint32 i;
 
 	if (conf->in_mem)
 	{
@@ -390,51 +415,445 @@ void save_relation_siqs(uint32 offset, uint32 *large_prime, uint32 num_factors,
 
 		r->large_prime[0] = large_prime[0];
 		r->large_prime[1] = large_prime[1];
+		r->large_prime[2] = large_prime[2];
 		r->num_factors = num_factors;
 		r->poly_idx = poly_id;
 		r->parity = parity;
 		r->sieve_offset = offset;
-		r->fb_offsets = (uint32 *)malloc(num_factors * sizeof(uint32));
+		r->fb_offsets = qs_arena_alloc(&conf->in_mem_arena, num_factors);
 		for (i=0; i<num_factors; i++)
 			r->fb_offsets[i] = fb_offsets[i];
 
 	}
 	else
 	{
-
-		//store to file
-		i = sprintf(buf, "R ");
-
-		if (parity)
-			i += sprintf(buf + i, "-%x ", offset);
+		siqs_r r;
+
+		//store to file, in whichever format it is using.  The
+		//background writer (if any) takes care of the formatting
+		r.sieve_offset = offset;
+		r.parity = parity;
+		r.poly_idx = poly_id;
+		r.num_factors = num_factors;
+		r.fb_offsets = fb_offsets;
+		r.large_prime[0] = large_prime[0];
+		r.large_prime[1] = large_prime[1];
+		r.large_prime[2] = large_prime[2];
+		if (conf->writer != NULL)
+			qs_writer_push_rel(conf->writer, &r);
 		else
-			i += sprintf(buf + i, "%x ", offset);
-	
-		i += sprintf(buf + i, "%x ", poly_id);
-	
-		k = 0;
-		while (k < num_factors)
-			i += sprintf(buf + i, "%x ", fb_offsets[k++]);
-
-		if (large_prime[0] < large_prime[1])
-			i += sprintf(buf + i, "L %x %x\n", large_prime[0], large_prime[1]);
-		else
-			i += sprintf(buf + i, "L %x %x\n", large_prime[1], large_prime[0]);
-
-		qs_savefile_write_line(&obj->qs_obj.savefile, buf);		
+			qs_savefile_write_rel(&obj->qs_obj.savefile, &r);
 	}
 
 	/* for partial relations, also update the bookeeping for
 		   tracking the number of fundamental cycles */
 
-	if (large_prime[0] != large_prime[1]) {
-		yafu_add_to_cycles(conf, obj->flags, large_prime[0], large_prime[1]);
-		conf->num_cycles++;
-	}
-	else {
-		conf->num_relations++;
-	}
+	yafu_count_relation(conf, obj->flags, large_prime);
 
 	return;
 }
 
+// fixed-width arithmetic for tlp residues, which are below 
+// large_prime_max^3 and so fit in two 64 bit words.  Values mod n are
+// kept fully reduced, and n < 2^126 keeps every sum below 2^128.
+typedef struct
+{
+	uint64 lo;
+	uint64 hi;
+} tlp_u128;
+
+static INLINE uint64 tlp_mul64(uint64 a, uint64 b, uint64 *hi)
+{
+	// the 128 bit product of a and b
+#if defined(__SIZEOF_INT128__)
+	unsigned __int128 p = (unsigned __int128)a * b;
+
+	*hi = (uint64)(p >> 64);
+	return (uint64)p;
+#elif defined(_MSC_VER) && defined(_WIN64)
+	return _umul128(a, b, hi);
+#else
+	uint64 a0 = a & 0xffffffff, a1 = a >> 32;
+	uint64 b0 = b & 0xffffffff, b1 = b >> 32;
+	uint64 p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0, p11 = a1 * b1;
+	uint64 mid = (p00 >> 32) + (p01 & 0xffffffff) + (p10 & 0xffffffff);
+
+	*hi = p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+	return (mid << 32) | (p00 & 0xffffffff);
+#endif
+}
+
+static INLINE int tlp_cmp(tlp_u128 a, tlp_u128 b)
+{
+	if (a.hi != b.hi)
+		return (a.hi > b.hi) ? 1 : -1;
+	if (a.lo != b.lo)
+		return (a.lo > b.lo) ? 1 : -1;
+	return 0;
+}
+
+static INLINE tlp_u128 tlp_sub(tlp_u128 a, tlp_u128 b)
+{
+	tlp_u128 r;
+
+	r.lo = a.lo - b.lo;
+	r.hi = a.hi - b.hi - (a.lo < b.lo);
+	return r;
+}
+
+static INLINE tlp_u128 tlp_addmod(tlp_u128 a, tlp_u128 b, tlp_u128 n)
+{
+	tlp_u128 r;
+
+	r.lo = a.lo + b.lo;
+	r.hi = a.hi + b.hi + (r.lo < a.lo);
+	if (tlp_cmp(r, n) >= 0)
+		r = tlp_sub(r, n);
+	return r;
+}
+
+static INLINE tlp_u128 tlp_montmul(tlp_u128 a, tlp_u128 b, 
+	tlp_u128 n, uint64 ninv)
+{
+	// a * b / 2^128 mod n, two words at a time.  a, b < n < 2^126
+	// keep the high product words below 2^62, so no carry is lost
+	uint64 t0 = 0, t1 = 0, t2 = 0, t3, c, c2, lo, hi, m, bi;
+	tlp_u128 r;
+	int i;
+
+	for (i = 0; i < 2; i++)
+	{
+		bi = (i == 0) ? b.lo : b.hi;
+
+		// t += a * bi
+		lo = tlp_mul64(a.lo, bi, &hi);
+		t0 += lo;
+		c = hi + (t0 < lo);
+		lo = tlp_mul64(a.hi, bi, &hi);
+		t1 += c;
+		c2 = (t1 < c);
+		t1 += lo;
+		c2 += (t1 < lo);
+		c = hi + c2;
+		t2 += c;
+		t3 = (t2 < c);
+
+		// t += m * n, which clears the low word, then shift it out
+		m = t0 * ninv;
+		lo = tlp_mul64(m, n.lo, &hi);
+		t0 += lo;
+		c = hi + (t0 < lo);
+		lo = tlp_mul64(m, n.hi, &hi);
+		t1 += c;
+		c2 = (t1 < c);
+		t1 += lo;
+		c2 += (t1 < lo);
+		c = hi + c2;
+		t2 += c;
+		t3 += (t2 < c);
+
+		t0 = t1;
+		t1 = t2;
+		t2 = t3;
+	}
+
+	r.lo = t0;
+	r.hi = t1;
+	if (tlp_cmp(r, n) >= 0)
+		r = tlp_sub(r, n);
+	return r;
+}
+
+static uint64 tlp_ninv(uint64 n0)
+{
+	// -1/n0 mod 2^64 by newton iteration; each step doubles the 
+	// number of correct bits, starting from 3 (n0 * n0 = 1 mod 8)
+	uint64 x = n0;
+	int i;
+
+	for (i = 0; i < 5; i++)
+		x *= 2 - n0 * x;
+	return 0 - x;
+}
+
+static INLINE int tlp_ctz64(uint64 x)
+{
+	// trailing zeros of a nonzero x
+#if defined(__GNUC__)
+	return __builtin_ctzll(x);
+#elif defined(_MSC_VER) && defined(_WIN64)
+	unsigned long i;
+
+	_BitScanForward64(&i, x);
+	return (int)i;
+#else
+	int i = 0;
+
+	while ((x & 1) == 0)
+	{
+		x >>= 1;
+		i++;
+	}
+	return i;
+#endif
+}
+
+static tlp_u128 tlp_gcd(tlp_u128 a, tlp_u128 n)
+{
+	// binary gcd with n odd
+	tlp_u128 t;
+
+	if ((a.lo | a.hi) == 0)
+		return n;
+
+	while ((a.lo | a.hi) != 0)
+	{
+		int s;
+
+		if (a.lo == 0)
+		{
+			a.lo = a.hi;
+			a.hi = 0;
+		}
+		s = tlp_ctz64(a.lo);
+		if (s > 0)
+		{
+			a.lo = (a.lo >> s) | (a.hi << (64 - s));
+			a.hi >>= s;
+		}
+
+		if (tlp_cmp(a, n) < 0)
+		{
+			t = a;
+			a = n;
+			n = t;
+		}
+		a = tlp_sub(a, n);
+	}
+
+	return n;
+}
+
+static int tlp_is_prp(tlp_u128 n)
+{
+	// base 2 fermat test of an odd n, in montgomery form.  one is
+	// 2^128 mod n, found by doubling, and the squarings of the left 
+	// to right exponentiation only ever need a doubling in between
+	tlp_u128 one, x, e;
+	uint64 ninv = tlp_ninv(n.lo);
+	int i;
+
+	one.lo = 1;
+	one.hi = 0;
+	for (i = 0; i < 128; i++)
+		one = tlp_addmod(one, one, n);
+
+	e = n;
+	e.lo--;
+
+	x = one;
+	for (i = 127; i >= 0; i--)
+	{
+		uint64 bit = (i >= 64) ? (e.hi >> (i - 64)) & 1 : (e.lo >> i) & 1;
+
+		x = tlp_montmul(x, x, n, ninv);
+		if (bit)
+			x = tlp_addmod(x, x, n);
+	}
+
+	return (tlp_cmp(x, one) == 0);
+}
+
+static int tdiv_tlp_rho(tlp_u128 n, uint32 max_iter, tlp_u128 *f)
+{
+	// Brent's variant of Pollard rho, accumulating differences so
+	// that a gcd is only needed every TLP_RHO_BATCH iterations.  
+	// gives up after max_iter iterations.  returns 1 and a proper
+	// factor of n in f on success.  The iteration is y -> y^2 / R + c
+	// in montgomery arithmetic, which is as good a random map as 
+	// y^2 + c.
+	tlp_u128 x, y, ys, q, d, c;
+	uint64 ninv = tlp_ninv(n.lo);
+	uint32 r, k, i, m, iter;
+
+	c.hi = 0;
+	ys.lo = ys.hi = 0;
+	x = ys;
+
+	// if the first polynomial finds every factor at once, try another.
+	// running out of iterations is final.
+	for (c.lo = 1; c.lo <= 3; c.lo += 2)
+	{
+		y.lo = 2;
+		y.hi = 0;
+		q.lo = 1;
+		q.hi = 0;
+		f->lo = 1;
+		f->hi = 0;
+		r = 1;
+		iter = 0;
+
+		do
+		{
+			x = y;
+			for (i = 0; i < r; i++)
+				y = tlp_addmod(tlp_montmul(y, y, n, ninv), c, n);
+
+			k = 0;
+			do
+			{
+				ys = y;
+				m = MIN(TLP_RHO_BATCH, r - k);
+				for (i = 0; i < m; i++)
+				{
+					y = tlp_addmod(tlp_montmul(y, y, n, ninv), c, n);
+					d = (tlp_cmp(x, y) >= 0) ? tlp_sub(x, y) : tlp_sub(y, x);
+					q = tlp_montmul(q, d, n, ninv);
+				}
+				*f = tlp_gcd(q, n);
+				k += m;
+				iter += m;
+			} while ((k < r) && (f->lo == 1) && (f->hi == 0));
+
+			r *= 2;
+		} while ((f->lo == 1) && (f->hi == 0) && (iter < max_iter));
+
+		if (tlp_cmp(*f, n) == 0)
+		{
+			// the batch overshot; step through it one gcd at a time
+			do
+			{
+				ys = tlp_addmod(tlp_montmul(ys, ys, n, ninv), c, n);
+				d = (tlp_cmp(x, ys) >= 0) ? tlp_sub(x, ys) : tlp_sub(ys, x);
+				*f = tlp_gcd(d, n);
+			} while ((f->lo == 1) && (f->hi == 0));
+		}
+
+		if ((f->hi == 0) && (f->lo == 1))
+			return 0;
+
+		if (tlp_cmp(*f, n) < 0)
+			return 1;
+	}
+
+	return 0;
+}
+
+static INLINE tlp_u128 tlp_from_mpz(mpz_t z)
+{
+	// z must be below 2^128
+	uint64 w[2] = {0, 0};
+	tlp_u128 r;
+
+	mpz_export(w, NULL, -1, sizeof(uint64), 0, 0, z);
+	r.lo = w[0];
+	r.hi = w[1];
+	return r;
+}
+
+static INLINE void tlp_to_mpz(mpz_t z, tlp_u128 a)
+{
+	uint64 w[2];
+
+	w[0] = a.lo;
+	w[1] = a.hi;
+	mpz_import(z, 2, -1, sizeof(uint64), 0, 0, w);
+}
+
+static int tdiv_tlp_add_factor(mpz_t f, uint32 *primes, int *num,
+	static_conf_t *sconf, dynamic_conf_t *dconf)
+{
+	// f divides a tlp residue, which has no factors below pmax.  
+	// since large_prime_max < pmax^2, anything below large_prime_max
+	// is prime, otherwise f has to be a product of two such primes.
+	uint64 f64, p64;
+	tlp_u128 fw;
+
+	if (mpz_cmp_ui(f, sconf->large_prime_max) < 0)
+	{
+		if (*num >= 3)
+			return 0;
+
+		primes[(*num)++] = (uint32)mpz_get_ui(f);
+		return 1;
+	}
+
+	if ((*num >= 2) || (mpz_sizeinbase(f, 2) > 62))
+		return 0;
+
+	f64 = mpz_get_64(f);
+	if (f64 >= (uint64)sconf->large_prime_max * (uint64)sconf->large_prime_max)
+		return 0;
+
+	fw.lo = f64;
+	fw.hi = 0;
+	if (tlp_is_prp(fw))
+		return 0;
+
+	dconf->attempted_squfof++;
+	p64 = sp_shanks_loop(f, sconf->obj);
+	if ((p64 <= 1) || (p64 == f64))
+	{
+		dconf->failed_squfof++;
+		return 0;
+	}
+
+	if ((p64 >= sconf->large_prime_max) || 
+		((f64 / p64) >= sconf->large_prime_max))
+		return 0;
+
+	primes[(*num)++] = (uint32)p64;
+	primes[(*num)++] = (uint32)(f64 / p64);
+	return 1;
+}
+
+static int tdiv_split_tlp(mpz_t q, uint32 *large_prime,
+	static_conf_t *sconf, dynamic_conf_t *dconf)
+{
+	// attempt to split a residue in the tlp range into at most three 
+	// primes, each below the single large prime cutoff.  on success 
+	// large_prime gets the primes in increasing order, padded with 1's.
+	// dconf->gmptmp1 and gmptmp2 hold the two halves of the split.
+	tlp_u128 qw, fw;
+	uint32 primes[3], tmp, max_iter;
+	int num = 0, i, j;
+
+	// residues are below large_prime_max^3, and have no small factors.
+	// anything else isn't going to split usefully.
+	if ((mpz_sizeinbase(q, 2) > 126) || mpz_even_p(q))
+		return 0;
+
+	// a single large prime this big is of no use
+	qw = tlp_from_mpz(q);
+	if (tlp_is_prp(qw))
+		return 0;
+
+	dconf->attempted_tlp++;
+
+	// rho needs about sqrt(p) iterations to find a factor p, and the
+	// smallest factor of a useful residue is below large_prime_max
+	max_iter = (uint32)(TLP_RHO_ITER_SCALE * sqrt((double)sconf->large_prime_max));
+	if (!tdiv_tlp_rho(qw, max_iter, &fw))
+		return 0;
+
+	tlp_to_mpz(dconf->gmptmp1, fw);
+	mpz_tdiv_q(dconf->gmptmp2, q, dconf->gmptmp1);
+	if (!tdiv_tlp_add_factor(dconf->gmptmp1, primes, &num, sconf, dconf) ||
+		!tdiv_tlp_add_factor(dconf->gmptmp2, primes, &num, sconf, dconf))
+		return 0;
+
+	for (i = 1; i < num; i++)
+	{
+		for (j = i; (j > 0) && (primes[j - 1] > primes[j]); j--)
+		{
+			tmp = primes[j];
+			primes[j] = primes[j - 1];
+			primes[j - 1] = tmp;
+		}
+	}
+
+	for (i = 0; i < 3; i++)
+		large_prime[i] = (i < num) ? primes[i] : 1;
+
+	return 1;
+}
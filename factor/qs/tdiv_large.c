@@ -435,10 +435,6 @@ void tdiv_LP(uint32 report_num,  uint8 parity, uint32 bnum,
 	z32 *tmp32 = &dconf->Qvals32[report_num];
 #endif
 
-#ifdef QS_TIMING
-	gettimeofday(&qs_timing_start, NULL);
-#endif
-
 	fb_offsets = &dconf->fb_offsets[report_num][0];
 	smooth_num = dconf->smooth_num[report_num];
 	block_loc = dconf->reports[report_num];
@@ -675,14 +671,6 @@ void tdiv_LP(uint32 report_num,  uint8 parity, uint32 bnum,
 
 	SCAN_CLEAN;
 
-#ifdef QS_TIMING
-	gettimeofday (&qs_timing_stop, NULL);
-	qs_timing_diff = my_difftime (&qs_timing_start, &qs_timing_stop);
-
-	TF_STG5 += ((double)qs_timing_diff->secs + (double)qs_timing_diff->usecs / 1000000);
-	free(qs_timing_diff);
-#endif
-
 	dconf->smooth_num[report_num] = smooth_num;
 
 	return;
@@ -18,6 +18,8 @@ code to the public domain.
 --bbuhrow@gmail.com 11/24/09
 ----------------------------------------------------------------------*/
 
+#define SIQS_KERNEL_AVX2
+#include "kernel_target.h"
 #include "common.h"
 
 
@@ -238,7 +240,7 @@ code to the public domain.
             : "r" (fbc->prime + i), "r" (fullfb_ptr->correction + i), \
             "r" (fullfb_ptr->small_inv + i), "r" (fbc->root1 + i), \
             "r" (fbc->root2 + i), "r"(buffer), "r"(i)	 \
-            : "r9", "r8", "r10", "r11", "rcx", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7", "memory", "cc");
+            : "r9", "r8", "r10", "r11", "rcx", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7", "xmm8", "memory", "cc");
 
 #define MOD_CMP_16X_vec_c(xtra_bits)																		\
 		__asm__ (																				\
@@ -83,10 +83,6 @@ void resieve_medprimes_32k(uint8 parity, uint32 poly_id, uint32 bnum,
 		fbc = dconf->comp_sieve_p;
 	}		
 
-#ifdef QS_TIMING
-	gettimeofday(&qs_timing_start, NULL);
-#endif
-
 	for (report_num = 0; report_num < dconf->num_reports; report_num++)
 	{
 #ifdef USE_YAFU_TDIV
@@ -171,13 +167,5 @@ void resieve_medprimes_32k(uint8 parity, uint32 poly_id, uint32 bnum,
 
 	}
 			
-#ifdef QS_TIMING
-	gettimeofday (&qs_timing_stop, NULL);
-	qs_timing_diff = my_difftime (&qs_timing_start, &qs_timing_stop);
-
-	TF_STG4 += ((double)qs_timing_diff->secs + (double)qs_timing_diff->usecs / 1000000);
-	free(qs_timing_diff);
-#endif
-
 	return;
 }
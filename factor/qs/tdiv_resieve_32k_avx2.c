@@ -18,6 +18,8 @@ code to the public domain.
 --bbuhrow@gmail.com 11/24/09
 ----------------------------------------------------------------------*/
 
+#define SIQS_KERNEL_AVX2
+#include "kernel_target.h"
 #include "common.h"
 
 #if defined( USE_AVX2 ) && defined (GCC_ASM64X)
@@ -423,10 +425,6 @@ void resieve_medprimes_32k_avx2(uint8 parity, uint32 poly_id, uint32 bnum,
         fbc = dconf->comp_sieve_p;
     }
 
-#ifdef QS_TIMING
-    gettimeofday(&qs_timing_start, NULL);
-#endif
-
 #ifdef USE_16X_RESIEVE_VEC
 
     // 16x trial division
@@ -731,14 +729,6 @@ void resieve_medprimes_32k_avx2(uint8 parity, uint32 poly_id, uint32 bnum,
 
     TDIV_MED_CLEAN;
 
-#ifdef QS_TIMING
-    gettimeofday(&qs_timing_stop, NULL);
-    qs_timing_diff = my_difftime(&qs_timing_start, &qs_timing_stop);
-
-    TF_STG4 += ((double)qs_timing_diff->secs + (double)qs_timing_diff->usecs / 1000000);
-    free(qs_timing_diff);
-#endif
-
     return;
 }
 
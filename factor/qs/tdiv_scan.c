@@ -384,6 +384,45 @@ this file contains code implementing 1)
 
 #define SCAN_MASK 0x8080808080808080ULL
 
+// the trial division shared by the scan routines below: reduce the 
+// reports the scan of this block left in dconf->reports to relations.  
+// prof_t is the clock at the start of the scan.
+static void tdiv_reports(uint32 blocknum, uint8 parity, uint64 prof_t,
+	static_conf_t *sconf, dynamic_conf_t *dconf)
+{
+	uint32 j;
+
+	if (dconf->num_reports >= MAX_SIEVE_REPORTS)
+		dconf->num_reports = MAX_SIEVE_REPORTS-1;
+
+    dconf->total_reports += dconf->num_reports;
+    dconf->total_blocks++;
+	QS_PROF_LAP(dconf, prof_t, QS_PROF_SCAN);
+
+	//remove small primes, and test if its worth continuing for each report
+	filter_SPV(parity, dconf->sieve, dconf->numB-1,blocknum,sconf,dconf);
+	QS_PROF_LAP(dconf, prof_t, QS_PROF_TDIV_SMALL);
+	tdiv_med_ptr(parity, dconf->numB-1,blocknum,sconf,dconf);
+	QS_PROF_LAP(dconf, prof_t, QS_PROF_TDIV_MED);
+	resieve_med_ptr(parity, dconf->numB-1,blocknum,sconf,dconf);
+	QS_PROF_LAP(dconf, prof_t, QS_PROF_RESIEVE);
+
+	// factor all reports in this block
+	for (j=0; j<dconf->num_reports; j++)
+	{
+		if (dconf->valid_Qs[j])
+		{
+            dconf->total_surviving_reports++;
+			tdiv_LP(j, parity, blocknum, sconf, dconf);
+			QS_PROF_LAP(dconf, prof_t, QS_PROF_TDIV_LP);
+			trial_divide_Q_siqs(j, parity, dconf->numB-1, blocknum,sconf,dconf);
+			QS_PROF_LAP(dconf, prof_t, QS_PROF_RESIDUE);
+		}
+	}
+
+	return;
+}
+
 	//when we compress small primes into 16 bits of a 32 bit field, the
 	//trick of fooling the sieve routine to not sieve those roots which
 	//divide poly_a fails when the blocksize is 2^16, because we're doing this:
@@ -423,10 +462,12 @@ int check_relations_siqs_1(uint32 blocknum, uint8 parity,
 	uint32 j,k,it=sconf->qs_blocksize>>3;
 	uint32 thisloc;
 	uint64 *sieveblock;
+	uint64 prof_t = 0;
 	uint64 mask = SCAN_MASK;
 
 	sieveblock = (uint64 *)dconf->sieve;
 	dconf->num_reports = 0;
+	QS_PROF_START(dconf, prof_t);
 
 	//check for relations
 	for (j=0;j<it;j++)
@@ -453,27 +494,7 @@ int check_relations_siqs_1(uint32 blocknum, uint8 parity,
 		}
 	}
 
-	if (dconf->num_reports >= MAX_SIEVE_REPORTS)
-		dconf->num_reports = MAX_SIEVE_REPORTS-1;
-
-    dconf->total_reports += dconf->num_reports;
-    dconf->total_blocks++;
-
-	//remove small primes, and test if its worth continuing for each report
-	filter_SPV(parity, dconf->sieve, dconf->numB-1,blocknum,sconf,dconf);
-	tdiv_med_ptr(parity, dconf->numB-1,blocknum,sconf,dconf);
-	resieve_med_ptr(parity, dconf->numB-1,blocknum,sconf,dconf);
-
-	// factor all reports in this block
-	for (j=0; j<dconf->num_reports; j++)
-	{
-		if (dconf->valid_Qs[j])
-		{
-            dconf->total_surviving_reports++;
-			tdiv_LP(j, parity, blocknum, sconf, dconf);
-			trial_divide_Q_siqs(j, parity, dconf->numB-1, blocknum,sconf,dconf);
-		}
-	}
+	tdiv_reports(blocknum, parity, prof_t, sconf, dconf);
 
 	return 0;
 }
@@ -486,9 +507,11 @@ int check_relations_siqs_4(uint32 blocknum, uint8 parity,
 	uint32 i,j,it=sconf->qs_blocksize>>3;
 	uint32 thisloc;
 	uint64 *sieveblock;
+	uint64 prof_t = 0;
 
 	sieveblock = (uint64 *)dconf->sieve;
 	dconf->num_reports = 0;
+	QS_PROF_START(dconf, prof_t);
 
 
 #ifdef SIMD_SIEVE_SCAN_VEC
@@ -617,27 +640,7 @@ int check_relations_siqs_4(uint32 blocknum, uint8 parity,
 #endif
 
 
-	if (dconf->num_reports >= MAX_SIEVE_REPORTS)
-		dconf->num_reports = MAX_SIEVE_REPORTS-1;
-
-    dconf->total_reports += dconf->num_reports;
-    dconf->total_blocks++;
-
-	//remove small primes, and test if its worth continuing for each report
-	filter_SPV(parity, dconf->sieve,dconf->numB-1,blocknum,sconf,dconf);
-	tdiv_med_ptr(parity, dconf->numB-1,blocknum,sconf,dconf);
-	resieve_med_ptr(parity, dconf->numB-1,blocknum,sconf,dconf);
-
-	// factor all reports in this block
-	for (j=0; j<dconf->num_reports; j++)
-	{
-		if (dconf->valid_Qs[j])
-		{
-            dconf->total_surviving_reports++;
-			tdiv_LP(j, parity, blocknum, sconf, dconf);
-			trial_divide_Q_siqs(j, parity, dconf->numB-1, blocknum,sconf,dconf);
-		}
-	}
+	tdiv_reports(blocknum, parity, prof_t, sconf, dconf);
 
 	return 0;
 }
@@ -649,9 +652,11 @@ int check_relations_siqs_8(uint32 blocknum, uint8 parity,
 	uint32 i,j,it=sconf->qs_blocksize>>3;
 	uint32 thisloc;
 	uint64 *sieveblock;
+	uint64 prof_t = 0;
 
 	sieveblock = (uint64 *)dconf->sieve;
 	dconf->num_reports = 0;
+	QS_PROF_START(dconf, prof_t);
 
 #ifdef SIMD_SIEVE_SCAN_VEC
 
@@ -780,27 +785,7 @@ int check_relations_siqs_8(uint32 blocknum, uint8 parity,
 #endif
 
 
-	if (dconf->num_reports >= MAX_SIEVE_REPORTS)
-		dconf->num_reports = MAX_SIEVE_REPORTS-1;
-
-    dconf->total_reports += dconf->num_reports;
-    dconf->total_blocks++;
-
-	//remove small primes, and test if its worth continuing for each report
-	filter_SPV(parity, dconf->sieve, dconf->numB-1, blocknum,sconf,dconf);
-	tdiv_med_ptr(parity, dconf->numB-1,blocknum,sconf,dconf);
-	resieve_med_ptr(parity, dconf->numB-1,blocknum,sconf,dconf);
-
-	// factor all reports in this block
-	for (j=0; j<dconf->num_reports; j++)
-	{
-		if (dconf->valid_Qs[j])
-		{
-            dconf->total_surviving_reports++;
-			tdiv_LP(j, parity, blocknum, sconf, dconf);
-			trial_divide_Q_siqs(j, parity, dconf->numB-1, blocknum,sconf,dconf);
-		}
-	}
+	tdiv_reports(blocknum, parity, prof_t, sconf, dconf);
 
 	return 0;
 }
@@ -813,9 +798,11 @@ int check_relations_siqs_16(uint32 blocknum, uint8 parity,
     uint32 i, j, it = sconf->qs_blocksize >> 3;
     uint32 thisloc;
     uint64 *sieveblock;
+    uint64 prof_t = 0;
 
     sieveblock = (uint64 *)dconf->sieve;
     dconf->num_reports = 0;
+    QS_PROF_START(dconf, prof_t);
 
 #ifdef SIMD_SIEVE_SCAN_VEC
 
@@ -946,27 +933,7 @@ int check_relations_siqs_16(uint32 blocknum, uint8 parity,
 #endif	
 
 
-	if (dconf->num_reports >= MAX_SIEVE_REPORTS)
-		dconf->num_reports = MAX_SIEVE_REPORTS-1;
-
-    dconf->total_reports += dconf->num_reports;
-    dconf->total_blocks++;
-
-	//remove small primes, and test if its worth continuing for each report
-	filter_SPV(parity, dconf->sieve, dconf->numB-1,blocknum,sconf,dconf);
-	tdiv_med_ptr(parity, dconf->numB-1,blocknum,sconf,dconf);
-	resieve_med_ptr(parity, dconf->numB-1,blocknum,sconf,dconf);
-
-	// factor all reports in this block
-	for (j=0; j<dconf->num_reports; j++)
-	{
-		if (dconf->valid_Qs[j])
-		{
-            dconf->total_surviving_reports++;
-			tdiv_LP(j, parity, blocknum, sconf, dconf);
-			trial_divide_Q_siqs(j, parity, dconf->numB-1, blocknum,sconf,dconf);
-		}
-	}
+	tdiv_reports(blocknum, parity, prof_t, sconf, dconf);
 
 	return 0;
 }
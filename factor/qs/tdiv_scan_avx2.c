@@ -0,0 +1,36 @@
+/*----------------------------------------------------------------------
+This source distribution is placed in the public domain by its author,
+Ben Buhrow. You may use it for any purpose, free of charge,
+without having to notify anyone. I disclaim any responsibility for any
+errors.
+
+Optionally, please be nice and tell me if you find this source to be
+useful. Again optionally, if you add to the functionality present here
+please consider making those additions public too, so that others may 
+benefit from your work.	
+
+Some parts of the code (and also this header), included in this 
+distribution have been reused from other sources. In particular I 
+have benefitted greatly from the work of Jason Papadopoulos's msieve @ 
+www.boo.net/~jasonp, Scott Contini's mpqs implementation, and Tom St. 
+Denis Tom's Fast Math library.  Many thanks to their kind donation of 
+code to the public domain.
+       				   --bbuhrow@gmail.com 11/24/09
+----------------------------------------------------------------------*/
+
+// the sieve scan for avx2 cpus in fat builds: tdiv_scan.c again, built
+// for the avx2 target with the check_relations_siqs_* routines renamed.
+// non-fat builds get the same code by building tdiv_scan.c with USE_AVX2.
+#define SIQS_KERNEL_AVX2
+#include "kernel_target.h"
+
+#if defined(SIQS_FAT) && defined(__GNUC__)
+
+#define check_relations_siqs_1 check_relations_siqs_1_avx2
+#define check_relations_siqs_4 check_relations_siqs_4_avx2
+#define check_relations_siqs_8 check_relations_siqs_8_avx2
+#define check_relations_siqs_16 check_relations_siqs_16_avx2
+
+#include "tdiv_scan.c"
+
+#endif
@@ -68,7 +68,7 @@ void nextRoots_32k(static_conf_t *sconf, dynamic_conf_t *dconf)
 	numblocks = sconf->num_blocks;
 	interval = numblocks << 15;
 	
-	if (lp_bucket_p->alloc_slices != 0) // != NULL)
+	if ((lp_bucket_p->alloc_slices != 0) && (dconf->poly_batch < 2))
 	{
 		lp_bucket_p->fb_bounds[0] = med_B;
 
@@ -101,9 +101,6 @@ void nextRoots_32k(static_conf_t *sconf, dynamic_conf_t *dconf)
 
 	if (sign > 0)
 	{
-#ifdef QS_TIMING
-		gettimeofday(&qs_timing_start, NULL);
-#endif
 
 		for (j=startprime;j<sconf->sieve_small_fb_start;j++,ptr++)
 		{
@@ -290,15 +287,10 @@ void nextRoots_32k(static_conf_t *sconf, dynamic_conf_t *dconf)
 			}
 		}
 
-#ifdef QS_TIMING
-		gettimeofday (&qs_timing_stop, NULL);
-		qs_timing_diff = my_difftime (&qs_timing_start, &qs_timing_stop);
-
-		POLY_STG2 += ((double)qs_timing_diff->secs + (double)qs_timing_diff->usecs / 1000000);
-		free(qs_timing_diff);
-
-		gettimeofday(&qs_timing_start, NULL);
-#endif
+		// with batched root updates, the bucket sieved primes are
+		// done a few polys at a time by nextRoots_32k_batch
+		if (dconf->poly_batch > 1)
+			return;
 
 		bound_index = 0;
 		bound_val = med_B;
@@ -653,16 +645,6 @@ void nextRoots_32k(static_conf_t *sconf, dynamic_conf_t *dconf)
 
 #endif
 
-#ifdef QS_TIMING
-		gettimeofday (&qs_timing_stop, NULL);
-		qs_timing_diff = my_difftime (&qs_timing_start, &qs_timing_stop);
-
-		POLY_STG3 += ((double)qs_timing_diff->secs + (double)qs_timing_diff->usecs / 1000000);
-		free(qs_timing_diff);
-
-		gettimeofday(&qs_timing_start, NULL);
-#endif
-			
 		
 #if defined(USE_POLY_SSE2_ASM) && defined(GCC_ASM64X) && !defined(PROFILING)
 		logp = update_data.logp[large_B-1];
@@ -988,22 +970,10 @@ void nextRoots_32k(static_conf_t *sconf, dynamic_conf_t *dconf)
 
 #endif
 
-#ifdef QS_TIMING
-		gettimeofday (&qs_timing_stop, NULL);
-		qs_timing_diff = my_difftime (&qs_timing_start, &qs_timing_stop);
-
-		POLY_STG4 += ((double)qs_timing_diff->secs + (double)qs_timing_diff->usecs / 1000000);
-		free(qs_timing_diff);
-#endif
-
 	}
 	else
 	{
 
-#ifdef QS_TIMING
-		gettimeofday(&qs_timing_start, NULL);
-#endif
-
 		for (j=startprime;j<sconf->sieve_small_fb_start;j++,ptr++)
 		{
 			prime = update_data.prime[j];
@@ -1190,15 +1160,10 @@ void nextRoots_32k(static_conf_t *sconf, dynamic_conf_t *dconf)
 			}
 		}	
 
-#ifdef QS_TIMING
-		gettimeofday (&qs_timing_stop, NULL);
-		qs_timing_diff = my_difftime (&qs_timing_start, &qs_timing_stop);
-
-		POLY_STG2 += ((double)qs_timing_diff->secs + (double)qs_timing_diff->usecs / 1000000);
-		free(qs_timing_diff);
-
-		gettimeofday(&qs_timing_start, NULL);
-#endif
+		// with batched root updates, the bucket sieved primes are
+		// done a few polys at a time by nextRoots_32k_batch
+		if (dconf->poly_batch > 1)
+			return;
 
 		bound_index = 0;
 		bound_val = med_B;
@@ -1551,16 +1516,6 @@ void nextRoots_32k(static_conf_t *sconf, dynamic_conf_t *dconf)
 
 #endif
 
-#ifdef QS_TIMING
-		gettimeofday (&qs_timing_stop, NULL);
-		qs_timing_diff = my_difftime (&qs_timing_start, &qs_timing_stop);
-
-		POLY_STG3 += ((double)qs_timing_diff->secs + (double)qs_timing_diff->usecs / 1000000);
-		free(qs_timing_diff);
-
-		gettimeofday(&qs_timing_start, NULL);
-#endif
-
 		
 #if defined(USE_POLY_SSE2_ASM) && defined(GCC_ASM64X) && !defined(PROFILING)
 		logp = update_data.logp[large_B-1];
@@ -1886,14 +1841,6 @@ void nextRoots_32k(static_conf_t *sconf, dynamic_conf_t *dconf)
 
 #endif
 
-#ifdef QS_TIMING
-		gettimeofday (&qs_timing_stop, NULL);
-		qs_timing_diff = my_difftime (&qs_timing_start, &qs_timing_stop);
-
-		POLY_STG4 += ((double)qs_timing_diff->secs + (double)qs_timing_diff->usecs / 1000000);
-		free(qs_timing_diff);
-#endif
-
 	}
 
 	if (lp_bucket_p->list != NULL)
@@ -1904,3 +1851,188 @@ void nextRoots_32k(static_conf_t *sconf, dynamic_conf_t *dconf)
 
 	return;
 }
+
+//one set of buckets being filled by nextRoots_32k_batch, with
+//the running state that nextRoots_32k keeps in locals
+typedef struct
+{
+	lp_bucket *b;
+	uint32 *sliceptr_p;
+	uint32 *sliceptr_n;
+	uint32 *numptr_p;
+	uint32 *numptr_n;
+	int *updates;		//the row of rootupdates for this poly
+	char sign;			//direction of the update for this poly
+	uint32 bound_val;
+	uint32 check_bound;
+	int bound_index;
+	uint8 logp;
+} batch_set_t;
+
+static INLINE void batch_next_slice(batch_set_t *s, uint32 j, uint32 numblocks)
+{
+	s->b->logp[s->bound_index] = s->logp;
+	s->bound_index++;
+	s->b->fb_bounds[s->bound_index] = j;
+	s->bound_val = j;
+	s->sliceptr_p += (numblocks << (BUCKET_BITS + 1));
+	s->sliceptr_n += (numblocks << (BUCKET_BITS + 1));
+	s->numptr_p += (numblocks << 1);
+	s->numptr_n += (numblocks << 1);
+	s->check_bound += BUCKET_ALLOC >> 1;
+}
+
+static INLINE void batch_check_slice(batch_set_t *s, uint32 j, 
+	uint32 numblocks, uint8 *logp)
+{
+	//CHECK_NEW_SLICE, for one set of buckets
+	uint32 k, room;
+
+	if (j >= s->check_bound)
+	{
+		room = 0;
+		for (k = 0; k < numblocks; k++)
+		{
+			if (s->numptr_p[k] > room)
+				room = s->numptr_p[k];
+			if (s->numptr_n[k] > room)
+				room = s->numptr_n[k];
+		}
+		room = BUCKET_ALLOC - room;
+
+		if (room < 32)
+		{
+			s->logp = logp[j];
+			batch_next_slice(s, j, numblocks);
+		}
+		else
+			s->check_bound += room >> 1;
+	}
+	else if ((j - s->bound_val) >= 65536)
+		batch_next_slice(s, j, numblocks);
+}
+
+static INLINE void batch_fill(uint32 *sliceptr, uint32 *numptr, 
+	uint32 root, uint32 prime, uint32 interval, uint32 entry)
+{
+	//bucket every hit of one root in the interval.  primes bigger
+	//than the interval go around this at most once
+	while (root < interval)
+	{
+		uint32 bnum = root >> 15;
+
+		sliceptr[(bnum << BUCKET_BITS) + numptr[bnum]] = entry | (root & 32767);
+		numptr[bnum]++;
+		root += prime;
+	}
+}
+
+void nextRoots_32k_batch(static_conf_t *sconf, dynamic_conf_t *dconf)
+{
+	//called after nextRoots_ptr when dconf->poly_batch > 1.  In that
+	//case nextRoots_* only updates the primes below med_B.  The bucket
+	//sieved primes are updated here for the next several polys at 
+	//once: each prime and its roots are loaded once, stepped through 
+	//the gray code a poly at a time, and the hits for each poly go into
+	//that poly's set of buckets.  The calls in between just move on to
+	//the next set.  Root updates and bucket fills are the bulk of the
+	//poly time for big inputs, mostly spent moving the fb through cache.
+	update_t update_data = dconf->update_data;
+	batch_set_t sets[QS_MAX_POLY_BATCH];
+	uint32 bound = sconf->factor_base->B;
+	uint32 med_B = sconf->factor_base->med_B;
+	uint32 numblocks = sconf->num_blocks;
+	uint32 interval = numblocks << 15;
+	uint32 j, t, len;
+
+	if (++dconf->batch_pos < dconf->batch_len)
+	{
+		dconf->buckets = dconf->bucket_sets + dconf->batch_pos;
+		return;
+	}
+
+	//the large prime roots are those of poly numB.  Fill sets for 
+	//numB+1 on, as far as the gray code for this 'a' goes
+	len = dconf->maxB - dconf->numB;
+	if (len > dconf->poly_batch)
+		len = dconf->poly_batch;
+	if (len < 1)
+		len = 1;
+
+	for (t = 0; t < len; t++)
+	{
+		batch_set_t *s = sets + t;
+		lp_bucket *b = dconf->bucket_sets + t;
+		char v = dconf->curr_poly->nu[dconf->numB + t];
+
+		s->b = b;
+		s->updates = dconf->rootupdates + (v - 1) * bound;
+		s->sign = dconf->curr_poly->gray[dconf->numB + t];
+		s->sliceptr_p = b->list;
+		s->sliceptr_n = b->list + (numblocks << BUCKET_BITS);
+		s->numptr_p = b->num;
+		s->numptr_n = b->num + numblocks;
+		s->bound_val = med_B;
+		s->check_bound = med_B + BUCKET_ALLOC/2;
+		s->bound_index = 0;
+		s->logp = update_data.logp[med_B - 1];
+
+		b->fb_bounds[0] = med_B;
+		memset(b->num, 0, 2 * numblocks * b->alloc_slices * sizeof(uint32));
+	}
+
+	for (j = med_B; j < bound; j++)
+	{
+		int prime = (int)update_data.prime[j];
+		int root1 = update_data.firstroots1[j];
+		int root2 = update_data.firstroots2[j];
+
+		for (t = 0; t < len; t++)
+		{
+			batch_set_t *s = sets + t;
+			int update = s->updates[j];
+			uint32 entry;
+
+			batch_check_slice(s, j, numblocks, update_data.logp);
+
+			if (s->sign > 0)
+			{
+				root1 -= update;
+				root2 -= update;
+				if (root1 < 0)
+					root1 += prime;
+				if (root2 < 0)
+					root2 += prime;
+			}
+			else
+			{
+				root1 += update;
+				root2 += update;
+				if (root1 >= prime)
+					root1 -= prime;
+				if (root2 >= prime)
+					root2 -= prime;
+			}
+
+			entry = (j - s->bound_val) << 16;
+			batch_fill(s->sliceptr_p, s->numptr_p, root1, prime, interval, entry);
+			batch_fill(s->sliceptr_p, s->numptr_p, root2, prime, interval, entry);
+			batch_fill(s->sliceptr_n, s->numptr_n, prime - root1, prime, interval, entry);
+			batch_fill(s->sliceptr_n, s->numptr_n, prime - root2, prime, interval, entry);
+		}
+
+		update_data.firstroots1[j] = root1;
+		update_data.firstroots2[j] = root2;
+	}
+
+	for (t = 0; t < len; t++)
+	{
+		sets[t].b->num_slices = sets[t].bound_index + 1;
+		sets[t].b->logp[sets[t].bound_index] = sets[t].logp;
+	}
+
+	dconf->batch_pos = 0;
+	dconf->batch_len = len;
+	dconf->buckets = dconf->bucket_sets;
+	return;
+}
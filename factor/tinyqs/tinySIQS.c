@@ -102,6 +102,7 @@ void tinySIQS(mpz_t n, mpz_t *factors, uint32 *num_factors)
 	tiny_static_init(static_conf, n);
 	static_conf->in_mem = 1;
 	static_conf->is_tiny = 1;
+	static_conf->writer = NULL;
 
 	//allocate structures for use in sieving with threads
 	tiny_dynamic_init(dconf, static_conf);
@@ -223,9 +224,8 @@ int free_tiny(static_conf_t *sconf, dynamic_conf_t *dconf)
 		mpz_clear(sconf->poly_a_list[i]);
 	free(sconf->poly_a_list);
 
-	for (i=0; i<dconf->buffered_rels; i++)
-		free(dconf->relation_buf[i].fb_offsets);
 	free(dconf->relation_buf);
+	qs_arena_free(&dconf->rel_arena);
 
 	return 0;
 }
@@ -1041,8 +1041,10 @@ int tiny_dynamic_init(dynamic_conf_t *dconf, static_conf_t *sconf)
 	dconf->relation_buf = (siqs_r *)malloc(32768 * sizeof(siqs_r));
 	dconf->buffered_rel_alloc = 32768;
 	dconf->buffered_rels = 0;
+	qs_arena_init(&dconf->rel_arena);
 
 	//allocate the sieving factor bases
+	memset(dconf->page_bytes, 0, HUGE_PAGE_KINDS * sizeof(uint64));
 	dconf->comp_sieve_p = (sieve_fb_compressed *)malloc(sizeof(sieve_fb_compressed));
 	dconf->comp_sieve_n = (sieve_fb_compressed *)malloc(sizeof(sieve_fb_compressed));
 
@@ -1064,26 +1066,26 @@ int tiny_dynamic_init(dynamic_conf_t *dconf, static_conf_t *sconf)
 	dconf->comp_sieve_n->logp = (uint16 *)xmalloc_align(
 		(size_t)(sconf->factor_base->med_B * sizeof(uint16)));
 
-	dconf->fb_sieve_p = (sieve_fb *)xmalloc_align(
+	dconf->fb_sieve_p = (sieve_fb *)qs_big_alloc(dconf,
 		(size_t)(sconf->factor_base->B * sizeof(sieve_fb)));
-	dconf->fb_sieve_n = (sieve_fb *)xmalloc_align(
+	dconf->fb_sieve_n = (sieve_fb *)qs_big_alloc(dconf,
 		(size_t)(sconf->factor_base->B * sizeof(sieve_fb)));
 	
 	dconf->update_data.sm_firstroots1 = (uint16 *)xmalloc_align(
 		(size_t)(sconf->factor_base->med_B * sizeof(uint16)));
 	dconf->update_data.sm_firstroots2 = (uint16 *)xmalloc_align(
 		(size_t)(sconf->factor_base->med_B * sizeof(uint16)));
-	dconf->update_data.firstroots1 = (int *)xmalloc_align(
+	dconf->update_data.firstroots1 = (int *)qs_big_alloc(dconf,
 		(size_t)(sconf->factor_base->B * sizeof(int)));
-	dconf->update_data.firstroots2 = (int *)xmalloc_align(
+	dconf->update_data.firstroots2 = (int *)qs_big_alloc(dconf,
 		(size_t)(sconf->factor_base->B * sizeof(int)));
-	dconf->update_data.prime = (uint32 *)xmalloc_align(
+	dconf->update_data.prime = (uint32 *)qs_big_alloc(dconf,
 		(size_t)(sconf->factor_base->B * sizeof(uint32)));
-	dconf->update_data.logp = (uint8 *)xmalloc_align(
+	dconf->update_data.logp = (uint8 *)qs_big_alloc(dconf,
 		(size_t)(sconf->factor_base->B * sizeof(uint8)));
-	dconf->rootupdates = (int *)xmalloc_align(
+	dconf->rootupdates = (int *)qs_big_alloc(dconf,
 		(size_t)(MAX_A_FACTORS * sconf->factor_base->B * sizeof(int)));
-	dconf->sm_rootupdates = (uint16 *)xmalloc_align(
+	dconf->sm_rootupdates = (uint16 *)qs_big_alloc(dconf,
 		(size_t)(MAX_A_FACTORS * sconf->factor_base->B * sizeof(uint16)));
 	
 	//allocate the sieve
@@ -1129,6 +1131,8 @@ int tiny_dynamic_init(dynamic_conf_t *dconf, static_conf_t *sconf)
 	dconf->buckets->list = NULL;
 	dconf->buckets->alloc_slices = 0;
 	dconf->buckets->num_slices = 0;
+	dconf->bucket_sets = dconf->buckets;
+	dconf->poly_batch = 1;
 
 	//used in trial division to mask out the fb_index portion of bucket entries, so that
 	//multiple block locations can be searched for in parallel using SSE2 instructions
@@ -38,7 +38,7 @@ code to the public domain.
 #define RIGHT 1
 #define LEFT 0
 
-#define NUM_FUNC 71
+#define NUM_FUNC 74
 
 //arbitrary precision calculator
 int process_expression(char *input_exp, fact_obj_t *fobj);
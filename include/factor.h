@@ -46,6 +46,16 @@ routines and bookkeeping */
 // stuff that needs to be visible to the msieve routines and 
 // the yafu sieve routines
 
+/* sieving parameters recorded in a siqs savefile header; a zero
+   multiplier means they were not recorded */
+typedef struct {
+	uint32 version;
+	uint32 multiplier;
+	uint32 fb_size;
+	uint32 large_prime_max;
+	uint32 dlp;
+} qs_savefile_params_t;
+
 /* structure encapsulating the savefile used in a factorization */
 typedef struct {
 
@@ -59,6 +69,8 @@ typedef struct {
 	char *name;
 	char *buf;
 	uint32 buf_off;
+	uint32 binary;		// nonzero for the binary relation format
+	qs_savefile_params_t params;	// header parameters, once read
 } qs_savefile_t;
 
 typedef struct {
@@ -248,6 +260,9 @@ typedef struct {
 #define SAVEFILE_READ 0x01
 #define SAVEFILE_WRITE 0x02
 #define SAVEFILE_APPEND 0x04
+#define QS_BIN_MAGIC "YQSB"
+#define QS_BIN_VERSION 1
+#define QS_MAX_POLY_BATCH 16	//largest -siqsbatch
 
 // factorization objects //
 
@@ -292,6 +307,7 @@ typedef struct
 
 	char ecm_path[1024];
 	int use_external;
+	int use_pipe;				//keep one external ecm process per thread, fed through pipes
 	uint32 B1;
 	uint64 B2;
 	int stg2_is_default;
@@ -350,6 +366,10 @@ typedef struct
 	mpz_t gmp_n;
 	qs_savefile_t savefile;		//savefile object
 	char siqs_savefile[1024];
+	int binary_savefile;		//start new savefiles in the binary format
+	char siqs_convert_file[1024];	//convert siqs_savefile to the other format here
+	int prof;					//-siqsprof: time the sieving stages
+	char prof_file[1024];		//and append the report to this file
 
 	double qs_exponent;
 	double qs_multiplier;
@@ -368,7 +388,14 @@ typedef struct
 	uint32 gbl_override_blocks;		//override the # of blocks used
 	int gbl_override_lpmult_flag;
 	uint32 gbl_override_lpmult;		//override the large prime multiplier
+	int gbl_override_la_density_flag;
+	uint32 gbl_override_la_density;	//target column weight of the merged matrix
+	int gbl_override_poly_batch_flag;
+	uint32 gbl_override_poly_batch;	//polys per batched large prime root update
+	int gbl_override_tfsmall_flag;
+	int gbl_override_tfsmall;		//add this many bits to the small prime variation cutoff
 	int gbl_force_DLP;
+	int gbl_force_TLP;
 
 	uint32 num_factors;			//number of factors found in this method
 	z *factors;					//array of bigint factors found in this method
@@ -377,6 +404,9 @@ typedef struct
 	double rels_per_sec;
 	double qs_time;
 	double total_time;
+	uint32 num_full;			//sieving results, as used by siqstune
+	uint32 num_partial;
+	uint32 pmax;
 
 } qs_obj_t;
 
@@ -541,7 +571,21 @@ uint32 qs_savefile_exists(qs_savefile_t *s);
 void qs_savefile_rewind(qs_savefile_t *s);
 void qs_savefile_read_line(char *buf, size_t max_len, qs_savefile_t *s);
 void qs_savefile_write_line(qs_savefile_t *s, char *buf);
+void qs_savefile_write_bytes(qs_savefile_t *s, uint8 *buf, uint32 len);
+uint32 qs_savefile_read_bytes(uint8 *buf, uint32 len, qs_savefile_t *s);
+int qs_savefile_read_n(char *filename, mpz_t n);
+int qs_savefile_read_header(char *filename, mpz_t n, qs_savefile_params_t *params);
+int qs_savefile_convert(char *infile, char *outfile);
+
+//default destination of the -siqsprof report
+#define QS_PROF_FILE "siqs_prof.json"
+
+//siqstune() writes the parameters it finds for this machine here,
+//and get_params uses them in place of the built in table
+#define QS_TUNE_FILE "siqs_tune.ini"
+int qs_load_tuned_params(char *fname);
 void qs_savefile_flush(qs_savefile_t *s);
+void qs_savefile_sync(qs_savefile_t *s);
 
 //#if defined(WIN32)
 // windows machines also need these declarations for functions located
@@ -611,5 +655,7 @@ int resume_check_input_match(mpz_t file_n, mpz_t input_n, mpz_t common_fact);
 uint32 factor_gnfs(msieve_obj *obj, mp_t *n, factor_list_t *factor_list);
 
 void factor_tune(fact_obj_t *fobj);
+double best_linear_fit(double *x, double *y, int numpts, 
+	double *slope, double *intercept);
 
 #endif //_FACTOR_H
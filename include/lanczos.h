@@ -24,13 +24,128 @@ Purpose:	Port into Yafu-1.14.
 extern "C" {
 #endif
 
+/* the Lanczos iteration works on QS_VBITS vectors at a
+   time, packed into one qs_v_t per matrix column. Each 
+   iteration finds about QS_VBITS dimensions of the solution
+   for one pass through the matrix, so wider vectors need 
+   fewer passes. The 128- and 256-bit widths do the vector
+   arithmetic in SSE2 and AVX2 registers. Override with
+   -DQS_VBITS=64, 128 or 256 */
+
+#ifndef QS_VBITS
+	#if defined(USE_AVX2)
+		#define QS_VBITS 256
+	#elif defined(__x86_64__) || defined(_WIN64)
+		#define QS_VBITS 128
+	#else
+		#define QS_VBITS 64
+	#endif
+#endif
+
+#if QS_VBITS != 64 && QS_VBITS != 128 && QS_VBITS != 256
+	#error "QS_VBITS must be 64, 128 or 256"
+#endif
+
+#define QS_VWORDS (QS_VBITS / 64)
+
+typedef struct {
+	uint64 w[QS_VWORDS];
+} qs_v_t;
+
+#if QS_VBITS == 256 && defined(USE_AVX2)
+	#include <immintrin.h>
+#elif QS_VBITS == 128
+	#include <emmintrin.h>
+#endif
+
+static INLINE qs_v_t qs_v_xor(qs_v_t a, qs_v_t b) {
+	qs_v_t r;
+#if QS_VBITS == 256 && defined(USE_AVX2)
+	_mm256_storeu_si256((__m256i *)r.w, _mm256_xor_si256(
+			_mm256_loadu_si256((__m256i *)a.w),
+			_mm256_loadu_si256((__m256i *)b.w)));
+#elif QS_VBITS == 128
+	_mm_storeu_si128((__m128i *)r.w, _mm_xor_si128(
+			_mm_loadu_si128((__m128i *)a.w),
+			_mm_loadu_si128((__m128i *)b.w)));
+#else
+	uint32 i;
+	for (i = 0; i < QS_VWORDS; i++)
+		r.w[i] = a.w[i] ^ b.w[i];
+#endif
+	return r;
+}
+
+static INLINE qs_v_t qs_v_and(qs_v_t a, qs_v_t b) {
+	qs_v_t r;
+#if QS_VBITS == 256 && defined(USE_AVX2)
+	_mm256_storeu_si256((__m256i *)r.w, _mm256_and_si256(
+			_mm256_loadu_si256((__m256i *)a.w),
+			_mm256_loadu_si256((__m256i *)b.w)));
+#elif QS_VBITS == 128
+	_mm_storeu_si128((__m128i *)r.w, _mm_and_si128(
+			_mm_loadu_si128((__m128i *)a.w),
+			_mm_loadu_si128((__m128i *)b.w)));
+#else
+	uint32 i;
+	for (i = 0; i < QS_VWORDS; i++)
+		r.w[i] = a.w[i] & b.w[i];
+#endif
+	return r;
+}
+
+static INLINE qs_v_t qs_v_or(qs_v_t a, qs_v_t b) {
+	qs_v_t r;
+	uint32 i;
+	for (i = 0; i < QS_VWORDS; i++)
+		r.w[i] = a.w[i] | b.w[i];
+	return r;
+}
+
+static INLINE qs_v_t qs_v_zero(void) {
+	qs_v_t r;
+	uint32 i;
+	for (i = 0; i < QS_VWORDS; i++)
+		r.w[i] = 0;
+	return r;
+}
+
+static INLINE qs_v_t qs_v_bit(uint32 b) {
+
+	/* the vector with only bit b set */
+
+	qs_v_t r = qs_v_zero();
+	r.w[b / 64] = (uint64)1 << (b % 64);
+	return r;
+}
+
+static INLINE uint32 qs_v_test(qs_v_t a, uint32 b) {
+	return (uint32)(a.w[b / 64] >> (b % 64)) & 1;
+}
+
+static INLINE uint32 qs_v_is_zero(qs_v_t a) {
+	uint64 t = 0;
+	uint32 i;
+	for (i = 0; i < QS_VWORDS; i++)
+		t |= a.w[i];
+	return t == 0;
+}
+
+static INLINE uint32 qs_v_is_all_ones(qs_v_t a) {
+	uint64 t = (uint64)(-1);
+	uint32 i;
+	for (i = 0; i < QS_VWORDS; i++)
+		t &= a.w[i];
+	return t == (uint64)(-1);
+}
+
 /* routines for cache-efficient multiplication of
    sparse matrices */
 
 /* the smallest number of columns that will be
    converted to packed format */
 
-#define QS_MIN_NCOLS_TO_PACK 18000
+#define QS_MIN_NCOLS_TO_PACK 8000
 
 /* the number of moderately dense rows that are
    packed less tightly */
@@ -89,8 +204,8 @@ typedef struct {
 				   dense_blocks[i] holds the i_th batch of
 				   64 matrix rows */
 	uint32 num_blocks;
-	uint64 *x;
-	uint64 *b;
+	qs_v_t *x;
+	qs_v_t *b;
 	qs_packed_block_t *blocks; /* sparse part of matrix, in block format */
 
 	/* fields for thread pool synchronization */
@@ -135,13 +250,20 @@ void yafu_packed_matrix_free(qs_packed_matrix_t *packed_matrix);
 
 size_t yafu_packed_matrix_sizeof(qs_packed_matrix_t *packed_matrix);
 
-void yafu_mul_MxN_Nx64(qs_packed_matrix_t *A, uint64 *x, uint64 *b);
+void yafu_mul_MxN_NxB(qs_packed_matrix_t *A, qs_v_t *x, qs_v_t *b);
+
+void yafu_mul_trans_MxN_NxB(qs_packed_matrix_t *A, qs_v_t *x, qs_v_t *b);
+
+void yafu_mul_NxB_BxB_acc(qs_v_t *v, qs_v_t *x, qs_v_t *y, uint32 n);
+
+void yafu_mul_BxN_NxB(qs_v_t *x, qs_v_t *y, qs_v_t *xy, uint32 n);
 
-void yafu_mul_trans_MxN_Nx64(qs_packed_matrix_t *A, uint64 *x, uint64 *b);
+/* the same products, where the left operand is one of
+   the 64-row blocks of dense matrix rows */
 
-void yafu_mul_Nx64_64x64_acc(uint64 *v, uint64 *x, uint64 *y, uint32 n);
+void yafu_mul_Nx64_64xB_acc(uint64 *v, qs_v_t *x, qs_v_t *y, uint32 n);
 
-void yafu_mul_64xN_Nx64(uint64 *x, uint64 *y, uint64 *xy, uint32 n);
+void yafu_mul_64xN_NxB(uint64 *x, qs_v_t *y, qs_v_t *xy, uint32 n);
 
 /* for big jobs, we use a multithreaded framework that calls
    these two routines for the heavy lifting */
@@ -36,6 +36,119 @@ static const poly_deadline_t time_limits[] = {
 
 #define NUM_TIME_LIMITS sizeof(time_limits)/sizeof(time_limits[0])
 
+// lattice sieving hands out the special-q range of each round in chunks 
+// from a work queue.  The first chunks split the round NFS_CHUNKS_PER_THREAD
+// ways per thread; after that chunks are sized from the measured special-q
+// rate to take about NFS_CHUNK_SECONDS each, but never less than 
+// NFS_MIN_CHUNK_Q special-q (each chunk is a new siever process).
+#define NFS_CHUNKS_PER_THREAD 4
+#define NFS_CHUNK_SECONDS 60
+#define NFS_MIN_CHUNK_Q 100
+
+// chunks finish out of special-q order, so the savefile alone doesn't say
+// where to resume.  each chunk whose relations have all been appended to
+// the savefile is recorded as a "start end" line in the savefile name 
+// plus NFS_QRANGE_EXT.  resuming starts at the first special-q not covered
+// and skips any completed chunks above it.
+#define NFS_QRANGE_EXT ".q"
+
+typedef struct
+{
+	uint32 *start;		// sorted, non-overlapping ranges [start, end)
+	uint32 *end;
+	uint32 num;
+} nfs_qranges_t;
+
+// while the sievers run, their output files are tailed every
+// NFS_INGEST_POLL_MS and new relations are appended to the savefile,
+// dropping any (a,b) pair that has already been seen this session
+#define NFS_INGEST_POLL_MS 1000
+#define NFS_RELSET_INIT_BITS 20
+
+// 64 bit file offsets, so that savefiles over 2GB can be read 
+// everywhere (long is 32 bits on win64)
+#if defined(WIN32) || defined(_WIN64)
+#define nfs_ftell64 _ftelli64
+#define nfs_fseek64 _fseeki64
+#else
+#define nfs_ftell64 ftello
+#define nfs_fseek64 fseeko
+#endif
+
+// a set of (a,b) pairs in an open-addressed table.  Each slot keeps the
+// pair itself and 32 bits of its hash as a quick first check (a zero tag
+// marks an empty slot)
+typedef struct
+{
+	int64 a;
+	uint32 b;
+	uint32 tag;
+} nfs_relset_slot_t;
+
+typedef struct
+{
+	nfs_relset_slot_t *slots;
+	uint32 bits;
+	uint32 count;
+	uint32 dups;		// relations dropped as duplicates
+	uint32 bad;			// lines that didn't parse as a relation
+} nfs_relset_t;
+
+// a background thread keeps the large ideals (primes above rlim/alim) of
+// every relation in memory and, each time the relation count has grown 
+// by NFS_BGFILT_RECHECK, repeats singleton removal on them.  once the 
+// excess of relations over large ideals covers the small ideals, plus
+// NFS_BGFILT_EXTRA, sieving stops and filtering is tried.
+#define NFS_BGFILT_POLL_MS 2000
+#define NFS_BGFILT_RECHECK 0.02
+#define NFS_BGFILT_EXTRA 200
+
+typedef struct
+{
+	// relations, as lists of large ideal ids (owned by the thread)
+	uint32 *rel_start;		// num_rels + 1 offsets into rel_ideals
+	uint32 num_rels;
+	size_t alloc_rels;
+	uint32 *rel_ideals;
+	size_t alloc_rel_ideals;
+
+	// map from (side, p, r) to ideal id
+	uint64 *ideal_keys;
+	uint32 *ideal_ids;
+	uint32 ideal_bits;
+	uint32 num_ideals;
+
+	// relations handed over by the master, waiting to be parsed.  this,
+	// and the master's relation set, are protected by lock.
+	char *pending;
+	size_t pending_len, pending_alloc;
+	nfs_relset_t *set;
+
+	// the relations in the savefile when we started are loaded in the 
+	// background too (up to load_limit)
+	char savefile[GSTR_MAXSIZE];
+	int64 load_limit;
+
+	uint32 rlim, alim;
+	double small_ideals;	// approx. number of ideals below rlim/alim
+	double need_mult;		// raised each time filtering fails anyway
+	uint32 last_pass_rels;
+
+	// results of the last singleton removal pass, read by the master
+	volatile uint32 est_rels, est_ideals;
+	volatile int loaded, ready, stop;
+
+#if defined(WIN32) || defined(_WIN64)
+	HANDLE thread_id;
+	HANDLE lock;
+	HANDLE wake_event;
+#else
+	pthread_t thread_id;
+	pthread_mutex_t lock;
+	pthread_cond_t wake_cond;
+#endif
+} nfs_bgfilt_t;
+
 enum nfs_thread_command {
 	NFS_COMMAND_INIT,
 	NFS_COMMAND_WAIT,
@@ -169,6 +282,8 @@ typedef struct
 	uint32 poly_time;
 	uint32 last_leading_coeff;
 	uint32 use_max_rels;
+	nfs_relset_t *relset; // (a,b) pairs ingested so far, NULL until sieving
+	nfs_bgfilt_t *bgfilt; // background filtering, NULL until sieving
 
 	snfs_t* snfs; // NULL if GNFS
 } nfs_job_t;
@@ -176,6 +291,8 @@ typedef struct
 typedef struct {
 	// stuff for parallel ggnfs sieving
 	char outfilename[80];
+	long tail_pos;		// how much of outfilename has been ingested
+	int finished;		// did the siever run its whole range?
 	nfs_job_t job;
 	uint32 siever;
 
@@ -191,6 +308,7 @@ typedef struct {
 
 	int tindex;
 	int is_poly_select;
+	int is_queued;		// report completion through the work queue
 
 	/* fields for thread pool synchronization */
 	volatile enum nfs_thread_command command;
@@ -237,10 +355,25 @@ void get_polysearch_params(fact_obj_t *fobj, uint64 *start, uint64 *range);
 void init_poly_threaddata(nfs_threaddata_t *t, msieve_obj *obj, 
 	mp_t *mpN, factor_list_t *factor_list, int tid, uint32 flags, uint64 start, uint64 stop);
 void do_sieving(fact_obj_t *fobj, nfs_job_t *job);
+void nfs_qranges_load(fact_obj_t *fobj, nfs_qranges_t *r);
+void nfs_qranges_free(nfs_qranges_t *r);
+uint32 nfs_qranges_resume(nfs_qranges_t *r);
 void trial_sieve(fact_obj_t* fobj); // external test sieve frontend
 int test_sieve(fact_obj_t* fobj, void* args, int njobs, int are_files);
 void savefile_concat(char *filein, char *fileout, msieve_obj *mobj);
 void win_file_concat(char *filein, char *fileout);
+nfs_relset_t *nfs_relset_new(void);
+void nfs_relset_free(nfs_relset_t *set);
+int nfs_relset_insert(nfs_relset_t *set, int64 a, uint32 b);
+int nfs_parse_ab(char *line, int64 *a, uint32 *b, char **rest);
+uint32 nfs_ingest_rels(char *filein, long *pos, int final, 
+	nfs_relset_t *set, nfs_bgfilt_t *filt, msieve_obj *mobj);
+nfs_bgfilt_t *nfs_bgfilt_start(fact_obj_t *fobj, nfs_job_t *job);
+void nfs_bgfilt_stop(nfs_bgfilt_t *filt);
+void nfs_bgfilt_lock(nfs_bgfilt_t *filt);
+void nfs_bgfilt_unlock(nfs_bgfilt_t *filt);
+void nfs_bgfilt_add(nfs_bgfilt_t *filt, char *line);
+void nfs_bgfilt_retry(nfs_bgfilt_t *filt, double nudge);
 void nfs_stop_worker_thread(nfs_threaddata_t *t,
 				uint32 is_master_thread);
 void nfs_start_worker_thread(nfs_threaddata_t *t, 
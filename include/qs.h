@@ -44,37 +44,61 @@ code to the public domain.
 
 
 #if defined(USE_AVX2)
-#define CLEAN_AVX2 __asm__ volatile ("vzeroupper   \n\t");
+// vzeroupper wipes the upper half of every ymm register, so say so;
+// otherwise gcc may keep packed pointers in a ymm register across it.
+#define CLEAN_AVX2 __asm__ volatile ("vzeroupper   \n\t" ::: \
+    "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7", \
+    "xmm8", "xmm9", "xmm10", "xmm11", "xmm12", "xmm13", "xmm14", "xmm15");
 #endif
 
 #if defined(USE_AVX2) || defined(USE_SSE41)
 #define USE_VEC_SQUFOF
 #endif
 
-//#define HAVE_CUDA
-//#define QS_TIMING
-
-#ifdef QS_TIMING
-struct timeval qs_timing_start, qs_timing_stop;
-TIME_DIFF *qs_timing_diff;
-double START;
-double TF_STG1;
-double TF_STG2;
-double TF_STG3;
-double TF_STG4;
-double TF_STG5;
-double TF_STG6;
-double POLY_STG0;
-double POLY_STG1;
-double POLY_STG2;
-double POLY_STG3;
-double POLY_STG4;
-double SIEVE_STG1;
-double SIEVE_STG2;
-double COUNT;
-double TF_SPECIAL;
+// which of the sse4.1 and avx2 siqs kernels this binary carries: those
+// of the instruction set it was built for, or all of them in a fat build
+// (make FAT=1, see factor/qs/kernel_target.h).  siqs_static_init picks
+// among them with HAS_SSE41 and HAS_AVX2.
+#if defined(USE_AVX2) || (defined(SIQS_FAT) && defined(__GNUC__))
+#define SIQS_AVX2_KERNELS
+#endif
+
+#if defined(USE_SSE41) || (defined(SIQS_FAT) && defined(__GNUC__))
+#define SIQS_SSE41_KERNELS
 #endif
 
+//#define HAVE_CUDA
+
+// -siqsprof: sieving time by stage, in yafu_read_clock cycles.  each 
+// thread counts into its own dconf->prof, so nothing is shared while
+// sieving; the counts are summed into sconf->prof as the threads are 
+// stopped and reported by update_final.  when profiling is off the
+// cost is one test of do_prof per stage.
+enum qs_prof_stage {
+	QS_PROF_ROOTS,			// poly a and b setup, root updates
+	QS_PROF_MED_SIEVE,		// small and medium prime sieving
+	QS_PROF_LP_SIEVE,		// emptying the large prime buckets into the sieve
+	QS_PROF_SCAN,			// scanning the sieve for reports
+	QS_PROF_TDIV_SMALL,		// small prime variation check, small prime tdiv
+	QS_PROF_TDIV_MED,		// medium prime tdiv
+	QS_PROF_RESIEVE,		// medium prime resieving
+	QS_PROF_TDIV_LP,		// large prime tdiv from the buckets
+	QS_PROF_RESIDUE,		// splitting and buffering the leftover cofactors
+	QS_PROF_SQUFOF,			// vector squfof
+	QS_PROF_MERGE,			// merging thread results into the master lists
+	QS_PROF_STAGES
+};
+
+#define QS_PROF_START(conf, t) \
+	do { if ((conf)->do_prof) (t) = yafu_read_clock(); } while (0)
+
+// charge the cycles since t to stage, and restart t
+#define QS_PROF_LAP(conf, t, stage) \
+	do { if ((conf)->do_prof) { \
+		uint64 _now = yafu_read_clock(); \
+		(conf)->prof[stage] += _now - (t); \
+		(t) = _now; } } while (0)
+
 
 /************************* Common types and functions *****************/
 
@@ -187,7 +211,7 @@ typedef struct
 /************************* SIQS types and functions *****************/
 typedef struct
 {
-	uint32 large_prime[2];		//large prime in the pd.
+	uint32 large_prime[3];		//large primes in the pd (1 if unused).
 	uint32 sieve_offset;		//offset specifying Q (the quadratic polynomial)
 	uint32 poly_idx;			//which poly this relation uses
 	uint32 parity;				//the sign of the offset (x) 0 is positive, 1 is negative
@@ -196,6 +220,97 @@ typedef struct
 	uint32 num_factors;			//number of factor base factors in the factorization of Q
 } siqs_r;
 
+/* relation factor lists are carved out of large blocks of
+   storage rather than malloc'ed one at a time.  Blocks are kept
+   around when the arena is reset, so once a thread's arena has
+   grown to its working size sieving does no more allocation */
+
+#define QS_ARENA_BLOCK_WORDS 262144
+
+typedef struct
+{
+	uint32 **blocks;			//list of blocks of QS_ARENA_BLOCK_WORDS words
+	uint32 num_blocks;			//number of blocks allocated
+	uint32 curr_block;			//block currently being handed out
+	uint32 used;				//words used in the current block
+} qs_arena_t;
+
+/* relations bound for the savefile are handed from the master
+   thread to a writer thread through a single-producer, single-
+   consumer ring, so that formatting and disk I/O never hold up
+   the merging of new relations.  The writer flushes (and syncs) 
+   the savefile at most every QS_WRITER_SYNC_SECONDS */
+
+#if defined(WIN32) || defined(_WIN64)
+#define QS_BARRIER() MemoryBarrier()
+#else
+#define QS_BARRIER() __sync_synchronize()
+#endif
+
+/* shared counters updated by several threads; both return 
+   the new value */
+#if defined(WIN32) || defined(_WIN64)
+#define QS_ATOMIC_INC(x) InterlockedIncrement((volatile LONG *)(x))
+#define QS_ATOMIC_DEC(x) InterlockedDecrement((volatile LONG *)(x))
+#else
+#define QS_ATOMIC_INC(x) __sync_add_and_fetch((x), 1)
+#define QS_ATOMIC_DEC(x) __sync_sub_and_fetch((x), 1)
+#endif
+
+#define QS_WRITER_SLOTS 8192
+#define QS_WRITER_SYNC_SECONDS 10
+
+typedef struct
+{
+	uint32 type;				//'A' or 'R'
+	siqs_r rel;					//a relation, with fb_offsets in data.fb
+	uint32 a_words;				//size of a poly 'a' value in data.a
+	union {
+		uint32 fb[MAX_SMOOTH_PRIMES];
+		uint32 a[MAX_SMOOTH_PRIMES];	//a poly 'a' value, least significant word first
+	} data;
+} qs_writer_rec_t;
+
+typedef struct
+{
+	qs_writer_rec_t *slots;
+	volatile uint32 head;		//next slot to fill, advanced only by the master
+	volatile uint32 tail;		//next slot to write, advanced only by the writer
+	volatile int done;			//set by the master when no more records will come
+	qs_savefile_t *savefile;
+	mpz_t a;
+
+	//each side sleeps until the other has made the ring 
+	//non-empty (or done) or non-full
+#if defined(WIN32) || defined(_WIN64)
+	HANDLE thread_id;
+	HANDLE not_empty;
+	HANDLE not_full;
+#else
+	pthread_t thread_id;
+	pthread_mutex_t lock;
+	pthread_cond_t not_empty;
+	pthread_cond_t not_full;
+#endif
+} qs_writer_t;
+
+/* a savefile mapped into memory, so that the filtering
+   stage can parse pieces of it on several threads */
+
+typedef struct
+{
+	uint8 *base;
+	uint64 size;
+	uint32 binary;				//nonzero for the binary relation format
+
+#if defined(WIN32) || defined(_WIN64)
+	HANDLE file;
+	HANDLE map;
+#else
+	int fd;
+#endif
+} qs_savefile_map_t;
+
 typedef struct poly_t {
 	uint32 a_idx;				// offset into a list of 'a' values 
 	mpz_t b;					// the MPQS 'b' value 
@@ -256,6 +371,12 @@ typedef struct
 	uint32 *list;			//contiguous space for all buckets
 } lp_bucket;
 
+//with -siqsbatch <num>, the roots of the bucket sieved primes are 
+//updated for num polynomials at a time (see nextRoots_32k_batch), each 
+//polynomial getting its own set of buckets.  The batched update is 
+//scalar code and replaces the vectorized bucket fill, so it is off 
+//by default.  num is at most QS_MAX_POLY_BATCH (factor.h)
+
 typedef struct
 {
 	mpz_t mpz_poly_a;
@@ -267,6 +388,35 @@ typedef struct
 	int s;
 } siqs_poly;
 
+/* poly 'a' values are generated ahead of demand by the master thread
+   into a small locked pool, from which the sieving threads draw
+   their next 'a' without waiting on the master.  A thread that finds
+   the pool empty generates its own 'a' (under the same lock, so the
+   master list of 'a' values stays complete and duplicate-free) */
+
+#define QS_APOOL_DEPTH_PER_THREAD 2
+
+typedef struct
+{
+	siqs_poly *polys;			//pre-generated 'a', s and qlisort for each entry
+	int depth;					//number of entries the master keeps ready
+	int count;					//number of entries currently ready
+
+#if defined(WIN32) || defined(_WIN64)
+	HANDLE lock;
+#else
+	pthread_mutex_t lock;
+#endif
+} qs_apool_t;
+
+/* each sieving thread hands the relations from each finished 'a' to
+   the master through its own single-producer, single-consumer ring of
+   result shells.  A shell is a dynamic_conf_t of which only the 
+   relation buffers, counters and curr_poly->mpz_poly_a are used; the
+   thread swaps its buffers into a free shell and keeps sieving */
+
+#define QS_RESULT_SLOTS 4
+
 typedef struct
 {
 	uint32 B;					//number of primes in the entire factor base
@@ -297,6 +447,38 @@ typedef struct {
 	uint32 count;
 } qs_cycle_t;
 
+/* relations with three large primes do not map onto a
+   graph, so with TLP the cycles are tracked instead by
+   incremental gaussian elimination over GF(2) of the
+   (sparse) vectors of large primes in each relation.
+   Each pivot is keyed by the smallest prime in its vector */
+
+#define QS_TLP_MAX_VECTOR 64
+#define QS_TLP_MAX_CYCLE 128
+
+typedef struct {
+	uint32 next;				// next pivot hashing to the same bucket
+	uint32 prime;				// smallest prime in this pivot's vector
+	uint32 vec_start;			// offset of the vector in prime_pool
+	uint32 rel_start;			// offset of the relation list in rel_pool
+	uint16 vec_len;
+	uint16 rel_len;
+} qs_tlp_pivot_t;
+
+typedef struct {
+	qs_tlp_pivot_t *pivots;		// pivot 0 is unused
+	uint32 num_pivots;
+	uint32 pivot_alloc;
+	uint32 *hashtable;			// hashtable to index into pivots
+	uint32 *prime_pool;			// storage for the pivot vectors
+	uint32 prime_pool_size;
+	uint32 prime_pool_alloc;
+	uint32 *rel_pool;			// relation lists, NULL if not tracked
+	uint32 rel_pool_size;
+	uint32 rel_pool_alloc;
+	uint32 num_dropped;			// partials too dense to reduce
+} qs_tlp_cycles_t;
+
 typedef struct {
 	fact_obj_t *obj;			// passed in with info from 'outside'
 
@@ -309,6 +491,7 @@ typedef struct {
 
 	uint32 *modsqrt_array;		// a square root of n mod each FB prime
 	uint32 multiplier;			// small multiplier for n (may be composite) 
+	qs_savefile_params_t saved_params;	// parameters of the savefile being resumed, if any
 	mpz_t n;					// the number to factor (scaled by multiplier)
 	mpz_t sqrt_n;				// sqrt of n
 	fb_list *factor_base;       // the factor base to use
@@ -321,9 +504,11 @@ typedef struct {
 	uint32 num_blocks;			// number of blocks to sieve on each side
 	uint32 num_extra_relations;	// number of extra relations to find
 	uint32 small_limit;			// upper limit of small prime variation
-	uint32 use_dlp;				// use double large primes? (0 or 1)
+	uint32 use_dlp;				// use double (1) or triple (2) large primes?
 	uint32 dlp_lower;			// lower bit range for dlp factorization attempts
 	uint32 dlp_upper;			// upper bit range for dlp factorization attempts
+	uint32 tlp_lower;			// lower bit range for tlp factorization attempts
+	uint32 tlp_upper;			// upper bit range for tlp factorization attempts
 
 	uint32 sieve_interval;		// one side of the sieve interval
 	uint32 qs_blocksize;		// blocksize of the sieve - only to be used
@@ -334,6 +519,7 @@ typedef struct {
 	int scan_unrolling;			// how many bytes to unroll the sieve scan
 
 	uint32 tf_small_cutoff;		// bit level to determine whether to bail early from tf
+	int tf_small_adjust;		// bits added to tf_small_cutoff by tuned parameters
 	uint32 tf_closnuf;			// subject anything sieved beyond this to tf
 	
 	uint32 tf_small_recip2_cutoff;
@@ -348,12 +534,15 @@ typedef struct {
 								// relation; actual value, not a multiplier
 	uint64 max_fb2;					// the square of the largest factor base prime 
 	uint64 large_prime_max2;			// the cutoff value for factoring partials 
+	double max_fb3;					// the cube of the largest factor base prime
+	double large_prime_max3;		// the cutoff value for factoring tlp partials
 
 	//master list of cycles
 	qs_cycle_t *cycle_table;		/* list of all the vertices in the graph */
 	uint32 cycle_table_size;	/* number of vertices filled in the table */
 	uint32 cycle_table_alloc;	/* number of cycle_t structures allocated */
 	uint32 *cycle_hashtable;	/* hashtable to index into cycle_table */
+	qs_tlp_cycles_t *tlp_cycles;	/* cycle counting for tlp (NULL otherwise) */
 	uint32 components;			/* connected components (see relation.c) */
 	uint32 vertices;			/* vertices in graph (see relation.c) */
 	uint32 num_relations;		/* number of relations in list */
@@ -379,10 +568,14 @@ typedef struct {
 	uint32 dlp_outside_range;
 	uint32 dlp_prp;
 	uint32 dlp_useful;
+	uint32 attempted_tlp;
+	uint32 tlp_useful;
     uint32 total_reports;
     uint32 total_surviving_reports;
     uint32 total_blocks;
     uint32 lp_scan_failures;
+	int do_prof;				// -siqsprof given
+	uint64 prof[QS_PROF_STAGES];	// cycles per stage, summed over the threads
 
 	//master time record
 	double t_time1;				// sieve time
@@ -396,6 +589,7 @@ typedef struct {
 	//these are used during linear algebra and sqrt root
 	uint32 total_poly_a;		// total number of polynomial 'a' values 
 	mpz_t *poly_a_list;			// list of 'a' values for MPQS polys 
+	uint32 num_poly_a_gen;		// 'a' values in poly_a_list, including any still in the pool
 	poly_t *poly_list;			// list of MPQS polynomials 
 	uint32 poly_list_alloc; 
 	uint32 apoly_alloc;
@@ -415,6 +609,14 @@ typedef struct {
 	uint32 buffered_rels;
 	uint32 buffered_rel_alloc;
 	siqs_r *in_mem_relations;
+	qs_arena_t in_mem_arena;	//storage for the in-mem relation factor lists
+
+	//background writer of the savefile, NULL when writing directly
+	qs_writer_t *writer;
+
+	//pool of 'a' values for the sieving threads
+	qs_apool_t apool;
+	volatile int stop_sieving;	//set by the master when enough relations are found
 
 #ifdef HAVE_CUDA
 	CUdevice cuDevice;
@@ -440,6 +642,10 @@ typedef struct {
 	//large prime sieving
 	update_t update_data;		// data for updating root values
 	lp_bucket *buckets;			// bins holding sieve updates
+	lp_bucket *bucket_sets;		// poly_batch sets of bins, buckets is one of them
+	uint32 poly_batch;			// polys whose large prime roots are updated together
+	uint32 batch_pos;			// which set holds the current poly's updates
+	uint32 batch_len;			// how many sets the last batch update filled
 	int *rootupdates;			// updates to apply to roots of primes
 	uint16 *sm_rootupdates;			// updates to apply to roots of primes
     uint32 *mask2;
@@ -465,6 +671,8 @@ typedef struct {
 	uint32 dlp_outside_range;
 	uint32 dlp_prp;
 	uint32 dlp_useful;
+	uint32 attempted_tlp;
+	uint32 tlp_useful;
     uint32 total_reports;
     uint32 total_surviving_reports;
     uint32 total_blocks;
@@ -483,10 +691,12 @@ typedef struct {
 	uint32 buffered_rels;
 	uint32 buffered_rel_alloc;
 	siqs_r *relation_buf;
+	qs_arena_t rel_arena;		//storage for the buffered relation factor lists
 
     uint64 *unfactored_residue;
     uint64 *residue_factors;
     uint32 num_64bit_residue;
+    uint32 residue_alloc;
 
 #ifdef HAVE_CUDA
 	uint64 *squfof_candidates;
@@ -497,8 +707,13 @@ typedef struct {
     uint32 *polyscratch;
 	uint16 *corrections;
 
+	// bytes of bucket, factor base and update arrays, by page kind
+	uint64 page_bytes[HUGE_PAGE_KINDS];
+
 	//counters and timers
     uint32 lp_scan_failures;
+	int do_prof;
+	uint64 prof[QS_PROF_STAGES];	// this thread's cycles per stage
 	uint32 num;					// sieve locations we've subjected to trial division
 	double rels_per_sec;
 
@@ -519,6 +734,11 @@ typedef struct {
 	volatile enum thread_command command;
     volatile int *thread_queue, *threads_waiting;
 
+	//results handed to the master, see QS_RESULT_SLOTS
+	dynamic_conf_t *results[QS_RESULT_SLOTS];
+	volatile uint32 res_head;	//next shell to fill, advanced only by this thread
+	volatile uint32 res_tail;	//next shell to merge, advanced only by the master
+
 #if defined(WIN32) || defined(_WIN64)
 	HANDLE thread_id;
 	HANDLE run_event;
@@ -571,6 +791,12 @@ int check_relations_siqs_8(uint32 blocknum, uint8 parity,
 						   static_conf_t *sconf, dynamic_conf_t *dconf);
 int check_relations_siqs_16(uint32 blocknum, uint8 parity, 
 						   static_conf_t *sconf, dynamic_conf_t *dconf);
+int check_relations_siqs_4_avx2(uint32 blocknum, uint8 parity, 
+						   static_conf_t *sconf, dynamic_conf_t *dconf);
+int check_relations_siqs_8_avx2(uint32 blocknum, uint8 parity, 
+						   static_conf_t *sconf, dynamic_conf_t *dconf);
+int check_relations_siqs_16_avx2(uint32 blocknum, uint8 parity, 
+						   static_conf_t *sconf, dynamic_conf_t *dconf);
 int (*scan_ptr)(uint32, uint8, static_conf_t *, dynamic_conf_t *);
 
 void filter_SPV(uint8 parity, uint8 *sieve, uint32 poly_id, uint32 bnum, 
@@ -610,6 +836,15 @@ void save_relation_siqs(uint32 offset, uint32 *large_prime, uint32 num_factors,
 						  uint32 *fb_offsets, uint32 poly_id, uint32 parity,
 						  static_conf_t *conf);
 
+void qs_arena_init(qs_arena_t *arena);
+uint32 *qs_arena_alloc(qs_arena_t *arena, uint32 num_words);
+void qs_arena_reset(qs_arena_t *arena);
+void qs_arena_free(qs_arena_t *arena);
+
+// allocate one of a thread's large sieving arrays, on huge pages when 
+// possible.  release with huge_free
+void *qs_big_alloc(dynamic_conf_t *dconf, size_t len);
+
 void stop_worker_thread(thread_sievedata_t *t);
 void start_worker_thread(thread_sievedata_t *t);
 
@@ -628,6 +863,10 @@ void free_filter_vars(static_conf_t *sconf);
 
 //poly
 void new_poly_a(static_conf_t *sconf, dynamic_conf_t *dconf);
+void qs_apool_init(static_conf_t *sconf, int depth);
+void qs_apool_fill(static_conf_t *sconf);
+void qs_apool_get(static_conf_t *sconf, siqs_poly *poly);
+void qs_apool_free(static_conf_t *sconf);
 void computeBl(static_conf_t *sconf, dynamic_conf_t *dconf);
 void nextB(dynamic_conf_t *dconf, static_conf_t *sconf);
 
@@ -639,6 +878,7 @@ void nextRoots_32k(static_conf_t *sconf, dynamic_conf_t *dconf);
 void nextRoots_32k_sse41(static_conf_t *sconf, dynamic_conf_t *dconf);
 void nextRoots_32k_avx2(static_conf_t *sconf, dynamic_conf_t *dconf);
 void nextRoots_64k(static_conf_t *sconf, dynamic_conf_t *dconf);
+void nextRoots_32k_batch(static_conf_t *sconf, dynamic_conf_t *dconf);
 void (*nextRoots_ptr)(static_conf_t *, dynamic_conf_t *);
 		   
 void testfirstRoots_32k(static_conf_t *sconf, dynamic_conf_t *dconf);
@@ -650,11 +890,30 @@ void batch_roots(int *rootupdates, int *firstroots1, int *firstroots2,
 
 //data I/O
 uint32 process_poly_a(static_conf_t *sconf);
+uint32 expand_poly_a(static_conf_t *sconf, mpz_t a, mpz_t **b_list, 
+	uint32 *b_alloc, int *qlisort, int *s);
 int get_a_offsets(fb_list *fb, siqs_poly *poly, mpz_t tmp);
-void generate_bpolys(static_conf_t *sconf, dynamic_conf_t *dconf, int maxB);
-int process_rel(char *substr, fb_list *fb, mpz_t n,
+void generate_bpolys(static_conf_t *sconf, dynamic_conf_t *dconf, 
+	mpz_t *b_list, int maxB);
+int process_rel(siqs_r *in, fb_list *fb, mpz_t n,
 				 static_conf_t *sconf, fact_obj_t *obj, siqs_r *rel);
 int restart_siqs(static_conf_t *sconf, dynamic_conf_t *dconf);
+
+//savefile entries, in either the text or binary format
+void qs_savefile_write_header(qs_savefile_t *s, mpz_t n, uint32 multiplier,
+	uint32 fb_size, uint32 large_prime_max, uint32 dlp);
+void qs_savefile_write_a(qs_savefile_t *s, mpz_t a);
+void qs_savefile_write_rel(qs_savefile_t *s, siqs_r *rel);
+int qs_savefile_read_entry(qs_savefile_t *s, siqs_r *rel, mpz_t val, int lp_only);
+int qs_savefile_map(char *filename, qs_savefile_map_t *m);
+void qs_savefile_unmap(qs_savefile_map_t *m);
+int qs_savefile_parse_entry(qs_savefile_map_t *m, uint8 **pos, uint8 *end, 
+	siqs_r *rel, mpz_t val, int lp_only);
+int qs_savefile_skip_entry(qs_savefile_map_t *m, uint8 **pos, uint8 *end);
+qs_writer_t * qs_writer_start(qs_savefile_t *s);
+void qs_writer_push_a(qs_writer_t *w, mpz_t a);
+void qs_writer_push_rel(qs_writer_t *w, siqs_r *rel);
+void qs_writer_stop(qs_writer_t *w);
 uint32 qs_purge_singletons(fact_obj_t *obj, siqs_r *list, 
 				uint32 num_relations,
 				qs_cycle_t *table, uint32 *hashtable);
@@ -690,6 +949,10 @@ int qcomp_siqs(const void *x, const void *y);
 uint32 make_fb_siqs(static_conf_t *sconf);
 void get_dummy_params(int bits, uint32 *B, uint32 *M, uint32 *NB);
 void siqstune(int bits);
+#define QS_MAX_TUNED_ROWS 64
+int qs_save_tuned_params(char *fname, int rows[][5], int num_rows);
+void qs_prof_merge(static_conf_t *sconf, dynamic_conf_t *dconf);
+void qs_prof_report(static_conf_t *sconf);
 void print_siqs_splash(dynamic_conf_t *dconf, static_conf_t *sconf);
 
 // tiny variants of a few routines, that live in tinySIQS.c
@@ -772,7 +1035,8 @@ uint32 yafu_factor_list_add(fact_obj_t *obj,
 /* pull out the large primes from a relation read from
    the savefile */
 
-void yafu_read_large_primes(char *buf, uint32 *prime1, uint32 *prime2);
+void yafu_read_large_primes(char *buf, uint32 *prime1, uint32 *prime2, 
+	uint32 *prime3);
 
 /* given the primes from a sieve relation, add
    that relation to the graph used for tracking
@@ -780,6 +1044,18 @@ void yafu_read_large_primes(char *buf, uint32 *prime1, uint32 *prime2);
 
 void yafu_add_to_cycles(static_conf_t *conf, uint32 flags, uint32 prime1, uint32 prime2);
 
+/* given the large primes from a sieve relation, decide if 
+   the relation is full or partial and update the cycle
+   counts accordingly. Handles both dlp and tlp relations */
+
+void yafu_count_relation(static_conf_t *conf, uint32 flags, uint32 *large_prime);
+
+/* the incremental elimination used to count (and with
+   track_rels != 0, build) cycles among tlp relations */
+
+qs_tlp_cycles_t * qs_tlp_cycles_init(int track_rels);
+void qs_tlp_cycles_free(qs_tlp_cycles_t *t);
+
 /* perform postprocessing on a list of relations */
 void yafu_qs_filter_relations(static_conf_t *sconf);
 
@@ -33,6 +33,12 @@ code to the public domain.
 #define BUCKETSTARTI 33335
 #define BITSINBYTE 8
 #define MAXSIEVEPRIMECOUNT 100000000	//# primes less than ~2e9: limit of 2e9^2 = 4e18
+#define PI_LMO_MIN 100000000		//below this pi(x) just counts with the SoE
+#define PI_PHI_C 6					//phi(n,c) by table for the first c primes...
+#define PI_PHI_PRIMORIAL 30030		//...whose product is this
+#define PI_PHI_TOTIENT 5760			//...and totient this
+#define SOE_PRESIEVE_NUMP 31		//the avx2 presieve handles the primes below sieve_p[31] = 131
+#define SOE_PRP_MAXLIMBS 16			//PRP checks of bigger values go through mpz
 //#define INPLACE_BUCKET 1
 //#define DO_SPECIAL_COUNT
 
@@ -40,10 +46,13 @@ enum soe_command {
 	SOE_COMMAND_INIT,
 	SOE_COMMAND_WAIT,
 	SOE_COMMAND_SIEVE_AND_COUNT,
+	SOE_COMMAND_SIEVE_AND_SUM,
 	SOE_COMMAND_SIEVE_AND_COMPUTE,
 	SOE_COMPUTE_ROOTS,
 	SOE_COMPUTE_PRIMES,
 	SOE_COMPUTE_PRPS,
+	SOE_COMPUTE_PI_EASY,
+	SOE_COMPUTE_PI_LEAVES,
 	SOE_COMMAND_END
 };
 
@@ -86,6 +95,7 @@ typedef struct
 	uint64 pbound;
 	uint64 pboundi;
 
+	uint32 presieve_max_id;		// primes below this index are done by pre_sieve
 	uint32 bucket_start_id;
 	uint32 large_bucket_start_prime;
 	uint32 num_bucket_primes;
@@ -109,6 +119,8 @@ typedef struct
 #endif
 	int only_count;
 	mpz_t *offset;
+	mpz_t *sum;			// running sum and sum of squares of the primes,
+	mpz_t *sqrsum;		// when summing (only_count == 2)
 	int sieve_range;
 	uint64 min_sieved_val;
 
@@ -140,7 +152,60 @@ typedef struct
 
 } soe_dynamicdata_t;
 
-typedef struct {
+typedef struct
+{
+	// shared by all segments
+	uint64 x;
+	uint64 y;
+	uint32 *primes;		// primes[1..a] are the primes <= y
+	uint32 a;
+	uint32 c;
+	uint32 b_sqrty;		// index of the last prime <= sqrt(y)
+	uint32 *pi_tab;		// pi(n) for n <= y
+	uint32 *lpf;		// least prime factor of n <= y
+	int8 *mu;			// moebius function of n <= y
+	uint16 *phi_tab;	// phi(n, c) for n < PI_PHI_PRIMORIAL
+	uint8 *coprime;		// 1 for n < PI_PHI_PRIMORIAL coprime to the first c primes
+	uint32 *hard_max;	// per prime > sqrt(y): largest m whose leaves need the sieve
+
+	// the primes p_b_start, p_(b_start + b_step), ... for the easy leaves
+	uint32 b_start;
+	uint32 b_step;
+
+	// the segment [low, high) of [1, x/y]
+	uint64 low;
+	uint64 high;
+	uint8 *sieve;
+	uint32 *tree;		// binary indexed tree of sieve counts
+	uint32 last_b;		// last prime sieved in this segment
+	int64 s2;			// special leaves, counted from the start of the segment
+	int64 *leaf_mu;		// per prime: -sum of mu(m) over its leaves in the segment
+	uint32 *seg_count;	// per prime: numbers left in the segment before it was sieved
+
+} pi_segdata_t;
+
+typedef struct
+{
+	// PRP checks of sieve_to_depth survivors (prp.c): fixed size 
+	// montgomery constants and scratch space for the current candidate
+	int num_witnesses;
+	mp_limb_t nhat;
+	int s, top;
+	mp_limb_t one[SOE_PRP_MAXLIMBS];
+	mp_limb_t mone[SOE_PRP_MAXLIMBS];
+	mp_limb_t x[SOE_PRP_MAXLIMBS];
+	mp_limb_t am[SOE_PRP_MAXLIMBS];
+	mp_limb_t v[SOE_PRP_MAXLIMBS];
+	mp_limb_t v1[SOE_PRP_MAXLIMBS];
+	mp_limb_t qk[SOE_PRP_MAXLIMBS];
+	mp_limb_t qm[SOE_PRP_MAXLIMBS];
+	mp_limb_t np1[SOE_PRP_MAXLIMBS + 1];
+	mp_limb_t t[2 * SOE_PRP_MAXLIMBS + 1];
+	mp_limb_t q[2];
+
+} soe_prp_t;
+
+typedef struct {
 	soe_dynamicdata_t ddata;
 	soe_staticdata_t sdata;
 	uint64 linecount;
@@ -151,6 +216,13 @@ typedef struct {
 
 	// stuff for computing PRPs
 	mpz_t offset, lowlimit, highlimit, tmpz;
+	soe_prp_t prp;
+
+	// stuff for counting primes
+	pi_segdata_t *pidata;
+
+	// stuff for summing primes: the sums over the current line
+	mpz_t linesum, linesqr;
 
 	/* fields for thread pool synchronization */
 	volatile enum soe_command command;
@@ -167,14 +239,92 @@ typedef struct {
 
 } thread_soedata_t;
 
+// streaming interface: primes are produced a segment at a time by a
+// thread which keeps one segment ahead of the consumer
+#define SOE_ITER_SEGMENT 100000000
+
+typedef void (*soe_callback_t)(uint64 *primes, uint64 num_p, void *user);
+
+typedef struct {
+	uint32 *sieve_p;
+	uint32 num_sp;
+	uint64 lowlimit, highlimit;
+	uint64 next_low;		// start of the next segment for the producer
+
+	// the batch the consumer is working through
+	uint64 *batch;
+	uint64 batch_num, batch_pos;
+
+	// the next batch, once the producer has it
+	uint64 *ahead;
+	uint64 ahead_num;
+	volatile int ahead_ready, done, stop;
+
+#if defined(WIN32) || defined(_WIN64)
+	HANDLE thread_id;
+	HANDLE lock;
+	HANDLE ready_event;
+	HANDLE space_event;
+#else
+	pthread_t thread_id;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+#endif
+
+} soe_iterator_t;
+
+// binary prime tables (primefile.c): gaps between consecutive primes, 
+// with the absolute value of every SOE_TABLE_CHECKPOINT'th prime kept in 
+// an index for random access
+#define SOE_TABLE_CHECKPOINT 65536
+#define SOE_TABLE_HEADER_WORDS 8
+
+typedef struct {
+	FILE *fid;
+	uint64 lowlimit, highlimit;
+	uint64 num_p;
+	uint64 last;			// the last prime added
+	uint64 pos;				// bytes written so far
+	uint64 *index;			// (prime, file offset) pairs
+	uint64 num_index, alloc_index;
+} soe_table_writer_t;
+
+typedef struct {
+	uint8 *base;			// the whole file, mapped into memory
+	uint64 size;
+	uint64 lowlimit, highlimit;
+	uint64 num_p;
+	uint64 interval;
+	uint64 *index;
+	uint64 num_index;
+
+	// cursor: the last prime returned, the number of primes returned,
+	// and where the next gap is
+	uint64 cur;
+	uint64 next_id;
+	uint8 *ptr;
+
+#if defined(WIN32) || defined(_WIN64)
+	HANDLE file;
+	HANDLE map;
+#else
+	int fd;
+#endif
+
+} soe_table_t;
+
 // top level sieving code
 uint64 spSOE(uint32 *sieve_p, uint32 num_sp, mpz_t *offset, 
 	uint64 lowlimit, uint64 *highlimit, int count, uint64 *primes);
+uint64 spSOE_sum(uint32 *sieve_p, uint32 num_sp, uint64 lowlimit, 
+	uint64 *highlimit, mpz_t *sum, mpz_t *sqrsum);
 
 // thread ready sieving functions
 void sieve_line(thread_soedata_t *thread_data);
 uint64 count_line(soe_staticdata_t *sdata, uint32 current_line);
 void count_line_special(thread_soedata_t *thread_data);
+void init_sum_tables(void);
+void sum_line(thread_soedata_t *thread_data);
 uint32 compute_8_bytes(soe_staticdata_t *sdata, 
 	uint32 pcount, uint64 *primes, uint64 byte_offset, int *pchar);
 uint64 primes_from_lineflags(soe_staticdata_t *sdata, thread_soedata_t *thread_data,
@@ -199,8 +349,31 @@ uint64 *GetPRIMESRange(uint32 *sieve_p, uint32 num_sp,
 	mpz_t *offset, uint64 lowlimit, uint64 highlimit, uint64 *num_p);
 uint64 *soe_wrapper(uint32 *sieve_p, uint32 num_sp, 
 	uint64 lowlimit, uint64 highlimit, int count, uint64 *num_p);
+uint64 soe_sum(uint32 *seed_p, uint32 num_sp, 
+	uint64 lowlimit, uint64 highlimit, mpz_t sum, mpz_t sqrsum);
 uint64 *sieve_to_depth(uint32 *seed_p, uint32 num_sp, 
 	mpz_t lowlimit, mpz_t highlimit, int count, int num_witnesses, uint64 *num_p);
+void soe_iter_init(soe_iterator_t *it, uint32 *seed_p, uint32 num_sp, 
+	uint64 lowlimit, uint64 highlimit);
+uint64 *soe_iter_next_batch(soe_iterator_t *it, uint64 *num_p);
+uint64 soe_iter_next(soe_iterator_t *it);
+void soe_iter_free(soe_iterator_t *it);
+uint64 soe_foreach(uint32 *seed_p, uint32 num_sp, uint64 lowlimit, uint64 highlimit,
+	soe_callback_t cb, void *user);
+uint64 pi_lmo(uint32 *seed_p, uint32 num_sp, uint64 x);
+int soe_table_create(soe_table_writer_t *w, char *filename,
+	uint64 lowlimit, uint64 highlimit);
+void soe_table_append(soe_table_writer_t *w, uint64 *primes, uint64 num_p);
+void soe_table_finish(soe_table_writer_t *w);
+int soe_table_open(soe_table_t *t, char *filename);
+uint64 soe_table_next(soe_table_t *t);
+uint64 soe_table_seek(soe_table_t *t, uint64 value);
+void soe_table_close(soe_table_t *t);
+uint64 *soe_table_load(char *filename, uint64 lowlimit, uint64 highlimit, uint64 *num_p);
+void soe_prp_init(soe_prp_t *b, int num_witnesses);
+int soe_prp(soe_prp_t *b, mpz_t n);
+void pi_sieve_segment(pi_segdata_t *s);
+void pi_easy_leaves(pi_segdata_t *s);
 
 // misc and helper functions
 uint64 estimate_primes_in_range(uint64 lowlimit, uint64 highlimit);
@@ -214,6 +387,11 @@ void do_soe_sieving(soe_staticdata_t *sdata, thread_soedata_t *thread_data, int
 void finalize_sieve(soe_staticdata_t *sdata,
 	thread_soedata_t *thread_data, int count, uint64 *primes);
 void pre_sieve(soe_dynamicdata_t *ddata, soe_staticdata_t *sdata, uint8 *flagblock);
+#if defined(USE_AVX2)
+void pre_sieve_avx2_init(void);
+void pre_sieve_avx2(soe_dynamicdata_t *ddata, soe_staticdata_t *sdata, uint8 *flagblock);
+uint64 count_flags_avx2(uint64 *flags, uint64 numwords);
+#endif
 
 // misc
 void primesum(uint64 lower, uint64 upper);
@@ -70,6 +70,20 @@ static INLINE void * xmalloc_align(size_t len)
 	return ptr;
 }
 
+/* big arrays backed by 2MB pages when the OS will give them to us;
+   memory from xmalloc_huge must be released with huge_free */
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+enum huge_page_kind
+{
+	HUGE_PAGE_NONE,			// ordinary pages
+	HUGE_PAGE_THP,			// madvised for transparent huge pages
+	HUGE_PAGE_EXPLICIT,		// reserved huge pages (hugetlbfs, MEM_LARGE_PAGES)
+	HUGE_PAGE_KINDS
+};
+
+void *xmalloc_huge(size_t len, int *kind);
+void huge_free(void *ptr);
+
 static INLINE void * xmalloc(size_t len) {
 	void *ptr = malloc(len);
 	if (ptr == NULL) {
@@ -158,6 +158,8 @@ uint64 LCGSTATE;
 //SoE
 int PRIMES_TO_FILE;
 int PRIMES_TO_SCREEN;
+int PRIMES_BINARY;				// primes go to primes.bin as a binary table
+char PRIME_TABLE_FILE[1024];	// startup primes are loaded from this table
 
 // machine info
 double MEAS_CPU_FREQUENCY;
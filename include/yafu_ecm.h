@@ -48,6 +48,19 @@ typedef struct {
 	int curves_run;
 	char tmp_output[80];
 
+	/* a long-lived external ecm process, used with -ecmpipe */
+	int ext_running;
+	mpz_t ext_n;				//the input the process is working on
+	FILE *ext_out;				//the process's output
+	char ext_line[1024];		//a line read ahead from the process
+	int ext_have_line;
+	int ext_failed;				//the last curve never started in the process
+#if defined(WIN32) || defined(_WIN64)
+	HANDLE ext_process;
+#else
+	pid_t ext_pid;
+#endif
+
 	/* fields for thread pool synchronization */
 	volatile enum ecm_thread_command command;
 
@@ -76,6 +89,9 @@ void ecm_stop_worker_thread(ecm_thread_data_t *t, uint32 is_master_thread);
 void ecm_start_worker_thread(ecm_thread_data_t *t, uint32 is_master_thread);
 void ecm_thread_free(ecm_thread_data_t *tdata);
 void ecm_thread_init(ecm_thread_data_t *tdata);
+int ecm_ext_start(ecm_thread_data_t *tdata);
+void ecm_ext_stop(ecm_thread_data_t *tdata);
+int ecm_ext_curve(ecm_thread_data_t *tdata);
 
 #if defined(WIN32) || defined(_WIN64)
 DWORD WINAPI ecm_worker_thread_main(LPVOID thread_data);
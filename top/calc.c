@@ -1149,7 +1149,7 @@ int getFunc(char *s, int *nargs)
 						"ptable","sieverange","fermat","nfs","tune",
 						"xor", "and", "or", "not", "frange",
 						"bpsw","aprcl","lte", "gte", "lt", 
-						"gt"};
+						"gt","pi","psum","psum2"};
 
 	int args[NUM_FUNC] = {1,1,2,1,1,
 					2,2,1,1,1,
@@ -1165,7 +1165,7 @@ int getFunc(char *s, int *nargs)
 					0,4,3,1,0,
 					2,2,2,1,2,
 					1,1,2,2,2,
-					2};
+					2,1,2,2};
 
 	for (i=0;i<NUM_FUNC;i++)
 	{
@@ -1180,6 +1180,42 @@ int getFunc(char *s, int *nargs)
 	return -1;
 }
 
+typedef struct
+{
+	FILE *out;
+	soe_table_writer_t *table;
+	int to_screen;
+	uint64 first, last;
+} print_primes_t;
+
+static void print_primes_cb(uint64 *primes, uint64 num_p, void *user)
+{
+	// soe_foreach callback for primes(): output one batch
+	print_primes_t *pp = (print_primes_t *)user;
+	uint64 i;
+
+	if (pp->first == 0)
+		pp->first = primes[0];
+	pp->last = primes[num_p - 1];
+
+	if (pp->out != NULL)
+	{
+		for (i = 0; i < num_p; i++)
+			fprintf(pp->out,"%" PRIu64 "\n",primes[i]);
+	}
+
+	if (pp->table != NULL)
+		soe_table_append(pp->table, primes, num_p);
+
+	if (pp->to_screen)
+	{
+		for (i = 0; i < num_p; i++)
+			printf("%" PRIu64 " ",primes[i]);
+	}
+
+	return;
+}
+
 int feval(int func, int nargs, fact_obj_t *fobj)
 {
 	// evaluate the function 'func', with 'nargs' argument(s) located
@@ -1626,6 +1662,52 @@ int feval(int func, int nargs, fact_obj_t *fobj)
 
 		lower = mpz_get_64(operands[0]);
 		upper = mpz_get_64(operands[1]);
+
+		if ((mpz_get_ui(operands[2]) == 0) && (upper > lower) &&
+			((upper - lower) > 10 * SOE_ITER_SEGMENT))
+		{
+			// too many to keep: stream them out instead, a segment at a time.
+			// the PRIMES table is left alone.
+			print_primes_t pp;
+			soe_table_writer_t table;
+			uint64 np;
+
+			pp.out = NULL;
+			pp.table = NULL;
+			pp.to_screen = PRIMES_TO_SCREEN;
+			pp.first = pp.last = 0;
+			if (PRIMES_TO_FILE && PRIMES_BINARY)
+			{
+				if (soe_table_create(&table, "primes.bin", lower, upper) == 0)
+					pp.table = &table;
+			}
+			else if (PRIMES_TO_FILE)
+			{
+				pp.out = fopen("primes.dat","w");
+				if (pp.out == NULL)
+				{
+					printf("fopen error: %s\n", strerror(errno));
+					printf("can't open primes.dat for writing\n");
+				}
+			}
+
+			np = soe_foreach(spSOEprimes, szSOEp, lower, upper, print_primes_cb, &pp);
+
+			if (pp.out != NULL)
+				fclose(pp.out);
+			if (pp.table != NULL)
+				soe_table_finish(pp.table);
+			if (pp.to_screen)
+				printf("\n");
+
+			if (VFLAG > 0)
+				printf("found %" PRIu64 " primes from %" PRIu64 " to %" PRIu64 
+					" (not stored)\n", np, pp.first, pp.last);
+
+			mpz_set_64(operands[0], np);
+			break;
+		}
+
 		free(PRIMES);
 		PRIMES = soe_wrapper(spSOEprimes, szSOEp, lower, upper, mpz_get_ui(operands[2]), &NUM_P);
 		if (PRIMES != NULL)
@@ -2265,7 +2347,14 @@ int feval(int func, int nargs, fact_obj_t *fobj)
 		break;
 
 	case 54:
-		printf("siqstune not currently supported\n");
+		//siqstune - one argument
+		if (nargs != 1)
+		{
+			printf("wrong number of arguments in siqstune\n");
+			break;
+		}
+
+		siqstune(mpz_get_ui(operands[0]));
 		break;
 
 	case 55:
@@ -2277,23 +2366,22 @@ int feval(int func, int nargs, fact_obj_t *fobj)
 		lower = 10;
 		count = 4;
 		printf("%" PRIu64 ": %" PRIu64 "\n",lower,count);
-		for (i = 1; i < 13; i++)
+		for (i = 1; i < 15; i++)
 		{
 			inc = (uint64)pow(10,i);
-			//this increment may be too high.  break it into chunks no larger than 10e9.
-			k = 10; 
-			if (inc > 10000000000ULL)
-			{
-				k *= (uint32)(inc / 10000000000ULL);
-				inc = 10000000000ULL;
-			}
-
-			for (j = 1; j < k; j++)
+			for (j = 1; j < 10; j++)
 			{
 				upper = lower + inc; 
 				gettimeofday(&tstart, NULL);	
-				soe_wrapper(spSOEprimes, szSOEp, lower, upper, 1, &n64);
-				count += n64;
+				//sieve the small increments.  past that it is much faster
+				//to count each entry from scratch.
+				if (upper < PI_LMO_MIN)
+				{
+					soe_wrapper(spSOEprimes, szSOEp, lower, upper, 1, &n64);
+					count += n64;
+				}
+				else
+					count = pi_lmo(spSOEprimes, szSOEp, upper);
 				gettimeofday (&tstop, NULL);
 				difference = my_difftime (&tstart, &tstop);
 				t = ((double)difference->secs + (double)difference->usecs / 1000000);
@@ -2768,6 +2856,66 @@ int feval(int func, int nargs, fact_obj_t *fobj)
 
 		break;
 
+	case 71:
+		//pi - one argument
+		if (nargs != 1)
+		{
+			printf("wrong number of arguments in pi\n");
+			break;
+		}
+
+		if ((mpz_sgn(operands[0]) < 0) || (mpz_sizeinbase(operands[0], 2) > 63))
+		{
+			printf("input to pi must be between 0 and 2^63\n");
+			mpz_set_ui(operands[0], 0);
+			break;
+		}
+
+		gettimeofday(&tstart, NULL);
+		n64 = pi_lmo(spSOEprimes, szSOEp, mpz_get_64(operands[0]));
+		mpz_set_64(operands[0], n64);
+		gettimeofday (&tstop, NULL);
+		difference = my_difftime (&tstart, &tstop);
+
+		t = ((double)difference->secs + (double)difference->usecs / 1000000);
+		free(difference);
+		printf("elapsed time = %6.4f\n",t);
+		break;
+
+	case 72:
+	case 73:
+		//psum, psum2 - two arguments
+		if (nargs != 2)
+		{
+			printf("wrong number of arguments in %s\n", (func == 72) ? "psum" : "psum2");
+			break;
+		}
+
+		if ((mpz_sgn(operands[0]) < 0) || (mpz_sizeinbase(operands[1], 2) > 63) ||
+			(mpz_cmp(operands[1], operands[0]) < 0))
+		{
+			printf("inputs must satisfy 0 <= lower <= upper < 2^63\n");
+			mpz_set_ui(operands[0], 0);
+			break;
+		}
+
+		gettimeofday(&tstart, NULL);
+		n64 = soe_sum(spSOEprimes, szSOEp, mpz_get_64(operands[0]), 
+			mpz_get_64(operands[1]), mp1, mp2);
+		gettimeofday (&tstop, NULL);
+		difference = my_difftime (&tstart, &tstop);
+		t = ((double)difference->secs + (double)difference->usecs / 1000000);
+		free(difference);
+
+		if (VFLAG > 0)
+			printf("found %" PRIu64 " primes in %6.4f seconds\n", n64, t);
+
+		if (func == 72)
+			mpz_set(operands[0], mp1);
+		else
+			mpz_set(operands[0], mp2);
+		break;
+
 	default:
 		printf("unrecognized function code\n");
 		mpz_set_ui(operands[0], 0);
@@ -28,7 +28,7 @@ code to the public domain.
 #include <ecm.h>
 
 // the number of recognized command line options
-#define NUMOPTIONS 72
+#define NUMOPTIONS 81
 // maximum length of command line option strings
 #define MAXOPTIONLEN 20
 
@@ -48,7 +48,9 @@ char OptionArray[NUMOPTIONS][MAXOPTIONLEN] = {
 	"nc2", "nc3", "p", "work", "nprp",
 	"ext_ecm", "testsieve", "nt", "aprcl_p", "aprcl_d",
 	"filt_bump", "nc1", "gnfs", "e", "repeat",
-	"ecmtime", "no_clk_test"};
+	"ecmtime", "no_clk_test", "forceTLP", "siqsbin", "siqsconv",
+	"ecmpipe", "pbin", "pload", "siqsTD", "siqsbatch",
+	"siqsprof"};
 
 // indication of whether or not an option needs a corresponding argument
 // 0 = no argument
@@ -69,7 +71,9 @@ int needsArg[NUMOPTIONS] = {
 	0,0,0,1,1,
 	1,1,1,1,1,
 	1,0,0,1,1,
-	1,0};
+	1,0,0,0,1,
+	0,0,1,1,1,
+	2};
 
 // function to read the .ini file and populate options
 void readINI(fact_obj_t *fobj);
@@ -78,6 +82,7 @@ void apply_tuneinfo(fact_obj_t *fobj, char *arg);
 // functions to populate the global options with default values, and to free
 // those which allocate memory
 void set_default_globals(void);
+void init_prime_cache(void);
 void free_globals(void);
 
 // function containing system commands to get the computer name
@@ -126,6 +131,18 @@ int main(int argc, char *argv[])
 	//check/process input arguments
 	is_cmdline_run = process_arguments(argc, argv, input_exp, fobj);
 
+	//the cached primes can come from a prime table given by -pload, so
+	//wait until the options are known to find them
+	init_prime_cache();
+
+	//a savefile conversion is all that is done in a -siqsconv run
+	if (fobj->qs_obj.siqs_convert_file[0] != '\0')
+	{
+		int num_rels = qs_savefile_convert(fobj->qs_obj.siqs_savefile, 
+			fobj->qs_obj.siqs_convert_file);
+		exit(num_rels < 0);
+	}
+
 #if !defined( TARGET_MIC )
     //get the computer name, cache sizes, etc.  store in globals
     get_computer_info(CPU_ID_STR);
@@ -139,6 +156,9 @@ int main(int argc, char *argv[])
 
 #endif
 
+	//siqs parameters tuned on this machine, if siqstune has been run
+	qs_load_tuned_params(QS_TUNE_FILE);
+
 	if (is_cmdline_run == 2)
 	{
 		// batchfile from stdin
@@ -907,9 +927,6 @@ void yafu_set_idle_priority(void) {
 
 void set_default_globals(void)
 {
-	uint64 limit, i;
-	uint32 seed_p[6542], num_sp;
-	
 	VFLAG = 0;
 	VERBOSE_PROC_INFO = 0;
 	LOGFLAG = 1;
@@ -918,6 +935,8 @@ void set_default_globals(void)
 	
 	PRIMES_TO_FILE = 0;
 	PRIMES_TO_SCREEN = 0;
+	PRIMES_BINARY = 0;
+	strcpy(PRIME_TABLE_FILE, "");
 	GLOBAL_OFFSET = 0;
     NO_CLK_TEST = 0;
 	
@@ -952,25 +971,51 @@ void set_default_globals(void)
 	IBASE = DEC;
 	OBASE = DEC;
 
-	//find, and hold globally, primes less than some N
-	//bootstrap the process by finding some initial sieve primes.
-	//if the requested offset+range is large we may need to find more - 
-	//we can use these primes to accomplish that.
-	num_sp = tiny_soe(65537, seed_p);
-	PRIMES = GetPRIMESRange(seed_p, num_sp, NULL, 0, szSOEp, &limit);
+	// random seeds
+	get_random_seeds(&g_rand);	
+
+	return;
+}
+
+void init_prime_cache(void)
+{
+	uint64 limit, i;
+	uint32 seed_p[6542], num_sp;
+	soe_table_t table;
+
+	//find, and hold globally, primes less than some N.
+	//a prime table from -pload saves generating them, and can hold more
+	PRIMES = NULL;
+	if ((strlen(PRIME_TABLE_FILE) > 0) && 
+		(soe_table_open(&table, PRIME_TABLE_FILE) == 0))
+	{
+		if ((table.lowlimit > 2) || (table.highlimit < szSOEp))
+			printf("prime table %s doesn't cover 2 to %u, ignoring\n", 
+				PRIME_TABLE_FILE, szSOEp);
+		else
+			PRIMES = soe_table_load(PRIME_TABLE_FILE, 0, table.highlimit, &limit);
+		soe_table_close(&table);
+	}
+
+	if (PRIMES == NULL)
+	{
+		//bootstrap the process by finding some initial sieve primes.
+		//if the requested offset+range is large we may need to find more - 
+		//we can use these primes to accomplish that.
+		num_sp = tiny_soe(65537, seed_p);
+		PRIMES = GetPRIMESRange(seed_p, num_sp, NULL, 0, szSOEp, &limit);
+	}
 
-	//save a batch of sieve primes too.
-	spSOEprimes = (uint32 *)malloc((size_t) (limit * sizeof(uint32)));
-	for (i=0;i<limit;i++)
+	//save a batch of sieve primes too: those that fit in 32 bits.
+	for (i=0; (i < limit) && (PRIMES[i] < 0xffffffffULL); i++);
+	szSOEp = (uint32)i;
+	spSOEprimes = (uint32 *)malloc((size_t) (szSOEp * sizeof(uint32)));
+	for (i=0;i<szSOEp;i++)
 		spSOEprimes[i] = (uint32)PRIMES[i];
 
-	szSOEp = limit;
 	NUM_P = limit;
 	P_MIN = 0; 
-	P_MAX = PRIMES[(uint32)NUM_P-1];
-
-	// random seeds
-	get_random_seeds(&g_rand);	
+	P_MAX = PRIMES[NUM_P-1];
 
 	return;
 }
@@ -2050,6 +2095,94 @@ void applyOpt(char *opt, char *arg, fact_obj_t *fobj)
         //argument "no_clk_test"
         NO_CLK_TEST = 1;
     }
+	else if (strcmp(opt,OptionArray[72]) == 0)
+	{
+		//argument "forceTLP"
+		fobj->qs_obj.gbl_force_TLP = 1;
+	}
+	else if (strcmp(opt,OptionArray[73]) == 0)
+	{
+		//argument "siqsbin"
+		fobj->qs_obj.binary_savefile = 1;
+	}
+	else if (strcmp(opt,OptionArray[74]) == 0)
+	{
+		//argument is a string
+		if (strlen(arg) < 1024)
+			strcpy(fobj->qs_obj.siqs_convert_file,arg);
+		else
+			printf("*** argument to siqsconv too long, ignoring ***\n");
+	}
+	else if (strcmp(opt,OptionArray[75]) == 0)
+	{
+		//argument "ecmpipe"
+		fobj->ecm_obj.use_pipe = 1;
+	}
+	else if (strcmp(opt,OptionArray[76]) == 0)
+	{
+		//argument "pbin"
+		PRIMES_BINARY = 1;
+	}
+	else if (strcmp(opt,OptionArray[77]) == 0)
+	{
+		//argument is a string
+		if (strlen(arg) < 1024)
+			strcpy(PRIME_TABLE_FILE,arg);
+		else
+			printf("*** argument to pload too long, ignoring ***\n");
+	}
+	else if (strcmp(opt,OptionArray[78]) == 0)
+	{
+		//argument should be all numeric
+		for (i=0;i<(int)strlen(arg);i++)
+		{
+			if (!isdigit(arg[i]))
+			{
+				printf("expected numeric input for option %s\n",opt);
+				exit(1);
+			}
+		}
+
+		fobj->qs_obj.gbl_override_la_density = strtoul(arg,ptr,10);
+		fobj->qs_obj.gbl_override_la_density_flag = 1;
+	}
+	else if (strcmp(opt,OptionArray[79]) == 0)
+	{
+		//argument should be all numeric
+		for (i=0;i<(int)strlen(arg);i++)
+		{
+			if (!isdigit(arg[i]))
+			{
+				printf("expected numeric input for option %s\n",opt);
+				exit(1);
+			}
+		}
+
+		fobj->qs_obj.gbl_override_poly_batch = strtoul(arg,ptr,10);
+		fobj->qs_obj.gbl_override_poly_batch_flag = 1;
+
+		if ((fobj->qs_obj.gbl_override_poly_batch < 1) ||
+			(fobj->qs_obj.gbl_override_poly_batch > QS_MAX_POLY_BATCH))
+		{
+			uint32 b = fobj->qs_obj.gbl_override_poly_batch;
+
+			fobj->qs_obj.gbl_override_poly_batch = (b < 1) ? 1 : QS_MAX_POLY_BATCH;
+			printf("*** siqsbatch must be between 1 and %d, using %u ***\n",
+				QS_MAX_POLY_BATCH, fobj->qs_obj.gbl_override_poly_batch);
+		}
+	}
+	else if (strcmp(opt,OptionArray[80]) == 0)
+	{
+		//argument "siqsprof", with an optional report file
+		fobj->qs_obj.prof = 1;
+		if (arg != NULL)
+		{
+			if (strlen(arg) < 1024)
+				strcpy(fobj->qs_obj.prof_file,arg);
+			else
+				printf("*** argument to siqsprof too long, ignoring ***\n");
+		}
+	}
 	else
 	{
 		printf("invalid option %s\n",opt);
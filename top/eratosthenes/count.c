@@ -28,6 +28,14 @@ uint64 count_line(soe_staticdata_t *sdata, uint32 current_line)
 	int done, kx;
 	uint64 prime;
 
+#if defined(USE_AVX2)
+	if (HAS_AVX2)
+	{
+		it = count_flags_avx2(flagblock64, numlinebytes >> 3);
+		i = numlinebytes >> 3;
+	}
+	else
+#endif
 	for (i=0;i<(numlinebytes >> 3);i++)
 	{
 		/* Convert to 64-bit unsigned integer */    
@@ -170,6 +178,11 @@ void count_line_special(thread_soedata_t *thread_data)
 
 		//count these bytes
 		it = 0;
+#if defined(USE_AVX2)
+		if (HAS_AVX2)
+			it = count_flags_avx2(flagblock64 + start, stop - start);
+		else
+#endif
 		for (ix = start; ix < stop; ix++)
 		{
 			/* Convert to 64-bit unsigned integer */    
@@ -213,3 +226,106 @@ void count_line_special(thread_soedata_t *thread_data)
 	}
 
 }
+
+//for each byte of flags: the number of bits set, and the sums of the 
+//positions and squared positions of those bits
+static uint8 sum_cnt[256];
+static uint8 sum_s1[256];
+static uint8 sum_s2[256];
+
+void init_sum_tables(void)
+{
+	int i, b;
+
+	for (i=0; i<256; i++)
+	{
+		sum_cnt[i] = sum_s1[i] = sum_s2[i] = 0;
+		for (b=0; b<8; b++)
+		{
+			if (i & (1 << b))
+			{
+				sum_cnt[i]++;
+				sum_s1[i] += b;
+				sum_s2[i] += b * b;
+			}
+		}
+	}
+
+	return;
+}
+
+void sum_line(thread_soedata_t *thread_data)
+{
+	//sum, and sum the squares of, the primes in a line.  the primes in 
+	//block k of the line are base + prodN * t, with base the value of the 
+	//first bit of the block and t < FLAGSIZE, so the count of primes and the 
+	//sums of t and t^2 fit in 64 bits within a block.  only those three 
+	//numbers are accumulated bytewise, and they are folded into the line sums 
+	//once per block.
+	soe_staticdata_t *sdata = &thread_data->sdata;
+	uint32 current_line = thread_data->current_line;
+	uint8 *line = sdata->lines[current_line];	
+	uint64 numlinebytes = sdata->numlinebytes;
+	uint64 lowlimit = sdata->lowlimit;
+	uint64 prodN = sdata->prodN;
+	uint64 i, j, stop, base, n, s1, s2, t0;
+	int ix;
+	mpz_t p, tmp;
+
+	//zero out any bits below the requested range
+	for (i=lowlimit + sdata->rclass[current_line], ix=0; i < sdata->orig_llimit; i += prodN, ix++)
+		line[ix >> 3] &= masks[ix & 7];
+	
+	//and any high bits above the requested range
+	for (i=sdata->highlimit + sdata->rclass[current_line] - prodN, ix=0; i > sdata->orig_hlimit; i -= prodN, ix++)
+		line[numlinebytes - 1 - (ix >> 3)] &= masks[7 - (ix & 7)];
+
+	mpz_init(p);
+	mpz_init(tmp);
+	mpz_set_ui(thread_data->linesum, 0);
+	mpz_set_ui(thread_data->linesqr, 0);
+	thread_data->linecount = 0;
+
+	for (i = 0; i < numlinebytes; i += BLOCKSIZE)
+	{
+		stop = MIN(i + BLOCKSIZE, numlinebytes);
+		n = s1 = s2 = 0;
+		for (j = i; j < stop; j++)
+		{
+			uint8 f = line[j];
+
+			if (f == 0)
+				continue;
+
+			t0 = (j - i) << 3;
+			n += sum_cnt[f];
+			s1 += sum_cnt[f] * t0 + sum_s1[f];
+			s2 += sum_cnt[f] * t0 * t0 + 2 * sum_s1[f] * t0 + sum_s2[f];
+		}
+
+		if (n == 0)
+			continue;
+
+		//sum += n * base + prodN * s1
+		//sqr += n * base^2 + 2 * base * prodN * s1 + prodN^2 * s2
+		base = prodN * (i << 3) + sdata->rclass[current_line] + lowlimit;
+		mpz_set_64(p, base);
+		mpz_addmul_ui(thread_data->linesum, p, (uint32)n);
+		mpz_set_64(tmp, s1);
+		mpz_mul_ui(tmp, tmp, (uint32)prodN);
+		mpz_add(thread_data->linesum, thread_data->linesum, tmp);
+
+		mpz_mul_2exp(tmp, tmp, 1);
+		mpz_addmul(thread_data->linesqr, p, tmp);
+		mpz_mul(tmp, p, p);
+		mpz_addmul_ui(thread_data->linesqr, tmp, (uint32)n);
+		mpz_set_64(tmp, s2);
+		mpz_addmul_ui(thread_data->linesqr, tmp, (uint32)(prodN * prodN));
+
+		thread_data->linecount += n;
+	}
+
+	mpz_clear(p);
+	mpz_clear(tmp);
+	return;
+}
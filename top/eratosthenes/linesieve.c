@@ -193,7 +193,14 @@ void sieve_line(thread_soedata_t *thread_data)
 		memset(flagblock,255,BLOCKSIZE);			
 		
 		//smallest primes use special methods
+#if defined(USE_AVX2)
+		if (sdata->presieve_max_id > 10)
+			pre_sieve_avx2(ddata, sdata, flagblock);
+		else
+			pre_sieve(ddata, sdata, flagblock);
+#else
 		pre_sieve(ddata, sdata, flagblock);
+#endif
 		
 		//one is not a prime
 		if (sdata->sieve_range == 0)
@@ -213,7 +220,7 @@ void sieve_line(thread_soedata_t *thread_data)
 		//unroll the loop: all primes less than this max hit the interval at least 16 times
 		maxP = FLAGSIZE >> 4;
 
-		for (j=10;j<ddata->pbounds[i];j++)
+		for (j=sdata->presieve_max_id;j<ddata->pbounds[i];j++)
 		{
 			uint32 tmpP;
 			uint64 stop;
@@ -0,0 +1,171 @@
+/*----------------------------------------------------------------------
+This source distribution is placed in the public domain by its author,
+Ben Buhrow. You may use it for any purpose, free of charge,
+without having to notify anyone. I disclaim any responsibility for any
+errors.
+
+Optionally, please be nice and tell me if you find this source to be
+useful. Again optionally, if you add to the functionality present here
+please consider making those additions public too, so that others may
+benefit from your work.
+
+       				   --bbuhrow@gmail.com 7/28/10
+----------------------------------------------------------------------*/
+
+#include "soe.h"
+
+#if defined(USE_AVX2)
+
+#include <immintrin.h>
+
+//sieve_p[0..SOE_PRESIEVE_NUMP-1] are the primes less than 128
+static const uint32 presieve_p[SOE_PRESIEVE_NUMP] = {
+	2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53,
+	59, 61, 67, 71, 73, 79, 83, 89, 97, 101, 103, 107, 109, 113, 127};
+
+//sum of (p + 3) over the primes 5 through 127
+#define PRESIEVE_NUMWORDS 1802
+
+//the 64 bit words of a line repeat with period p for each small prime p.
+//for every prime we store one period of that sequence, starting at the word
+//whose first hit is bit 0, plus 3 more words so that any 4 consecutive words
+//of the period can be read with one 256 bit load.  word i of the period has
+//its first hit at bit (-64*i) mod p; presieve_word_id maps a bit offset (the
+//form the offsets array holds) back to the word id.
+static uint64 presieve_words[PRESIEVE_NUMWORDS];
+static uint32 presieve_word_start[SOE_PRESIEVE_NUMP];
+static uint8 presieve_word_id[PRESIEVE_NUMWORDS];
+static volatile int presieve_initialized = 0;
+
+void pre_sieve_avx2_init(void)
+{
+	uint32 j, i, p, b, start;
+	uint64 w;
+
+	if (presieve_initialized)
+		return;
+
+	start = 0;
+	for (j=2; j<SOE_PRESIEVE_NUMP; j++)
+	{
+		p = presieve_p[j];
+		presieve_word_start[j] = start;
+		for (i=0; i<p+3; i++)
+		{
+			//first hit in this word
+			b = (p - (uint32)((64 * (uint64)i) % p)) % p;
+
+			if (i < p)
+				presieve_word_id[start + b] = (uint8)i;
+
+			w = 0xffffffffffffffffULL;
+			for ( ; b < 64; b += p)
+				w &= ~(1ULL << b);
+			presieve_words[start + i] = w;
+		}
+		start += p + 3;
+	}
+
+	presieve_initialized = 1;
+	return;
+}
+
+//AND 256 bits of flags with the next 4 words of a prime's period
+#define PRESIEVE_STEP(x) \
+	vflags = _mm256_and_si256(vflags, _mm256_loadu_si256((__m256i *)(w##x + id##x))); \
+	id##x += 4; \
+	if (id##x >= p##x) id##x -= p##x;
+
+void pre_sieve_avx2(soe_dynamicdata_t *ddata, soe_staticdata_t *sdata, uint8 *flagblock)
+{
+	//same job as pre_sieve, but for all of the primes up to 128 and 256 bits
+	//at a time, four primes per pass through the block.  the last group is
+	//padded with words of all ones, which leave the flags unchanged.
+	static const uint64 ones[4] = {
+		0xffffffffffffffffULL, 0xffffffffffffffffULL,
+		0xffffffffffffffffULL, 0xffffffffffffffffULL};
+	__m256i *flag256 = (__m256i *)flagblock;
+	__m256i vflags;
+	const uint64 *w0, *w1, *w2, *w3;
+	uint32 id0, id1, id2, id3;
+	uint32 p0, p1, p2, p3;
+	uint32 j, g, k;
+
+	for (j=sdata->startprime; j<SOE_PRESIEVE_NUMP; j+=4)
+	{
+		const uint64 *w[4];
+		uint32 id[4], p[4];
+
+		for (g=0; g<4; g++)
+		{
+			if (j + g < SOE_PRESIEVE_NUMP)
+			{
+				p[g] = presieve_p[j + g];
+				w[g] = presieve_words + presieve_word_start[j + g];
+				id[g] = presieve_word_id[presieve_word_start[j + g] + ddata->offsets[j + g]];
+			}
+			else
+			{
+				p[g] = 4;
+				w[g] = ones;
+				id[g] = 0;
+			}
+		}
+
+		w0 = w[0]; w1 = w[1]; w2 = w[2]; w3 = w[3];
+		id0 = id[0]; id1 = id[1]; id2 = id[2]; id3 = id[3];
+		p0 = p[0]; p1 = p[1]; p2 = p[2]; p3 = p[3];
+
+		for (k=0; k<(FLAGSIZE >> 8); k++)
+		{
+			vflags = _mm256_loadu_si256(flag256 + k);
+			PRESIEVE_STEP(0);
+			PRESIEVE_STEP(1);
+			PRESIEVE_STEP(2);
+			PRESIEVE_STEP(3);
+			_mm256_storeu_si256(flag256 + k, vflags);
+		}
+
+		//the offsets array wants the first hit in the next block
+		for (g=0; (g<4) && (j + g < SOE_PRESIEVE_NUMP); g++)
+			ddata->offsets[j + g] = (ddata->offsets[j + g] + p[g] - (FLAGSIZE % p[g])) % p[g];
+	}
+
+	return;
+}
+
+uint64 count_flags_avx2(uint64 *flags, uint64 numwords)
+{
+	//population count of numwords 64 bit words, using a 4 bit lookup table
+	//in each byte of a 256 bit register (vpshufb), and summing the bytes
+	//into 64 bit lanes with vpsadbw.
+	const __m256i lookup = _mm256_setr_epi8(
+		0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+		0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+	const __m256i lownib = _mm256_set1_epi8(0x0f);
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i acc = _mm256_setzero_si256();
+	__m256i v, lo, hi, cnt;
+	uint64 i, it;
+	uint64 lanes[4];
+
+	for (i=0; i + 4 <= numwords; i += 4)
+	{
+		v = _mm256_loadu_si256((__m256i *)(flags + i));
+		lo = _mm256_and_si256(v, lownib);
+		hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), lownib);
+		cnt = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo),
+			_mm256_shuffle_epi8(lookup, hi));
+		acc = _mm256_add_epi64(acc, _mm256_sad_epu8(cnt, zero));
+	}
+
+	_mm256_storeu_si256((__m256i *)lanes, acc);
+	it = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+
+	for ( ; i < numwords; i++)
+		it += _mm_popcnt_u64(flags[i]);
+
+	return it;
+}
+
+#endif
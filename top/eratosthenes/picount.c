@@ -0,0 +1,585 @@
+/*----------------------------------------------------------------------
+This source distribution is placed in the public domain by its author,
+Ben Buhrow. You may use it for any purpose, free of charge,
+without having to notify anyone. I disclaim any responsibility for any
+errors.
+
+Optionally, please be nice and tell me if you find this source to be
+useful. Again optionally, if you add to the functionality present here
+please consider making those additions public too, so that others may
+benefit from your work.
+
+       				   --bbuhrow@gmail.com 7/1/10
+----------------------------------------------------------------------*/
+
+#include "soe.h"
+
+/*
+   combinatorial prime counting, after Lagarias, Miller and Odlyzko with
+   the segmented special leaf sieve of Deleglise and Rivat.  with
+   x^(1/3) <= y <= x^(1/2) and a = pi(y),
+
+   pi(x) = phi(x,a) + a - 1 - P2(x,a)
+
+   where phi(x,a) counts the n <= x with no prime factor <= p_a, and P2
+   counts the n <= x with exactly two prime factors > p_a.
+
+   phi(x,a) = S1 + S2.  the ordinary leaves S1 are summed directly over
+   the squarefree n <= y using a table of phi(n,c) for the first c primes.
+   the special leaves S2 need phi(x/(p_b*m), b-1) with x/(p_b*m) < x/y, and
+   are found by sieving [1, x/y] a segment at a time, keeping a binary
+   indexed tree over the segment for the counts.  segments are independent
+   apart from the running count of survivors below them, so a batch of
+   them is sieved at once by the SoE worker threads and the counts are
+   stitched together afterwards.
+
+   P2 needs pi(x/p) for the primes y < p <= sqrt(x), which come from a
+   streaming pass of the SoE over [sqrt(x), x/y].
+
+   the work is about O(x^(2/3)) instead of O(x) to sieve the whole range.
+   memory is dominated by the tables up to y and the primes up to sqrt(x).
+*/
+
+static uint64 pi_isqrt(uint64 x)
+{
+	uint64 r = (uint64)sqrt((double)x);
+
+	while (r * r > x)
+		r--;
+	while ((r + 1) * (r + 1) <= x)
+		r++;
+
+	return r;
+}
+
+static uint64 pi_icbrt(uint64 x)
+{
+	uint64 r = (uint64)pow((double)x, 1.0 / 3.0);
+
+	while (r * r * r > x)
+		r--;
+	while ((r + 1) * (r + 1) * (r + 1) <= x)
+		r++;
+
+	return r;
+}
+
+static uint32 pi_tree_prefix(uint32 *tree, int32 i)
+{
+	// number of survivors in positions [0, i] of the segment
+	uint32 sum = 0;
+
+	for (; i >= 0; i = (i & (i + 1)) - 1)
+		sum += tree[i];
+
+	return sum;
+}
+
+void pi_sieve_segment(pi_segdata_t *s)
+{
+	// sieve the segment [low, high) of [1, x/y] with the primes p_(c+1)
+	// through p_(last_b), counting the special leaves of each prime
+	// along the way.  counts are relative to the start of the segment;
+	// the caller adds in the survivors below it.
+	uint64 x = s->x;
+	uint64 y = s->y;
+	uint64 low = s->low;
+	uint64 xlow = x / low;
+	uint64 xhigh = x / s->high;
+	uint32 size = (uint32)(s->high - low);
+	uint32 count;
+	uint32 b, i, j, r;
+	uint8 *sieve = s->sieve;
+	uint32 *tree = s->tree;
+
+	// start with the numbers coprime to the first c primes
+	r = (uint32)(low % PI_PHI_PRIMORIAL);
+	for (i = 0; i < size; i += j)
+	{
+		j = PI_PHI_PRIMORIAL - r;
+		if (j > size - i)
+			j = size - i;
+		memcpy(sieve + i, s->coprime + r, j);
+		r = 0;
+	}
+
+	count = 0;
+	for (i = 0; i < size; i++)
+	{
+		tree[i] = sieve[i];
+		count += sieve[i];
+	}
+	for (i = 0; i < size; i++)
+	{
+		j = i | (i + 1);
+		if (j < size)
+			tree[j] += tree[i];
+	}
+
+	s->s2 = 0;
+	for (b = s->c + 1; b <= s->last_b; b++)
+	{
+		uint64 p = s->primes[b];
+		uint64 m, mlo, mhi, k;
+
+		s->seg_count[b] = count;
+		s->leaf_mu[b] = 0;
+
+		// the leaves x/(p*m) in this segment, with m > y/p and
+		// lpf(m) > p, have m in (max(y/p, xhigh/p), min(y, xlow/p)]
+		mhi = xlow / p;
+		if (mhi > y)
+			mhi = y;
+		mlo = xhigh / p;
+		if (mlo < y / p)
+			mlo = y / p;
+
+		if (b <= s->b_sqrty)
+		{
+			for (m = mhi; m > mlo; m--)
+			{
+				if ((s->mu[m] != 0) && (s->lpf[m] > p))
+				{
+					uint64 n = x / (p * m);
+
+					s->s2 -= s->mu[m] * (int64)pi_tree_prefix(tree, (int32)(n - low));
+					s->leaf_mu[b] -= s->mu[m];
+				}
+			}
+		}
+		else if (mhi > mlo)
+		{
+			// p^2 > y, so m has to be a prime > p, and only the leaves
+			// that can't be counted from the pi table are left here
+			if (mhi > s->hard_max[b])
+				mhi = s->hard_max[b];
+			if (mlo < p)
+				mlo = p;
+			for (k = s->pi_tab[mhi]; (mhi > mlo) && (s->primes[k] > mlo); k--)
+			{
+				uint64 n = x / (p * s->primes[k]);
+
+				s->s2 += pi_tree_prefix(tree, (int32)(n - low));
+				s->leaf_mu[b]++;
+			}
+		}
+
+		// then remove the multiples of p, including p itself
+		k = ((low + p - 1) / p) * p;
+		for (; k < s->high; k += p)
+		{
+			i = (uint32)(k - low);
+			if (sieve[i])
+			{
+				sieve[i] = 0;
+				count--;
+				for (; i < size; i |= i + 1)
+					tree[i]--;
+			}
+		}
+	}
+
+	return;
+}
+
+void pi_easy_leaves(pi_segdata_t *s)
+{
+	// the special leaves x/(p*q) for the primes p_b > sqrt(y), for which
+	// m is a prime q > p.  n = x/(p*q) < p leaves phi(n, b-1) = 1, and
+	// when n < p^2 and n <= y, phi(n, b-1) = pi(n) - b + 2 from the table.
+	// runs of q that give the same pi(n) are counted together.  the
+	// largest q whose leaf needs the sieve is left in hard_max.
+	uint64 x = s->x;
+	uint64 y = s->y;
+	uint32 *primes = s->primes;
+	uint32 *pi_tab = s->pi_tab;
+	uint32 a = s->a;
+	uint32 b;
+
+	s->s2 = 0;
+	for (b = s->b_start; b < a; b += s->b_step)
+	{
+		uint64 p = primes[b];
+		uint64 x2 = x / p;
+		uint64 qlo, qhi, qsparse;
+		uint32 l, l2;
+
+		// trivial leaves: q > x2/p
+		qhi = x2 / p;
+		if (qhi < y)
+			s->s2 += a - pi_tab[(qhi > p) ? qhi : p];
+		else
+			qhi = y;
+		if (qhi <= p)
+			continue;
+
+		// easy leaves: n < min(p^2, y + 1)
+		qlo = (p * p <= y) ? x2 / (p * p) : x2 / (y + 1);
+		if (qlo < p)
+			qlo = p;
+		if (qlo < qhi)
+			s->hard_max[b] = (uint32)qlo;
+		else
+			s->hard_max[b] = (uint32)qhi;
+
+		// for q > sqrt(x2) successive leaves are mostly far enough apart 
+		// that there are no runs to find
+		qsparse = (uint64)sqrt((double)x2);
+		if (qsparse < qlo)
+			qsparse = qlo;
+
+		l = pi_tab[qhi];
+		while (primes[l] > qsparse)
+		{
+			s->s2 += (int64)pi_tab[x2 / primes[l]] - b + 2;
+			l--;
+		}
+
+		while (primes[l] > qlo)
+		{
+			uint32 pi_n = pi_tab[x2 / primes[l]];
+			uint64 qm = (pi_n < a) ? x2 / primes[pi_n + 1] : 0;
+
+			l2 = pi_tab[(qm > qlo) ? qm : qlo];
+			s->s2 += (int64)(pi_n - b + 2) * (int64)(l - l2);
+			l = l2;
+		}
+	}
+
+	return;
+}
+
+static void pi_run_threads(thread_soedata_t *thread_data, uint32 num, 
+	enum soe_command command)
+{
+	// run the command on threads 0 through num-1, the last of them in
+	// this thread, and wait for them all to finish
+	uint32 j;
+
+	for (j = 0; j < num; j++)
+	{
+		thread_soedata_t *t = thread_data + j;
+
+		if (j == (num - 1))
+		{
+			if (command == SOE_COMPUTE_PI_EASY)
+				pi_easy_leaves(t->pidata);
+			else
+				pi_sieve_segment(t->pidata);
+		}
+		else
+		{
+			t->command = command;
+#if defined(WIN32) || defined(_WIN64)
+			SetEvent(t->run_event);
+#else
+			pthread_cond_signal(&t->run_cond);
+			pthread_mutex_unlock(&t->run_lock);
+#endif
+		}
+	}
+
+	for (j = 0; j < num - 1; j++)
+	{
+		thread_soedata_t *t = thread_data + j;
+
+#if defined(WIN32) || defined(_WIN64)
+		WaitForSingleObject(t->finish_event, INFINITE);
+#else
+		pthread_mutex_lock(&t->run_lock);
+		while (t->command != SOE_COMMAND_WAIT)
+			pthread_cond_wait(&t->run_cond, &t->run_lock);
+#endif
+	}
+
+	return;
+}
+
+uint64 pi_lmo(uint32 *seed_p, uint32 num_sp, uint64 x)
+{
+	uint64 y, z, sqrtx, seg_size, low;
+	uint64 i, j, n, pi;
+	uint64 *phi;
+	int64 s1, s2, p2;
+	uint32 a, c, b, b_sqrty, num_seg;
+	uint32 *hard_max;
+	uint32 *primes, *pi_tab, *lpf;
+	int8 *mu;
+	uint16 *phi_tab;
+	uint8 *coprime;
+	uint32 *p2_primes;
+	uint64 num_p2, alloc_p2;
+	double alpha;
+	pi_segdata_t *segs;
+	thread_soedata_t *thread_data;
+	soe_iterator_t it;
+	struct timeval start, stop;
+	TIME_DIFF *	difference;
+	double t_time;
+
+	if (x < PI_LMO_MIN)
+	{
+		soe_wrapper(seed_p, num_sp, 0, x, 1, &n);
+		return n;
+	}
+
+	gettimeofday(&start, NULL);
+
+	// balance the special leaf sieve, which gets cheaper as y grows,
+	// against the easy leaves, which get more numerous.  alpha was 
+	// tuned by hand between 1e12 and 1e16.  y must stay below sqrt(x).
+	sqrtx = pi_isqrt(x);
+	alpha = 2.0 * log((double)x) / log(10.0) - 12.0;
+	if (alpha < 1.0)
+		alpha = 1.0;
+	y = (uint64)(alpha * (double)pi_icbrt(x));
+	if (y > sqrtx / 2)
+		y = sqrtx / 2;
+	z = x / y;
+
+	// tables up to y: least prime factor, moebius, pi and the primes
+	lpf = (uint32 *)calloc(y + 1, sizeof(uint32));
+	mu = (int8 *)malloc((y + 1) * sizeof(int8));
+	pi_tab = (uint32 *)malloc((y + 1) * sizeof(uint32));
+	if ((lpf == NULL) || (mu == NULL) || (pi_tab == NULL))
+	{
+		printf("unable to allocate tables to %" PRIu64 " for prime counting\n", y);
+		exit(1);
+	}
+
+	a = 0;
+	for (i = 2; i <= y; i++)
+	{
+		if (lpf[i] == 0)
+		{
+			a++;
+			for (j = i; j <= y; j += i)
+			{
+				if (lpf[j] == 0)
+					lpf[j] = (uint32)i;
+			}
+		}
+		pi_tab[i] = a;
+	}
+	pi_tab[0] = pi_tab[1] = 0;
+
+	// 1 has no prime factors, so it passes every lpf(m) > p test
+	mu[1] = 1;
+	lpf[1] = 0xffffffff;
+	for (i = 2; i <= y; i++)
+	{
+		uint64 m = i / lpf[i];
+
+		if ((m > 1) && (lpf[m] == lpf[i]))
+			mu[i] = 0;
+		else
+			mu[i] = -mu[m];
+	}
+
+	// primes[0] is a sentinel for the prime leaf loops
+	primes = (uint32 *)malloc((a + 1) * sizeof(uint32));
+	primes[0] = 0;
+	for (i = 2, j = 1; i <= y; i++)
+	{
+		if (lpf[i] == i)
+			primes[j++] = (uint32)i;
+	}
+
+	c = PI_PHI_C;
+	b_sqrty = 0;
+	while ((b_sqrty + 1 <= a) && ((uint64)primes[b_sqrty + 1] * primes[b_sqrty + 1] <= y))
+		b_sqrty++;
+
+	phi_tab = (uint16 *)malloc(PI_PHI_PRIMORIAL * sizeof(uint16));
+	coprime = (uint8 *)malloc(PI_PHI_PRIMORIAL * sizeof(uint8));
+	phi_tab[0] = 0;
+	coprime[0] = 0;
+	for (i = 1; i < PI_PHI_PRIMORIAL; i++)
+	{
+		for (j = 1; j <= c; j++)
+		{
+			if ((i % primes[j]) == 0)
+				break;
+		}
+		coprime[i] = (j > c);
+		phi_tab[i] = phi_tab[i - 1] + coprime[i];
+	}
+
+	if (VFLAG > 0)
+		printf("pi: x = %" PRIu64 ", y = %" PRIu64 ", a = %u, sieving to %" PRIu64 "\n",
+			x, y, a, z);
+
+	// ordinary leaves
+	s1 = 0;
+	for (i = 1; i <= y; i++)
+	{
+		if ((mu[i] != 0) && (lpf[i] > primes[c]))
+		{
+			n = x / i;
+			s1 += mu[i] * (int64)((n / PI_PHI_PRIMORIAL) * PI_PHI_TOTIENT +
+				phi_tab[n % PI_PHI_PRIMORIAL]);
+		}
+	}
+
+	// P2: pi(x/p) for the primes y < p <= sqrt(x), in decreasing order
+	// of p so that x/p increases and pi can be counted as we go.
+	alloc_p2 = 1024;
+	num_p2 = 0;
+	p2_primes = (uint32 *)malloc(alloc_p2 * sizeof(uint32));
+	soe_iter_init(&it, seed_p, num_sp, y + 1, sqrtx);
+	while ((n = soe_iter_next(&it)) != 0)
+	{
+		if (num_p2 == alloc_p2)
+		{
+			alloc_p2 *= 2;
+			p2_primes = (uint32 *)realloc(p2_primes, alloc_p2 * sizeof(uint32));
+		}
+		p2_primes[num_p2++] = (uint32)n;
+	}
+	soe_iter_free(&it);
+
+	soe_wrapper(seed_p, num_sp, 0, sqrtx, 1, &pi);
+	p2 = 0;
+	if ((num_p2 > 0) && (x / p2_primes[0] > sqrtx))
+	{
+		soe_iter_init(&it, seed_p, num_sp, sqrtx + 1, x / p2_primes[0]);
+		n = soe_iter_next(&it);
+		for (i = num_p2; i > 0; i--)
+		{
+			uint64 t = x / p2_primes[i - 1];
+
+			while ((n != 0) && (n <= t))
+			{
+				pi++;
+				n = soe_iter_next(&it);
+			}
+
+			// pi(x/p) - pi(p) + 1, with pi(p) = a + i
+			p2 += (int64)pi - (int64)(a + i) + 1;
+		}
+		soe_iter_free(&it);
+	}
+	free(p2_primes);
+
+	// special leaves: the easy ones first, with each thread taking every
+	// THREADS'th prime, then the rest by sieving [1, z] in segments, a
+	// batch of THREADS at a time
+	seg_size = 65536;
+	while ((seg_size * seg_size < z) && (seg_size < 4194304))
+		seg_size *= 2;
+
+	phi = (uint64 *)calloc(a + 1, sizeof(uint64));
+	hard_max = (uint32 *)calloc(a + 1, sizeof(uint32));
+	segs = (pi_segdata_t *)malloc(THREADS * sizeof(pi_segdata_t));
+	thread_data = (thread_soedata_t *)malloc(THREADS * sizeof(thread_soedata_t));
+	for (i = 0; i < (uint64)THREADS; i++)
+	{
+		pi_segdata_t *s = segs + i;
+
+		s->x = x;
+		s->y = y;
+		s->primes = primes;
+		s->a = a;
+		s->c = c;
+		s->b_sqrty = b_sqrty;
+		s->hard_max = hard_max;
+		s->pi_tab = pi_tab;
+		s->lpf = lpf;
+		s->mu = mu;
+		s->phi_tab = phi_tab;
+		s->coprime = coprime;
+		s->b_start = b_sqrty + 1 + (uint32)i;
+		s->b_step = THREADS;
+		s->sieve = (uint8 *)malloc(seg_size * sizeof(uint8));
+		s->tree = (uint32 *)malloc(seg_size * sizeof(uint32));
+		s->leaf_mu = (int64 *)malloc((a + 1) * sizeof(int64));
+		s->seg_count = (uint32 *)malloc((a + 1) * sizeof(uint32));
+		thread_data[i].pidata = s;
+	}
+
+	for (i = 0; i < (uint64)THREADS - 1; i++)
+		start_soe_worker_thread(thread_data + i, 0);
+	start_soe_worker_thread(thread_data + i, 1);
+
+	pi_run_threads(thread_data, THREADS, SOE_COMPUTE_PI_EASY);
+	s2 = 0;
+	for (i = 0; i < (uint64)THREADS; i++)
+		s2 += segs[i].s2;
+
+	low = 1;
+	while (low <= z)
+	{
+		// set up the next batch
+		for (num_seg = 0; (num_seg < (uint32)THREADS) && (low <= z); num_seg++)
+		{
+			pi_segdata_t *s = segs + num_seg;
+			uint64 sq;
+
+			s->low = low;
+			s->high = low + seg_size;
+			if (s->high > z + 1)
+				s->high = z + 1;
+			low = s->high;
+
+			// primes with p^2 > x/low have no leaves here or above,
+			// so they needn't be sieved
+			sq = pi_isqrt(x / s->low);
+			if (sq >= y)
+				s->last_b = a - 1;
+			else
+				s->last_b = pi_tab[sq];
+			if (s->last_b > a - 1)
+				s->last_b = a - 1;
+		}
+
+		pi_run_threads(thread_data, num_seg, SOE_COMPUTE_PI_LEAVES);
+
+		// stitch the segments together in order
+		for (j = 0; j < num_seg; j++)
+		{
+			pi_segdata_t *s = segs + j;
+
+			s2 += s->s2;
+			for (b = c + 1; b <= s->last_b; b++)
+			{
+				s2 += s->leaf_mu[b] * (int64)phi[b];
+				phi[b] += s->seg_count[b];
+			}
+		}
+	}
+
+	for (i = 0; i < (uint64)THREADS - 1; i++)
+		stop_soe_worker_thread(thread_data + i, 0);
+
+	pi = (uint64)(s1 + s2 + (int64)a - 1 - p2);
+
+	gettimeofday(&stop, NULL);
+	difference = my_difftime(&start, &stop);
+	t_time = ((double)difference->secs + (double)difference->usecs / 1000000);
+	free(difference);
+
+	if (VFLAG > 0)
+		printf("pi: S1 = %" PRId64 ", S2 = %" PRId64 ", P2 = %" PRId64
+			", %u segments of %" PRIu64 ", elapsed time = %6.4f\n",
+			s1, s2, p2, (uint32)((z + seg_size - 1) / seg_size), seg_size, t_time);
+
+	for (i = 0; i < (uint64)THREADS; i++)
+	{
+		free(segs[i].sieve);
+		free(segs[i].tree);
+		free(segs[i].leaf_mu);
+		free(segs[i].seg_count);
+	}
+	free(segs);
+	free(thread_data);
+	free(phi);
+	free(hard_max);
+	free(phi_tab);
+	free(coprime);
+	free(primes);
+	free(pi_tab);
+	free(lpf);
+	free(mu);
+
+	return pi;
+}
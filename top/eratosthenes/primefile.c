@@ -0,0 +1,344 @@
+/*----------------------------------------------------------------------
+This source distribution is placed in the public domain by its author,
+Ben Buhrow. You may use it for any purpose, free of charge,
+without having to notify anyone. I disclaim any responsibility for any
+errors.
+
+Optionally, please be nice and tell me if you find this source to be
+useful. Again optionally, if you add to the functionality present here
+please consider making those additions public too, so that others may
+benefit from your work.
+
+       				   --bbuhrow@gmail.com 7/1/10
+----------------------------------------------------------------------*/
+
+#include "soe.h"
+
+#if !defined(WIN32) && !defined(_WIN64)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// binary prime tables.  the file is a header of 8 64-bit words:
+//
+//	magic, lowlimit, highlimit, number of primes, checkpoint interval,
+//	number of checkpoints, file offset of the checkpoint index,
+//	file offset of the gap data
+//
+// followed by the gap data and then the checkpoint index.  every
+// SOE_TABLE_CHECKPOINT'th prime (starting with the first) is a checkpoint:
+// its value is stored in the index, next to the file offset of the gap
+// that follows it, and no gap is stored for it.  all other primes are
+// stored as half the gap from the previous prime, 7 bits per byte with the
+// top bit set on all but the last byte.  the one odd gap, from 2 to 3, is
+// stored as 0.  nearly all gaps below 2^64 take one byte.
+
+static const char soe_table_magic[8] = {'Y','A','F','U','P','R','M','1'};
+
+int soe_table_create(soe_table_writer_t *w, char *filename,
+	uint64 lowlimit, uint64 highlimit)
+{
+	uint64 header[SOE_TABLE_HEADER_WORDS];
+
+	w->fid = fopen(filename, "wb");
+	if (w->fid == NULL)
+	{
+		printf("fopen error: %s\n", strerror(errno));
+		printf("can't open %s for writing\n", filename);
+		return 1;
+	}
+
+	w->lowlimit = lowlimit;
+	w->highlimit = highlimit;
+	w->num_p = 0;
+	w->last = 0;
+	w->pos = sizeof(header);
+	w->num_index = 0;
+	w->alloc_index = 1024;
+	w->index = (uint64 *)malloc(2 * w->alloc_index * sizeof(uint64));
+
+	// the header is filled in by soe_table_finish
+	memset(header, 0, sizeof(header));
+	fwrite(header, sizeof(uint64), SOE_TABLE_HEADER_WORDS, w->fid);
+
+	return 0;
+}
+
+void soe_table_append(soe_table_writer_t *w, uint64 *primes, uint64 num_p)
+{
+	// add a batch of primes, which must be larger than any already added
+	uint8 buf[4096];
+	int n = 0;
+	uint64 i, d;
+
+	for (i = 0; i < num_p; i++)
+	{
+		if ((w->num_p % SOE_TABLE_CHECKPOINT) == 0)
+		{
+			// checkpoint: flush first, so that the offset is right
+			fwrite(buf, 1, n, w->fid);
+			w->pos += n;
+			n = 0;
+
+			if (w->num_index == w->alloc_index)
+			{
+				w->alloc_index *= 2;
+				w->index = (uint64 *)realloc(w->index,
+					2 * w->alloc_index * sizeof(uint64));
+			}
+			w->index[2 * w->num_index] = primes[i];
+			w->index[2 * w->num_index + 1] = w->pos;
+			w->num_index++;
+		}
+		else
+		{
+			d = (primes[i] - w->last) >> 1;
+			while (d >= 0x80)
+			{
+				buf[n++] = (uint8)(d | 0x80);
+				d >>= 7;
+			}
+			buf[n++] = (uint8)d;
+
+			if (n > (int)(sizeof(buf) - 16))
+			{
+				fwrite(buf, 1, n, w->fid);
+				w->pos += n;
+				n = 0;
+			}
+		}
+
+		w->last = primes[i];
+		w->num_p++;
+	}
+
+	fwrite(buf, 1, n, w->fid);
+	w->pos += n;
+
+	return;
+}
+
+void soe_table_finish(soe_table_writer_t *w)
+{
+	uint64 header[SOE_TABLE_HEADER_WORDS];
+
+	fwrite(w->index, sizeof(uint64), 2 * w->num_index, w->fid);
+
+	memcpy(&header[0], soe_table_magic, 8);
+	header[1] = w->lowlimit;
+	header[2] = w->highlimit;
+	header[3] = w->num_p;
+	header[4] = SOE_TABLE_CHECKPOINT;
+	header[5] = w->num_index;
+	header[6] = w->pos;
+	header[7] = sizeof(header);
+
+	rewind(w->fid);
+	fwrite(header, sizeof(uint64), SOE_TABLE_HEADER_WORDS, w->fid);
+	fclose(w->fid);
+	free(w->index);
+
+	if (VFLAG > 0)
+		printf("wrote %" PRIu64 " primes in %" PRIu64 " bytes\n",
+			w->num_p, w->pos + 16 * w->num_index);
+
+	return;
+}
+
+int soe_table_open(soe_table_t *t, char *filename)
+{
+	// map a prime table into memory.  nothing is read until it is used,
+	// and the pages are shared with any other process using the same table.
+	uint64 *header;
+
+#if defined(WIN32) || defined(_WIN64)
+	LARGE_INTEGER sz;
+
+	t->file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (t->file == INVALID_HANDLE_VALUE)
+	{
+		printf("can't open prime table %s\n", filename);
+		return 1;
+	}
+	GetFileSizeEx(t->file, &sz);
+	t->size = (uint64)sz.QuadPart;
+
+	t->map = CreateFileMappingA(t->file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (t->map == NULL)
+	{
+		printf("can't map prime table %s\n", filename);
+		CloseHandle(t->file);
+		return 1;
+	}
+	t->base = (uint8 *)MapViewOfFile(t->map, FILE_MAP_READ, 0, 0, 0);
+	if (t->base == NULL)
+	{
+		printf("can't map prime table %s\n", filename);
+		CloseHandle(t->map);
+		CloseHandle(t->file);
+		return 1;
+	}
+#else
+	struct stat st;
+
+	t->fd = open(filename, O_RDONLY);
+	if (t->fd < 0)
+	{
+		printf("fopen error: %s\n", strerror(errno));
+		printf("can't open prime table %s\n", filename);
+		return 1;
+	}
+	fstat(t->fd, &st);
+	t->size = (uint64)st.st_size;
+
+	t->base = (uint8 *)mmap(NULL, t->size, PROT_READ, MAP_SHARED, t->fd, 0);
+	if (t->base == (uint8 *)MAP_FAILED)
+	{
+		printf("mmap error: %s\n", strerror(errno));
+		close(t->fd);
+		return 1;
+	}
+#endif
+
+	header = (uint64 *)t->base;
+	if ((t->size < SOE_TABLE_HEADER_WORDS * sizeof(uint64)) ||
+		(memcmp(header, soe_table_magic, 8) != 0) ||
+		(header[6] + 16 * header[5] > t->size) ||
+		(header[4] == 0) || (header[3] == 0))
+	{
+		printf("%s is not a yafu prime table\n", filename);
+		soe_table_close(t);
+		return 1;
+	}
+
+	t->lowlimit = header[1];
+	t->highlimit = header[2];
+	t->num_p = header[3];
+	t->interval = header[4];
+	t->num_index = header[5];
+	t->index = (uint64 *)(t->base + header[6]);
+
+	// start before the first prime
+	t->next_id = 0;
+	t->cur = 0;
+	t->ptr = t->base + header[7];
+
+	return 0;
+}
+
+uint64 soe_table_next(soe_table_t *t)
+{
+	// return the next prime in the table, or 0 at the end
+	uint64 d;
+	int s;
+
+	if (t->next_id >= t->num_p)
+		return 0;
+
+	if ((t->next_id % t->interval) == 0)
+	{
+		t->cur = t->index[2 * (t->next_id / t->interval)];
+		t->ptr = t->base + t->index[2 * (t->next_id / t->interval) + 1];
+	}
+	else
+	{
+		d = 0;
+		s = 0;
+		while (*t->ptr & 0x80)
+		{
+			d |= (uint64)(*t->ptr++ & 0x7f) << s;
+			s += 7;
+		}
+		d |= (uint64)(*t->ptr++) << s;
+
+		if (t->cur == 2)
+			t->cur = 3;
+		else
+			t->cur += 2 * d;
+	}
+
+	t->next_id++;
+	return t->cur;
+}
+
+uint64 soe_table_seek(soe_table_t *t, uint64 value)
+{
+	// return the first prime >= value, or 0 if there is none in the table.
+	// soe_table_next continues from there.
+	uint64 lo = 0, hi = t->num_index, mid, p;
+
+	// last checkpoint <= value
+	while (hi - lo > 1)
+	{
+		mid = (lo + hi) / 2;
+		if (t->index[2 * mid] <= value)
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	t->next_id = lo * t->interval;
+	do
+	{
+		p = soe_table_next(t);
+	} while ((p != 0) && (p < value));
+
+	return p;
+}
+
+void soe_table_close(soe_table_t *t)
+{
+#if defined(WIN32) || defined(_WIN64)
+	UnmapViewOfFile(t->base);
+	CloseHandle(t->map);
+	CloseHandle(t->file);
+#else
+	munmap(t->base, t->size);
+	close(t->fd);
+#endif
+	return;
+}
+
+uint64 *soe_table_load(char *filename, uint64 lowlimit, uint64 highlimit, uint64 *num_p)
+{
+	// read the primes in [lowlimit, highlimit] from a prime table into a
+	// new array.  returns NULL if the table can't be used.
+	soe_table_t t;
+	uint64 *primes;
+	uint64 p, n = 0, alloc;
+
+	*num_p = 0;
+	if (soe_table_open(&t, filename))
+		return NULL;
+
+	alloc = 1024;
+	if (MAX(lowlimit, t.lowlimit) < MIN(highlimit, t.highlimit))
+		alloc += estimate_primes_in_range(MAX(lowlimit, t.lowlimit),
+			MIN(highlimit, t.highlimit));
+	if (alloc > t.num_p)
+		alloc = t.num_p;
+	primes = (uint64 *)malloc(alloc * sizeof(uint64));
+
+	for (p = soe_table_seek(&t, lowlimit); (p != 0) && (p <= highlimit);
+		p = soe_table_next(&t))
+	{
+		if (n == alloc)
+		{
+			alloc += alloc / 4 + 1024;
+			primes = (uint64 *)realloc(primes, alloc * sizeof(uint64));
+		}
+		primes[n++] = p;
+	}
+
+	soe_table_close(&t);
+
+	if (n == 0)
+	{
+		free(primes);
+		return NULL;
+	}
+
+	*num_p = n;
+	return primes;
+}
@@ -0,0 +1,352 @@
+/*----------------------------------------------------------------------
+This source distribution is placed in the public domain by its author,
+Ben Buhrow. You may use it for any purpose, free of charge,
+without having to notify anyone. I disclaim any responsibility for any
+errors.
+
+Optionally, please be nice and tell me if you find this source to be
+useful. Again optionally, if you add to the functionality present here
+please consider making those additions public too, so that others may
+benefit from your work.
+
+       				   --bbuhrow@gmail.com 7/1/10
+----------------------------------------------------------------------*/
+
+#include "soe.h"
+#include "mpz_aprcl.h"
+
+// PRP checks of the values that survive sieve_to_depth.  the values are
+// all about the same size, so the strong pseudoprime tests are done with
+// montgomery arithmetic on a fixed number of limbs, straight from the mpn
+// layer, with the scratch space for a whole batch set up once.  survivors
+// of those get a strong lucas test, done the same way, which together 
+// with the base 2 test makes a strong BPSW test.
+
+static const uint32 prp_bases[16] = {
+	2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53};
+
+void soe_prp_init(soe_prp_t *b, int num_witnesses)
+{
+	b->num_witnesses = num_witnesses;
+	if (b->num_witnesses < 1)
+		b->num_witnesses = 1;
+	if (b->num_witnesses > 16)
+		b->num_witnesses = 16;
+	return;
+}
+
+#if GMP_LIMB_BITS == 64
+
+static void mont_redc(mp_limb_t *r, mp_limb_t *t, const mp_limb_t *n,
+	mp_size_t k, mp_limb_t nhat)
+{
+	// r = t / 2^(64k) mod n, for t < n * 2^(64k).  t has 2k limbs and
+	// is overwritten.  the carry out of each row is stored in the limb
+	// that row cleared, and they are all added in at the end.
+	mp_limb_t c;
+	mp_size_t i;
+
+	for (i = 0; i < k; i++)
+	{
+		c = mpn_addmul_1(t + i, n, k, t[i] * nhat);
+		t[i] = c;
+	}
+
+	c = mpn_add_n(r, t + k, t, k);
+	if (c || (mpn_cmp(r, n, k) >= 0))
+		mpn_sub_n(r, r, n, k);
+
+	return;
+}
+
+static void mont_mul(soe_prp_t *b, mp_limb_t *r, const mp_limb_t *x, 
+	const mp_limb_t *y, const mp_limb_t *n, mp_size_t k)
+{
+	// r = x * y / 2^(64k) mod n.  r may be x or y.
+	if (x == y)
+		mpn_sqr(b->t, x, k);
+	else
+		mpn_mul_n(b->t, x, y, k);
+	mont_redc(r, b->t, n, k, b->nhat);
+
+	return;
+}
+
+static void mont_sub(mp_limb_t *r, const mp_limb_t *x, const mp_limb_t *y,
+	const mp_limb_t *n, mp_size_t k)
+{
+	// r = x - y mod n, for x, y < n
+	if (mpn_sub_n(r, x, y, k))
+		mpn_add_n(r, r, n, k);
+
+	return;
+}
+
+static void mont_setup(soe_prp_t *b, const mp_limb_t *n, mp_size_t k)
+{
+	// the constants for montgomery arithmetic mod odd n, k limbs, which 
+	// all of the bases share
+	mp_limb_t *t = b->t;
+	mp_size_t i;
+	int j;
+
+	// nhat = -1/n mod 2^64, by newton iteration: 5 steps from 3 good bits
+	b->nhat = n[0];
+	for (j = 0; j < 5; j++)
+		b->nhat *= 2 - n[0] * b->nhat;
+	b->nhat = -b->nhat;
+
+	// R mod n and n - R mod n, the montgomery forms of 1 and -1
+	for (i = 0; i < k; i++)
+		t[i] = 0;
+	t[k] = 1;
+	mpn_tdiv_qr(b->q, b->one, 0, t, k + 1, n, k);
+	mpn_sub_n(b->mone, n, b->one, k);
+
+	// n - 1 = d * 2^s, d odd.  n is odd, so above bit 0 the bits of 
+	// n - 1 are those of n.
+	b->s = 1;
+	while (((n[b->s >> 6] >> (b->s & 63)) & 1) == 0)
+		b->s++;
+
+	b->top = (int)(k * 64) - 1;
+	while (((n[b->top >> 6] >> (b->top & 63)) & 1) == 0)
+		b->top--;
+
+	return;
+}
+
+static int mont_sprp(soe_prp_t *b, const mp_limb_t *n, mp_size_t k, uint32 base)
+{
+	// strong pseudoprime test of n > base, with the constants from 
+	// mont_setup.  x is kept in montgomery form throughout, so checks 
+	// against 1 and -1 are checks against b->one and b->mone.
+	mp_limb_t *one = b->one, *mone = b->mone, *x = b->x;
+	mp_limb_t *am = b->am, *t = b->t;
+	mp_limb_t nhat = b->nhat;
+	mp_size_t i;
+	int r, j;
+
+	// the montgomery form of the base, when it is not 2
+	if (base != 2)
+	{
+		t[k] = mpn_mul_1(t, one, k, base);
+		mpn_tdiv_qr(b->q, am, 0, t, k + 1, n, k);
+	}
+
+	// base^d, left to right over the bits of n - 1 from the top down to
+	// bit s.  multiplying by 2 is a shift and a conditional subtract.
+	if (base == 2)
+	{
+		if (mpn_lshift(x, one, k, 1) || (mpn_cmp(x, n, k) >= 0))
+			mpn_sub_n(x, x, n, k);
+	}
+	else
+	{
+		for (i = 0; i < k; i++)
+			x[i] = am[i];
+	}
+
+	for (j = b->top - 1; j >= b->s; j--)
+	{
+		mpn_sqr(t, x, k);
+		mont_redc(x, t, n, k, nhat);
+
+		if ((n[j >> 6] >> (j & 63)) & 1)
+		{
+			if (base == 2)
+			{
+				if (mpn_lshift(x, x, k, 1) || (mpn_cmp(x, n, k) >= 0))
+					mpn_sub_n(x, x, n, k);
+			}
+			else
+			{
+				mpn_mul_n(t, x, am, k);
+				mont_redc(x, t, n, k, nhat);
+			}
+		}
+	}
+
+	if ((mpn_cmp(x, one, k) == 0) || (mpn_cmp(x, mone, k) == 0))
+		return 1;
+
+	for (r = 1; r < b->s; r++)
+	{
+		mpn_sqr(t, x, k);
+		mont_redc(x, t, n, k, nhat);
+
+		if (mpn_cmp(x, mone, k) == 0)
+			return 1;
+		if (mpn_cmp(x, one, k) == 0)
+			return 0;
+	}
+
+	return 0;
+}
+
+static int mont_lucas(soe_prp_t *b, mpz_t n, const mp_limb_t *nl, mp_size_t k)
+{
+	// strong lucas test of n with selfridge's parameters: the first D in
+	// 5, -7, 9, -11, ... with (D/n) = -1, P = 1 and Q = (1 - D)/4.  with
+	// n + 1 = d * 2^s, n passes if U_d = 0 or V_(d*2^r) = 0 for some 
+	// r < s.  only V and Q^k are carried along the chain; U_d follows 
+	// from D * U_d = 2 * V_(d+1) - P * V_d, and D is a unit mod n.
+	mp_limb_t *v = b->v, *v1 = b->v1, *qk = b->qk, *qm = b->qm;
+	mp_limb_t *w = b->x, *np1 = b->np1, *t = b->t;
+	mp_size_t i, ke;
+	long d = 5, q;
+	int j, r, s, top;
+
+	while (1)
+	{
+		j = mpz_si_kronecker(d, n);
+		if (j == -1)
+			break;
+
+		// n is much bigger than d, so d divides n
+		if (j == 0)
+			return 0;
+
+		// squares never give -1, so check for them before going on
+		if ((d == 13) && mpz_perfect_square_p(n))
+			return 0;
+
+		if (d > 0)
+			d = -(d + 2);
+		else
+			d = -d + 2;
+	}
+
+	q = (1 - d) / 4;
+	if (mpz_gcd_ui(NULL, n, (q < 0) ? -q : q) > 1)
+		return 0;
+
+	// the montgomery form of Q
+	t[k] = mpn_mul_1(t, b->one, k, (q < 0) ? -q : q);
+	mpn_tdiv_qr(b->q, qm, 0, t, k + 1, nl, k);
+	if (q < 0)
+		mpn_sub_n(qm, nl, qm, k);
+
+	// bits of n + 1
+	np1[k] = mpn_add_1(np1, nl, k, 1);
+	ke = k + (np1[k] != 0);
+
+	s = 0;
+	while (((np1[s >> 6] >> (s & 63)) & 1) == 0)
+		s++;
+
+	top = (int)(ke * 64) - 1;
+	while (((np1[top >> 6] >> (top & 63)) & 1) == 0)
+		top--;
+
+	// V_1 = P, V_2 = P^2 - 2Q, Q^1 = Q
+	for (i = 0; i < k; i++)
+	{
+		v[i] = b->one[i];
+		qk[i] = qm[i];
+	}
+	mont_sub(v1, v, qm, nl, k);
+	mont_sub(v1, v1, qm, nl, k);
+
+	// from (V_k, V_(k+1), Q^k) to those at 2k or 2k+1, over the bits of 
+	// n + 1 from the top down to bit s
+	for (j = top - 1; j >= s; j--)
+	{
+		if ((np1[j >> 6] >> (j & 63)) & 1)
+		{
+			// V_(2k+1) = V_k * V_(k+1) - P * Q^k
+			// V_(2k+2) = V_(k+1)^2 - 2 * Q^(k+1)
+			// Q^(2k+1) = Q^k * Q^(k+1)
+			mont_mul(b, v, v, v1, nl, k);
+			mont_sub(v, v, qk, nl, k);
+			mont_mul(b, w, qk, qm, nl, k);
+			mont_mul(b, v1, v1, v1, nl, k);
+			mont_sub(v1, v1, w, nl, k);
+			mont_sub(v1, v1, w, nl, k);
+			mont_mul(b, qk, qk, w, nl, k);
+		}
+		else
+		{
+			// V_(2k+1) = V_k * V_(k+1) - P * Q^k
+			// V_(2k) = V_k^2 - 2 * Q^k
+			// Q^(2k) = (Q^k)^2
+			mont_mul(b, v1, v, v1, nl, k);
+			mont_sub(v1, v1, qk, nl, k);
+			mont_mul(b, v, v, v, nl, k);
+			mont_sub(v, v, qk, nl, k);
+			mont_sub(v, v, qk, nl, k);
+			mont_mul(b, qk, qk, qk, nl, k);
+		}
+	}
+
+	// U_d = 0 or V_d = 0
+	if (mpn_add_n(w, v1, v1, k) || (mpn_cmp(w, nl, k) >= 0))
+		mpn_sub_n(w, w, nl, k);
+	if ((mpn_cmp(w, v, k) == 0) || mpn_zero_p(v, k))
+		return 1;
+
+	// V_(d*2^r) = 0
+	for (r = 1; r < s; r++)
+	{
+		mont_mul(b, v, v, v, nl, k);
+		mont_sub(v, v, qk, nl, k);
+		mont_sub(v, v, qk, nl, k);
+		if (mpn_zero_p(v, k))
+			return 1;
+		mont_mul(b, qk, qk, qk, nl, k);
+	}
+
+	return 0;
+}
+
+#endif
+
+int soe_prp(soe_prp_t *b, mpz_t n)
+{
+	// is n a probable prime: a strong pseudoprime to each of the first
+	// num_witnesses prime bases, and a strong lucas pseudoprime
+	int i, ret;
+
+	// small values aren't worth setting up for
+	if (mpz_size(n) < 2)
+		return is_mpz_prp(n);
+
+	if (mpz_even_p(n))
+		return 0;
+
+#if GMP_LIMB_BITS == 64
+	if (mpz_size(n) <= SOE_PRP_MAXLIMBS)
+	{
+		const mp_limb_t *nl = n->_mp_d;
+		mp_size_t k = mpz_size(n);
+
+		mont_setup(b, nl, k);
+		for (i = 0; i < b->num_witnesses; i++)
+		{
+			if (!mont_sprp(b, nl, k, prp_bases[i]))
+				return 0;
+		}
+
+		return mont_lucas(b, n, nl, k);
+	}
+	else
+#endif
+	{
+		mpz_t a;
+
+		mpz_init(a);
+		for (i = 0; i < b->num_witnesses; i++)
+		{
+			mpz_set_ui(a, prp_bases[i]);
+			if (mpz_sprp(n, a) == PRP_COMPOSITE)
+			{
+				mpz_clear(a);
+				return 0;
+			}
+		}
+		mpz_clear(a);
+	}
+
+	ret = mpz_strongselfridge_prp(n);
+	return ((ret == PRP_PRP) || (ret == PRP_PRIME));
+}
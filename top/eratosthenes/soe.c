@@ -14,87 +14,113 @@ benefit from your work.
 
 #include "soe.h"
 
-uint64 spSOE(uint32 *sieve_p, uint32 num_sp, mpz_t *offset,
-	uint64 lowlimit, uint64 *highlimit, int count, uint64 *primes)
+static uint64 soe_sieve(soe_staticdata_t *sdata, uint32 *sieve_p, uint32 num_sp, 
+	mpz_t *offset, uint64 lowlimit, uint64 *highlimit, int count, uint64 *primes)
 {
 	/*
-	if count == 1, then the primes are simply counted, and not 
-	explicitly calculated and saved in *primes.
-
-	otherwise, store primes in the provided *primes array
-
-	in either case, return the number of primes found
+	the sieve behind spSOE and spSOE_sum.  count is as for spSOE, or 2 
+	when the primes are summed into sdata->sum and sdata->sqrsum (and also 
+	counted).
 	*/
 
 	//keep track of how much memory we've used
 	uint64 allocated_bytes = 0;
 
-	//structure of static info
-	soe_staticdata_t sdata;
-
 	//thread data holds all data needed during sieving
 	thread_soedata_t *thread_data;		//an array of thread data objects
 
 	//*********************** BEGIN ******************************//
 	
 	//sanity check the input
-	sdata.only_count = count;
-	if (check_input(*highlimit, lowlimit, num_sp, sieve_p, &sdata, *offset))
+	sdata->only_count = count;
+	if (check_input(*highlimit, lowlimit, num_sp, sieve_p, sdata, *offset))
 		return 0;
 
 	//determine what kind of sieve to used based on the input
-	get_numclasses(*highlimit, lowlimit, &sdata);
+	get_numclasses(*highlimit, lowlimit, sdata);
 
 	//allocate and initialize some stuff
-	allocated_bytes += init_sieve(&sdata);
-	*highlimit = sdata.highlimit;
+	allocated_bytes += init_sieve(sdata);
+	*highlimit = sdata->highlimit;
 	
 	//allocate thread data structure
 	thread_data = (thread_soedata_t *)malloc(THREADS * sizeof(thread_soedata_t));
 
 	//find all roots of prime with prodN.  These are used when finding offsets.
-	getRoots(&sdata, thread_data);
+	getRoots(sdata, thread_data);
 
 	//init bucket sieving
-	set_bucket_depth(&sdata);
+	set_bucket_depth(sdata);
 
 	//initialize stuff used in thread structures.
 	//this is necessary even if THREADS = 1;	
-	allocated_bytes += alloc_threaddata(&sdata, thread_data);
+	allocated_bytes += alloc_threaddata(sdata, thread_data);
 
 	if (VFLAG > 2)
 	{	
-		printf("finding requested range %" PRIu64 " to %" PRIu64 "\n",sdata.orig_llimit,sdata.orig_hlimit);
+		printf("finding requested range %" PRIu64 " to %" PRIu64 "\n",sdata->orig_llimit,sdata->orig_hlimit);
 		printf("sieving range %" PRIu64 " to %" PRIu64 "\n",lowlimit,*highlimit);
-		//if (sdata.sieve_range)
-		//	gmp_printf("range offset is %Zd\n", sdata.offset);
-		printf("using %" PRIu64 " primes, max prime = %" PRIu64 "  \n",sdata.pboundi,sdata.pbound);
-		printf("using %u residue classes\n",sdata.numclasses);
-		printf("lines have %" PRIu64 " bytes and %" PRIu64 " flags\n",sdata.numlinebytes,sdata.numlinebytes * 8);
-		printf("lines broken into = %" PRIu64 " blocks of size %u\n",sdata.blocks,BLOCKSIZE);
-		printf("blocks contain %u flags and cover %" PRIu64 " primes\n", FLAGSIZE, sdata.blk_r);
-		if (sdata.num_bucket_primes > 0)
+		//if (sdata->sieve_range)
+		//	gmp_printf("range offset is %Zd\n", sdata->offset);
+		printf("using %" PRIu64 " primes, max prime = %" PRIu64 "  \n",sdata->pboundi,sdata->pbound);
+		printf("using %u residue classes\n",sdata->numclasses);
+		printf("lines have %" PRIu64 " bytes and %" PRIu64 " flags\n",sdata->numlinebytes,sdata->numlinebytes * 8);
+		printf("lines broken into = %" PRIu64 " blocks of size %u\n",sdata->blocks,BLOCKSIZE);
+		printf("blocks contain %u flags and cover %" PRIu64 " primes\n", FLAGSIZE, sdata->blk_r);
+		if (sdata->num_bucket_primes > 0)
 		{
 			printf("bucket sieving %u primes > %u\n",
-				sdata.num_bucket_primes,sdata.sieve_p[sdata.bucket_start_id]);
-			printf("allocating space for %u hits per bucket\n",sdata.bucket_alloc);
-			printf("allocating space for %u hits per large bucket\n",sdata.large_bucket_alloc);
+				sdata->num_bucket_primes,sdata->sieve_p[sdata->bucket_start_id]);
+			printf("allocating space for %u hits per bucket\n",sdata->bucket_alloc);
+			printf("allocating space for %u hits per large bucket\n",sdata->large_bucket_alloc);
 		}
-		if (sdata.num_inplace_primes > 0)
+		if (sdata->num_inplace_primes > 0)
 		{
 			printf("inplace sieving %u primes > %u\n",
-				sdata.num_inplace_primes,sdata.sieve_p[sdata.inplace_start_id]);
+				sdata->num_inplace_primes,sdata->sieve_p[sdata->inplace_start_id]);
 		}
 		printf("using %" PRIu64 " bytes for sieving storage\n",allocated_bytes);
 	}
 
 	//get 'r done.
-	do_soe_sieving(&sdata, thread_data, count);
+	do_soe_sieving(sdata, thread_data, count);
 
 	//finish up
-	finalize_sieve(&sdata, thread_data, count, primes);
+	finalize_sieve(sdata, thread_data, count, primes);
+
+	return sdata->num_found;
+}
+
+uint64 spSOE(uint32 *sieve_p, uint32 num_sp, mpz_t *offset,
+	uint64 lowlimit, uint64 *highlimit, int count, uint64 *primes)
+{
+	/*
+	if count == 1, then the primes are simply counted, and not 
+	explicitly calculated and saved in *primes.
+
+	otherwise, store primes in the provided *primes array
+
+	in either case, return the number of primes found
+	*/
+	soe_staticdata_t sdata;
+
+	sdata.sum = NULL;
+	sdata.sqrsum = NULL;
+	return soe_sieve(&sdata, sieve_p, num_sp, offset, lowlimit, highlimit, count, primes);
+}
+
+uint64 spSOE_sum(uint32 *sieve_p, uint32 num_sp, uint64 lowlimit, 
+	uint64 *highlimit, mpz_t *sum, mpz_t *sqrsum)
+{
+	//add the primes in the range, and their squares, to sum and sqrsum.
+	//each thread sums its own lines, like counting, and the line sums are
+	//added up as the lines finish.  returns the number of primes found.
+	soe_staticdata_t sdata;
 
-	return sdata.num_found;
+	init_sum_tables();
+	sdata.sum = sum;
+	sdata.sqrsum = sqrsum;
+	return soe_sieve(&sdata, sieve_p, num_sp, NULL, lowlimit, highlimit, 2, NULL);
 }
 
 void do_soe_sieving(soe_staticdata_t *sdata, thread_soedata_t *thread_data, int count)
@@ -111,6 +137,15 @@ void do_soe_sieving(soe_staticdata_t *sdata, thread_soedata_t *thread_data, int
 
 	start_soe_worker_thread(thread_data + i, 1);
 
+	if (count == 2)
+	{
+		for (i = 0; i < THREADS; i++)
+		{
+			mpz_init(thread_data[i].linesum);
+			mpz_init(thread_data[i].linesqr);
+		}
+	}
+
 	//main sieve, line by line
 	k = 0;	//count total lines processed
 	pchar = 0;
@@ -136,7 +171,15 @@ void do_soe_sieving(soe_staticdata_t *sdata, thread_soedata_t *thread_data, int
 
 			if (i == j - 1) {
 				
-				if (count)
+				if (count == 2)
+				{
+					t->sdata.lines[t->current_line] = 
+						(uint8 *)malloc(t->sdata.numlinebytes * sizeof(uint8));
+					sieve_line(t);
+					sum_line(t);
+					free(t->sdata.lines[t->current_line]);
+				}
+				else if (count)
 				{
 					t->sdata.lines[t->current_line] = 
 						(uint8 *)malloc(t->sdata.numlinebytes * sizeof(uint8));
@@ -150,7 +193,9 @@ void do_soe_sieving(soe_staticdata_t *sdata, thread_soedata_t *thread_data, int
 				}
 			}
 			else {
-				if (count)
+				if (count == 2)
+					t->command = SOE_COMMAND_SIEVE_AND_SUM;
+				else if (count)
 					t->command = SOE_COMMAND_SIEVE_AND_COUNT;
 				else
 					t->command = SOE_COMMAND_SIEVE_AND_COMPUTE;
@@ -197,6 +242,15 @@ void do_soe_sieving(soe_staticdata_t *sdata, thread_soedata_t *thread_data, int
 
 		}
 
+		if (count == 2)
+		{
+			for (i = 0; i < j; i++)
+			{
+				mpz_add(*sdata->sum, *sdata->sum, thread_data[i].linesum);
+				mpz_add(*sdata->sqrsum, *sdata->sqrsum, thread_data[i].linesqr);
+			}
+		}
+
 		for (i = 0; i < j; i++)
 		{
 			if (thread_data[i].ddata.min_sieved_val < sdata->min_sieved_val)
@@ -210,6 +264,15 @@ void do_soe_sieving(soe_staticdata_t *sdata, thread_soedata_t *thread_data, int
 	sdata->num_found = num_p;
 #endif
 
+	if (count == 2)
+	{
+		for (i = 0; i < THREADS; i++)
+		{
+			mpz_clear(thread_data[i].linesum);
+			mpz_clear(thread_data[i].linesqr);
+		}
+	}
+
 	//stop the worker threads and free stuff not needed anymore
 	for (i=0; i<THREADS - 1; i++)
 	{
@@ -377,6 +440,7 @@ void finalize_sieve(soe_staticdata_t *sdata,
 	{
 		//add in relevant sieving primes not captured in the flag arrays
 		uint64 ui_offset;
+		mpz_t tmpz;
 
 		if (sdata->sieve_range)
 		{
@@ -402,13 +466,23 @@ void finalize_sieve(soe_staticdata_t *sdata,
 
 		//PRIMES is already sized appropriately by the wrapper
 		//load in the sieve primes that we need
+		mpz_init(tmpz);
 		i = 0;
 		while (((uint64)sdata->sieve_p[i] < sdata->min_sieved_val) && (i < sdata->bucket_start_id))
 		{
 			if (sdata->sieve_p[i] >= (sdata->orig_llimit + ui_offset))		
+			{
 				num_p++;
+				if (count == 2)
+				{
+					mpz_add_ui(*sdata->sum, *sdata->sum, sdata->sieve_p[i]);
+					mpz_set_64(tmpz, (uint64)sdata->sieve_p[i] * (uint64)sdata->sieve_p[i]);
+					mpz_add(*sdata->sqrsum, *sdata->sqrsum, tmpz);
+				}
+			}
 			i++;
 		}
+		mpz_clear(tmpz);
 		//printf("added %u primes\n", (uint32)(num_p - sdata->num_found));
 	}
 	else
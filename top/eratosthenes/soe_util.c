@@ -261,6 +261,15 @@ uint64 init_sieve(soe_staticdata_t *sdata)
 	}
 
 	//compute the breakpoints at which we switch to other sieving methods	
+	sdata->presieve_max_id = 10;
+#if defined(USE_AVX2)
+	if (HAS_AVX2 && (sdata->pboundi > SOE_PRESIEVE_NUMP))
+	{
+		pre_sieve_avx2_init();
+		sdata->presieve_max_id = SOE_PRESIEVE_NUMP;
+	}
+#endif
+
 	if (sdata->pboundi > BUCKETSTARTI)
 	{
 		sdata->bucket_start_id = BUCKETSTARTI;
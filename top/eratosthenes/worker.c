@@ -97,6 +97,14 @@ void *soe_worker_thread_main(void *thread_data) {
 			t->linecount = count_line(&t->sdata, t->current_line);
 			free(t->sdata.lines[t->current_line]);
 		}
+		else if (t->command == SOE_COMMAND_SIEVE_AND_SUM)
+		{
+			t->sdata.lines[t->current_line] = 
+				(uint8 *)malloc(t->sdata.numlinebytes * sizeof(uint8));
+			sieve_line(t);
+			sum_line(t);
+			free(t->sdata.lines[t->current_line]);
+		}
 		else if (t->command == SOE_COMMAND_SIEVE_AND_COMPUTE)
 		{
 			sieve_line(t);
@@ -170,11 +178,19 @@ void *soe_worker_thread_main(void *thread_data) {
 				mpz_add_ui(t->tmpz, t->offset, t->ddata.primes[i - t->startid]);
 				if ((mpz_cmp(t->tmpz, t->lowlimit) >= 0) && (mpz_cmp(t->highlimit, t->tmpz) >= 0))
 				{
-					if (is_mpz_prp(t->tmpz))
+					if (soe_prp(&t->prp, t->tmpz))
 						t->ddata.primes[t->linecount++] = t->ddata.primes[i - t->startid];
 				}
 			}
 		}
+		else if (t->command == SOE_COMPUTE_PI_EASY)
+		{
+			pi_easy_leaves(t->pidata);
+		}
+		else if (t->command == SOE_COMPUTE_PI_LEAVES)
+		{
+			pi_sieve_segment(t->pidata);
+		}
 		else if (t->command == SOE_COMMAND_END)
 			break;
 
@@ -95,23 +95,16 @@ uint64 *GetPRIMESRange(uint32 *sieve_p, uint32 num_sp,
 	return primes;
 }
 
-uint64 *soe_wrapper(uint32 *seed_p, uint32 num_sp, 
-	uint64 lowlimit, uint64 highlimit, int count, uint64 *num_p)
+static uint32 *get_sieve_primes(uint32 *seed_p, uint32 *num_sp, uint64 highlimit)
 {
-	//public interface to the sieve.  
-	uint64 retval, tmpl, tmph, i;
-	uint32 max_p;	
+	//the primes needed to sieve up to highlimit: the seed primes if they are
+	//enough, otherwise more found with the seed primes.  num_sp is updated.
+	uint64 retval, i;
+	uint32 max_p;
 	uint32 *sieve_p;
 	uint64 *primes = NULL;
 
-	if (highlimit < lowlimit)
-	{
-		printf("error: lowlimit must be less than highlimit\n");
-		*num_p = 0;
-		return primes;
-	}	
-
-	if (highlimit > (seed_p[num_sp-1] * seed_p[num_sp-1]))
+	if (highlimit > (seed_p[*num_sp-1] * seed_p[*num_sp-1]))
 	{
 		//then we need to generate more sieving primes
 		uint32 range_est;
@@ -131,11 +124,11 @@ uint64 *soe_wrapper(uint32 *seed_p, uint32 num_sp,
 
 		//find the sieving primes using the seed primes
 		NO_STORE = 0;
-		primes = GetPRIMESRange(seed_p, num_sp, NULL, 0, max_p, &retval);
+		primes = GetPRIMESRange(seed_p, *num_sp, NULL, 0, max_p, &retval);
 		for (i=0; i<retval; i++)
 			sieve_p[i] = (uint32)primes[i];
 		printf("found %u sieving primes\n",(uint32)retval);
-		num_sp = (uint32)retval;
+		*num_sp = (uint32)retval;
 		free(primes);
 		primes = NULL;
 		//NO_STORE = 1;
@@ -143,20 +136,40 @@ uint64 *soe_wrapper(uint32 *seed_p, uint32 num_sp,
 	else
 	{
 		//seed primes are enough
-		sieve_p = (uint32 *)malloc((size_t) (num_sp * sizeof(uint32)));
+		sieve_p = (uint32 *)malloc((size_t) (*num_sp * sizeof(uint32)));
 		//NO_STORE = 1;
 
 		if (sieve_p == NULL)
 		{
 			printf("unable to allocate %u bytes for %u sieving primes\n",
-				num_sp * (uint32)sizeof(uint32), num_sp);
+				*num_sp * (uint32)sizeof(uint32), *num_sp);
 			exit(1);
 		}
 
-		for (i=0; i<num_sp; i++)
+		for (i=0; i<*num_sp; i++)
 			sieve_p[i] = seed_p[i];
 	}
 
+	return sieve_p;
+}
+
+uint64 *soe_wrapper(uint32 *seed_p, uint32 num_sp, 
+	uint64 lowlimit, uint64 highlimit, int count, uint64 *num_p)
+{
+	//public interface to the sieve.  
+	uint64 retval, tmpl, tmph, i;
+	uint32 *sieve_p;
+	uint64 *primes = NULL;
+
+	if (highlimit < lowlimit)
+	{
+		printf("error: lowlimit must be less than highlimit\n");
+		*num_p = 0;
+		return primes;
+	}	
+
+	sieve_p = get_sieve_primes(seed_p, &num_sp, highlimit);
+
 	if (count)
 	{
 		//this needs to be a range of at least 1e6
@@ -266,7 +279,20 @@ uint64 *soe_wrapper(uint32 *seed_p, uint32 num_sp,
 		// now dump the requested range of primes to a file, or the
 		// screen, both, or neither, depending on the state of a couple
 		// global configuration variables
-		if (PRIMES_TO_FILE)
+		if (PRIMES_TO_FILE && PRIMES_BINARY)
+		{
+			soe_table_writer_t table;
+			uint64 j;
+
+			if (soe_table_create(&table, "primes.bin", lowlimit, highlimit) == 0)
+			{
+				for (i = 0; (i < *num_p) && (primes[i] < lowlimit); i++);
+				for (j = i; (j < *num_p) && (primes[j] <= highlimit); j++);
+				soe_table_append(&table, primes + i, j - i);
+				soe_table_finish(&table);
+			}
+		}
+		else if (PRIMES_TO_FILE)
 		{
 			FILE *out;
 			out = fopen("primes.dat","w");
@@ -301,6 +327,83 @@ uint64 *soe_wrapper(uint32 *seed_p, uint32 num_sp,
 	return primes;
 }
 
+uint64 soe_sum(uint32 *seed_p, uint32 num_sp, 
+	uint64 lowlimit, uint64 highlimit, mpz_t sum, mpz_t sqrsum)
+{
+	//public interface to prime summation: set sum and sqrsum to the sum 
+	//of the primes in [lowlimit, highlimit] and the sum of their squares.
+	//returns the number of primes.
+	uint64 num_p = 0, retval, tmpl, tmph, stop, i;
+	uint64 maxrange = 100000000000ULL;
+	uint32 *sieve_p;
+	uint64 *primes;
+	mpz_t s, sq;
+
+	mpz_set_ui(sum, 0);
+	mpz_set_ui(sqrsum, 0);
+
+	if (highlimit < lowlimit)
+	{
+		printf("error: lowlimit must be less than highlimit\n");
+		return 0;
+	}	
+
+	sieve_p = get_sieve_primes(seed_p, &num_sp, highlimit);
+
+	//this needs to be a range of at least 1e6
+	if ((highlimit - lowlimit) < 1000000)
+	{
+		primes = GetPRIMESRange(sieve_p, num_sp, NULL, lowlimit, lowlimit + 1000000, &retval);
+
+		mpz_init(s);
+		for (i = 0; i < retval; i++)
+		{
+			if (primes[i] >= lowlimit && primes[i] <= highlimit)
+			{
+				mpz_set_64(s, primes[i]);
+				mpz_add(sum, sum, s);
+				mpz_addmul(sqrsum, s, s);
+				num_p++;
+			}
+		}
+		mpz_clear(s);
+		free(primes);
+		free(sieve_p);
+		return num_p;
+	}
+
+	//step through big ranges.  the pieces include both of their ends, so
+	//they must not overlap, and the last one is kept at least 1e6 long.
+	mpz_init(s);
+	mpz_init(sq);
+	tmpl = lowlimit;
+	do
+	{
+		if ((highlimit - tmpl) > (maxrange + 1000000))
+			stop = tmpl + maxrange;
+		else
+			stop = highlimit;
+
+		//spSOE_sum may move tmph up to the end of its last sieve line
+		tmph = stop;
+		mpz_set_ui(s, 0);
+		mpz_set_ui(sq, 0);
+		num_p += spSOE_sum(sieve_p, num_sp, tmpl, &tmph, &s, &sq);
+		mpz_add(sum, sum, s);
+		mpz_add(sqrsum, sqrsum, sq);
+
+		if (VFLAG > 1)
+			printf("so far, found %" PRIu64 " primes\n", num_p);
+
+		tmpl = stop + 1;
+	} while (stop < highlimit);
+
+	mpz_clear(s);
+	mpz_clear(sq);
+	free(sieve_p);
+	return num_p;
+}
+
 uint64 *sieve_to_depth(uint32 *seed_p, uint32 num_sp, 
 	mpz_t lowlimit, mpz_t highlimit, int count, int num_witnesses, uint64 *num_p)
 {
@@ -464,6 +567,9 @@ uint64 *sieve_to_depth(uint32 *seed_p, uint32 num_sp,
 			if (thread_data[THREADS-1].stopid != (uint32)*num_p)
 				thread_data[THREADS-1].stopid = (uint32)*num_p;
 
+			for (j = 0; j < THREADS; j++)
+				soe_prp_init(&thread_data[j].prp, num_witnesses);
+
 			// allocate space for stuff in the threads
 			if (THREADS == 1)
 			{
@@ -500,7 +606,7 @@ uint64 *sieve_to_depth(uint32 *seed_p, uint32 num_sp,
 					t->linecount = 0;
 					for (i = t->startid; i < t->stopid; i++)
 					{
-						if (((i & 128) == 0) && (VFLAG > 0))
+						if (((i & 127) == 0) && (VFLAG > 0))
 						{
 							int k;
 							for (k = 0; k<pchar; k++)
@@ -512,7 +618,7 @@ uint64 *sieve_to_depth(uint32 *seed_p, uint32 num_sp,
 						mpz_add_ui(tmpz, *offset, t->ddata.primes[i - t->startid]);
 						if ((mpz_cmp(tmpz, lowlimit) >= 0) && (mpz_cmp(highlimit, tmpz) >= 0))
 						{
-							if (is_mpz_prp(tmpz))
+							if (soe_prp(&t->prp, tmpz))
 								t->ddata.primes[t->linecount++] = t->ddata.primes[i - t->startid];
 						}
 					}
@@ -651,4 +757,310 @@ uint64 *sieve_to_depth(uint32 *seed_p, uint32 num_sp,
 	return values;
 }
 
+// streaming interface to the sieve.  the range is sieved in segments of
+// SOE_ITER_SEGMENT, by a producer thread which stays one segment ahead
+// of the consumer, so that memory use doesn't depend on the size of
+// the range.  the producer calls the usual sieve, which uses the worker 
+// threads, so the consumer must not use the sieve itself while iterating.
+
+static uint64 *soe_iter_segment(soe_iterator_t *it, uint64 lo, uint64 hi, uint64 *num_p)
+{
+	// find the primes in [lo, hi)
+	uint64 *primes;
+	uint64 tmph = hi;
+	uint64 n, i;
+
+	// the sieve wants ranges of at least 1e6; there is slack built into
+	// the sieve limit, so just make the range bigger and trim it after
+	if ((tmph - lo) < 1000000)
+		tmph = lo + 1000000;
+
+	primes = GetPRIMESRange(it->sieve_p, it->num_sp, NULL, lo, tmph, &n);
+
+	for (i = 0; i < n; i++)
+	{
+		if (primes[i] >= lo)
+			break;
+	}
+	if (i > 0)
+	{
+		memmove(primes, primes + i, (n - i) * sizeof(uint64));
+		n -= i;
+	}
+
+	while ((n > 0) && (primes[n - 1] >= hi))
+		n--;
+
+	*num_p = n;
+	return primes;
+}
+
+#if defined(WIN32) || defined(_WIN64)
+DWORD WINAPI soe_iter_producer(LPVOID thread_data) {
+#else
+void *soe_iter_producer(void *thread_data) {
+#endif
+	soe_iterator_t *it = (soe_iterator_t *)thread_data;
+
+	while (!it->stop && (it->next_low <= it->highlimit))
+	{
+		uint64 lo = it->next_low;
+		uint64 hi, n;
+		uint64 *primes;
+
+		// segments are half open, the last one ends just past highlimit
+		if ((it->highlimit - lo) >= SOE_ITER_SEGMENT)
+			hi = lo + SOE_ITER_SEGMENT;
+		else
+			hi = it->highlimit + 1;
+
+		primes = soe_iter_segment(it, lo, hi, &n);
+		it->next_low = hi;
+
+		// wait for the consumer to take the last batch, then hand over this one
+#if defined(WIN32) || defined(_WIN64)
+		while (1)
+		{
+			WaitForSingleObject(it->lock, INFINITE);
+			if (!it->ahead_ready || it->stop)
+				break;
+			ReleaseMutex(it->lock);
+			WaitForSingleObject(it->space_event, INFINITE);
+		}
+#else
+		pthread_mutex_lock(&it->lock);
+		while (it->ahead_ready && !it->stop)
+			pthread_cond_wait(&it->cond, &it->lock);
+#endif
+
+		if (it->stop)
+			free(primes);
+		else
+		{
+			it->ahead = primes;
+			it->ahead_num = n;
+			it->ahead_ready = 1;
+		}
+
+#if defined(WIN32) || defined(_WIN64)
+		ReleaseMutex(it->lock);
+		SetEvent(it->ready_event);
+#else
+		pthread_cond_broadcast(&it->cond);
+		pthread_mutex_unlock(&it->lock);
+#endif
+	}
+
+	// tell the consumer there is nothing more coming
+#if defined(WIN32) || defined(_WIN64)
+	WaitForSingleObject(it->lock, INFINITE);
+	it->done = 1;
+	ReleaseMutex(it->lock);
+	SetEvent(it->ready_event);
+	return 0;
+#else
+	pthread_mutex_lock(&it->lock);
+	it->done = 1;
+	pthread_cond_broadcast(&it->cond);
+	pthread_mutex_unlock(&it->lock);
+	return NULL;
+#endif
+}
+
+void soe_iter_init(soe_iterator_t *it, uint32 *seed_p, uint32 num_sp, 
+	uint64 lowlimit, uint64 highlimit)
+{
+	// set up an iterator over the primes in [lowlimit, highlimit], and
+	// start sieving the first segment
+	uint64 i;
+
+	it->lowlimit = lowlimit;
+	it->highlimit = highlimit;
+	it->next_low = lowlimit;
+	it->batch = NULL;
+	it->batch_num = 0;
+	it->batch_pos = 0;
+	it->ahead = NULL;
+	it->ahead_num = 0;
+	it->ahead_ready = 0;
+	it->done = 0;
+	it->stop = 0;
+
+	if (highlimit < lowlimit)
+	{
+		printf("error: lowlimit must be less than highlimit\n");
+		it->next_low = highlimit + 1;
+	}
+
+	if (highlimit > ((uint64)seed_p[num_sp-1] * (uint64)seed_p[num_sp-1]))
+	{
+		// we need more sieving primes than we were given.  find them
+		// once, here, instead of for every segment.
+		uint64 *primes;
+		uint64 max_p, n;
+
+		max_p = (uint64)sqrt((double)highlimit) + 65536;
+		primes = GetPRIMESRange(seed_p, num_sp, NULL, 0, max_p, &n);
+		it->sieve_p = (uint32 *)malloc(n * sizeof(uint32));
+		if (it->sieve_p == NULL)
+		{
+			printf("unable to allocate %u bytes for %u sieving primes\n",
+				(uint32)(n * sizeof(uint32)), (uint32)n);
+			exit(1);
+		}
+		for (i = 0; i < n; i++)
+			it->sieve_p[i] = (uint32)primes[i];
+		it->num_sp = (uint32)n;
+		free(primes);
+	}
+	else
+	{
+		it->sieve_p = (uint32 *)malloc(num_sp * sizeof(uint32));
+		if (it->sieve_p == NULL)
+		{
+			printf("unable to allocate %u bytes for %u sieving primes\n",
+				num_sp * (uint32)sizeof(uint32), num_sp);
+			exit(1);
+		}
+		memcpy(it->sieve_p, seed_p, num_sp * sizeof(uint32));
+		it->num_sp = num_sp;
+	}
+
+#if defined(WIN32) || defined(_WIN64)
+	it->lock = CreateMutex(NULL, FALSE, NULL);
+	it->ready_event = CreateEvent(NULL, FALSE, FALSE, NULL);
+	it->space_event = CreateEvent(NULL, FALSE, FALSE, NULL);
+	it->thread_id = CreateThread(NULL, 0, soe_iter_producer, it, 0, NULL);
+#else
+	pthread_mutex_init(&it->lock, NULL);
+	pthread_cond_init(&it->cond, NULL);
+	pthread_create(&it->thread_id, NULL, soe_iter_producer, it);
+#endif
+
+	return;
+}
+
+uint64 *soe_iter_next_batch(soe_iterator_t *it, uint64 *num_p)
+{
+	// cursor interface: return the next batch of primes, in order, or NULL
+	// once the range is finished.  the batch belongs to the iterator, and 
+	// is only valid until the next call.
+	free(it->batch);
+	it->batch = NULL;
+	it->batch_num = 0;
+	it->batch_pos = 0;
+
+	while (1)
+	{
+#if defined(WIN32) || defined(_WIN64)
+		while (1)
+		{
+			WaitForSingleObject(it->lock, INFINITE);
+			if (it->ahead_ready || it->done)
+				break;
+			ReleaseMutex(it->lock);
+			WaitForSingleObject(it->ready_event, INFINITE);
+		}
+#else
+		pthread_mutex_lock(&it->lock);
+		while (!it->ahead_ready && !it->done)
+			pthread_cond_wait(&it->cond, &it->lock);
+#endif
+
+		if (it->ahead_ready)
+		{
+			it->batch = it->ahead;
+			it->batch_num = it->ahead_num;
+			it->ahead = NULL;
+			it->ahead_ready = 0;
+		}
+
+		// let the producer get going on the next segment
+#if defined(WIN32) || defined(_WIN64)
+		ReleaseMutex(it->lock);
+		SetEvent(it->space_event);
+#else
+		pthread_cond_broadcast(&it->cond);
+		pthread_mutex_unlock(&it->lock);
+#endif
+
+		if (it->batch == NULL)
+			break;
+
+		// skip any segments with no primes in them
+		if (it->batch_num > 0)
+			break;
+
+		free(it->batch);
+		it->batch = NULL;
+	}
+
+	*num_p = it->batch_num;
+	return it->batch;
+}
+
+uint64 soe_iter_next(soe_iterator_t *it)
+{
+	// cursor interface, one prime at a time.  returns 0 once the range
+	// is finished.
+	uint64 n;
+
+	if (it->batch_pos >= it->batch_num)
+	{
+		if (soe_iter_next_batch(it, &n) == NULL)
+			return 0;
+	}
+
+	return it->batch[it->batch_pos++];
+}
+
+void soe_iter_free(soe_iterator_t *it)
+{
+	// stop the producer, which may be in the middle of a segment, and 
+	// free everything
+#if defined(WIN32) || defined(_WIN64)
+	WaitForSingleObject(it->lock, INFINITE);
+	it->stop = 1;
+	ReleaseMutex(it->lock);
+	SetEvent(it->space_event);
+	WaitForSingleObject(it->thread_id, INFINITE);
+	CloseHandle(it->thread_id);
+	CloseHandle(it->ready_event);
+	CloseHandle(it->space_event);
+	CloseHandle(it->lock);
+#else
+	pthread_mutex_lock(&it->lock);
+	it->stop = 1;
+	pthread_cond_broadcast(&it->cond);
+	pthread_mutex_unlock(&it->lock);
+	pthread_join(it->thread_id, NULL);
+	pthread_cond_destroy(&it->cond);
+	pthread_mutex_destroy(&it->lock);
+#endif
+
+	free(it->ahead);
+	free(it->batch);
+	free(it->sieve_p);
+	return;
+}
+
+uint64 soe_foreach(uint32 *seed_p, uint32 num_sp, uint64 lowlimit, uint64 highlimit,
+	soe_callback_t cb, void *user)
+{
+	// callback interface: cb is handed the primes in [lowlimit, highlimit],
+	// in order, a batch at a time.  returns the number of primes.
+	soe_iterator_t it;
+	uint64 *primes;
+	uint64 n, total = 0;
+
+	soe_iter_init(&it, seed_p, num_sp, lowlimit, highlimit);
+	while ((primes = soe_iter_next_batch(&it, &n)) != NULL)
+	{
+		cb(primes, n, user);
+		total += n;
+	}
+	soe_iter_free(&it);
+
+	return total;
+}
 
@@ -30,6 +30,10 @@ code to the public domain.
 #include "yafu_string.h"
 #include "soe.h"
 
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
 const char* szFeatures[] =
 {
     "x87 FPU On Chip",
@@ -1002,6 +1006,163 @@ int qcomp_double(const void *x, const void *y)
 		return -1;
 }
 
+/* large page allocations ---------------------------------------------
+
+   Big arrays that are scattered into (the siqs bucket lists, factor
+   base and root update arrays) take a TLB miss on nearly every access
+   when backed by 4k pages.  xmalloc_huge tries explicitly reserved
+   2MB pages first (hugetlbfs / MEM_LARGE_PAGES), then a 2MB aligned
+   mapping marked for transparent huge pages, and falls back to an
+   ordinary aligned allocation.  Each block starts with a small header
+   recording how it was obtained, so huge_free can release any of them.
+----------------------------------------------------------------------*/
+
+typedef struct
+{
+	void *base;			// start of the mapping or malloc'ed block
+	size_t len;			// length of the mapping
+	int kind;			// one of enum huge_page_kind
+} huge_hdr_t;
+
+#define HUGE_HDR_SIZE 64
+
+#if defined(__linux__)
+static int thp_state = -1;
+
+static int thp_available(void)
+{
+	// check once whether the kernel will honor MADV_HUGEPAGE
+	FILE *fid;
+	char str[256];
+
+	if (thp_state >= 0)
+		return thp_state;
+
+	thp_state = 0;
+	fid = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+	if (fid != NULL)
+	{
+		if (fgets(str, 256, fid) != NULL)
+			thp_state = (strstr(str, "[never]") == NULL);
+		fclose(fid);
+	}
+
+	return thp_state;
+}
+#endif
+
+void *xmalloc_huge(size_t len, int *kind)
+{
+	huge_hdr_t *hdr;
+	uint8 *base = NULL;
+	size_t maplen = (len + HUGE_HDR_SIZE + HUGE_PAGE_SIZE - 1) & 
+		~((size_t)HUGE_PAGE_SIZE - 1);
+
+	*kind = HUGE_PAGE_NONE;
+
+	// not worth a huge page
+	if (len < HUGE_PAGE_SIZE / 2)
+		goto fallback;
+
+#if defined(__linux__)
+
+#ifdef MAP_HUGETLB
+	base = (uint8 *)mmap(NULL, maplen, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (base != (uint8 *)MAP_FAILED)
+	{
+		*kind = HUGE_PAGE_EXPLICIT;
+		goto done;
+	}
+#endif
+
+#ifdef MADV_HUGEPAGE
+	if (thp_available())
+	{
+		// over-map by one huge page, then trim to a 2MB boundary 
+		// so the kernel can back the whole range with huge pages
+		uint8 *map;
+		size_t head;
+
+		map = (uint8 *)mmap(NULL, maplen + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (map != (uint8 *)MAP_FAILED)
+		{
+			head = (HUGE_PAGE_SIZE - ((size_t)map & (HUGE_PAGE_SIZE - 1))) & 
+				(HUGE_PAGE_SIZE - 1);
+			base = map + head;
+			if (head > 0)
+				munmap(map, head);
+			munmap(base + maplen, HUGE_PAGE_SIZE - head);
+			madvise(base, maplen, MADV_HUGEPAGE);
+			*kind = HUGE_PAGE_THP;
+			goto done;
+		}
+	}
+#endif
+
+#elif defined(_WIN32)
+	{
+		// needs the "lock pages in memory" privilege; without it 
+		// VirtualAlloc fails and we use ordinary pages
+		SIZE_T large = GetLargePageMinimum();
+
+		if (large > 0)
+		{
+			maplen = (len + HUGE_HDR_SIZE + large - 1) & ~((size_t)large - 1);
+			base = (uint8 *)VirtualAlloc(NULL, maplen, 
+				MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+			if (base != NULL)
+			{
+				*kind = HUGE_PAGE_EXPLICIT;
+				goto done;
+			}
+		}
+	}
+#endif
+
+fallback:
+	maplen = len + HUGE_HDR_SIZE;
+	base = (uint8 *)xmalloc_align(maplen);
+	if (base == NULL)
+	{
+		printf("failed to allocate %" PRIu64 " bytes\n", (uint64)maplen);
+		exit(-1);
+	}
+	*kind = HUGE_PAGE_NONE;
+
+done:
+	hdr = (huge_hdr_t *)base;
+	hdr->base = base;
+	hdr->len = maplen;
+	hdr->kind = *kind;
+	return base + HUGE_HDR_SIZE;
+}
+
+void huge_free(void *ptr)
+{
+	huge_hdr_t *hdr;
+
+	if (ptr == NULL)
+		return;
+
+	hdr = (huge_hdr_t *)((uint8 *)ptr - HUGE_HDR_SIZE);
+
+	if (hdr->kind == HUGE_PAGE_NONE)
+	{
+		align_free(hdr->base);
+		return;
+	}
+
+#if defined(__linux__)
+	munmap(hdr->base, hdr->len);
+#elif defined(_WIN32)
+	VirtualFree(hdr->base, 0, MEM_RELEASE);
+#endif
+
+	return;
+}
+
 #ifdef _MSC_VER
 
 	/* Core aware timing on Windows, courtesy of Brian Gladman */
@@ -1182,6 +1343,8 @@ typedef union {
 			"movl %%esi, %%ebx   \n\t"		\
 			:"=a"(a), "=m"(b), "=c"(c), "=d"(d) 	\
 			:"0"(code1), "2"(code2) : "%esi")
+	#define XGETBV(code, a, d)				\
+		ASM_G volatile("xgetbv" : "=a"(a), "=d"(d) : "c"(code))
 
 #elif defined(GCC_ASM64X)
 	#define HAS_CPUID
@@ -1201,6 +1364,8 @@ typedef union {
 			"movq %%rsi, %%rbx   \n\t"		\
 			:"=a"(a), "=m"(b), "=c"(c), "=d"(d) 	\
 			:"0"(code1), "2"(code2) : "%rsi")
+	#define XGETBV(code, a, d)				\
+		ASM_G volatile("xgetbv" : "=a"(a), "=d"(d) : "c"(code))
 
 #elif defined(_MSC_VER)
 	#include <intrin.h>
@@ -1221,11 +1386,17 @@ typedef union {
 		c = _z[2]; \
 		d = _z[3]; \
 	}
+	#define XGETBV(code, a, d) \
+	{	uint64 _x = _xgetbv(code); \
+		a = (uint32)_x; \
+		d = (uint32)(_x >> 32); \
+	}
 
 #else
 
 #define CPUID(code, a, b, c, d)
 #define CPUID2(code1, code2, a,b,c,d)
+#define XGETBV(code, a, d)
 
 #endif
 
@@ -1560,6 +1731,7 @@ int extended_cpuid(char *idstr, int *cachelinesize, char *bSSE41Extensions,
     //char    bSSE41Extensions = 0;
     char    bSSE42Extensions = 0;
     char    bPOPCNT = 0;
+    char    bOSXSAVE = 0;
 
     char    bMultithreading = 0;
 
@@ -1648,6 +1820,7 @@ int extended_cpuid(char *idstr, int *cachelinesize, char *bSSE41Extensions,
             bSSE42Extensions = (CPUInfo[2] & 0x100000) || 0;
             bPOPCNT= (CPUInfo[2] & 0x800000) || 0;
 			*AVX = (CPUInfo[2] & 0x10000000) || 0;
+			bOSXSAVE = (CPUInfo[2] & 0x8000000) || 0;
             nFeatureInfo = CPUInfo[3];
             bMultithreading = (nFeatureInfo & (1 << 28)) || 0;
         }
@@ -1958,6 +2131,20 @@ int extended_cpuid(char *idstr, int *cachelinesize, char *bSSE41Extensions,
 	CPUID2(0x7,0,CPUInfo[0],CPUInfo[1],CPUInfo[2],CPUInfo[3]);
 
 	*AVX2 = (CPUInfo[1] & 0x20) || 0;
+
+	// the avx registers can only be used if the os saves them across
+	// context switches: it must have enabled xgetbv, and set both the
+	// sse and avx state bits in xcr0.
+	if (bOSXSAVE)
+	{
+		uint32 xcr0_lo = 0, xcr0_hi = 0;
+
+		XGETBV(0, xcr0_lo, xcr0_hi);
+		if ((xcr0_lo & 0x6) != 0x6)
+			*AVX = *AVX2 = 0;
+	}
+	else
+		*AVX = *AVX2 = 0;
 		
 	if ((*AVX2) && do_print)
 		printf("\n\n\tAVX2 Extensions\n");